@@ -55,6 +55,14 @@ AbstractBtMessage::AbstractBtMessage(uint8_t id, const std::string& name)
 
 AbstractBtMessage::~AbstractBtMessage() {}
 
+void AbstractBtMessage::resetState()
+{
+  sendingInProgress_ = false;
+  invalidate_ = false;
+  validator_.reset();
+  metadataGetMode_ = false;
+}
+
 void AbstractBtMessage::setPeer(const SharedHandle<Peer>& peer)
 {
   peer_ = peer;
@@ -181,6 +181,10 @@ public:
   {
     metadataGetMode_ = true;
   }
+
+  // Clears the flags and the validator so that a pooled message
+  // object can be used for another message. See BtMessagePool.
+  virtual void resetState();
 };
 
 typedef SharedHandle<AbstractBtMessage> AbstractBtMessageHandle;
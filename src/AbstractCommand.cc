@@ -193,14 +193,31 @@ bool AbstractCommand::execute() {
           size_t maxSegments = req_?req_->getMaxPipelinedRequest():1;
           size_t minSplitSize = calculateMinSplitSize();
           while(segments_.size() < maxSegments) {
-            SharedHandle<Segment> segment =
-              getSegmentMan()->getSegment(getCuid(), minSplitSize);
+            SharedHandle<Segment> segment;
+            if(!segments_.empty() && req_->isPipeliningEnabled()) {
+              // Prefer the contiguous segment so that HttpRequestCommand
+              // can merge the requests.
+              segment = getSegmentMan()->getCleanSegmentAfter
+                (getCuid(), segments_.back(), fileEntry_);
+            }
+            if(!segment) {
+              segment = getSegmentMan()->getSegment(getCuid(), minSplitSize);
+            }
             if(!segment) {
               break;
             } else {
               segments_.push_back(segment);
             }
           }
+          if(segments_.empty()) {
+            // Near the end of download, take over a part of the
+            // range left to the slowest connection.
+            SharedHandle<Segment> segment =
+              getSegmentMan()->stealSegment(getCuid());
+            if(segment) {
+              segments_.push_back(segment);
+            }
+          }
           if(segments_.empty()) {
             // TODO socket could be pooled here if pipelining is
             // enabled...  Hmm, I don't think if pipelining is enabled
@@ -220,9 +237,30 @@ bool AbstractCommand::execute() {
           // For multi-file downloads
           size_t minSplitSize = calculateMinSplitSize();
           size_t maxSegments = req_->getMaxPipelinedRequest();
-          if(segments_.size() < maxSegments) {
+          while(segments_.size() < maxSegments) {
+            SharedHandle<Segment> segment;
+            if(!segments_.empty() && req_->isPipeliningEnabled()) {
+              segment = getSegmentMan()->getCleanSegmentAfter
+                (getCuid(), segments_.back(), fileEntry_);
+            }
+            if(segment) {
+              segments_.push_back(segment);
+              continue;
+            }
+            size_t numSegments = segments_.size();
             getSegmentMan()->getSegment
-              (segments_, getCuid(), minSplitSize, fileEntry_, maxSegments);
+              (segments_, getCuid(), minSplitSize, fileEntry_,
+               numSegments+1);
+            if(segments_.size() == numSegments) {
+              break;
+            }
+          }
+          if(segments_.empty()) {
+            SharedHandle<Segment> segment =
+              getSegmentMan()->stealSegment(getCuid(), fileEntry_);
+            if(segment) {
+              segments_.push_back(segment);
+            }
           }
           if(segments_.empty()) {
             return prepareForRetry(0);
@@ -128,12 +128,23 @@ void AbstractDiskWriter::createFile(int addFlags)
   }  
 }
 
-ssize_t AbstractDiskWriter::writeDataInternal(const unsigned char* data, size_t len)
+ssize_t AbstractDiskWriter::writeDataInternal
+(const unsigned char* data, size_t len, off_t offset)
 {
+#ifndef HAVE_PWRITE
+  seek(offset);
+#endif // !HAVE_PWRITE
   ssize_t writtenLength = 0;
   while((size_t)writtenLength < len) {
     ssize_t ret = 0;
-    while((ret = write(fd_, data+writtenLength, len-writtenLength)) == -1 && errno == EINTR);
+#ifdef HAVE_PWRITE
+    // pwrite() saves lseek() call per write.
+    while((ret = pwrite(fd_, data+writtenLength, len-writtenLength,
+                        offset+writtenLength)) == -1 && errno == EINTR);
+#else // !HAVE_PWRITE
+    while((ret = write(fd_, data+writtenLength, len-writtenLength)) == -1 &&
+          errno == EINTR);
+#endif // !HAVE_PWRITE
     if(ret == -1) {
       return -1;
     }
@@ -142,10 +153,16 @@ ssize_t AbstractDiskWriter::writeDataInternal(const unsigned char* data, size_t
   return writtenLength;
 }
 
-ssize_t AbstractDiskWriter::readDataInternal(unsigned char* data, size_t len)
+ssize_t AbstractDiskWriter::readDataInternal
+(unsigned char* data, size_t len, off_t offset)
 {
   ssize_t ret = 0;
+#ifdef HAVE_PREAD
+  while((ret = pread(fd_, data, len, offset)) == -1 && errno == EINTR);
+#else // !HAVE_PREAD
+  seek(offset);
   while((ret = read(fd_, data, len)) == -1 && errno == EINTR);
+#endif // !HAVE_PREAD
   return ret;
 }
 
@@ -162,8 +179,7 @@ void AbstractDiskWriter::seek(off_t offset)
 
 void AbstractDiskWriter::writeData(const unsigned char* data, size_t len, off_t offset)
 {
-  seek(offset);
-  if(writeDataInternal(data, len) < 0) {
+  if(writeDataInternal(data, len, offset) < 0) {
     int errNum = errno;
     // If errno is ENOSPC(not enough space in device), throw
     // DownloadFailureException and abort download instantly.
@@ -188,8 +204,7 @@ void AbstractDiskWriter::writeData(const unsigned char* data, size_t len, off_t
 ssize_t AbstractDiskWriter::readData(unsigned char* data, size_t len, off_t offset)
 {
   ssize_t ret;
-  seek(offset);
-  if((ret = readDataInternal(data, len)) < 0) {
+  if((ret = readDataInternal(data, len, offset)) < 0) {
     int errNum = errno;
     throw DL_ABORT_EX3
       (errNum,
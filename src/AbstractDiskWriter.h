@@ -49,8 +49,9 @@ private:
 
   bool directIOAllowed_;
 
-  ssize_t writeDataInternal(const unsigned char* data, size_t len);
-  ssize_t readDataInternal(unsigned char* data, size_t len);
+  ssize_t writeDataInternal(const unsigned char* data, size_t len,
+                            off_t offset);
+  ssize_t readDataInternal(unsigned char* data, size_t len, off_t offset);
 
   void seek(off_t offset);
 protected:
@@ -85,6 +86,8 @@ public:
   virtual void enableReadOnly();
 
   virtual void disableReadOnly();
+
+  virtual int getFd() const { return fd_; }
 };
 
 } // namespace aria2
@@ -80,6 +80,13 @@ ssize_t AbstractSingleDiskAdaptor::readData
   return diskWriter_->readData(data, len, offset);
 }
 
+int AbstractSingleDiskAdaptor::getFdForRead
+(off_t& fileOffset, off_t offset, size_t len)
+{
+  fileOffset = offset;
+  return diskWriter_->getFd();
+}
+
 bool AbstractSingleDiskAdaptor::fileExists()
 {
   return File(getFilePath()).exists();
@@ -152,18 +152,14 @@ bool BitfieldMan::hasMissingPiece
   if(bitfieldLength_ != length) {
     return false;
   }
-  bool retval = false;
-  for(size_t i = 0; i < bitfieldLength_; ++i) {
-    unsigned char temp = peerBitfield[i] & ~bitfield_[i];
-    if(filterEnabled_) {
-      temp &= filterBitfield_[i];
-    }
-    if(temp&0xffu) {
-      retval = true;
-      break;
-    }
+  if(filterEnabled_) {
+    return bitfield::findFirstSet
+      (array(peerBitfield)&~array(bitfield_)&array(filterBitfield_),
+       0, blocks_) != blocks_;
+  } else {
+    return bitfield::findFirstSet
+      (array(peerBitfield)&~array(bitfield_), 0, blocks_) != blocks_;
   }
-  return retval;
 }
 
 bool BitfieldMan::getFirstMissingUnusedIndex(size_t& index) const
@@ -205,24 +201,20 @@ bool BitfieldMan::getFirstMissingIndex(size_t& index) const
 namespace {
 template<typename Array>
 size_t getStartIndex(size_t index, const Array& bitfield, size_t blocks) {
-  while(index < blocks && bitfield::test(bitfield, blocks, index)) {
-    ++index;
-  }
   if(blocks <= index) {
     return blocks;
-  } else {
-    return index;
   }
+  return bitfield::findFirstSet(~bitfield, index, blocks);
 }
 } // namespace
 
 namespace {
 template<typename Array>
 size_t getEndIndex(size_t index, const Array& bitfield, size_t blocks) {
-  while(index < blocks && !bitfield::test(bitfield, blocks, index)) {
-    ++index;
+  if(blocks <= index) {
+    return index;
   }
-  return index;
+  return bitfield::findFirstSet(bitfield, index, blocks);
 }
 } // namespace
 
@@ -313,15 +305,22 @@ namespace {
 template<typename Array>
 bool copyBitfield(unsigned char* dst, const Array& src, size_t blocks)
 {
+  uint64_t wbits = 0;
+  const size_t len = (blocks+7)/8;
+  const size_t nwords = (len-1)/sizeof(uint64_t);
+  for(size_t i = 0; i < nwords; ++i) {
+    uint64_t w = bitfield::loadWord(src, i);
+    memcpy(dst+i*sizeof(w), &w, sizeof(w));
+    wbits |= w;
+  }
   unsigned char bits = 0;
-  size_t len = (blocks+7)/8;
-  for(size_t i = 0; i < len-1; ++i) {
+  for(size_t i = nwords*sizeof(uint64_t); i < len-1; ++i) {
     dst[i] = src[i];
     bits |= dst[i];
   }
   dst[len-1] = src[len-1]&bitfield::lastByteMask(blocks);
   bits |= dst[len-1];
-  return bits != 0;
+  return wbits != 0 || bits != 0;
 }
 } // namespace
 
@@ -386,13 +385,8 @@ size_t BitfieldMan::countMissingBlock() const {
 
 size_t BitfieldMan::countMissingBlockNow() const {
   if(filterEnabled_) {
-    array_ptr<unsigned char> temp(new unsigned char[bitfieldLength_]);
-    for(size_t i = 0; i < bitfieldLength_; ++i) {
-      temp[i] = bitfield_[i]&filterBitfield_[i];
-    }
-    size_t count =  bitfield::countSetBit(filterBitfield_, blocks_)-
-      bitfield::countSetBit(temp, blocks_);
-    return count;
+    return bitfield::countSetBit
+      (~array(bitfield_)&array(filterBitfield_), blocks_);
   } else {
     return blocks_-bitfield::countSetBit(bitfield_, blocks_);
   }
@@ -439,12 +433,8 @@ bool BitfieldMan::unsetBit(size_t index) {
 
 bool BitfieldMan::isFilteredAllBitSet() const {
   if(filterEnabled_) {
-    for(size_t i = 0; i < bitfieldLength_; ++i) {
-      if((bitfield_[i]&filterBitfield_[i]) != filterBitfield_[i]) {
-        return false;
-      }
-    }
-    return true;
+    return bitfield::findFirstSet
+      (~array(bitfield_)&array(filterBitfield_), 0, blocks_) == blocks_;
   } else {
     return isAllBitSet();
   }
@@ -457,10 +447,8 @@ bool testAllBitSet
   if(length == 0) {
     return true;
   }
-  for(size_t i = 0; i < length-1; ++i) {
-    if(bitfield[i] != 0xffu) {
-      return false;
-    }
+  if(bitfield::findFirstSet(~array(bitfield), 0, blocks) != blocks) {
+    return false;
   }
   return bitfield[length-1] == bitfield::lastByteMask(blocks);
 }
@@ -504,8 +492,9 @@ void BitfieldMan::clearAllBit() {
 }
 
 void BitfieldMan::setAllBit() {
-  for(size_t i = 0; i < blocks_; ++i) {
-    setBitInternal(bitfield_, i, true);
+  if(bitfieldLength_ > 0) {
+    memset(bitfield_, 0xff, bitfieldLength_-1);
+    bitfield_[bitfieldLength_-1] = bitfield::lastByteMask(blocks_);
   }
   updateCache();
 }
@@ -516,8 +505,9 @@ void BitfieldMan::clearAllUseBit() {
 }
 
 void BitfieldMan::setAllUseBit() {
-  for(size_t i = 0; i < blocks_; ++i) {
-    setBitInternal(useBitfield_, i, true);
+  if(bitfieldLength_ > 0) {
+    memset(useBitfield_, 0xff, bitfieldLength_-1);
+    useBitfield_[bitfieldLength_-1] = bitfield::lastByteMask(blocks_);
   }
 }
 
@@ -611,34 +601,32 @@ uint64_t BitfieldMan::getFilteredTotalLengthNow() const {
   }
 }
 
-uint64_t BitfieldMan::getCompletedLength(bool useFilter) const {
-  unsigned char* temp;
-  if(useFilter) {
-    temp = new unsigned char[bitfieldLength_];
-    for(size_t i = 0; i < bitfieldLength_; ++i) {
-      temp[i] = bitfield_[i];
-      if(filterEnabled_) {
-        temp[i] &= filterBitfield_[i];
-      }
-    }
-  } else {
-    temp = bitfield_;
-  }
-  size_t completedBlocks = bitfield::countSetBit(temp, blocks_);
-  uint64_t completedLength = 0;
+namespace {
+template<typename Array>
+uint64_t computeCompletedLength
+(const Array& bitfield, size_t blocks, size_t blockLength,
+ size_t lastBlockLength)
+{
+  size_t completedBlocks = bitfield::countSetBit(bitfield, blocks);
   if(completedBlocks == 0) {
-    completedLength = 0;
+    return 0;
+  } else if(bitfield::test(bitfield, blocks, blocks-1)) {
+    return ((uint64_t)completedBlocks-1)*blockLength+lastBlockLength;
   } else {
-    if(bitfield::test(temp, blocks_, blocks_-1)) {
-      completedLength = ((uint64_t)completedBlocks-1)*blockLength_+getLastBlockLength();
-    } else {
-      completedLength = ((uint64_t)completedBlocks)*blockLength_;
-    }
+    return ((uint64_t)completedBlocks)*blockLength;
   }
-  if(useFilter) {
-    delete [] temp;
+}
+} // namespace
+
+uint64_t BitfieldMan::getCompletedLength(bool useFilter) const {
+  if(useFilter && filterEnabled_) {
+    return computeCompletedLength
+      (array(bitfield_)&array(filterBitfield_), blocks_, blockLength_,
+       getLastBlockLength());
+  } else {
+    return computeCompletedLength
+      (array(bitfield_), blocks_, blockLength_, getLastBlockLength());
   }
-  return completedLength;
 }
 
 uint64_t BitfieldMan::getCompletedLengthNow() const {
@@ -660,18 +648,18 @@ void BitfieldMan::updateCache()
 
 bool BitfieldMan::isBitRangeSet(size_t startIndex, size_t endIndex) const
 {
-  for(size_t i =  startIndex; i <= endIndex; ++i) {
-    if(!isBitSet(i)) {
-      return false;
-    }
+  if(endIndex < startIndex) {
+    return true;
   }
-  return true;
+  assert(endIndex < blocks_);
+  return bitfield::findFirstSet(~array(bitfield_), startIndex, endIndex+1) ==
+    endIndex+1;
 }
 
 void BitfieldMan::unsetBitRange(size_t startIndex, size_t endIndex)
 {
   for(size_t i = startIndex; i <= endIndex; ++i) {
-    unsetBit(i);
+    setBitInternal(bitfield_, i, false);
   }
   updateCache();
 }
@@ -679,7 +667,7 @@ void BitfieldMan::unsetBitRange(size_t startIndex, size_t endIndex)
 void BitfieldMan::setBitRange(size_t startIndex, size_t endIndex)
 {
   for(size_t i = startIndex; i <= endIndex; ++i) {
-    setBit(i);
+    setBitInternal(bitfield_, i, true);
   }
   updateCache();
 }
@@ -697,12 +685,7 @@ bool BitfieldMan::isBitSetOffsetRange(uint64_t offset, uint64_t length) const
   }
   size_t startBlock = offset/blockLength_;
   size_t endBlock = (offset+length-1)/blockLength_;
-  for(size_t i = startBlock; i <= endBlock; i++) {
-    if(!isBitSet(i)) {
-      return false;
-    }
-  }
-  return true;
+  return isBitRangeSet(startBlock, endBlock);
 }
 
 uint64_t BitfieldMan::getMissingUnusedLength(size_t startingIndex) const
@@ -710,14 +693,14 @@ uint64_t BitfieldMan::getMissingUnusedLength(size_t startingIndex) const
   if(startingIndex < 0 || blocks_ <= startingIndex) {
     return 0;
   }
-  uint64_t length = 0;
-  for(size_t i = startingIndex; i < blocks_; ++i) {
-    if(isBitSet(i) || isUseBitSet(i)) {
-      break;
-    }
-    length += getBlockLength(i);
+  size_t endIndex = bitfield::findFirstSet
+    (array(bitfield_)|array(useBitfield_), startingIndex, blocks_);
+  if(endIndex == blocks_) {
+    return (uint64_t)(blocks_-1-startingIndex)*blockLength_+
+      getLastBlockLength();
+  } else {
+    return (uint64_t)(endIndex-startingIndex)*blockLength_;
   }
-  return length;
 }
 
 BitfieldMan::Range::Range(size_t startIndex, size_t endIndex)
@@ -44,6 +44,8 @@
 
 namespace aria2 {
 
+struct UDPTrackerRequest;
+
 class BtAnnounce {
 public:
   virtual ~BtAnnounce() {}
@@ -97,6 +99,22 @@ public:
   virtual void processAnnounceResponse(const unsigned char* trackerResponse,
                                        size_t trackerResponseLength) = 0;
 
+  /**
+   * Creates UDP tracker announce request for the tracker at
+   * remoteAddr:remotePort. remoteAddr may be a host name. Call
+   * getAnnounceUrl() first to decide the event. Returns null if
+   * announce is not ready.
+   */
+  virtual SharedHandle<UDPTrackerRequest>
+  createUDPTrackerRequest(const std::string& remoteAddr,
+                          uint16_t remotePort) = 0;
+
+  /**
+   * Processes the reply of UDP tracker announce request.
+   */
+  virtual void processUDPTrackerResponse
+  (const SharedHandle<UDPTrackerRequest>& req) = 0;
+
   /**
    * Returns true if no more announce is needed.
    */
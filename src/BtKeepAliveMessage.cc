@@ -40,14 +40,20 @@ namespace aria2 {
 const std::string BtKeepAliveMessage::NAME("keep alive");
 
 unsigned char* BtKeepAliveMessage::createMessage()
+{
+  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
+  writeMessage(msg);
+  return msg;
+}
+
+bool BtKeepAliveMessage::writeMessage(unsigned char* msg)
 {
   /**
    * len --- 0, 4bytes
    * total: 4bytes
    */
-  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
   memset(msg, 0, MESSAGE_LENGTH);
-  return msg;
+  return true;
 }
 
 size_t BtKeepAliveMessage::getMessageLength()
@@ -0,0 +1,85 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_BT_MESSAGE_POOL_H
+#define D_BT_MESSAGE_POOL_H
+
+#include "common.h"
+
+#include <vector>
+
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+// Keeps up to capacity message objects of type T and hands out the
+// ones which nobody else refers to anymore, so that frequently
+// created messages are not allocated each time.  T must be default
+// constructible and derive from AbstractBtMessage.
+template<typename T>
+class BtMessagePool {
+private:
+  std::vector<SharedHandle<T> > messages_;
+public:
+  BtMessagePool(size_t capacity):messages_(capacity) {}
+
+  // Returns a message object with its state cleared. If all pooled
+  // objects are in use, returns a newly allocated object, which is
+  // not pooled. The first free object is returned, so that received
+  // messages, which are released immediately, keep reusing the same
+  // few objects.
+  SharedHandle<T> get()
+  {
+    for(size_t i = 0, len = messages_.size(); i < len; ++i) {
+      SharedHandle<T>& m = messages_[i];
+      if(!m) {
+        m.reset(new T());
+        return m;
+      } else if(m.getRefCount() == 1) {
+        m->resetState();
+        return m;
+      }
+    }
+    return SharedHandle<T>(new T());
+  }
+
+  size_t getCapacity() const
+  {
+    return messages_.size();
+  }
+};
+
+} // namespace aria2
+
+#endif // D_BT_MESSAGE_POOL_H
@@ -53,8 +53,10 @@
 #include "BtMessageFactory.h"
 #include "BtRequestFactory.h"
 #include "PeerConnection.h"
+#include "SocketBuffer.h"
 #include "fmt.h"
 #include "DownloadContext.h"
+#include "RequestGroup.h"
 
 namespace aria2 {
 
@@ -66,34 +68,34 @@ BtPieceMessage::BtPieceMessage
     index_(index),
     begin_(begin),
     blockLength_(blockLength),
-    block_(0),
-    rawData_(0)
+    block_(0)
 {
   setUploading(true);
 }
 
-BtPieceMessage::~BtPieceMessage()
-{
-  delete [] rawData_;
-}
+BtPieceMessage::~BtPieceMessage() {}
 
-void BtPieceMessage::setRawMessage(unsigned char* data)
+BtPieceMessageHandle BtPieceMessage::create
+(const unsigned char* data, size_t dataLength)
 {
-  delete [] rawData_;
-  rawData_ = data;
-  block_ = data+9;
+  BtPieceMessageHandle message(new BtPieceMessage());
+  message->parse(data, dataLength);
+  return message;
 }
 
-BtPieceMessageHandle BtPieceMessage::create
-(const unsigned char* data, size_t dataLength)
+void BtPieceMessage::parse(const unsigned char* data, size_t dataLength)
 {
   bittorrent::assertPayloadLengthGreater(9, dataLength, NAME);
   bittorrent::assertID(ID, data, NAME);
-  BtPieceMessageHandle message(new BtPieceMessage());
-  message->setIndex(bittorrent::getIntParam(data, 1));
-  message->setBegin(bittorrent::getIntParam(data, 5));
-  message->setBlockLength(dataLength-9);
-  return message;
+  index_ = bittorrent::getIntParam(data, 1);
+  begin_ = bittorrent::getIntParam(data, 5);
+  blockLength_ = dataLength-9;
+}
+
+void BtPieceMessage::resetState()
+{
+  AbstractBtMessage::resetState();
+  block_ = 0;
 }
 
 void BtPieceMessage::doReceivedAction()
@@ -104,6 +106,10 @@ void BtPieceMessage::doReceivedAction()
   RequestSlot slot = getBtMessageDispatcher()->getOutstandingRequest
     (index_, begin_, blockLength_);
   getPeer()->updateDownloadLength(blockLength_);
+  if(downloadContext_->getOwnerRequestGroup()) {
+    downloadContext_->getOwnerRequestGroup()->updateDownloadLength
+      (blockLength_);
+  }
   if(!RequestSlot::isNull(slot)) {
     getPeer()->snubbing(false);
     SharedHandle<Piece> piece = getPieceStorage()->getPiece(index_);
@@ -115,8 +121,14 @@ void BtPieceMessage::doReceivedAction()
                      blockLength_,
                      static_cast<long long int>(offset),
                      static_cast<unsigned long>(slot.getBlockIndex())));
-    getPieceStorage()->getDiskAdaptor()->writeData
-      (block_, blockLength_, offset);
+    if(piece->getWrDiskCacheEntry()) {
+      // Write Disk Cache enabled.
+      piece->updateWrCache(getPieceStorage()->getWrDiskCache(),
+                           block_, blockLength_, offset);
+    } else {
+      getPieceStorage()->getDiskAdaptor()->writeData
+        (block_, blockLength_, offset);
+    }
     piece->completeBlock(slot.getBlockIndex());
     A2_LOG_DEBUG(fmt(MSG_PIECE_BITFIELD, getCuid(),
                      util::toHex(piece->getBitfield(),
@@ -142,6 +154,13 @@ void BtPieceMessage::doReceivedAction()
 size_t BtPieceMessage::MESSAGE_HEADER_LENGTH = 13;
 
 unsigned char* BtPieceMessage::createMessageHeader()
+{
+  unsigned char* msgHeader = new unsigned char[MESSAGE_HEADER_LENGTH];
+  writeMessageHeader(msgHeader);
+  return msgHeader;
+}
+
+void BtPieceMessage::writeMessageHeader(unsigned char* msgHeader)
 {
   /**
    * len --- 9+blockLength, 4bytes
@@ -150,12 +169,10 @@ unsigned char* BtPieceMessage::createMessageHeader()
    * begin --- begin, 4bytes
    * total: 13bytes
    */
-  unsigned char* msgHeader = new unsigned char[MESSAGE_HEADER_LENGTH];
   bittorrent::createPeerMessageString(msgHeader, MESSAGE_HEADER_LENGTH,
                                       9+blockLength_, ID);
   bittorrent::setIntParam(&msgHeader[5], index_);
   bittorrent::setIntParam(&msgHeader[9], begin_);
-  return msgHeader;
 }
 
 size_t BtPieceMessage::getMessageHeaderLength()
@@ -175,23 +192,32 @@ void BtPieceMessage::send()
                     getPeer()->getIPAddress().c_str(),
                     getPeer()->getPort(),
                     toString().c_str()));
-    unsigned char* msgHdr = createMessageHeader();
+    unsigned char msgHdr[SocketBuffer::INLINE_BUF_SIZE];
+    writeMessageHeader(msgHdr);
     size_t msgHdrLen = getMessageHeaderLength();
     A2_LOG_DEBUG(fmt("msglength = %lu bytes",
                      static_cast<unsigned long>(msgHdrLen+blockLength_)));
-    getPeerConnection()->pushBytes(msgHdr, msgHdrLen);
+    getPeerConnection()->pushInlineBytes(msgHdr, msgHdrLen);
     off_t pieceDataOffset =
       (off_t)index_*downloadContext_->getPieceLength()+begin_;
     pushPieceData(pieceDataOffset, blockLength_);
   }
   writtenLength = getPeerConnection()->sendPendingData();
   getPeer()->updateUploadLength(writtenLength);
+  if(downloadContext_->getOwnerRequestGroup()) {
+    downloadContext_->getOwnerRequestGroup()->updateUploadLength
+      (writtenLength);
+  }
   setSendingInProgress(!getPeerConnection()->sendBufferIsEmpty());
 }
 
 void BtPieceMessage::pushPieceData(off_t offset, size_t length) const
 {
   assert(length <= 16*1024);
+  if(getPeerConnection()->pushFileData
+     (getPieceStorage()->getDiskAdaptor(), offset, length)) {
+    return;
+  }
   unsigned char* buf = new unsigned char[length];
   ssize_t r;
   try {
@@ -220,6 +246,12 @@ bool BtPieceMessage::checkPieceHash(const SharedHandle<Piece>& piece)
                      static_cast<unsigned long>(piece->getIndex())));
     return
       piece->getHashString()==downloadContext_->getPieceHash(piece->getIndex());
+  } else if(piece->getWrDiskCacheEntry()) {
+    // Cached data is hashed without reading it back from disk.
+    return piece->getHashStringWithWrCache
+      (downloadContext_->getPieceLength(),
+       getPieceStorage()->getDiskAdaptor())
+      == downloadContext_->getPieceHash(piece->getIndex());
   } else {
     off_t offset = (off_t)piece->getIndex()*downloadContext_->getPieceLength();
     
@@ -243,6 +275,9 @@ void BtPieceMessage::onWrongPiece(const SharedHandle<Piece>& piece)
   A2_LOG_INFO(fmt(MSG_GOT_WRONG_PIECE,
                   getCuid(),
                   static_cast<unsigned long>(piece->getIndex())));
+  if(piece->getWrDiskCacheEntry()) {
+    piece->clearWrCache(getPieceStorage()->getWrDiskCache());
+  }
   erasePieceOnDisk(piece);
   piece->clearAllBlock();
   piece->destroyHashContext();
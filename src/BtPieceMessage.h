@@ -50,8 +50,7 @@ private:
   size_t index_;
   uint32_t begin_;
   uint32_t blockLength_;
-  unsigned char* block_;
-  unsigned char* rawData_;
+  const unsigned char* block_;
   SharedHandle<DownloadContext> downloadContext_;
 
   static size_t MESSAGE_HEADER_LENGTH;
@@ -86,10 +85,10 @@ public:
 
   size_t getBlockLength() const { return blockLength_; }
 
-  // Stores raw message data. After this function call, this object
-  // has ownership of data. Caller must not be free or alter data.
-  // Member block is pointed to block starting position in data.
-  void setRawMessage(unsigned char* data);
+  // Sets the received block. block is not copied, so it must be
+  // valid until doReceivedAction() is called. Usually it points to
+  // the receive buffer of PeerConnection.
+  void setBlock(const unsigned char* block) { block_ = block; }
 
   void setBlockLength(size_t blockLength) { blockLength_ = blockLength; }
 
@@ -98,10 +97,21 @@ public:
   static BtPieceMessageHandle create
   (const unsigned char* data, size_t dataLength);
 
+  // Sets the index, begin and block length from the payload
+  // data. Throws DlAbortEx if data is not a piece message.
+  void parse(const unsigned char* data, size_t dataLength);
+
   virtual void doReceivedAction();
 
+  // Also clears the block.
+  virtual void resetState();
+
   unsigned char* createMessageHeader();
 
+  // Writes the message header into msgHeader, which must have room
+  // for getMessageHeaderLength() bytes.
+  void writeMessageHeader(unsigned char* msgHeader);
+
   size_t getMessageHeaderLength();
 
   virtual void send();
@@ -100,6 +100,13 @@ void BtPortMessage::doReceivedAction()
 }
 
 unsigned char* BtPortMessage::createMessage()
+{
+  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
+  writeMessage(msg);
+  return msg;
+}
+
+bool BtPortMessage::writeMessage(unsigned char* msg)
 {
   /**
    * len --- 5, 4bytes
@@ -107,10 +114,9 @@ unsigned char* BtPortMessage::createMessage()
    * port --- port number, 2bytes
    * total: 7bytes
    */
-  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
   bittorrent::createPeerMessageString(msg, MESSAGE_LENGTH, 3, ID);
   bittorrent::setShortIntParam(&msg[5], port_);
-  return msg;
+  return true;
 }
 
 size_t BtPortMessage::getMessageLength() {
@@ -72,6 +72,8 @@ public:
 
   virtual unsigned char* createMessage();
 
+  virtual bool writeMessage(unsigned char* msg);
+
   virtual size_t getMessageLength();
 
   virtual std::string toString() const;
@@ -41,9 +41,14 @@
 #include "BtRuntime.h"
 #include "BtProgressInfoFile.h"
 #include "bittorrent_helper.h"
+#include "UDPTrackerClient.h"
 
 namespace aria2 {
 
+BtRegistry::BtRegistry() {}
+
+BtRegistry::~BtRegistry() {}
+
 SharedHandle<DownloadContext>
 BtRegistry::getDownloadContext(gid_t gid) const
 {
@@ -89,6 +94,12 @@ void BtRegistry::removeAll() {
   pool_.clear();
 }
 
+void BtRegistry::setUDPTrackerClient
+(const SharedHandle<UDPTrackerClient>& client)
+{
+  udpTrackerClient_ = client;
+}
+
 BtObject::BtObject
 (const SharedHandle<DownloadContext>& downloadContext,
  const SharedHandle<PieceStorage>& pieceStorage,
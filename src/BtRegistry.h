@@ -50,6 +50,7 @@ class BtAnnounce;
 class BtRuntime;
 class BtProgressInfoFile;
 class DownloadContext;
+class UDPTrackerClient;
 
 struct BtObject {
   SharedHandle<DownloadContext> downloadContext_;
@@ -80,7 +81,11 @@ struct BtObject {
 class BtRegistry {
 private:
   std::map<gid_t, BtObject> pool_;
+  SharedHandle<UDPTrackerClient> udpTrackerClient_;
 public:
+  BtRegistry();
+  ~BtRegistry();
+
   SharedHandle<DownloadContext>
   getDownloadContext(gid_t gid) const;
 
@@ -104,6 +109,13 @@ public:
   void removeAll();
 
   bool remove(gid_t gid);
+
+  // UDPTrackerClient shared among all torrents.
+  void setUDPTrackerClient(const SharedHandle<UDPTrackerClient>& client);
+  const SharedHandle<UDPTrackerClient>& getUDPTrackerClient() const
+  {
+    return udpTrackerClient_;
+  }
 };
 
 } // namespace aria2
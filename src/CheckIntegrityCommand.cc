@@ -53,19 +53,43 @@ CheckIntegrityCommand::CheckIntegrityCommand
  const SharedHandle<CheckIntegrityEntry>& entry):
   RealtimeCommand(cuid, requestGroup, e),
   entry_(entry)
+#ifdef HAVE_PTHREAD
+  , wakeupFd_(-1)
+#endif // HAVE_PTHREAD
 {}
 
-CheckIntegrityCommand::~CheckIntegrityCommand() {}
+CheckIntegrityCommand::~CheckIntegrityCommand()
+{
+#ifdef HAVE_PTHREAD
+  if(wakeupFd_ != -1) {
+    getDownloadEngine()->deleteFdForReadCheck(wakeupFd_, this);
+  }
+#endif // HAVE_PTHREAD
+}
 
 bool CheckIntegrityCommand::executeInternal()
 {
   if(getRequestGroup()->isHaltRequested()) {
-    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry();
+    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry(entry_);
     return true;
   }
+#ifdef HAVE_PTHREAD
+  if(wakeupFd_ == -1 && entry_->isAsync()) {
+    wakeupFd_ = entry_->getWakeupFd();
+    getDownloadEngine()->addFdForReadCheck(wakeupFd_, this);
+  }
+#endif // HAVE_PTHREAD
   entry_->validateChunk();
   if(entry_->finished()) {
-    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry();
+#ifdef HAVE_PTHREAD
+    // The validator has closed the wakeup fd. Remove it before the
+    // fd number is reused.
+    if(wakeupFd_ != -1) {
+      getDownloadEngine()->deleteFdForReadCheck(wakeupFd_, this);
+      wakeupFd_ = -1;
+    }
+#endif // HAVE_PTHREAD
+    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry(entry_);
     // Enable control file saving here. See also
     // RequestGroup::processCheckIntegrityEntry() to know why this is
     // needed.
@@ -92,6 +116,12 @@ bool CheckIntegrityCommand::executeInternal()
     getDownloadEngine()->setNoWait(true);
     return true;
   } else {
+#ifdef HAVE_PTHREAD
+    if(wakeupFd_ != -1) {
+      // Sleep until worker threads post results.
+      setStatusInactive();
+    }
+#endif // HAVE_PTHREAD
     getDownloadEngine()->addCommand(this);
     return false;
   }
@@ -99,7 +129,7 @@ bool CheckIntegrityCommand::executeInternal()
 
 bool CheckIntegrityCommand::handleException(Exception& e)
 {
-  getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry();
+  getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry(entry_);
   A2_LOG_ERROR_EX(fmt(MSG_FILE_VALIDATION_FAILURE,
                    getCuid()),
                   e);
@@ -45,6 +45,10 @@ class CheckIntegrityEntry;
 class CheckIntegrityCommand : public RealtimeCommand {
 private:
   SharedHandle<CheckIntegrityEntry> entry_;
+#ifdef HAVE_PTHREAD
+  // The wakeup fd of entry_ registered to DownloadEngine, or -1.
+  int wakeupFd_;
+#endif // HAVE_PTHREAD
 public:
   CheckIntegrityCommand(cuid_t cuid,
                         RequestGroup* requestGroup,
@@ -79,6 +79,16 @@ bool CheckIntegrityEntry::finished()
   return validator_->finished();
 }
 
+bool CheckIntegrityEntry::isAsync() const
+{
+  return validator_ && validator_->isAsync();
+}
+
+int CheckIntegrityEntry::getWakeupFd() const
+{
+  return validator_ ? validator_->getWakeupFd() : -1;
+}
+
 void CheckIntegrityEntry::cutTrailingGarbage()
 {
   getRequestGroup()->getPieceStorage()->getDiskAdaptor()->cutTrailingGarbage();
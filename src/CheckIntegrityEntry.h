@@ -69,6 +69,12 @@ public:
 
   virtual bool finished();
 
+  // Returns true if validator is running in other threads.
+  bool isAsync() const;
+
+  // See IteratableValidator::getWakeupFd().
+  int getWakeupFd() const;
+
   virtual bool isValidationReady() = 0;
 
   virtual void initValidator() = 0;
@@ -34,7 +34,8 @@
 /* copyright --> */
 #include "ChunkedDecodingStreamFilter.h"
 
-#include <cassert>
+#include <cstring>
+#include <algorithm>
 
 #include "util.h"
 #include "message.h"
@@ -79,26 +80,34 @@ ChunkedDecodingStreamFilter::~ChunkedDecodingStreamFilter() {}
 
 void ChunkedDecodingStreamFilter::init() {}
 
+bool ChunkedDecodingStreamFilter::readLine
+(size_t& inbufOffset, const unsigned char* inbuf, size_t inlen)
+{
+  const unsigned char* first = inbuf+inbufOffset;
+  const unsigned char* lf = reinterpret_cast<const unsigned char*>
+    (memchr(first, '\n', inlen-inbufOffset));
+  const unsigned char* last = lf ? lf+1 : inbuf+inlen;
+  if(buf_.size()+(last-first) > MAX_BUF_SIZE) {
+    throw DL_ABORT_EX("Could not find end of line before buffer got full.");
+  }
+  // Only the bytes of this line are copied; the rest of inbuf is
+  // left for the next state.
+  buf_.append(first, last);
+  inbufOffset += last-first;
+  return lf && util::endsWith(buf_, A2STR::CRLF);
+}
+
 bool ChunkedDecodingStreamFilter::readChunkSize
 (size_t& inbufOffset, const unsigned char* inbuf, size_t inlen)
 {
-  size_t pbufSize = buf_.size();
-  buf_.append(&inbuf[inbufOffset], &inbuf[inlen]);
-  std::string::size_type crlfPos = buf_.find(A2STR::CRLF);
-  if(crlfPos == std::string::npos) {
-    if(buf_.size() > MAX_BUF_SIZE) {
-      throw DL_ABORT_EX("Could not find chunk size before buffer got full.");
-    }
-    inbufOffset = inlen;
-    return false;
+  if(!readLine(inbufOffset, inbuf, inlen)) {
+    return inbufOffset < inlen;
   }
   std::string::size_type extPos = buf_.find(A2STR::SEMICOLON_C);
-  if(extPos == std::string::npos || crlfPos < extPos) {
-    extPos = crlfPos;
+  if(extPos == std::string::npos) {
+    extPos = buf_.size()-2;
   }
   chunkSize_ = util::parseULLInt(buf_.substr(0, extPos), 16);
-  assert(crlfPos+2 > pbufSize);
-  inbufOffset += crlfPos+2-pbufSize;
   buf_.clear();
   if(chunkSize_ == 0) {
     state_ = readTrailerStateHandler_;
@@ -111,39 +120,16 @@ bool ChunkedDecodingStreamFilter::readChunkSize
 bool ChunkedDecodingStreamFilter::readTrailer
 (size_t& inbufOffset, const unsigned char* inbuf, size_t inlen)
 {
-  size_t pbufSize = buf_.size();
-  buf_.append(&inbuf[inbufOffset], &inbuf[inlen]);
-  std::string::size_type crlfcrlfPos = buf_.find("\r\n\r\n");
-  if(crlfcrlfPos != std::string::npos) {
-    // TODO crlfcrlfPos == 0 case?
-    inbufOffset += crlfcrlfPos+4-pbufSize;
-    inbufOffset = inlen;
-    buf_.clear();
+  if(!readLine(inbufOffset, inbuf, inlen)) {
+    return inbufOffset < inlen;
+  }
+  if(buf_.size() == 2) {
+    // Empty line terminates the trailer.
     state_ = streamEndStateHandler_;
-    return true;
-  } else {
-    std::string::size_type crlfPos = buf_.find(A2STR::CRLF);
-    if(crlfPos == std::string::npos) {
-      if(buf_.size() > MAX_BUF_SIZE) {
-        throw DL_ABORT_EX
-          ("Could not find end of stream before buffer got full.");
-      }
-      inbufOffset = inlen;
-      return false;
-    } else if(crlfPos == 0) {
-      inbufOffset += crlfPos+2-pbufSize;
-      buf_.clear();
-      state_ = streamEndStateHandler_;
-      return true;
-    } else {
-      if(buf_.size() > MAX_BUF_SIZE) {
-        throw DL_ABORT_EX
-          ("Could not find end of stream before buffer got full.");
-      }
-      inbufOffset = inlen;
-      return false;
-    }
   }
+  // Trailer fields are ignored.
+  buf_.clear();
+  return true;
 }
 
 bool ChunkedDecodingStreamFilter::readData
@@ -170,20 +156,17 @@ bool ChunkedDecodingStreamFilter::readData
 bool ChunkedDecodingStreamFilter::readDataEnd
 (size_t& inbufOffset, const unsigned char* inbuf, size_t inlen)
 {
-  size_t pbufSize = buf_.size();
-  buf_.append(&inbuf[inbufOffset], &inbuf[inlen]);
-  if(buf_.size() >= 2) {
-    if(util::startsWith(buf_, A2STR::CRLF)) {
-      inbufOffset += 2-pbufSize;
-      buf_.clear();
-      state_ = readChunkSizeStateHandler_;
-      return true;
-    } else {
-      throw DL_ABORT_EX("No CRLF at the end of chunk.");
-    }
-  } else {
-    inbufOffset = inlen;
+  size_t len = std::min(static_cast<size_t>(2-buf_.size()), inlen-inbufOffset);
+  buf_.append(&inbuf[inbufOffset], &inbuf[inbufOffset+len]);
+  inbufOffset += len;
+  if(buf_.size() < 2) {
     return false;
+  } else if(buf_ == A2STR::CRLF) {
+    buf_.clear();
+    state_ = readChunkSizeStateHandler_;
+    return true;
+  } else {
+    throw DL_ABORT_EX("No CRLF at the end of chunk.");
   }
 }
 
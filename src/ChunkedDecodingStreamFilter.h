@@ -65,6 +65,11 @@ private:
 
   static size_t MAX_BUF_SIZE;
 
+  // Appends the bytes of the current line in inbuf to buf_. Returns
+  // true if buf_ holds a whole line terminated by CRLF.
+  bool readLine
+  (size_t& inbufOffset, const unsigned char* inbuf, size_t inlen);
+
   bool readChunkSize
   (size_t& inbufOffset, const unsigned char* inbuf, size_t inlen);
 
@@ -34,6 +34,7 @@
 /* copyright --> */
 #include "Command.h"
 #include "LogFactory.h"
+#include "DownloadEngine.h"
 
 namespace aria2 {
 
@@ -43,9 +44,23 @@ Command::Command(cuid_t cuid)
     readEvent_(false),
     writeEvent_(false),
     errorEvent_(false),
-    hupEvent_(false)
+    hupEvent_(false),
+    sleepingIn_(0),
+    deadline_(0)
 {}
 
+Command::~Command()
+{
+  if(sleepingIn_) {
+    sleepingIn_->removeSleepingCommand(this);
+  }
+}
+
+void Command::wakeup()
+{
+  sleepingIn_->wakeupCommand(this);
+}
+
 void Command::transitStatus()
 {
   switch(status_) {
@@ -59,6 +74,9 @@ void Command::transitStatus()
 void Command::setStatus(STATUS status)
 {
   status_ = status;
+  if(sleepingIn_ && status_ != STATUS_INACTIVE) {
+    wakeup();
+  }
 }
 
 void Command::readEventReceived()
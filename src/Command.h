@@ -41,6 +41,8 @@ namespace aria2 {
 
 typedef long long int cuid_t;
 
+class DownloadEngine;
+
 class Command {
 public:
   enum STATUS {
@@ -59,6 +61,18 @@ private:
   bool writeEvent_;
   bool errorEvent_;
   bool hupEvent_;
+
+  // Non-null while this command is sleeping in DownloadEngine, that
+  // is, it is not run until its status becomes active or deadline_
+  // passes.
+  DownloadEngine* sleepingIn_;
+  // Milliseconds
+  int64_t deadline_;
+
+  // Tells DownloadEngine to run this command if it is sleeping.
+  void wakeup();
+
+  friend class DownloadEngine;
 protected:
   bool readEventEnabled() const
   {
@@ -82,17 +96,29 @@ protected:
 public:
   Command(cuid_t cuid);
 
-  virtual ~Command() {}
+  virtual ~Command();
 
   virtual bool execute() = 0;
 
   cuid_t getCuid() const { return cuid_; }
 
-  void setStatusActive() { status_ = STATUS_ACTIVE; }
+  void setStatusActive()
+  {
+    status_ = STATUS_ACTIVE;
+    if(sleepingIn_) {
+      wakeup();
+    }
+  }
 
   void setStatusInactive() { status_ = STATUS_INACTIVE; }
 
-  void setStatusRealtime() { status_ = STATUS_REALTIME; }
+  void setStatusRealtime()
+  {
+    status_ = STATUS_REALTIME;
+    if(sleepingIn_) {
+      wakeup();
+    }
+  }
 
   void setStatus(STATUS status);
 
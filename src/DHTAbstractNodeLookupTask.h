@@ -54,6 +54,7 @@
 #include "Logger.h"
 #include "util.h"
 #include "DHTIDCloser.h"
+#include "DHTMessageTracker.h"
 #include "a2functional.h"
 #include "fmt.h"
 
@@ -82,11 +83,23 @@ private:
     }
   }
 
+  // Returns the number of queries kept in flight. It grows with the
+  // rate of timed out and late replies measured by DHTMessageTracker.
+  size_t getAlpha() const
+  {
+    if(getMessageTracker()) {
+      return getMessageTracker()->getAlpha(ALPHA, DHTBucket::K);
+    } else {
+      return ALPHA;
+    }
+  }
+
   void sendMessage()
   {
+    size_t alpha = getAlpha();
     for(std::deque<SharedHandle<DHTNodeLookupEntry> >::iterator i =
           entries_.begin(), eoi = entries_.end();
-        i != eoi && inFlightMessage_ < ALPHA; ++i) {
+        i != eoi && inFlightMessage_ < alpha; ++i) {
       if((*i)->used == false) {
         ++inFlightMessage_;
         (*i)->used = true;
@@ -149,7 +162,7 @@ public:
     memcpy(targetID_, targetID, DHT_ID_LENGTH);
   }
 
-  static const size_t ALPHA = 3;
+  static const size_t ALPHA = DHT_LOOKUP_ALPHA;
 
   virtual void startup()
   {
@@ -160,7 +173,6 @@ public:
     if(entries_.empty()) {
       setFinished(true);
     } else {
-      // TODO use RTT here
       inFlightMessage_ = 0;
       sendMessage();
       if(inFlightMessage_ == 0) {
@@ -50,7 +50,8 @@ DHTAbstractTask::DHTAbstractTask():
   routingTable_(0),
   dispatcher_(0),
   factory_(0),
-  taskQueue_(0)
+  taskQueue_(0),
+  tracker_(0)
 {}
 
 bool DHTAbstractTask::finished()
@@ -78,6 +79,11 @@ void DHTAbstractTask::setTaskQueue(DHTTaskQueue* taskQueue)
   taskQueue_ = taskQueue;
 }
 
+void DHTAbstractTask::setMessageTracker(DHTMessageTracker* tracker)
+{
+  tracker_ = tracker;
+}
+
 void DHTAbstractTask::setLocalNode(const SharedHandle<DHTNode>& localNode)
 {
   localNode_ = localNode;
@@ -47,6 +47,7 @@ class DHTMessageDispatcher;
 class DHTMessageFactory;
 class DHTMessage;
 class DHTTaskQueue;
+class DHTMessageTracker;
 
 class DHTAbstractTask:public DHTTask {
 private:
@@ -61,6 +62,8 @@ private:
   DHTMessageFactory* factory_;
   
   DHTTaskQueue* taskQueue_;
+
+  DHTMessageTracker* tracker_;
 protected:
   void setFinished(bool f)
   {
@@ -99,6 +102,14 @@ public:
 
   void setTaskQueue(DHTTaskQueue* taskQueue);
 
+  // Returns DHTMessageTracker, or 0 if it is not set.
+  DHTMessageTracker* getMessageTracker() const
+  {
+    return tracker_;
+  }
+
+  void setMessageTracker(DHTMessageTracker* tracker);
+
   const SharedHandle<DHTNode>& getLocalNode() const
   {
     return localNode_;
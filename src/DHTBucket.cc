@@ -43,7 +43,6 @@
 #include "Logger.h"
 #include "util.h"
 #include "DHTConstants.h"
-#include "a2functional.h"
 #include "bittorrent_helper.h"
 #include "bitfield.h"
 #include "wallclock.h"
@@ -57,6 +56,7 @@ DHTBucket::DHTBucket
  const SharedHandle<DHTNode>& localNode)
   : prefixLength_(prefixLength),
     localNode_(localNode),
+    numNodes_(0),
     lastUpdated_(global::wallclock)
 {
   memcpy(max_, max, DHT_ID_LENGTH);
@@ -66,6 +66,7 @@ DHTBucket::DHTBucket
 DHTBucket::DHTBucket(const SharedHandle<DHTNode>& localNode)
   : prefixLength_(0),
     localNode_(localNode),
+    numNodes_(0),
     lastUpdated_(global::wallclock)
 {
   memset(max_, 0xffu, DHT_ID_LENGTH);
@@ -107,27 +108,52 @@ bool DHTBucket::isInRange(const unsigned char* nodeID,
                                   &nodeID[0], &nodeID[DHT_ID_LENGTH]);
 }
 
+size_t DHTBucket::findNode(const unsigned char* nodeID) const
+{
+  for(size_t i = 0; i < numNodes_; ++i) {
+    if(memcmp(nodes_[i].id, nodeID, DHT_ID_LENGTH) == 0) {
+      return i;
+    }
+  }
+  return numNodes_;
+}
+
+void DHTBucket::eraseNode(size_t index)
+{
+  for(size_t i = index+1; i < numNodes_; ++i) {
+    nodes_[i-1] = nodes_[i];
+  }
+  --numNodes_;
+  nodes_[numNodes_].node.reset();
+}
+
+void DHTBucket::appendNode(const SharedHandle<DHTNode>& node)
+{
+  memcpy(nodes_[numNodes_].id, node->getID(), DHT_ID_LENGTH);
+  nodes_[numNodes_].node = node;
+  ++numNodes_;
+}
+
 bool DHTBucket::addNode(const SharedHandle<DHTNode>& node)
 {
   notifyUpdate();
-  std::deque<SharedHandle<DHTNode> >::iterator itr =
-    std::find_if(nodes_.begin(), nodes_.end(), derefEqual(node));
-  if(itr == nodes_.end()) {
-    if(nodes_.size() < K) {
-      nodes_.push_back(node);
+  size_t index = findNode(node->getID());
+  if(index == numNodes_) {
+    if(numNodes_ < K) {
+      appendNode(node);
       return true;
     } else {
-      if(nodes_.front()->isBad()) {
-        nodes_.erase(nodes_.begin());
-        nodes_.push_back(node);
+      if(nodes_[0].node->isBad()) {
+        eraseNode(0);
+        appendNode(node);
         return true;
       } else {
         return false;
       }
     }
   } else {
-    nodes_.erase(itr);
-    nodes_.push_back(node);
+    eraseNode(index);
+    appendNode(node);
     return true;
   }
 }
@@ -144,11 +170,10 @@ void DHTBucket::cacheNode(const SharedHandle<DHTNode>& node)
 void DHTBucket::dropNode(const SharedHandle<DHTNode>& node)
 {
   if(cachedNodes_.size()) {
-    std::deque<SharedHandle<DHTNode> >::iterator itr =
-      std::find_if(nodes_.begin(), nodes_.end(), derefEqual(node));
-    if(itr != nodes_.end()) {
-      nodes_.erase(itr);
-      nodes_.push_back(cachedNodes_.front());
+    size_t index = findNode(node->getID());
+    if(index != numNodes_) {
+      eraseNode(index);
+      appendNode(cachedNodes_.front());
       cachedNodes_.erase(cachedNodes_.begin());
     }
   }
@@ -156,21 +181,22 @@ void DHTBucket::dropNode(const SharedHandle<DHTNode>& node)
 
 void DHTBucket::moveToHead(const SharedHandle<DHTNode>& node)
 {
-  std::deque<SharedHandle<DHTNode> >::iterator itr =
-    std::find_if(nodes_.begin(), nodes_.end(), derefEqual(node));
-  if(itr != nodes_.end()) {
-    nodes_.erase(itr);
-    nodes_.push_front(node);
+  size_t index = findNode(node->getID());
+  if(index != numNodes_) {
+    for(size_t i = index; i > 0; --i) {
+      nodes_[i] = nodes_[i-1];
+    }
+    memcpy(nodes_[0].id, node->getID(), DHT_ID_LENGTH);
+    nodes_[0].node = node;
   }
 }
 
 void DHTBucket::moveToTail(const SharedHandle<DHTNode>& node)
 {
-  std::deque<SharedHandle<DHTNode> >::iterator itr =
-    std::find_if(nodes_.begin(), nodes_.end(), derefEqual(node));
-  if(itr != nodes_.end()) {
-    nodes_.erase(itr);
-    nodes_.push_back(node);
+  size_t index = findNode(node->getID());
+  if(index != numNodes_) {
+    eraseNode(index);
+    appendNode(node);
   }
 }
 
@@ -195,16 +221,20 @@ SharedHandle<DHTBucket> DHTBucket::split()
   SharedHandle<DHTBucket> rBucket(new DHTBucket(prefixLength_,
                                                 rMax, rMin, localNode_));
 
-  std::deque<SharedHandle<DHTNode> > lNodes;
-  for(std::deque<SharedHandle<DHTNode> >::iterator i = nodes_.begin(),
-        eoi = nodes_.end(); i != eoi; ++i) {
-    if(rBucket->isInRange(*i)) {
-      assert(rBucket->addNode(*i));
+  size_t numLNodes = 0;
+  for(size_t i = 0; i < numNodes_; ++i) {
+    if(rBucket->isInRange(nodes_[i].id)) {
+      bool added = rBucket->addNode(nodes_[i].node);
+      assert(added);
+      (void)added;
     } else {
-      lNodes.push_back(*i);
-    }      
+      nodes_[numLNodes++] = nodes_[i];
+    }
+  }
+  for(size_t i = numLNodes; i < numNodes_; ++i) {
+    nodes_[i].node.reset();
   }
-  nodes_ = lNodes;
+  numNodes_ = numLNodes;
   // TODO create toString() and use it.
   A2_LOG_DEBUG(fmt("New bucket. prefixLength=%u, Range:%s-%s",
                    static_cast<unsigned int>(rBucket->getPrefixLength()),
@@ -217,26 +247,35 @@ SharedHandle<DHTBucket> DHTBucket::split()
   return rBucket;
 }
 
+std::vector<SharedHandle<DHTNode> > DHTBucket::getNodes() const
+{
+  std::vector<SharedHandle<DHTNode> > nodes;
+  nodes.reserve(numNodes_);
+  for(size_t i = 0; i < numNodes_; ++i) {
+    nodes.push_back(nodes_[i].node);
+  }
+  return nodes;
+}
+
 void DHTBucket::getGoodNodes
 (std::vector<SharedHandle<DHTNode> >& goodNodes) const
 {
-  goodNodes.insert(goodNodes.end(), nodes_.begin(), nodes_.end());  
-  goodNodes.erase(std::remove_if(goodNodes.begin(), goodNodes.end(),
-                                 mem_fun_sh(&DHTNode::isBad)), goodNodes.end());
+  for(size_t i = 0; i < numNodes_; ++i) {
+    if(!nodes_[i].node->isBad()) {
+      goodNodes.push_back(nodes_[i].node);
+    }
+  }
 }
 
 SharedHandle<DHTNode> DHTBucket::getNode(const unsigned char* nodeID, const std::string& ipaddr, uint16_t port) const
 {
-  SharedHandle<DHTNode> node(new DHTNode(nodeID));
-  node->setIPAddress(ipaddr);
-  node->setPort(port);
-  std::deque<SharedHandle<DHTNode> >::const_iterator itr =
-    std::find_if(nodes_.begin(), nodes_.end(), derefEqual(node));
-  if(itr == nodes_.end() ||
-     (*itr)->getIPAddress() != ipaddr || (*itr)->getPort() != port) {
+  size_t index = findNode(nodeID);
+  if(index == numNodes_ ||
+     nodes_[index].node->getIPAddress() != ipaddr ||
+     nodes_[index].node->getPort() != port) {
     return SharedHandle<DHTNode>();
   } else {
-    return *itr;
+    return nodes_[index].node;
   }
 }
 
@@ -248,7 +287,7 @@ bool DHTBucket::operator==(const DHTBucket& bucket) const
 
 bool DHTBucket::needsRefresh() const
 {
-  return nodes_.size() < K ||
+  return numNodes_ < K ||
     lastUpdated_.difference(global::wallclock) >= DHT_BUCKET_REFRESH_INTERVAL;
 }
 
@@ -257,30 +296,19 @@ void DHTBucket::notifyUpdate()
   lastUpdated_ = global::wallclock;
 }
 
-namespace {
-class FindQuestionableNode {
-public:
-  bool operator()(const SharedHandle<DHTNode>& node) const
-  {
-    return node->isQuestionable();
-  }
-};
-} // namespace
-
 bool DHTBucket::containsQuestionableNode() const
 {
-  return std::find_if(nodes_.begin(), nodes_.end(), FindQuestionableNode()) != nodes_.end();
+  return getLRUQuestionableNode();
 }
 
 SharedHandle<DHTNode> DHTBucket::getLRUQuestionableNode() const
 {
-  std::deque<SharedHandle<DHTNode> >::const_iterator i =
-    std::find_if(nodes_.begin(), nodes_.end(), FindQuestionableNode());
-  if(i == nodes_.end()) {
-    return SharedHandle<DHTNode>();
-  } else {
-    return *i;
+  for(size_t i = 0; i < numNodes_; ++i) {
+    if(nodes_[i].node->isQuestionable()) {
+      return nodes_[i].node;
+    }
   }
+  return SharedHandle<DHTNode>();
 }
 
 } // namespace aria2
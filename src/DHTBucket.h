@@ -50,6 +50,10 @@ namespace aria2 {
 class DHTNode;
 
 class DHTBucket {
+public:
+  static const size_t K = 8;
+
+  static const size_t CACHE_SIZE = 2;
 private:
   size_t prefixLength_;
 
@@ -60,8 +64,21 @@ private:
 
   SharedHandle<DHTNode> localNode_;
 
-  // sorted in ascending order
-  std::deque<SharedHandle<DHTNode> > nodes_;
+  // A node in this bucket. The node ID is copied into the entry, so
+  // that looking up a node and computing distances touch no other
+  // memory than this bucket. DHTNode itself is held by SharedHandle,
+  // because DHT messages and tasks update its condition through the
+  // same object.
+  struct NodeEntry {
+    unsigned char id[DHT_ID_LENGTH];
+    SharedHandle<DHTNode> node;
+  };
+
+  // The first numNodes_ elements are the nodes in this bucket, sorted
+  // by last time seen in ascending order.
+  NodeEntry nodes_[K];
+
+  size_t numNodes_;
 
   // a replacement cache. The maximum size is specified by CACHE_SIZE.
   // This is sorted by last time seen.
@@ -71,6 +88,16 @@ private:
 
   bool isInRange(const unsigned char* nodeID,
                  const unsigned char* max, const unsigned char* min) const;
+
+  // Returns the index of the node whose ID is nodeID, or numNodes_ if
+  // there is no such node.
+  size_t findNode(const unsigned char* nodeID) const;
+
+  // Removes the node at index and shifts the following nodes.
+  void eraseNode(size_t index);
+
+  // Appends node to nodes_. numNodes_ must be less than K.
+  void appendNode(const SharedHandle<DHTNode>& node);
 public:
   DHTBucket(const SharedHandle<DHTNode>& localNode);
 
@@ -80,10 +107,6 @@ public:
 
   ~DHTBucket();
 
-  static const size_t K = 8;
-
-  static const size_t CACHE_SIZE = 2;
-
   void getRandomNodeID(unsigned char* nodeID) const;
 
   SharedHandle<DHTBucket> split();
@@ -115,14 +138,25 @@ public:
 
   size_t countNode() const
   {
-    return nodes_.size();
+    return numNodes_;
   }
 
-  const std::deque<SharedHandle<DHTNode> >& getNodes() const
+  // Returns the index-th node. index must be less than countNode().
+  const SharedHandle<DHTNode>& getNodeAt(size_t index) const
   {
-    return nodes_;
+    return nodes_[index].node;
   }
 
+  // Returns the ID of the index-th node. index must be less than
+  // countNode().
+  const unsigned char* getNodeIDAt(size_t index) const
+  {
+    return nodes_[index].id;
+  }
+
+  // Returns a copy of the nodes in this bucket.
+  std::vector<SharedHandle<DHTNode> > getNodes() const;
+
   void getGoodNodes(std::vector<SharedHandle<DHTNode> >& nodes) const;
 
   void dropNode(const SharedHandle<DHTNode>& node);
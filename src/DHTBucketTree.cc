@@ -126,92 +126,146 @@ SharedHandle<DHTBucket> findBucketFor
 }
 
 namespace {
-void collectNodes
-(std::vector<SharedHandle<DHTNode> >& nodes,
- const SharedHandle<DHTBucket>& bucket)
+const size_t DHT_ID_WORDS = DHT_ID_LENGTH/4;
+
+// Stores the XOR distance between id and key in dist as big endian
+// words, so that distances are compared word by word.
+void xorDistance
+(uint32_t* dist, const unsigned char* id, const unsigned char* key)
 {
-  std::vector<SharedHandle<DHTNode> > goodNodes;
-  bucket->getGoodNodes(goodNodes);
-  nodes.insert(nodes.end(), goodNodes.begin(), goodNodes.end());
+  for(size_t i = 0; i < DHT_ID_WORDS; ++i, id += 4, key += 4) {
+    dist[i] =
+      (static_cast<uint32_t>(id[0]^key[0]) << 24) |
+      (static_cast<uint32_t>(id[1]^key[1]) << 16) |
+      (static_cast<uint32_t>(id[2]^key[2]) << 8) |
+      static_cast<uint32_t>(id[3]^key[3]);
+  }
 }
 } // namespace
 
 namespace {
-void collectDownwardLeftFirst
-(std::vector<SharedHandle<DHTNode> >& nodes,  DHTBucketTreeNode* tnode)
+bool lessDistance(const uint32_t* dist1, const uint32_t* dist2)
 {
-  if(tnode->leaf()) {
-    collectNodes(nodes, tnode->getBucket());
-  } else {
-    collectDownwardLeftFirst(nodes, tnode->getLeft());
-    if(nodes.size() < DHTBucket::K) {
-      collectDownwardLeftFirst(nodes, tnode->getRight());
+  for(size_t i = 0; i < DHT_ID_WORDS; ++i) {
+    if(dist1[i] != dist2[i]) {
+      return dist1[i] < dist2[i];
     }
   }
+  return false;
 }
-} //namespace
+} // namespace
 
 namespace {
-void collectDownwardRightFirst
-(std::vector<SharedHandle<DHTNode> >& nodes,  DHTBucketTreeNode* tnode)
-{
-  if(tnode->leaf()) {
-    collectNodes(nodes, tnode->getBucket());
-  } else {
-    collectDownwardRightFirst(nodes, tnode->getRight());
-    if(nodes.size() < DHTBucket::K) {
-      collectDownwardRightFirst(nodes, tnode->getLeft());
+// Keeps the K closest good nodes to key seen so far, sorted by
+// distance in ascending order. Nothing is allocated.
+class ClosestNodes {
+private:
+  const unsigned char* key_;
+  uint32_t dist_[DHTBucket::K][DHT_ID_WORDS];
+  const SharedHandle<DHTNode>* nodes_[DHTBucket::K];
+  size_t size_;
+
+  void insert(const uint32_t* dist, const SharedHandle<DHTNode>& node)
+  {
+    size_t i = size_;
+    if(i == DHTBucket::K) {
+      --i;
+    } else {
+      ++size_;
     }
+    for(; i > 0 && lessDistance(dist, dist_[i-1]); --i) {
+      memcpy(dist_[i], dist_[i-1], sizeof(dist_[i]));
+      nodes_[i] = nodes_[i-1];
+    }
+    memcpy(dist_[i], dist, sizeof(dist_[i]));
+    nodes_[i] = &node;
   }
-}
-} //namespace
+public:
+  ClosestNodes(const unsigned char* key)
+    : key_(key),
+      size_(0)
+  {}
 
-namespace {
-void collectUpward
-(std::vector<SharedHandle<DHTNode> >& nodes, DHTBucketTreeNode* from)
+  void addGoodNodes(const SharedHandle<DHTBucket>& bucket)
+  {
+    for(size_t i = 0, len = bucket->countNode(); i < len; ++i) {
+      uint32_t dist[DHT_ID_WORDS];
+      xorDistance(dist, bucket->getNodeIDAt(i), key_);
+      // The bucket keeps node IDs, so DHTNode is only looked at if
+      // the node is closer than the K nodes found so far.
+      if(full() && !lessDistance(dist, dist_[DHTBucket::K-1])) {
+        continue;
+      }
+      const SharedHandle<DHTNode>& node = bucket->getNodeAt(i);
+      if(!node->isBad()) {
+        insert(dist, node);
+      }
+    }
+  }
+
+  void addSubtree(DHTBucketTreeNode* tnode)
+  {
+    if(tnode->leaf()) {
+      addGoodNodes(tnode->getBucket());
+    } else {
+      addSubtree(tnode->getLeft());
+      addSubtree(tnode->getRight());
+    }
+  }
+
+  bool full() const
+  {
+    return size_ == DHTBucket::K;
+  }
+
+  size_t getNodes(SharedHandle<DHTNode>* nodes) const
+  {
+    for(size_t i = 0; i < size_; ++i) {
+      nodes[i] = *nodes_[i];
+    }
+    return size_;
+  }
+};
+} // namespace
+
+size_t findClosestKNodes
+(SharedHandle<DHTNode>* nodes,
+ DHTBucketTreeNode* root,
+ const unsigned char* key)
 {
-  while(1) {
-    DHTBucketTreeNode* parent = from->getParent();
+  // The tree splits the ID space by prefix, so every node in the
+  // sibling of an ancestor of the leaf is closer to key than any node
+  // outside that ancestor. Visiting siblings from the bottom up and
+  // stopping once K nodes are found yields the exact K closest nodes.
+  ClosestNodes closest(key);
+  DHTBucketTreeNode* tnode = findTreeNodeFor(root, key);
+  closest.addGoodNodes(tnode->getBucket());
+  while(!closest.full()) {
+    DHTBucketTreeNode* parent = tnode->getParent();
     if(!parent) {
       break;
     }
-    if(parent->getLeft() == from) {
-      collectNodes(nodes, parent->getRight()->getBucket());
+    if(parent->getLeft() == tnode) {
+      closest.addSubtree(parent->getRight());
     } else {
-      collectNodes(nodes, parent->getLeft()->getBucket());
-    }
-    from = parent;
-    parent = parent->getParent();
-    if(DHTBucket::K <= nodes.size()) {
-      break;
+      closest.addSubtree(parent->getLeft());
     }
+    tnode = parent;
   }
+  return closest.getNodes(nodes);
 }
-} // namespace
 
 void findClosestKNodes
 (std::vector<SharedHandle<DHTNode> >& nodes,
  DHTBucketTreeNode* root,
  const unsigned char* key)
 {
-  size_t nodesSize = nodes.size();
-  if(DHTBucket::K <= nodesSize) {
+  if(DHTBucket::K <= nodes.size()) {
     return;
   }
-  DHTBucketTreeNode* leaf = findTreeNodeFor(root, key);
-  if(leaf == root) {
-    collectNodes(nodes, leaf->getBucket());
-  } else {
-    DHTBucketTreeNode* parent = leaf->getParent();
-    if(parent->getLeft() == leaf) {
-      collectDownwardLeftFirst(nodes, parent);
-    } else {
-      collectDownwardRightFirst(nodes, parent);
-    }
-    if(nodes.size() < DHTBucket::K) {
-      collectUpward(nodes, parent);
-    }
-  }
+  SharedHandle<DHTNode> closest[DHTBucket::K];
+  size_t numClosest = findClosestKNodes(closest, root, key);
+  nodes.insert(nodes.end(), &closest[0], &closest[numClosest]);
   if(DHTBucket::K < nodes.size()) {
     nodes.erase(nodes.begin()+DHTBucket::K, nodes.end());
   }
@@ -103,10 +103,18 @@ DHTBucketTreeNode* findTreeNodeFor
 SharedHandle<DHTBucket> findBucketFor
 (DHTBucketTreeNode* root, const unsigned char* key);
 
-// Stores most closest K nodes against key in nodes. K is
-// DHTBucket::K. This function may returns less than K nodes because
-// the routing tree contains less than K nodes. The order of nodes is
-// arbitrary.  Caller must pass empty nodes.
+// Stores most closest K good nodes against key in nodes, sorted by
+// XOR distance in ascending order, and returns the number of stored
+// nodes. K is DHTBucket::K and nodes must have room for K nodes. This
+// function may return less than K because the routing tree contains
+// less than K good nodes. No memory is allocated.
+size_t findClosestKNodes
+(SharedHandle<DHTNode>* nodes,
+ DHTBucketTreeNode* root,
+ const unsigned char* key);
+
+// Same as above, but appends nodes to the vector. Caller must pass
+// empty nodes.
 void findClosestKNodes
 (std::vector<SharedHandle<DHTNode> >& nodes,
  DHTBucketTreeNode* root,
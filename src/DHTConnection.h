@@ -47,8 +47,28 @@ public:
   virtual ssize_t receiveMessage(unsigned char* data, size_t len,
                                  std::string& host, uint16_t& port) = 0;
 
+  // Sends data to host:port. The data may be queued and sent by the
+  // later call of flush(). Returns len if the data is sent or queued,
+  // or 0 if it cannot be accepted now.
   virtual ssize_t sendMessage(const unsigned char* data, size_t len,
                               const std::string& host, uint16_t port) = 0;
+
+  // Sends the data queued by sendMessage().
+  virtual void flush() = 0;
+
+  // Returns true if all data queued by sendMessage() has been sent.
+  virtual bool sendQueueIsEmpty() const = 0;
+
+  // Returns the number of datagrams received and passed to the
+  // caller.
+  virtual int64_t getNumReceived() const = 0;
+
+  // Returns the number of datagrams sent.
+  virtual int64_t getNumSent() const = 0;
+
+  // Returns the number of datagrams which were truncated on receipt
+  // or could not be sent.
+  virtual int64_t getNumDropped() const = 0;
 };
 
 } // namespace aria2
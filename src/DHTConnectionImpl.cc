@@ -34,25 +34,54 @@
 /* copyright --> */
 #include "DHTConnectionImpl.h"
 
+#include <cstring>
 #include <utility>
 #include <algorithm>
 
 #include "LogFactory.h"
 #include "Logger.h"
 #include "RecoverableException.h"
+#include "DlAbortEx.h"
+#include "message.h"
 #include "util.h"
 #include "Socket.h"
 #include "SimpleRandomizer.h"
+#include "DHTConstants.h"
 #include "fmt.h"
 
 namespace aria2 {
 
 DHTConnectionImpl::DHTConnectionImpl(int family)
   : socket_(new SocketCore(SOCK_DGRAM)),
-    family_(family)
-{}
+    family_(family),
+    buf_(2*DHT_DATAGRAM_RING_SIZE*DHT_MAX_DATAGRAM_SIZE),
+    recvRing_(DHT_DATAGRAM_RING_SIZE),
+    recvFirst_(0),
+    recvLast_(0),
+    sendRing_(DHT_DATAGRAM_RING_SIZE),
+    sendFirst_(0),
+    sendLast_(0),
+    numReceived_(0),
+    numSent_(0),
+    numDropped_(0)
+{
+  unsigned char* p = &buf_[0];
+  for(size_t i = 0; i < DHT_DATAGRAM_RING_SIZE; ++i) {
+    recvRing_[i].data = p;
+    p += DHT_MAX_DATAGRAM_SIZE;
+    sendRing_[i].data = p;
+    p += DHT_MAX_DATAGRAM_SIZE;
+  }
+}
 
-DHTConnectionImpl::~DHTConnectionImpl() {}
+DHTConnectionImpl::~DHTConnectionImpl()
+{
+  A2_LOG_INFO(fmt("IPv%d DHT: %s datagrams received, %s sent, %s dropped.",
+                  family_ == AF_INET?4:6,
+                  util::itos(numReceived_).c_str(),
+                  util::itos(numSent_).c_str(),
+                  util::itos(numDropped_).c_str()));
+}
 
 bool DHTConnectionImpl::bind
 (uint16_t& port, const std::string& addr, IntSequence& ports)
@@ -96,24 +125,110 @@ bool DHTConnectionImpl::bind(uint16_t& port, const std::string& addr)
   return false;
 }
 
+bool DHTConnectionImpl::fillRecvRing()
+{
+  recvFirst_ = recvLast_ = 0;
+  for(size_t i = 0; i < recvRing_.size(); ++i) {
+    recvRing_[i].length = DHT_MAX_DATAGRAM_SIZE;
+  }
+  size_t num = socket_->readDatagrams(&recvRing_[0], recvRing_.size());
+  for(size_t i = 0; i < num; ++i) {
+    if(recvRing_[i].truncated) {
+      A2_LOG_INFO("Dropped too large DHT datagram.");
+      ++numDropped_;
+    } else {
+      // Swap the whole slot so that each slot keeps its own buffer.
+      std::swap(recvRing_[recvLast_], recvRing_[i]);
+      ++recvLast_;
+    }
+  }
+  return recvLast_ > 0;
+}
+
 ssize_t DHTConnectionImpl::receiveMessage(unsigned char* data, size_t len,
                                           std::string& host, uint16_t& port)
 {
-  std::pair<std::string, uint16_t> remoteHost;
-  ssize_t length = socket_->readDataFrom(data, len, remoteHost);
-  if(length == 0) {
-    return length;
-  } else {
-    host = remoteHost.first;
-    port = remoteHost.second;
-    return length;
+  if(recvFirst_ == recvLast_ && !fillRecvRing()) {
+    return 0;
   }
+  const Datagram& dgram = recvRing_[recvFirst_++];
+  std::pair<std::string, uint16_t> remoteHost =
+    util::getNumericNameInfo
+    (reinterpret_cast<const struct sockaddr*>(&dgram.addr), dgram.addrlen);
+  host = remoteHost.first;
+  port = remoteHost.second;
+  ++numReceived_;
+  size_t length = std::min(len, dgram.length);
+  memcpy(data, dgram.data, length);
+  return length;
 }
 
 ssize_t DHTConnectionImpl::sendMessage(const unsigned char* data, size_t len,
                                        const std::string& host, uint16_t port)
 {
-  return socket_->writeData(data, len, host, port);
+  if(len > DHT_MAX_DATAGRAM_SIZE) {
+    // Keep the order of messages.
+    flush();
+    if(sendFirst_ != sendLast_) {
+      return 0;
+    }
+    ssize_t r = socket_->writeData(data, len, host, port);
+    if(r == static_cast<ssize_t>(len)) {
+      ++numSent_;
+    }
+    return r;
+  }
+  if(sendLast_ == sendRing_.size()) {
+    flush();
+    if(sendLast_ == sendRing_.size()) {
+      return 0;
+    }
+  }
+  Datagram& dgram = sendRing_[sendLast_];
+  // DHT nodes are given by numeric addresses, which AI_NUMERICHOST
+  // converts without a name service lookup.
+  std::string service = util::uitos(port);
+  struct addrinfo* res;
+  int s = callGetaddrinfo(&res, host.c_str(), service.c_str(),
+                          family_, SOCK_DGRAM, AI_NUMERICHOST, 0);
+  if(s == EAI_NONAME) {
+    s = callGetaddrinfo(&res, host.c_str(), service.c_str(),
+                        family_, SOCK_DGRAM, 0, 0);
+  }
+  if(s) {
+    throw DL_ABORT_EX(fmt(EX_SOCKET_SEND, gai_strerror(s)));
+  }
+  WSAAPI_AUTO_DELETE<struct addrinfo*> resDeleter(res, freeaddrinfo);
+  memcpy(&dgram.addr, res->ai_addr, res->ai_addrlen);
+  dgram.addrlen = res->ai_addrlen;
+  memcpy(dgram.data, data, len);
+  dgram.length = len;
+  ++sendLast_;
+  return len;
+}
+
+void DHTConnectionImpl::flush()
+{
+  while(sendFirst_ < sendLast_) {
+    try {
+      size_t num = socket_->writeDatagrams(&sendRing_[sendFirst_],
+                                           sendLast_-sendFirst_);
+      if(num == 0) {
+        break;
+      }
+      sendFirst_ += num;
+      numSent_ += num;
+    } catch(RecoverableException& e) {
+      A2_LOG_INFO_EX("Failed to send DHT datagram.", e);
+      ++sendFirst_;
+      ++numDropped_;
+    }
+  }
+  // Move the datagrams left in the ring to the beginning.
+  std::rotate(sendRing_.begin(), sendRing_.begin()+sendFirst_,
+              sendRing_.begin()+sendLast_);
+  sendLast_ -= sendFirst_;
+  sendFirst_ = 0;
 }
 
 } // namespace aria2
@@ -36,18 +36,42 @@
 #define D_DHT_CONNECTION_IMPL_H
 
 #include "DHTConnection.h"
+
+#include <vector>
+
 #include "SharedHandle.h"
 #include "IntSequence.h"
+#include "SocketCore.h"
 
 namespace aria2 {
 
-class SocketCore;
-
+// Datagrams are received into and sent from preallocated rings of
+// DHT_DATAGRAM_RING_SIZE slots, so that a batch of them is read or
+// written with one recvmmsg(2)/sendmmsg(2) call.
 class DHTConnectionImpl:public DHTConnection {
 private:
   SharedHandle<SocketCore> socket_;
 
   int family_;
+
+  // Backing store of the slots of both rings.
+  std::vector<unsigned char> buf_;
+
+  std::vector<Datagram> recvRing_;
+  // Received datagrams are recvRing_[recvFirst_, recvLast_).
+  size_t recvFirst_;
+  size_t recvLast_;
+
+  std::vector<Datagram> sendRing_;
+  // Queued datagrams are sendRing_[sendFirst_, sendLast_).
+  size_t sendFirst_;
+  size_t sendLast_;
+
+  int64_t numReceived_;
+  int64_t numSent_;
+  int64_t numDropped_;
+
+  bool fillRecvRing();
 public:
   DHTConnectionImpl(int family);
 
@@ -79,6 +103,28 @@ public:
   virtual ssize_t sendMessage(const unsigned char* data, size_t len,
                               const std::string& host, uint16_t port);
 
+  virtual void flush();
+
+  virtual bool sendQueueIsEmpty() const
+  {
+    return sendFirst_ == sendLast_;
+  }
+
+  virtual int64_t getNumReceived() const
+  {
+    return numReceived_;
+  }
+
+  virtual int64_t getNumSent() const
+  {
+    return numSent_;
+  }
+
+  virtual int64_t getNumDropped() const
+  {
+    return numDropped_;
+  }
+
   const SharedHandle<SocketCore>& getSocket() const
   {
     return socket_;
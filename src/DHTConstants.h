@@ -60,6 +60,45 @@
 
 #define DHT_PEER_ANNOUNCE_CHECK_INTERVAL (5*60)
 
+// The maximum number of peers stored for one info hash.
+#define DHT_PEER_ANNOUNCE_MAX_PEER 50
+
+// The maximum number of info hashes stored in DHTPeerAnnounceStorage.
+#define DHT_PEER_ANNOUNCE_MAX_ENTRY 30000
+
 #define DHT_TOKEN_UPDATE_INTERVAL (10*60)
 
+// The number of slots in each datagram ring of DHTConnectionImpl.
+#define DHT_DATAGRAM_RING_SIZE 32
+
+// The size of a slot in the datagram rings. Larger datagrams are
+// dropped on receipt and sent without queueing.
+#define DHT_MAX_DATAGRAM_SIZE (8*1024)
+
+// Bounds of the number of messages DHTInteractionCommand receives in
+// one iteration.
+#define DHT_MIN_RECEIVE_BUDGET 20
+
+#define DHT_MAX_RECEIVE_BUDGET 1024
+
+// The number of queries a lookup keeps in flight when no query times
+// out.
+#define DHT_LOOKUP_ALPHA 3
+
+// The maximum number of outstanding queries. DHTTaskQueueImpl does
+// not start queued tasks while this many queries are outstanding.
+#define DHT_MAX_IN_FLIGHT_QUERY 256
+
+// The maximum number of peer lookups run at once.
+#define DHT_MAX_CONCURRENT_PEER_LOOKUP 64
+
+// The lower bound of the query timeout adapted to measured RTTs, in
+// seconds. The upper bound is --dht-message-timeout.
+#define DHT_MIN_MESSAGE_TIMEOUT 2
+
+// Node lookups whose targets share this many leading bits find the
+// same closest nodes in a network of less than 2^28 nodes, so only
+// one of them is run. This must be a multiple of 8.
+#define DHT_LOOKUP_DEDUP_PREFIX_BITS 32
+
 #endif // D_DHT_CONSTANTS_H
@@ -33,6 +33,9 @@
  */
 /* copyright --> */
 #include "DHTInteractionCommand.h"
+
+#include <algorithm>
+
 #include "DownloadEngine.h"
 #include "RecoverableException.h"
 #include "DHTMessageDispatcher.h"
@@ -46,18 +49,25 @@
 #include "LogFactory.h"
 #include "DHTMessageCallback.h"
 #include "DHTNode.h"
+#include "DHTConnection.h"
+#include "DHTConstants.h"
 #include "fmt.h"
 
 namespace aria2 {
 
 DHTInteractionCommand::DHTInteractionCommand(cuid_t cuid, DownloadEngine* e)
   : Command(cuid),
-    e_(e)
+    e_(e),
+    writeCheck_(false),
+    receiveBudget_(DHT_MIN_RECEIVE_BUDGET)
 {}
 
 DHTInteractionCommand::~DHTInteractionCommand()
 {
   disableReadCheckSocket(readCheckSocket_);
+  if(writeCheck_) {
+    e_->deleteSocketForWriteCheck(readCheckSocket_, this);
+  }
 }
 
 void DHTInteractionCommand::setReadCheckSocket(const SocketHandle& socket)
@@ -79,18 +89,36 @@ bool DHTInteractionCommand::execute()
 
   taskQueue_->executeTask();
 
-  for(size_t i = 0; i < 20; ++i) {
+  size_t numReceived = 0;
+  for(; numReceived < receiveBudget_; ++numReceived) {
     SharedHandle<DHTMessage> m = receiver_->receiveMessage();
     if(!m) {
       break;
     }
   }
+  if(numReceived == receiveBudget_) {
+    receiveBudget_ = std::min(receiveBudget_*2,
+                              static_cast<size_t>(DHT_MAX_RECEIVE_BUDGET));
+  } else if(numReceived < receiveBudget_/4) {
+    receiveBudget_ = std::max(receiveBudget_/2,
+                              static_cast<size_t>(DHT_MIN_RECEIVE_BUDGET));
+  }
   receiver_->handleTimeout();
   try {
     dispatcher_->sendMessages();
+    receiver_->getConnection()->flush();
   } catch(RecoverableException& e) {
     A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
   }
+  // Wake up when the socket can take the rest of the queued datagrams.
+  bool sendQueueIsEmpty = receiver_->getConnection()->sendQueueIsEmpty();
+  if(writeCheck_ && sendQueueIsEmpty) {
+    e_->deleteSocketForWriteCheck(readCheckSocket_, this);
+    writeCheck_ = false;
+  } else if(!writeCheck_ && !sendQueueIsEmpty) {
+    e_->addSocketForWriteCheck(readCheckSocket_, this);
+    writeCheck_ = true;
+  }
   e_->addCommand(this);
   return false;
 }
@@ -53,6 +53,13 @@ private:
   SharedHandle<DHTMessageReceiver> receiver_;
   SharedHandle<DHTTaskQueue> taskQueue_;
   SharedHandle<SocketCore> readCheckSocket_;
+  // True while readCheckSocket_ is also checked for writing, which is
+  // while the connection has datagrams it could not send.
+  bool writeCheck_;
+  // The number of messages received in one iteration at most.  It
+  // grows while the socket has more messages than this and shrinks
+  // when the traffic is light.
+  size_t receiveBudget_;
 public:
   DHTInteractionCommand(cuid_t cuid, DownloadEngine* e);
 
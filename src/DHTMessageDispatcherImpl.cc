@@ -70,7 +70,7 @@ DHTMessageDispatcherImpl::addMessageToQueue
 (const SharedHandle<DHTMessage>& message,
  const SharedHandle<DHTMessageCallback>& callback)
 {
-  addMessageToQueue(message, timeout_, callback);
+  addMessageToQueue(message, tracker_->getTimeout(timeout_), callback);
 }
 
 bool
@@ -42,7 +42,7 @@
 
 #include "SharedHandle.h"
 #include "A2STR.h"
-#include "ValueBase.h"
+#include "bencode2.h"
 
 namespace aria2 {
 
@@ -57,12 +57,12 @@ public:
   virtual ~DHTMessageFactory() {}
 
   virtual SharedHandle<DHTQueryMessage>
-  createQueryMessage(const Dict* dict,
+  createQueryMessage(const bencode2::Node* dict,
                      const std::string& ipaddr, uint16_t port) = 0;
 
   virtual SharedHandle<DHTResponseMessage>
   createResponseMessage(const std::string& messageType,
-                        const Dict* dict,
+                        const bencode2::Node* dict,
                         const std::string& ipaddr, uint16_t port) = 0;
 
   virtual SharedHandle<DHTQueryMessage>
@@ -89,11 +89,13 @@ DHTMessageFactoryImpl::getRemoteNode
 }
 
 namespace {
-const Dict* getDictionary(const Dict* dict, const std::string& key)
+const bencode2::Node* getNode
+(const bencode2::Node* dict, const std::string& key,
+ bencode2::Node::Type type)
 {
-  const Dict* d = asDict(dict->get(key));
-  if(d) {
-    return d;
+  const bencode2::Node* c = dict->find(key);
+  if(c && c->type == type) {
+    return c;
   } else {
     throw DL_ABORT_EX
       (fmt("Malformed DHT message. Missing %s", key.c_str()));
@@ -102,97 +104,91 @@ const Dict* getDictionary(const Dict* dict, const std::string& key)
 } // namespace
 
 namespace {
-const String* getString(const Dict* dict, const std::string& key)
+const bencode2::Node* getDictionary
+(const bencode2::Node* dict, const std::string& key)
 {
-  const String* c = asString(dict->get(key));
-  if(c) {
-    return c;
-  } else {
-    throw DL_ABORT_EX
-      (fmt("Malformed DHT message. Missing %s", key.c_str()));
-  }
+  return getNode(dict, key, bencode2::Node::DICT);
 }
 } // namespace
 
 namespace {
-const Integer* getInteger(const Dict* dict, const std::string& key)
+const bencode2::Node* getString
+(const bencode2::Node* dict, const std::string& key)
 {
-  const Integer* c = asInteger(dict->get(key));
-  if(c) {
-    return c;
-  } else {
-    throw DL_ABORT_EX
-      (fmt("Malformed DHT message. Missing %s", key.c_str()));
-  }
+  return getNode(dict, key, bencode2::Node::STRING);
 }
 } // namespace
 
 namespace {
-const String* getString(const List* list, size_t index)
+const bencode2::Node* getInteger
+(const bencode2::Node* dict, const std::string& key)
 {
-  const String* c = asString(list->get(index));
-  if(c) {
-    return c;
-  } else {
-    throw DL_ABORT_EX
-      (fmt("Malformed DHT message. element[%lu] is not String.",
-           static_cast<unsigned long>(index)));
-  }
+  return getNode(dict, key, bencode2::Node::INTEGER);
+}
+} // namespace
+
+namespace {
+const bencode2::Node* getList
+(const bencode2::Node* dict, const std::string& key)
+{
+  return getNode(dict, key, bencode2::Node::LIST);
 }
 } // namespace
 
 namespace {
-const Integer* getInteger(const List* list, size_t index)
+const bencode2::Node* getString(const bencode2::Node* list, size_t index)
 {
-  const Integer* c = asInteger(list->get(index));
-  if(c) {
+  const bencode2::Node* c = list->get(index);
+  if(c && c->type == bencode2::Node::STRING) {
     return c;
   } else {
     throw DL_ABORT_EX
-      (fmt("Malformed DHT message. element[%lu] is not Integer.",
+      (fmt("Malformed DHT message. element[%lu] is not String.",
            static_cast<unsigned long>(index)));
   }
 }
 } // namespace
 
 namespace {
-const List* getList(const Dict* dict, const std::string& key)
+const bencode2::Node* getInteger(const bencode2::Node* list, size_t index)
 {
-  const List* l = asList(dict->get(key));
-  if(l) {
-    return l;
+  const bencode2::Node* c = list->get(index);
+  if(c && c->type == bencode2::Node::INTEGER) {
+    return c;
   } else {
     throw DL_ABORT_EX
-      (fmt("Malformed DHT message. Missing %s", key.c_str()));
+      (fmt("Malformed DHT message. element[%lu] is not Integer.",
+           static_cast<unsigned long>(index)));
   }
 }
 } // namespace
 
-void DHTMessageFactoryImpl::validateID(const String* id) const
+void DHTMessageFactoryImpl::validateID(const bencode2::Node* id) const
 {
-  if(id->s().size() != DHT_ID_LENGTH) {
+  if(id->length != DHT_ID_LENGTH) {
     throw DL_ABORT_EX
       (fmt("Malformed DHT message. Invalid ID length."
            " Expected:%lu, Actual:%lu",
            static_cast<unsigned long>(DHT_ID_LENGTH),
-           static_cast<unsigned long>(id->s().size())));
+           static_cast<unsigned long>(id->length)));
   }
 }
 
-void DHTMessageFactoryImpl::validatePort(const Integer* port) const
+void DHTMessageFactoryImpl::validatePort(const bencode2::Node* port) const
 {
-  if(!(0 < port->i() && port->i() < UINT16_MAX)) {
+  if(!(0 < port->integer && port->integer < UINT16_MAX)) {
     throw DL_ABORT_EX
       (fmt("Malformed DHT message. Invalid port=%s",
-           util::itos(port->i()).c_str()));
+           util::itos(port->integer).c_str()));
   }
 }
 
 namespace {
-void setVersion(const SharedHandle<DHTMessage>& msg, const Dict* dict)
+void setVersion(const SharedHandle<DHTMessage>& msg,
+                const bencode2::Node* dict)
 {
-  const String* v = asString(dict->get(DHTMessage::V));
-  if(v) {
+  const bencode2::Node* v = dict->find(DHTMessage::V);
+  if(v && v->type == bencode2::Node::STRING) {
     msg->setVersion(v->s());
   } else {
     msg->setVersion(A2STR::NIL);
@@ -201,39 +197,43 @@ void setVersion(const SharedHandle<DHTMessage>& msg, const Dict* dict)
 } // namespace
 
 SharedHandle<DHTQueryMessage> DHTMessageFactoryImpl::createQueryMessage
-(const Dict* dict, const std::string& ipaddr, uint16_t port)
+(const bencode2::Node* dict, const std::string& ipaddr, uint16_t port)
 {
-  const String* messageType = getString(dict, DHTQueryMessage::Q);
-  const String* transactionID = getString(dict, DHTMessage::T);
-  const String* y = getString(dict, DHTMessage::Y);
-  const Dict* aDict = getDictionary(dict, DHTQueryMessage::A);
-  if(y->s() != DHTQueryMessage::Q) {
+  const bencode2::Node* messageType = getString(dict, DHTQueryMessage::Q);
+  const bencode2::Node* transactionID = getString(dict, DHTMessage::T);
+  const bencode2::Node* y = getString(dict, DHTMessage::Y);
+  const bencode2::Node* aDict = getDictionary(dict, DHTQueryMessage::A);
+  if(!y->equals(DHTQueryMessage::Q)) {
     throw DL_ABORT_EX("Malformed DHT message. y != q");
   }
-  const String* id = getString(aDict, DHTMessage::ID);
+  const bencode2::Node* id = getString(aDict, DHTMessage::ID);
   validateID(id);
   SharedHandle<DHTNode> remoteNode = getRemoteNode(id->uc(), ipaddr, port);
   SharedHandle<DHTQueryMessage> msg;
-  if(messageType->s() == DHTPingMessage::PING) {
+  if(messageType->equals(DHTPingMessage::PING)) {
     msg = createPingMessage(remoteNode, transactionID->s());
-  } else if(messageType->s() == DHTFindNodeMessage::FIND_NODE) {
-    const String* targetNodeID =
+  } else if(messageType->equals(DHTFindNodeMessage::FIND_NODE)) {
+    const bencode2::Node* targetNodeID =
       getString(aDict, DHTFindNodeMessage::TARGET_NODE);
     validateID(targetNodeID);
     msg = createFindNodeMessage(remoteNode, targetNodeID->uc(),
                                 transactionID->s());
-  } else if(messageType->s() == DHTGetPeersMessage::GET_PEERS) {
-    const String* infoHash =  getString(aDict, DHTGetPeersMessage::INFO_HASH);
+  } else if(messageType->equals(DHTGetPeersMessage::GET_PEERS)) {
+    const bencode2::Node* infoHash =
+      getString(aDict, DHTGetPeersMessage::INFO_HASH);
     validateID(infoHash);
     msg = createGetPeersMessage(remoteNode, infoHash->uc(), transactionID->s());
-  } else if(messageType->s() == DHTAnnouncePeerMessage::ANNOUNCE_PEER) {
-    const String* infoHash = getString(aDict,DHTAnnouncePeerMessage::INFO_HASH);
+  } else if(messageType->equals(DHTAnnouncePeerMessage::ANNOUNCE_PEER)) {
+    const bencode2::Node* infoHash =
+      getString(aDict, DHTAnnouncePeerMessage::INFO_HASH);
     validateID(infoHash);
-    const Integer* port = getInteger(aDict, DHTAnnouncePeerMessage::PORT);
+    const bencode2::Node* port =
+      getInteger(aDict, DHTAnnouncePeerMessage::PORT);
     validatePort(port);
-    const String* token = getString(aDict, DHTAnnouncePeerMessage::TOKEN);
+    const bencode2::Node* token =
+      getString(aDict, DHTAnnouncePeerMessage::TOKEN);
     msg = createAnnouncePeerMessage(remoteNode, infoHash->uc(),
-                                    static_cast<uint16_t>(port->i()),
+                                    static_cast<uint16_t>(port->integer),
                                     token->s(), transactionID->s());
   } else {
     throw DL_ABORT_EX(fmt("Unsupported message type: %s",
@@ -246,30 +246,30 @@ SharedHandle<DHTQueryMessage> DHTMessageFactoryImpl::createQueryMessage
 SharedHandle<DHTResponseMessage>
 DHTMessageFactoryImpl::createResponseMessage
 (const std::string& messageType,
- const Dict* dict,
+ const bencode2::Node* dict,
  const std::string& ipaddr,
  uint16_t port)
 {
-  const String* transactionID = getString(dict, DHTMessage::T);
-  const String* y = getString(dict, DHTMessage::Y);
-  if(y->s() == DHTUnknownMessage::E) {
+  const bencode2::Node* transactionID = getString(dict, DHTMessage::T);
+  const bencode2::Node* y = getString(dict, DHTMessage::Y);
+  if(y->equals(DHTUnknownMessage::E)) {
     // for now, just report error message arrived and throw exception.
-    const List* e = getList(dict, DHTUnknownMessage::E);
-    if(e->size() == 2) {
+    const bencode2::Node* e = getList(dict, DHTUnknownMessage::E);
+    if(e->size == 2) {
       A2_LOG_INFO(fmt("Received Error DHT message. code=%s, msg=%s",
-                      util::itos(getInteger(e, 0)->i()).c_str(),
+                      util::itos(getInteger(e, 0)->integer).c_str(),
                       util::percentEncode(getString(e, 1)->s()).c_str()));
     } else {
       A2_LOG_DEBUG("e doesn't have 2 elements.");
     }
     throw DL_ABORT_EX("Received Error DHT message.");
-  } else if(y->s() != DHTResponseMessage::R) {
+  } else if(!y->equals(DHTResponseMessage::R)) {
     throw DL_ABORT_EX
       (fmt("Malformed DHT message. y != r: y=%s",
            util::percentEncode(y->s()).c_str()));
   }
-  const Dict* rDict = getDictionary(dict, DHTResponseMessage::R);
-  const String* id = getString(rDict, DHTMessage::ID);
+  const bencode2::Node* rDict = getDictionary(dict, DHTResponseMessage::R);
+  const bencode2::Node* id = getString(rDict, DHTMessage::ID);
   validateID(id);
   SharedHandle<DHTNode> remoteNode = getRemoteNode(id->uc(), ipaddr, port);
   SharedHandle<DHTResponseMessage> msg;
@@ -385,16 +385,16 @@ void DHTMessageFactoryImpl::extractNodes
 SharedHandle<DHTResponseMessage>
 DHTMessageFactoryImpl::createFindNodeReplyMessage
 (const SharedHandle<DHTNode>& remoteNode,
- const Dict* dict,
+ const bencode2::Node* dict,
  const std::string& transactionID)
 {
-  const String* nodesData =
-    asString(getDictionary(dict, DHTResponseMessage::R)->
-             get(family_ == AF_INET?DHTFindNodeReplyMessage::NODES:
-                 DHTFindNodeReplyMessage::NODES6));
+  const bencode2::Node* nodesData =
+    getDictionary(dict, DHTResponseMessage::R)->
+    find(family_ == AF_INET?DHTFindNodeReplyMessage::NODES:
+         DHTFindNodeReplyMessage::NODES6);
   std::vector<SharedHandle<DHTNode> > nodes;
-  if(nodesData) {
-    extractNodes(nodes, nodesData->uc(), nodesData->s().size());
+  if(nodesData && nodesData->type == bencode2::Node::STRING) {
+    extractNodes(nodes, nodesData->uc(), nodesData->length);
   }
   return createFindNodeReplyMessage(remoteNode, nodes, transactionID);
 }
@@ -416,26 +416,25 @@ DHTMessageFactoryImpl::createGetPeersMessage
 SharedHandle<DHTResponseMessage>
 DHTMessageFactoryImpl::createGetPeersReplyMessage
 (const SharedHandle<DHTNode>& remoteNode,
- const Dict* dict,
+ const bencode2::Node* dict,
  const std::string& transactionID)
 {
-  const Dict* rDict = getDictionary(dict, DHTResponseMessage::R);
-  const String* nodesData =
-    asString(rDict->get(family_ == AF_INET?DHTGetPeersReplyMessage::NODES:
-                        DHTGetPeersReplyMessage::NODES6));
+  const bencode2::Node* rDict = getDictionary(dict, DHTResponseMessage::R);
+  const bencode2::Node* nodesData =
+    rDict->find(family_ == AF_INET?DHTGetPeersReplyMessage::NODES:
+                DHTGetPeersReplyMessage::NODES6);
   std::vector<SharedHandle<DHTNode> > nodes;
-  if(nodesData) {
-    extractNodes(nodes, nodesData->uc(), nodesData->s().size());
+  if(nodesData && nodesData->type == bencode2::Node::STRING) {
+    extractNodes(nodes, nodesData->uc(), nodesData->length);
   }
-  const List* valuesList =
-    asList(rDict->get(DHTGetPeersReplyMessage::VALUES));
+  const bencode2::Node* valuesList =
+    rDict->find(DHTGetPeersReplyMessage::VALUES);
   std::vector<SharedHandle<Peer> > peers;
   size_t clen = bittorrent::getCompactLength(family_);
-  if(valuesList) {
-    for(List::ValueType::const_iterator i = valuesList->begin(),
-          eoi = valuesList->end(); i != eoi; ++i) {
-      const String* data = asString(*i);
-      if(data && data->s().size() == clen) {
+  if(valuesList && valuesList->type == bencode2::Node::LIST) {
+    for(const bencode2::Node* data = valuesList->first; data;
+        data = data->next) {
+      if(data->type == bencode2::Node::STRING && data->length == clen) {
         std::pair<std::string, uint16_t> addr =
           bittorrent::unpackcompact(data->uc(), family_);
         if(addr.first.empty()) {
@@ -446,7 +445,8 @@ DHTMessageFactoryImpl::createGetPeersReplyMessage
       }
     }
   }  
-  const String* token = getString(rDict, DHTGetPeersReplyMessage::TOKEN);
+  const bencode2::Node* token =
+    getString(rDict, DHTGetPeersReplyMessage::TOKEN);
   return createGetPeersReplyMessage
     (remoteNode, nodes, peers, token->s(), transactionID);
 }
@@ -68,9 +68,9 @@ private:
   SharedHandle<DHTNode> getRemoteNode
   (const unsigned char* id, const std::string& ipaddr, uint16_t port) const;
 
-  void validateID(const String* id) const;
+  void validateID(const bencode2::Node* id) const;
 
-  void validatePort(const Integer* i) const;
+  void validatePort(const bencode2::Node* i) const;
 
   void extractNodes
   (std::vector<SharedHandle<DHTNode> >& nodes,
@@ -84,12 +84,12 @@ public:
   virtual ~DHTMessageFactoryImpl();
 
   virtual SharedHandle<DHTQueryMessage>
-  createQueryMessage(const Dict* dict,
+  createQueryMessage(const bencode2::Node* dict,
                      const std::string& ipaddr, uint16_t port);
 
   virtual SharedHandle<DHTResponseMessage>
   createResponseMessage(const std::string& messageType,
-                        const Dict* dict,
+                        const bencode2::Node* dict,
                         const std::string& ipaddr, uint16_t port);
 
   virtual SharedHandle<DHTQueryMessage>
@@ -108,7 +108,7 @@ public:
 
   SharedHandle<DHTResponseMessage>
   createFindNodeReplyMessage(const SharedHandle<DHTNode>& remoteNode,
-                             const Dict* dict,
+                             const bencode2::Node* dict,
                              const std::string& transactionID);
 
 
@@ -134,7 +134,7 @@ public:
   SharedHandle<DHTResponseMessage>
   createGetPeersReplyMessage
   (const SharedHandle<DHTNode>& remoteNode,
-   const Dict* dict,
+   const bencode2::Node* dict,
    const std::string& transactionID);
 
   virtual SharedHandle<DHTQueryMessage>
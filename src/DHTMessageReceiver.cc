@@ -76,12 +76,15 @@ SharedHandle<DHTMessage> DHTMessageReceiver::receiveMessage()
       return SharedHandle<DHTMessage>();
     }
     bool isReply = false;
-    SharedHandle<ValueBase> decoded = bencode2::decode(data, length);
-    const Dict* dict = asDict(decoded);
-    if(dict) {
-      const String* y = asString(dict->get(DHTMessage::Y));
-      if(y) {
-        if(y->s() == DHTResponseMessage::R || y->s() == DHTUnknownMessage::E) {
+    // The decoded nodes point into data and are freed together with
+    // doc.
+    bencode2::Document doc;
+    const bencode2::Node* dict = doc.parse(data, length);
+    if(dict && dict->type == bencode2::Node::DICT) {
+      const bencode2::Node* y = dict->find(DHTMessage::Y);
+      if(y && y->type == bencode2::Node::STRING) {
+        if(y->equals(DHTResponseMessage::R) ||
+           y->equals(DHTUnknownMessage::E)) {
           isReply = true;
         }
       } else {
@@ -35,6 +35,7 @@
 #include "DHTMessageTracker.h"
 
 #include <utility>
+#include <algorithm>
 
 #include "DHTMessage.h"
 #include "DHTMessageCallback.h"
@@ -51,65 +52,97 @@
 
 namespace aria2 {
 
-DHTMessageTracker::DHTMessageTracker() {}
+DHTMessageTracker::DHTMessageTracker()
+  : srtt_(-1),
+    rttvar_(0),
+    missRate_(0)
+{}
 
 DHTMessageTracker::~DHTMessageTracker() {}
 
 void DHTMessageTracker::addMessage(const SharedHandle<DHTMessage>& message, time_t timeout, const SharedHandle<DHTMessageCallback>& callback)
 {
   SharedHandle<DHTMessageTrackerEntry> e(new DHTMessageTrackerEntry(message, timeout, callback));
-  entries_.push_back(e);
+  entries_.insert(std::make_pair(e->getTransactionID(), e));
+  deadlines_.insert(std::make_pair(e->getDeadline(), e));
+}
+
+DHTMessageTracker::EntryMap::iterator DHTMessageTracker::findEntry
+(const std::string& transactionID, const std::string& ipaddr, uint16_t port)
+{
+  std::pair<EntryMap::iterator, EntryMap::iterator> range =
+    entries_.equal_range(transactionID);
+  for(EntryMap::iterator i = range.first; i != range.second; ++i) {
+    if((*i).second->match(transactionID, ipaddr, port)) {
+      return i;
+    }
+  }
+  return entries_.end();
+}
+
+bool DHTMessageTracker::removeEntry
+(const SharedHandle<DHTMessageTrackerEntry>& entry)
+{
+  std::pair<EntryMap::iterator, EntryMap::iterator> range =
+    entries_.equal_range(entry->getTransactionID());
+  for(EntryMap::iterator i = range.first; i != range.second; ++i) {
+    if((*i).second.get() == entry.get()) {
+      entries_.erase(i);
+      return true;
+    }
+  }
+  return false;
 }
 
 std::pair<SharedHandle<DHTResponseMessage>, SharedHandle<DHTMessageCallback> >
 DHTMessageTracker::messageArrived
-(const Dict* dict, const std::string& ipaddr, uint16_t port)
+(const bencode2::Node* dict, const std::string& ipaddr, uint16_t port)
 {
-  const String* tid = asString(dict->get(DHTMessage::T));
-  if(!tid) {
+  const bencode2::Node* tid = dict->find(DHTMessage::T);
+  if(!tid || tid->type != bencode2::Node::STRING) {
     throw DL_ABORT_EX(fmt("Malformed DHT message. From:%s:%u",
                           ipaddr.c_str(), port));
   }
   A2_LOG_DEBUG(fmt("Searching tracker entry for TransactionID=%s, Remote=%s:%u",
                    util::toHex(tid->s()).c_str(),
                    ipaddr.c_str(), port));
-  for(std::deque<SharedHandle<DHTMessageTrackerEntry> >::iterator i =
-        entries_.begin(), eoi = entries_.end(); i != eoi; ++i) {
-    if((*i)->match(tid->s(), ipaddr, port)) {
-      SharedHandle<DHTMessageTrackerEntry> entry = *i;
-      entries_.erase(i);
-      A2_LOG_DEBUG("Tracker entry found.");
-      SharedHandle<DHTNode> targetNode = entry->getTargetNode();
-      try {
-        SharedHandle<DHTResponseMessage> message =
-          factory_->createResponseMessage(entry->getMessageType(), dict,
-                                          targetNode->getIPAddress(),
-                                          targetNode->getPort());
-
-        int64_t rtt = entry->getElapsedMillis();
-        A2_LOG_DEBUG(fmt("RTT is %s", util::itos(rtt).c_str()));
-        message->getRemoteNode()->updateRTT(rtt);
-        SharedHandle<DHTMessageCallback> callback = entry->getCallback();
-        if(!(*targetNode == *message->getRemoteNode())) {
-          // Node ID has changed. Drop previous node ID from
-          // DHTRoutingTable
-          A2_LOG_DEBUG
-            (fmt("Node ID has changed: old:%s, new:%s",
-                 util::toHex(targetNode->getID(), DHT_ID_LENGTH).c_str(),
-                 util::toHex(message->getRemoteNode()->getID(),
-                             DHT_ID_LENGTH).c_str()));
-          routingTable_->dropNode(targetNode);
-        }
-        return std::make_pair(message, callback);
-      } catch(RecoverableException& e) {
-        handleTimeoutEntry(entry);
-        throw;
-      }
+  EntryMap::iterator i = findEntry(tid->s(), ipaddr, port);
+  if(i == entries_.end()) {
+    A2_LOG_DEBUG("Tracker entry not found.");
+    return std::pair<SharedHandle<DHTResponseMessage>,
+                     SharedHandle<DHTMessageCallback> >();
+  }
+  SharedHandle<DHTMessageTrackerEntry> entry = (*i).second;
+  entries_.erase(i);
+  removeDeadline(entry);
+  A2_LOG_DEBUG("Tracker entry found.");
+  SharedHandle<DHTNode> targetNode = entry->getTargetNode();
+  try {
+    SharedHandle<DHTResponseMessage> message =
+      factory_->createResponseMessage(entry->getMessageType(), dict,
+                                      targetNode->getIPAddress(),
+                                      targetNode->getPort());
+
+    int64_t rtt = entry->getElapsedMillis();
+    A2_LOG_DEBUG(fmt("RTT is %s", util::itos(rtt).c_str()));
+    message->getRemoteNode()->updateRTT(rtt);
+    updateRTT(rtt);
+    SharedHandle<DHTMessageCallback> callback = entry->getCallback();
+    if(!(*targetNode == *message->getRemoteNode())) {
+      // Node ID has changed. Drop previous node ID from
+      // DHTRoutingTable
+      A2_LOG_DEBUG
+        (fmt("Node ID has changed: old:%s, new:%s",
+             util::toHex(targetNode->getID(), DHT_ID_LENGTH).c_str(),
+             util::toHex(message->getRemoteNode()->getID(),
+                         DHT_ID_LENGTH).c_str()));
+      routingTable_->dropNode(targetNode);
     }
+    return std::make_pair(message, callback);
+  } catch(RecoverableException& e) {
+    handleTimeoutEntry(entry);
+    throw;
   }
-  A2_LOG_DEBUG("Tracker entry not found.");
-  return std::pair<SharedHandle<DHTResponseMessage>,
-                   SharedHandle<DHTMessageCallback> >();
 }
 
 void DHTMessageTracker::handleTimeoutEntry
@@ -121,6 +154,7 @@ void DHTMessageTracker::handleTimeoutEntry
                      node->getIPAddress().c_str(), node->getPort()));
     node->updateRTT(entry->getElapsedMillis());
     node->timeout();
+    updateMissRate(true);
     if(node->isBad()) {
       A2_LOG_DEBUG(fmt("Marked bad: %s:%u",
                        node->getIPAddress().c_str(), node->getPort()));
@@ -135,30 +169,43 @@ void DHTMessageTracker::handleTimeoutEntry
   }
 }
 
+void DHTMessageTracker::removeDeadline
+(const SharedHandle<DHTMessageTrackerEntry>& entry)
+{
+  std::pair<DeadlineMap::iterator, DeadlineMap::iterator> range =
+    deadlines_.equal_range(entry->getDeadline());
+  for(DeadlineMap::iterator i = range.first; i != range.second; ++i) {
+    if((*i).second.get() == entry.get()) {
+      deadlines_.erase(i);
+      return;
+    }
+  }
+}
+
 void DHTMessageTracker::handleTimeout()
 {
-  for(std::deque<SharedHandle<DHTMessageTrackerEntry> >::iterator i =
-        entries_.begin(), eoi = entries_.end(); i != eoi;) {
-    if((*i)->isTimeout()) {
-        SharedHandle<DHTMessageTrackerEntry> entry = *i;
-        i = entries_.erase(i);
-        eoi = entries_.end();
-        handleTimeoutEntry(entry);
-    } else {
-      ++i;
+  while(!deadlines_.empty()) {
+    SharedHandle<DHTMessageTrackerEntry> entry = (*deadlines_.begin()).second;
+    if(!entry->isTimeout()) {
+      break;
     }
+    deadlines_.erase(deadlines_.begin());
+    removeEntry(entry);
+    handleTimeoutEntry(entry);
   }
 }
 
 SharedHandle<DHTMessageTrackerEntry>
 DHTMessageTracker::getEntryFor(const SharedHandle<DHTMessage>& message) const
 {
-  for(std::deque<SharedHandle<DHTMessageTrackerEntry> >::const_iterator i =
-        entries_.begin(), eoi = entries_.end(); i != eoi; ++i) {
-    if((*i)->match(message->getTransactionID(),
-                   message->getRemoteNode()->getIPAddress(),
-                   message->getRemoteNode()->getPort())) {
-      return *i;
+  const std::string& tid = message->getTransactionID();
+  std::pair<EntryMap::const_iterator, EntryMap::const_iterator> range =
+    entries_.equal_range(tid);
+  for(EntryMap::const_iterator i = range.first; i != range.second; ++i) {
+    if((*i).second->match(tid,
+                          message->getRemoteNode()->getIPAddress(),
+                          message->getRemoteNode()->getPort())) {
+      return (*i).second;
     }
   }
   return SharedHandle<DHTMessageTrackerEntry>();
@@ -169,6 +216,46 @@ size_t DHTMessageTracker::countEntry() const
   return entries_.size();
 }
 
+void DHTMessageTracker::updateRTT(int64_t rtt)
+{
+  // A late reply holds a lookup back as a timeout does.
+  updateMissRate(srtt_ >= 0 && rtt > srtt_+4*rttvar_);
+  if(srtt_ < 0) {
+    srtt_ = rtt;
+    rttvar_ = rtt/2;
+  } else {
+    rttvar_ = (3*rttvar_+(srtt_ < rtt ? rtt-srtt_ : srtt_-rtt))/4;
+    srtt_ = (7*srtt_+rtt)/8;
+  }
+}
+
+void DHTMessageTracker::updateMissRate(bool missed)
+{
+  if(missed) {
+    missRate_ += (1024-missRate_)/16;
+  } else {
+    missRate_ -= (missRate_+15)/16;
+  }
+}
+
+time_t DHTMessageTracker::getTimeout(time_t maxTimeout) const
+{
+  if(srtt_ < 0) {
+    return maxTimeout;
+  }
+  time_t timeout = static_cast<time_t>((srtt_+4*rttvar_+999)/1000);
+  return std::min(std::max(timeout,
+                           static_cast<time_t>(DHT_MIN_MESSAGE_TIMEOUT)),
+                  maxTimeout);
+}
+
+size_t DHTMessageTracker::getAlpha(size_t alpha, size_t maxAlpha) const
+{
+  // missRate_ never reaches 1024, see updateMissRate().
+  size_t answerRate = 1024-missRate_;
+  return std::min((alpha*1024+answerRate-1)/answerRate, maxAlpha);
+}
+
 void DHTMessageTracker::setRoutingTable
 (const SharedHandle<DHTRoutingTable>& routingTable)
 {
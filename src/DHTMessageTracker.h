@@ -38,11 +38,13 @@
 #include "common.h"
 
 #include <utility>
-#include <deque>
+#include <string>
+#include <map>
 
 #include "SharedHandle.h"
 #include "a2time.h"
-#include "ValueBase.h"
+#include "TimerA2.h"
+#include "bencode2.h"
 
 namespace aria2 {
 
@@ -55,12 +57,40 @@ class DHTMessageTrackerEntry;
 
 class DHTMessageTracker {
 private:
-  std::deque<SharedHandle<DHTMessageTrackerEntry> > entries_;
-  
+  // Outstanding messages indexed by transaction ID. Transaction ID is
+  // only 2 bytes long, so different nodes may share one.
+  typedef std::multimap<std::string, SharedHandle<DHTMessageTrackerEntry> >
+  EntryMap;
+
+  EntryMap entries_;
+
+  // Outstanding messages in the order of their deadline.
+  typedef std::multimap<Timer, SharedHandle<DHTMessageTrackerEntry> >
+  DeadlineMap;
+
+  DeadlineMap deadlines_;
+
+  EntryMap::iterator findEntry
+  (const std::string& transactionID, const std::string& ipaddr, uint16_t port);
+
+  bool removeEntry(const SharedHandle<DHTMessageTrackerEntry>& entry);
+
+  void removeDeadline(const SharedHandle<DHTMessageTrackerEntry>& entry);
+
   SharedHandle<DHTRoutingTable> routingTable_;
 
   SharedHandle<DHTMessageFactory> factory_;
 
+  // Smoothed RTT and RTT variation in milliseconds, computed as in
+  // RFC 6298. srtt_ is -1 until the first RTT is measured.
+  int64_t srtt_;
+  int64_t rttvar_;
+
+  // Exponentially weighted moving average of the fraction of queries
+  // which were missed, in 1/1024 units. A query is missed if it timed
+  // out or was answered later than SRTT+4*RTTVAR.
+  int missRate_;
+
   void handleTimeoutEntry(const SharedHandle<DHTMessageTrackerEntry>& entry);
 public:
   DHTMessageTracker();
@@ -73,7 +103,7 @@ public:
                   SharedHandle<DHTMessageCallback>());
 
   std::pair<SharedHandle<DHTResponseMessage>, SharedHandle<DHTMessageCallback> >
-  messageArrived(const Dict* dict,
+  messageArrived(const bencode2::Node* dict,
                  const std::string& ipaddr, uint16_t port);
 
   void handleTimeout();
@@ -83,6 +113,23 @@ public:
 
   size_t countEntry() const;
 
+  // Updates the RTT estimate and the miss rate with rtt in
+  // milliseconds of an answered query.
+  void updateRTT(int64_t rtt);
+
+  // Updates the miss rate with the outcome of a query.
+  void updateMissRate(bool missed);
+
+  // Returns the timeout in seconds for a new query: SRTT+4*RTTVAR,
+  // rounded up and clamped to [DHT_MIN_MESSAGE_TIMEOUT, maxTimeout].
+  // Returns maxTimeout until an RTT is measured.
+  time_t getTimeout(time_t maxTimeout) const;
+
+  // Returns the number of queries a lookup should keep in flight so
+  // that alpha of them are expected to be answered in time, at most
+  // maxAlpha.
+  size_t getAlpha(size_t alpha, size_t maxAlpha) const;
+
   void setRoutingTable(const SharedHandle<DHTRoutingTable>& routingTable);
 
   void setMessageFactory(const SharedHandle<DHTMessageFactory>& factory);
@@ -63,6 +63,13 @@ bool DHTMessageTrackerEntry::isTimeout() const
 void DHTMessageTrackerEntry::extendTimeout()
 {}
 
+Timer DHTMessageTrackerEntry::getDeadline() const
+{
+  Timer deadline = dispatchedTime_;
+  deadline.advance(timeout_);
+  return deadline;
+}
+
 bool DHTMessageTrackerEntry::match(const std::string& transactionID, const std::string& ipaddr, uint16_t port) const
 {
   if(transactionID_ != transactionID || targetNode_->getPort() != port) {
@@ -77,6 +77,14 @@ public:
 
   bool match(const std::string& transactionID, const std::string& ipaddr, uint16_t port) const;
 
+  const std::string& getTransactionID() const
+  {
+    return transactionID_;
+  }
+
+  // Returns the time when this message times out.
+  Timer getDeadline() const;
+
   const SharedHandle<DHTNode>& getTargetNode() const
   {
     return targetNode_;
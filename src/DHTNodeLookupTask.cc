@@ -41,6 +41,7 @@
 #include "util.h"
 #include "DHTNodeLookupTaskCallback.h"
 #include "DHTQueryMessage.h"
+#include "fmt.h"
 
 namespace aria2 {
 
@@ -64,6 +65,24 @@ DHTNodeLookupTask::createMessage(const SharedHandle<DHTNode>& remoteNode)
   return getMessageFactory()->createFindNodeMessage(remoteNode, getTargetID());
 }
 
+bool DHTNodeLookupTask::finishIfDuplicateOf(const DHTTask& task)
+{
+  const DHTNodeLookupTask* lookup =
+    dynamic_cast<const DHTNodeLookupTask*>(&task);
+  if(!lookup) {
+    return false;
+  }
+  if(memcmp(getTargetID(), lookup->getTargetID(),
+            DHT_LOOKUP_DEDUP_PREFIX_BITS/8) != 0) {
+    return false;
+  }
+  A2_LOG_DEBUG(fmt("Node lookup for %s is covered by the one for %s",
+                   util::toHex(getTargetID(), DHT_ID_LENGTH).c_str(),
+                   util::toHex(lookup->getTargetID(), DHT_ID_LENGTH).c_str()));
+  setFinished(true);
+  return true;
+}
+
 SharedHandle<DHTMessageCallback> DHTNodeLookupTask::createCallback()
 {
   return SharedHandle<DHTNodeLookupTaskCallback>
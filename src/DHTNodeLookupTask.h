@@ -54,6 +54,11 @@ public:
   (const SharedHandle<DHTNode>& remoteNode);
 
   virtual SharedHandle<DHTMessageCallback> createCallback();
+
+  // Returns true if task is a node lookup whose target shares
+  // DHT_LOOKUP_DEDUP_PREFIX_BITS leading bits with the target of this
+  // task.
+  virtual bool finishIfDuplicateOf(const DHTTask& task);
 };
 
 } // namespace aria2
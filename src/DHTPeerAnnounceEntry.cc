@@ -49,14 +49,47 @@ DHTPeerAnnounceEntry::DHTPeerAnnounceEntry(const unsigned char* infoHash)
 
 DHTPeerAnnounceEntry::~DHTPeerAnnounceEntry() {}
 
+namespace {
+class AddrLess {
+public:
+  bool operator()(const PeerAddrEntry& lhs, const PeerAddrEntry& rhs) const
+  {
+    if(lhs.getIPAddress() == rhs.getIPAddress()) {
+      return lhs.getPort() < rhs.getPort();
+    } else {
+      return lhs.getIPAddress() < rhs.getIPAddress();
+    }
+  }
+};
+} // namespace
+
+namespace {
+class LastUpdatedLess {
+public:
+  bool operator()(const PeerAddrEntry& lhs, const PeerAddrEntry& rhs) const
+  {
+    return lhs.getLastUpdated() < rhs.getLastUpdated();
+  }
+};
+} // namespace
+
 void DHTPeerAnnounceEntry::addPeerAddrEntry(const PeerAddrEntry& entry)
 {
   std::vector<PeerAddrEntry>::iterator i =
-    std::find(peerAddrEntries_.begin(), peerAddrEntries_.end(), entry);
-  if(i == peerAddrEntries_.end()) {
-    peerAddrEntries_.push_back(entry);
-  } else {
+    std::lower_bound(peerAddrEntries_.begin(), peerAddrEntries_.end(), entry,
+                     AddrLess());
+  if(i != peerAddrEntries_.end() && *i == entry) {
     (*i).notifyUpdate();
+  } else {
+    if(peerAddrEntries_.size() >= DHT_PEER_ANNOUNCE_MAX_PEER) {
+      std::vector<PeerAddrEntry>::iterator oldest =
+        std::min_element(peerAddrEntries_.begin(), peerAddrEntries_.end(),
+                         LastUpdatedLess());
+      peerAddrEntries_.erase(oldest);
+      i = std::lower_bound(peerAddrEntries_.begin(), peerAddrEntries_.end(),
+                           entry, AddrLess());
+    }
+    peerAddrEntries_.insert(i, entry);
   }
   notifyUpdate();
 }
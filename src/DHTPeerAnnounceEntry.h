@@ -52,6 +52,7 @@ class DHTPeerAnnounceEntry {
 private:
   unsigned char infoHash_[DHT_ID_LENGTH];
 
+  // Sorted by IP address and port.
   std::vector<PeerAddrEntry> peerAddrEntries_;
 
   Timer lastUpdated_;
@@ -61,7 +62,9 @@ public:
   ~DHTPeerAnnounceEntry();
 
   // add peer addr entry.
-  // if it already exists, update "Last Updated" property.
+  // if it already exists, update "Last Updated" property.  If there
+  // are already DHT_PEER_ANNOUNCE_MAX_PEER entries, the least recently
+  // updated one is removed.
   void addPeerAddrEntry(const PeerAddrEntry& entry);
 
   size_t countPeerAddrEntry() const;
@@ -46,42 +46,38 @@
 #include "LogFactory.h"
 #include "Logger.h"
 #include "util.h"
-#include "a2functional.h"
 #include "wallclock.h"
 #include "fmt.h"
 
 namespace aria2 {
 
-DHTPeerAnnounceStorage::DHTPeerAnnounceStorage() {}
+DHTPeerAnnounceStorage::DHTPeerAnnounceStorage()
+  : maxEntry_(DHT_PEER_ANNOUNCE_MAX_ENTRY)
+{}
 
 DHTPeerAnnounceStorage::~DHTPeerAnnounceStorage() {}
 
-namespace {
-class InfoHashLess
-{
-public:
-  bool operator()(const SharedHandle<DHTPeerAnnounceEntry>& lhs,
-                  const SharedHandle<DHTPeerAnnounceEntry>& rhs)
-  {
-    return memcmp(lhs->getInfoHash(), rhs->getInfoHash(), DHT_ID_LENGTH) < 0;
-  }
-};
-} // namespace
-
 SharedHandle<DHTPeerAnnounceEntry>
 DHTPeerAnnounceStorage::getPeerAnnounceEntry(const unsigned char* infoHash)
 {
-  SharedHandle<DHTPeerAnnounceEntry> entry(new DHTPeerAnnounceEntry(infoHash));
-
-  std::deque<SharedHandle<DHTPeerAnnounceEntry> >::iterator i = 
-    std::lower_bound(entries_.begin(), entries_.end(), entry, InfoHashLess());
-
-  if(i != entries_.end() &&
-     memcmp(infoHash, (*i)->getInfoHash(), DHT_ID_LENGTH) == 0) {
-    entry = *i;
-  } else {
-    entries_.insert(i, entry);
+  std::string key(&infoHash[0], &infoHash[DHT_ID_LENGTH]);
+  std::map<std::string, EntryList::iterator>::iterator i = index_.find(key);
+  if(i != index_.end()) {
+    // Move the entry to the end as the most recently announced one.
+    entries_.splice(entries_.end(), entries_, (*i).second);
+    return *(*i).second;
+  }
+  if(entries_.size() >= maxEntry_ && !entries_.empty()) {
+    const SharedHandle<DHTPeerAnnounceEntry>& oldest = entries_.front();
+    A2_LOG_DEBUG(fmt("Evicting peer announce entry: infoHash=%s",
+                     util::toHex(oldest->getInfoHash(),
+                                 DHT_ID_LENGTH).c_str()));
+    index_.erase(std::string(&oldest->getInfoHash()[0],
+                             &oldest->getInfoHash()[DHT_ID_LENGTH]));
+    entries_.pop_front();
   }
+  SharedHandle<DHTPeerAnnounceEntry> entry(new DHTPeerAnnounceEntry(infoHash));
+  index_.insert(std::make_pair(key, entries_.insert(entries_.end(), entry)));
   return entry;
 }
 
@@ -97,22 +93,16 @@ DHTPeerAnnounceStorage::addPeerAnnounce(const unsigned char* infoHash,
 
 bool DHTPeerAnnounceStorage::contains(const unsigned char* infoHash) const
 {
-  SharedHandle<DHTPeerAnnounceEntry> entry(new DHTPeerAnnounceEntry(infoHash));
-  return 
-    std::binary_search(entries_.begin(), entries_.end(), entry, InfoHashLess());
+  return index_.count(std::string(&infoHash[0], &infoHash[DHT_ID_LENGTH]));
 }
 
 void DHTPeerAnnounceStorage::getPeers(std::vector<SharedHandle<Peer> >& peers,
                                       const unsigned char* infoHash)
 {
-  SharedHandle<DHTPeerAnnounceEntry> entry(new DHTPeerAnnounceEntry(infoHash));
-
-  std::deque<SharedHandle<DHTPeerAnnounceEntry> >::iterator i = 
-    std::lower_bound(entries_.begin(), entries_.end(), entry, InfoHashLess());
-  if(i != entries_.end() &&
-     memcmp(infoHash, (*i)->getInfoHash(), DHT_ID_LENGTH) == 0 &&
-     !(*i)->empty()) {
-    (*i)->getPeers(peers);
+  std::map<std::string, EntryList::iterator>::const_iterator i =
+    index_.find(std::string(&infoHash[0], &infoHash[DHT_ID_LENGTH]));
+  if(i != index_.end() && !(*(*i).second)->empty()) {
+    (*(*i).second)->getPeers(peers);
   }
 }
 
@@ -132,9 +122,16 @@ void DHTPeerAnnounceStorage::handleTimeout()
   A2_LOG_DEBUG(fmt("Now purge peer announces(%lu entries) which are timed out.",
                    static_cast<unsigned long>(entries_.size())));
   std::for_each(entries_.begin(), entries_.end(), RemoveStalePeerAddrEntry());
-  entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
-                                mem_fun_sh(&DHTPeerAnnounceEntry::empty)),
-                 entries_.end());
+  for(EntryList::iterator i = entries_.begin(), eoi = entries_.end();
+      i != eoi;) {
+    if((*i)->empty()) {
+      index_.erase(std::string(&(*i)->getInfoHash()[0],
+                               &(*i)->getInfoHash()[DHT_ID_LENGTH]));
+      i = entries_.erase(i);
+    } else {
+      ++i;
+    }
+  }
   A2_LOG_DEBUG(fmt("Currently %lu peer announce entries",
                    static_cast<unsigned long>(entries_.size())));
 }
@@ -142,8 +139,8 @@ void DHTPeerAnnounceStorage::handleTimeout()
 void DHTPeerAnnounceStorage::announcePeer()
 {
   A2_LOG_DEBUG("Now announcing peer.");
-  for(std::deque<SharedHandle<DHTPeerAnnounceEntry> >::iterator i =
-        entries_.begin(), eoi = entries_.end(); i != eoi; ++i) {
+  for(EntryList::iterator i = entries_.begin(), eoi = entries_.end();
+      i != eoi; ++i) {
     if((*i)->getLastUpdated().
        difference(global::wallclock) >= DHT_PEER_ANNOUNCE_INTERVAL) {
       (*i)->notifyUpdate();
@@ -37,8 +37,10 @@
 
 #include "common.h"
 
-#include <deque>
+#include <string>
 #include <vector>
+#include <list>
+#include <map>
 
 #include "SharedHandle.h"
 
@@ -51,7 +53,17 @@ class DHTTaskFactory;
 
 class DHTPeerAnnounceStorage {
 private:
-  std::deque<SharedHandle<DHTPeerAnnounceEntry> > entries_;
+  typedef std::list<SharedHandle<DHTPeerAnnounceEntry> > EntryList;
+
+  // Entries in the order of the last peer announce. The least
+  // recently announced entry comes first and is evicted first when
+  // the number of entries reaches maxEntry_.
+  EntryList entries_;
+
+  // Index of entries_ by info hash.
+  std::map<std::string, EntryList::iterator> index_;
+
+  size_t maxEntry_;
 
   SharedHandle<DHTPeerAnnounceEntry> getPeerAnnounceEntry(const unsigned char* infoHash);
 
@@ -83,6 +95,16 @@ public:
   void setTaskQueue(const SharedHandle<DHTTaskQueue>& taskQueue);
 
   void setTaskFactory(const SharedHandle<DHTTaskFactory>& taskFactory);
+
+  size_t countEntry() const
+  {
+    return entries_.size();
+  }
+
+  void setMaxEntry(size_t maxEntry)
+  {
+    maxEntry_ = maxEntry;
+  }
 };
 
 } // namespace aria2
@@ -132,4 +132,18 @@ void DHTPeerLookupTask::setPeerStorage(const SharedHandle<PeerStorage>& ps)
   peerStorage_ = ps;
 }
 
+bool DHTPeerLookupTask::finishIfDuplicateOf(const DHTTask& task)
+{
+  const DHTPeerLookupTask* lookup =
+    dynamic_cast<const DHTPeerLookupTask*>(&task);
+  if(!lookup || peerStorage_.get() != lookup->peerStorage_.get() ||
+     memcmp(getTargetID(), lookup->getTargetID(), DHT_ID_LENGTH) != 0) {
+    return false;
+  }
+  A2_LOG_DEBUG(fmt("Peer lookup for %s is already queued",
+                   util::toHex(getTargetID(), DHT_ID_LENGTH).c_str()));
+  setFinished(true);
+  return true;
+}
+
 } // namespace aria2
@@ -73,6 +73,10 @@ public:
   void setBtRuntime(const SharedHandle<BtRuntime>& btRuntime);
 
   void setPeerStorage(const SharedHandle<PeerStorage>& peerStorage);
+
+  // Returns true if task is a peer lookup for the same info hash
+  // which stores peers in the same PeerStorage.
+  virtual bool finishIfDuplicateOf(const DHTTask& task);
 };
 
 } // namespace aria2
@@ -113,6 +113,12 @@ void DHTRoutingTable::getClosestKNodes
   dht::findClosestKNodes(nodes, root_, key);
 }
 
+size_t DHTRoutingTable::getClosestKNodes
+(SharedHandle<DHTNode>* nodes, const unsigned char* key) const
+{
+  return dht::findClosestKNodes(nodes, root_, key);
+}
+
 size_t DHTRoutingTable::countBucket() const
 {
   return numBucket_;
@@ -75,6 +75,12 @@ public:
   void getClosestKNodes(std::vector<SharedHandle<DHTNode> >& nodes,
                         const unsigned char* key) const;
 
+  // Stores the closest K good nodes to key in nodes, which must have
+  // room for DHTBucket::K nodes, and returns the number of stored
+  // nodes. No memory is allocated.
+  size_t getClosestKNodes(SharedHandle<DHTNode>* nodes,
+                          const unsigned char* key) const;
+
   size_t countBucket() const;
 
   void showBuckets() const;
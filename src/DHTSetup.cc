@@ -141,7 +141,7 @@ void DHTSetup::setup
 
     SharedHandle<DHTMessageReceiver> receiver(new DHTMessageReceiver(tracker));
 
-    SharedHandle<DHTTaskQueue> taskQueue(new DHTTaskQueueImpl());
+    SharedHandle<DHTTaskQueueImpl> taskQueue(new DHTTaskQueueImpl());
 
     SharedHandle<DHTTaskFactoryImpl> taskFactory(new DHTTaskFactoryImpl());
 
@@ -165,8 +165,11 @@ void DHTSetup::setup
     taskFactory->setMessageDispatcher(dispatcher.get());
     taskFactory->setMessageFactory(factory.get());
     taskFactory->setTaskQueue(taskQueue.get());
+    taskFactory->setMessageTracker(tracker.get());
     taskFactory->setTimeout(messageTimeout);
 
+    taskQueue->setMessageTracker(tracker.get());
+
     routingTable->setTaskQueue(taskQueue);
     routingTable->setTaskFactory(taskFactory);
 
@@ -46,6 +46,14 @@ public:
   virtual void startup() = 0;
 
   virtual bool finished() = 0;
+
+  // Called with a queued or running task before this task is
+  // queued. If task does the work of this task, this task finishes
+  // without running and returns true.
+  virtual bool finishIfDuplicateOf(const DHTTask& task)
+  {
+    return false;
+  }
 };
 
 } // namespace aria2
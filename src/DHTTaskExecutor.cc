@@ -51,15 +51,22 @@ DHTTaskExecutor::DHTTaskExecutor(size_t numConcurrent)
 DHTTaskExecutor::~DHTTaskExecutor() {}
 
 void DHTTaskExecutor::update()
+{
+  update(SIZE_MAX);
+}
+
+size_t DHTTaskExecutor::update(size_t maxStart)
 {
   execTasks_.erase(std::remove_if(execTasks_.begin(), execTasks_.end(),
                                   mem_fun_sh(&DHTTask::finished)),
                    execTasks_.end());
   size_t r = numConcurrent_-execTasks_.size();
-  while(r && !queue_.empty()) {
+  size_t numStarted = 0;
+  while(r && numStarted < maxStart && !queue_.empty()) {
     SharedHandle<DHTTask> task = queue_.front();
     queue_.pop_front();
     task->startup();
+    ++numStarted;
     if(!task->finished()) {
       execTasks_.push_back(task);
       --r;
@@ -68,6 +75,26 @@ void DHTTaskExecutor::update()
   A2_LOG_DEBUG(fmt("Executing %u Task(s). Queue has %u task(s).",
                    static_cast<unsigned int>(getExecutingTaskSize()),
                    static_cast<unsigned int>(getQueueSize())));
+  return numStarted;
+}
+
+void DHTTaskExecutor::addTask(const SharedHandle<DHTTask>& task)
+{
+  for(std::vector<SharedHandle<DHTTask> >::const_iterator i =
+        execTasks_.begin(), eoi = execTasks_.end(); i != eoi; ++i) {
+    if(!(*i)->finished() && task->finishIfDuplicateOf(*(*i))) {
+      A2_LOG_DEBUG("Dropped a task duplicating a running task.");
+      return;
+    }
+  }
+  for(std::deque<SharedHandle<DHTTask> >::const_iterator i = queue_.begin(),
+        eoi = queue_.end(); i != eoi; ++i) {
+    if(task->finishIfDuplicateOf(*(*i))) {
+      A2_LOG_DEBUG("Dropped a task duplicating a queued task.");
+      return;
+    }
+  }
+  queue_.push_back(task);
 }
 
 } // namespace aria2
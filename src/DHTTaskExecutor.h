@@ -58,10 +58,12 @@ public:
 
   void update();
 
-  void addTask(const SharedHandle<DHTTask>& task)
-  {
-    queue_.push_back(task);
-  }
+  // Removes finished tasks and starts at most maxStart queued tasks.
+  // Returns the number of tasks started.
+  size_t update(size_t maxStart);
+
+  // Queues task unless it is a duplicate of a queued or running task.
+  void addTask(const SharedHandle<DHTTask>& task);
 
   size_t getExecutingTaskSize() const
   {
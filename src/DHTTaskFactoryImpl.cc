@@ -56,6 +56,7 @@ DHTTaskFactoryImpl::DHTTaskFactoryImpl()
     dispatcher_(0),
     factory_(0),
     taskQueue_(0),
+    tracker_(0),
     timeout_(DHT_MESSAGE_TIMEOUT)
 {}
 
@@ -124,6 +125,7 @@ void DHTTaskFactoryImpl::setCommonProperty(const SharedHandle<DHTAbstractTask>&
   task->setMessageDispatcher(dispatcher_);
   task->setMessageFactory(factory_);
   task->setTaskQueue(taskQueue_);
+  task->setMessageTracker(tracker_);
   task->setLocalNode(localNode_);
 }
 
@@ -147,6 +149,11 @@ void DHTTaskFactoryImpl::setTaskQueue(DHTTaskQueue* taskQueue)
   taskQueue_ = taskQueue;
 }
 
+void DHTTaskFactoryImpl::setMessageTracker(DHTMessageTracker* tracker)
+{
+  tracker_ = tracker;
+}
+
 void DHTTaskFactoryImpl::setLocalNode(const SharedHandle<DHTNode>& localNode)
 {
   localNode_ = localNode;
@@ -46,6 +46,7 @@ class DHTMessageDispatcher;
 class DHTMessageFactory;
 class DHTTaskQueue;
 class DHTAbstractTask;
+class DHTMessageTracker;
 
 class DHTTaskFactoryImpl:public DHTTaskFactory {
 private:
@@ -59,6 +60,8 @@ private:
   
   DHTTaskQueue* taskQueue_;
 
+  DHTMessageTracker* tracker_;
+
   time_t timeout_;
 
   void setCommonProperty(const SharedHandle<DHTAbstractTask>& task);
@@ -96,6 +99,8 @@ public:
 
   void setTaskQueue(DHTTaskQueue* taskQueue);
 
+  void setMessageTracker(DHTMessageTracker* tracker);
+
   void setLocalNode(const SharedHandle<DHTNode>& localNode);
 
   void setTimeout(time_t timeout)
@@ -34,6 +34,9 @@
 /* copyright --> */
 #include "DHTTaskQueueImpl.h"
 #include "DHTTask.h"
+#include "DHTMessageTracker.h"
+#include "DHTMessageCallback.h"
+#include "DHTConstants.h"
 #include "Logger.h"
 #include "LogFactory.h"
 
@@ -45,18 +48,34 @@ const size_t NUM_CONCURRENT_TASK = 5;
 
 DHTTaskQueueImpl::DHTTaskQueueImpl()
   : periodicTaskQueue1_(NUM_CONCURRENT_TASK),
-    periodicTaskQueue2_(NUM_CONCURRENT_TASK),
-    immediateTaskQueue_(NUM_CONCURRENT_TASK)
+    // Peer lookups are many when lots of torrents are added at once,
+    // so they are run under the in-flight query budget instead of a
+    // small task limit.
+    periodicTaskQueue2_(DHT_MAX_CONCURRENT_PEER_LOOKUP),
+    immediateTaskQueue_(NUM_CONCURRENT_TASK),
+    tracker_(0)
 {}
 
 DHTTaskQueueImpl::~DHTTaskQueueImpl() {}
 
 void DHTTaskQueueImpl::executeTask()
 {
+  // A started lookup sends DHT_LOOKUP_ALPHA queries at once. Only the
+  // periodic queues are limited. Immediate tasks are pings to new
+  // peers and bootstrap lookups, which must not wait behind them.
+  size_t maxStart = SIZE_MAX;
+  if(tracker_) {
+    size_t inFlight = tracker_->countEntry();
+    if(inFlight < DHT_MAX_IN_FLIGHT_QUERY) {
+      maxStart = (DHT_MAX_IN_FLIGHT_QUERY-inFlight)/DHT_LOOKUP_ALPHA;
+    } else {
+      maxStart = 0;
+    }
+  }
   A2_LOG_DEBUG("Updating periodicTaskQueue1");
-  periodicTaskQueue1_.update();
+  maxStart -= periodicTaskQueue1_.update(maxStart);
   A2_LOG_DEBUG("Updating periodicTaskQueue2");
-  periodicTaskQueue2_.update();
+  maxStart -= periodicTaskQueue2_.update(maxStart);
   A2_LOG_DEBUG("Updating immediateTaskQueue");
   immediateTaskQueue_.update();
 }
@@ -40,6 +40,8 @@
 
 namespace aria2 {
 
+class DHTMessageTracker;
+
 class DHTTaskQueueImpl:public DHTTaskQueue {
 private:
   DHTTaskExecutor periodicTaskQueue1_;
@@ -47,6 +49,10 @@ private:
   DHTTaskExecutor periodicTaskQueue2_;
 
   DHTTaskExecutor immediateTaskQueue_;
+
+  // If set, queued tasks are started only while fewer than
+  // DHT_MAX_IN_FLIGHT_QUERY queries are outstanding.
+  DHTMessageTracker* tracker_;
 public:
   DHTTaskQueueImpl();
 
@@ -59,6 +65,11 @@ public:
   virtual void addPeriodicTask2(const SharedHandle<DHTTask>& task);
 
   virtual void addImmediateTask(const SharedHandle<DHTTask>& task);
+
+  void setMessageTracker(DHTMessageTracker* tracker)
+  {
+    tracker_ = tracker;
+  }
 };
 
 } // namespace aria2
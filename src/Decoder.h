@@ -48,7 +48,17 @@ public:
   // init() must be called before calling decode().
   virtual void init() = 0;
 
-  virtual std::string decode(const unsigned char* inbuf, size_t inlen) = 0;
+  // Decodes inbuf and appends the result to out. The caller can keep
+  // out across calls so that its storage is reused.
+  virtual void decode(std::string& out,
+                      const unsigned char* inbuf, size_t inlen) = 0;
+
+  std::string decode(const unsigned char* inbuf, size_t inlen)
+  {
+    std::string out;
+    decode(out, inbuf, inlen);
+    return out;
+  }
 
   virtual bool finished() = 0;
 
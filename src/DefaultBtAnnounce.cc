@@ -33,6 +33,9 @@
  */
 /* copyright --> */
 #include "DefaultBtAnnounce.h"
+
+#include <cstring>
+
 #include "LogFactory.h"
 #include "Logger.h"
 #include "util.h"
@@ -52,6 +55,7 @@
 #include "bittorrent_helper.h"
 #include "wallclock.h"
 #include "uri.h"
+#include "UDPTrackerRequest.h"
 
 namespace aria2 {
 
@@ -114,7 +118,7 @@ bool uriHasQuery(const std::string& uri)
 }
 } // namespace
 
-std::string DefaultBtAnnounce::getAnnounceUrl() {
+bool DefaultBtAnnounce::adjustAnnounceList() {
   if(isStoppedAnnounceReady()) {
     if(!announceList_.currentTierAcceptsStoppedEvent()) {
       announceList_.moveToStoppedAllowedTier();
@@ -134,12 +138,24 @@ std::string DefaultBtAnnounce::getAnnounceUrl() {
       announceList_.setEvent(AnnounceTier::STARTED_AFTER_COMPLETION);
     }
   } else {
-    return A2STR::NIL;
+    return false;
   }
-  unsigned int numWant = 50;
+  return true;
+}
+
+unsigned int DefaultBtAnnounce::getNumWant() const {
   if(!btRuntime_->lessThanMinPeers() || btRuntime_->isHalt()) {
-    numWant = 0;
+    return 0;
+  } else {
+    return 50;
   }
+}
+
+std::string DefaultBtAnnounce::getAnnounceUrl() {
+  if(!adjustAnnounceList()) {
+    return A2STR::NIL;
+  }
+  unsigned int numWant = getNumWant();
   TransferStat stat = peerStorage_->calculateStat();
   uint64_t left =
     pieceStorage_->getTotalLength()-pieceStorage_->getCompletedLength();
@@ -284,6 +300,79 @@ DefaultBtAnnounce::processAnnounceResponse(const unsigned char* trackerResponse,
   }
 }
 
+SharedHandle<UDPTrackerRequest>
+DefaultBtAnnounce::createUDPTrackerRequest
+(const std::string& remoteAddr, uint16_t remotePort)
+{
+  if(!adjustAnnounceList()) {
+    return SharedHandle<UDPTrackerRequest>();
+  }
+  TransferStat stat = peerStorage_->calculateStat();
+  SharedHandle<UDPTrackerRequest> req(new UDPTrackerRequest());
+  req->remoteAddr = remoteAddr;
+  req->remotePort = remotePort;
+  req->action = UDPT_ACT_ANNOUNCE;
+  const unsigned char* infoHash = bittorrent::getInfoHash(downloadContext_);
+  req->infohash.assign(infoHash, infoHash+INFO_HASH_LENGTH);
+  req->peerId.assign(bittorrent::getStaticPeerId(),
+                     bittorrent::getStaticPeerId()+PEER_ID_LENGTH);
+  req->downloaded = stat.getSessionDownloadLength();
+  req->left =
+    pieceStorage_->getTotalLength()-pieceStorage_->getCompletedLength();
+  req->uploaded = stat.getSessionUploadLength();
+  switch(announceList_.getEvent()) {
+  case AnnounceTier::STARTED:
+  case AnnounceTier::STARTED_AFTER_COMPLETION:
+    req->event = UDPT_EVT_STARTED;
+    break;
+  case AnnounceTier::STOPPED:
+    req->event = UDPT_EVT_STOPPED;
+    break;
+  case AnnounceTier::COMPLETED:
+    req->event = UDPT_EVT_COMPLETED;
+    break;
+  default:
+    req->event = UDPT_EVT_NONE;
+  }
+  if(!option_->blank(PREF_BT_EXTERNAL_IP)) {
+    unsigned char compact[COMPACT_LEN_IPV6];
+    if(bittorrent::packcompact
+       (compact, option_->get(PREF_BT_EXTERNAL_IP), 0) == COMPACT_LEN_IPV4) {
+      memcpy(&req->ip, compact, 4);
+    }
+  }
+  // Use last 4 bytes of peer ID as a key
+  req->key = bittorrent::getIntParam(bittorrent::getStaticPeerId(),
+                                     PEER_ID_LENGTH-4);
+  req->numWant = getNumWant();
+  req->port = btRuntime_->getListenPort();
+  return req;
+}
+
+void DefaultBtAnnounce::processUDPTrackerResponse
+(const SharedHandle<UDPTrackerRequest>& req)
+{
+  const SharedHandle<UDPTrackerReply>& reply = req->reply;
+  A2_LOG_DEBUG("Now processing UDP tracker response.");
+  if(reply->interval > 0) {
+    minInterval_ = reply->interval;
+    A2_LOG_DEBUG(fmt("Min interval:%ld", static_cast<long int>(minInterval_)));
+    interval_ = minInterval_;
+  }
+  incomplete_ = reply->leechers;
+  A2_LOG_DEBUG(fmt("Incomplete:%d", incomplete_));
+  complete_ = reply->seeders;
+  A2_LOG_DEBUG(fmt("Complete:%d", complete_));
+  if(!btRuntime_->isHalt() && btRuntime_->lessThanMinPeers()) {
+    std::vector<SharedHandle<Peer> > peers;
+    for(std::vector<std::pair<std::string, uint16_t> >::const_iterator i =
+          reply->peers.begin(), eoi = reply->peers.end(); i != eoi; ++i) {
+      peers.push_back(SharedHandle<Peer>(new Peer((*i).first, (*i).second)));
+    }
+    peerStorage_->addPeer(peers);
+  }
+}
+
 bool DefaultBtAnnounce::noMoreAnnounce() {
   return (trackers_ == 0 &&
           btRuntime_->isHalt() &&
@@ -70,6 +70,11 @@
 
 namespace aria2 {
 
+namespace {
+// The number of message objects kept in each message pool.
+const size_t MESSAGE_POOL_SIZE = 16;
+} // namespace
+
 DefaultBtMessageFactory::DefaultBtMessageFactory():
   cuid_(0),
   dhtEnabled_(false),
@@ -80,7 +85,10 @@ DefaultBtMessageFactory::DefaultBtMessageFactory():
   routingTable_(0),
   taskQueue_(0),
   taskFactory_(0),
-  metadataGetMode_(false)
+  metadataGetMode_(false),
+  havePool_(MESSAGE_POOL_SIZE),
+  requestPool_(MESSAGE_POOL_SIZE),
+  piecePool_(MESSAGE_POOL_SIZE)
 {}
 
 DefaultBtMessageFactory::~DefaultBtMessageFactory() {}
@@ -118,38 +126,35 @@ DefaultBtMessageFactory::createBtMessage
         msg = m;
       }
       break;
-    case BtHaveMessage::ID:
-      msg = BtHaveMessage::create(data, dataLength);
-      {
-        if(!metadataGetMode_) {
-          SharedHandle<BtMessageValidator> v
-            (new IndexBtMessageValidator(static_cast<BtHaveMessage*>(msg.get()),
-                                         downloadContext_->getNumPieces()));
-          msg->setBtMessageValidator(v);
-        }
+    case BtHaveMessage::ID: {
+      SharedHandle<BtHaveMessage> temp = havePool_.get();
+      temp->parse(data, dataLength);
+      if(!metadataGetMode_) {
+        IndexBtMessageValidator
+          (temp.get(), downloadContext_->getNumPieces()).validate();
       }
+      msg = temp;
       break;
-    case BtBitfieldMessage::ID:
-      msg = BtBitfieldMessage::create(data, dataLength);
-      {
-        if(!metadataGetMode_) {
-          SharedHandle<BtMessageValidator> v
-            (new BtBitfieldMessageValidator
-             (static_cast<BtBitfieldMessage*>(msg.get()),
-              downloadContext_->getNumPieces()));
-          msg->setBtMessageValidator(v);
-        }
+    }
+    case BtBitfieldMessage::ID: {
+      SharedHandle<BtBitfieldMessage> temp =
+        BtBitfieldMessage::create(data, dataLength);
+      if(!metadataGetMode_) {
+        BtBitfieldMessageValidator
+          (temp.get(), downloadContext_->getNumPieces()).validate();
       }
+      msg = temp;
       break;
+    }
     case BtRequestMessage::ID: {
-      BtRequestMessageHandle temp = BtRequestMessage::create(data, dataLength);
+      SharedHandle<BtRequestMessage> temp = requestPool_.get();
+      temp->parse(data, dataLength);
+      temp->setBlockIndex(0);
       if(!metadataGetMode_) {
-        SharedHandle<BtMessageValidator> validator
-          (new RangeBtMessageValidator
-           (temp.get(),
-            downloadContext_->getNumPieces(),
-            pieceStorage_->getPieceLength(temp->getIndex())));
-        temp->setBtMessageValidator(validator);
+        RangeBtMessageValidator
+          (temp.get(),
+           downloadContext_->getNumPieces(),
+           pieceStorage_->getPieceLength(temp->getIndex())).validate();
       }
       msg = temp;
       break;
@@ -157,25 +162,22 @@ DefaultBtMessageFactory::createBtMessage
     case BtCancelMessage::ID: {
       BtCancelMessageHandle temp = BtCancelMessage::create(data, dataLength);
       if(!metadataGetMode_) {
-        SharedHandle<BtMessageValidator> validator
-          (new RangeBtMessageValidator
-           (temp.get(),
-            downloadContext_->getNumPieces(),
-            pieceStorage_->getPieceLength(temp->getIndex())));
-        temp->setBtMessageValidator(validator);
+        RangeBtMessageValidator
+          (temp.get(),
+           downloadContext_->getNumPieces(),
+           pieceStorage_->getPieceLength(temp->getIndex())).validate();
       }
       msg = temp;
       break;
     }
     case BtPieceMessage::ID: {
-      BtPieceMessageHandle temp = BtPieceMessage::create(data, dataLength);
+      SharedHandle<BtPieceMessage> temp = piecePool_.get();
+      temp->parse(data, dataLength);
       if(!metadataGetMode_) {
-        BtMessageValidatorHandle validator
-          (new BtPieceMessageValidator
-           (temp.get(),
-            downloadContext_->getNumPieces(),
-            pieceStorage_->getPieceLength(temp->getIndex())));
-        temp->setBtMessageValidator(validator);
+        BtPieceMessageValidator
+          (temp.get(),
+           downloadContext_->getNumPieces(),
+           pieceStorage_->getPieceLength(temp->getIndex())).validate();
       }
       temp->setDownloadContext(downloadContext_);
       msg = temp;
@@ -190,12 +192,10 @@ DefaultBtMessageFactory::createBtMessage
     case BtRejectMessage::ID: {
       BtRejectMessageHandle temp = BtRejectMessage::create(data, dataLength);
       if(!metadataGetMode_) {
-        SharedHandle<BtMessageValidator> validator
-          (new RangeBtMessageValidator
-           (temp.get(),
-            downloadContext_->getNumPieces(),
-            pieceStorage_->getPieceLength(temp->getIndex())));
-        temp->setBtMessageValidator(validator);
+        RangeBtMessageValidator
+          (temp.get(),
+           downloadContext_->getNumPieces(),
+           pieceStorage_->getPieceLength(temp->getIndex())).validate();
       }
       msg = temp;
       break;
@@ -204,10 +204,8 @@ DefaultBtMessageFactory::createBtMessage
       BtSuggestPieceMessageHandle temp =
         BtSuggestPieceMessage::create(data, dataLength);
       if(!metadataGetMode_) {
-        SharedHandle<BtMessageValidator> validator
-          (new IndexBtMessageValidator(temp.get(),
-                                       downloadContext_->getNumPieces()));
-        temp->setBtMessageValidator(validator);
+        IndexBtMessageValidator
+          (temp.get(), downloadContext_->getNumPieces()).validate();
       }
       msg = temp;
       break;
@@ -216,10 +214,8 @@ DefaultBtMessageFactory::createBtMessage
       BtAllowedFastMessageHandle temp =
         BtAllowedFastMessage::create(data, dataLength);
       if(!metadataGetMode_) {
-        SharedHandle<BtMessageValidator> validator
-          (new IndexBtMessageValidator(temp.get(),
-                                       downloadContext_->getNumPieces()));
-        temp->setBtMessageValidator(validator);
+        IndexBtMessageValidator
+          (temp.get(), downloadContext_->getNumPieces()).validate();
       }
       msg = temp;
       break;
@@ -299,17 +295,11 @@ BtMessageHandle
 DefaultBtMessageFactory::createRequestMessage
 (const SharedHandle<Piece>& piece, size_t blockIndex)
 {
-  BtRequestMessageHandle msg
-    (new BtRequestMessage(piece->getIndex(),
-                          blockIndex*piece->getBlockLength(),
-                          piece->getBlockLength(blockIndex),
-                          blockIndex));
-  SharedHandle<BtMessageValidator> validator
-    (new RangeBtMessageValidator
-     (msg.get(),
-      downloadContext_->getNumPieces(),
-      pieceStorage_->getPieceLength(msg->getIndex())));
-  msg->setBtMessageValidator(validator);
+  SharedHandle<BtRequestMessage> msg = requestPool_.get();
+  msg->setIndex(piece->getIndex());
+  msg->setBegin(blockIndex*piece->getBlockLength());
+  msg->setLength(piece->getBlockLength(blockIndex));
+  msg->setBlockIndex(blockIndex);
   setCommonProperty(msg);
   return msg;
 }
@@ -319,12 +309,6 @@ DefaultBtMessageFactory::createCancelMessage
 (size_t index, uint32_t begin, size_t length)
 {
   BtCancelMessageHandle msg(new BtCancelMessage(index, begin, length));
-  SharedHandle<BtMessageValidator> validator
-    (new RangeBtMessageValidator
-     (msg.get(),
-      downloadContext_->getNumPieces(),
-      pieceStorage_->getPieceLength(index)));
-  msg->setBtMessageValidator(validator);
   setCommonProperty(msg);
   return msg;
 }
@@ -333,12 +317,10 @@ BtMessageHandle
 DefaultBtMessageFactory::createPieceMessage
 (size_t index, uint32_t begin, size_t length)
 {
-  BtPieceMessageHandle msg(new BtPieceMessage(index, begin, length));
-  BtMessageValidatorHandle validator
-    (new BtPieceMessageValidator(msg.get(),
-                                 downloadContext_->getNumPieces(),
-                                 pieceStorage_->getPieceLength(index)));
-  msg->setBtMessageValidator(validator);
+  SharedHandle<BtPieceMessage> msg = piecePool_.get();
+  msg->setIndex(index);
+  msg->setBegin(begin);
+  msg->setBlockLength(length);
   msg->setDownloadContext(downloadContext_);
   setCommonProperty(msg);
   return msg;
@@ -347,10 +329,8 @@ DefaultBtMessageFactory::createPieceMessage
 BtMessageHandle
 DefaultBtMessageFactory::createHaveMessage(size_t index)
 {
-  BtHaveMessageHandle msg(new BtHaveMessage(index));
-  SharedHandle<BtMessageValidator> v
-    (new IndexBtMessageValidator(msg.get(), downloadContext_->getNumPieces()));
-  msg->setBtMessageValidator(v);
+  SharedHandle<BtHaveMessage> msg = havePool_.get();
+  msg->setIndex(index);
   setCommonProperty(msg);
   return msg;
 }
@@ -393,10 +373,6 @@ DefaultBtMessageFactory::createBitfieldMessage()
   BtBitfieldMessageHandle msg
     (new BtBitfieldMessage(pieceStorage_->getBitfield(),
                            pieceStorage_->getBitfieldLength()));
-  SharedHandle<BtMessageValidator> v
-    (new BtBitfieldMessageValidator(msg.get(),
-                                    downloadContext_->getNumPieces()));
-  msg->setBtMessageValidator(v);
   setCommonProperty(msg);
   return msg;
 }
@@ -430,12 +406,6 @@ DefaultBtMessageFactory::createRejectMessage
 (size_t index, uint32_t begin, size_t length)
 {
   BtRejectMessageHandle msg(new BtRejectMessage(index, begin, length));
-  SharedHandle<BtMessageValidator> validator
-    (new RangeBtMessageValidator
-     (msg.get(),
-      downloadContext_->getNumPieces(),
-      pieceStorage_->getPieceLength(index)));
-  msg->setBtMessageValidator(validator);
   setCommonProperty(msg);
   return msg;
 }
@@ -444,9 +414,6 @@ BtMessageHandle
 DefaultBtMessageFactory::createAllowedFastMessage(size_t index)
 {
   BtAllowedFastMessageHandle msg(new BtAllowedFastMessage(index));
-  SharedHandle<BtMessageValidator> validator
-    (new IndexBtMessageValidator(msg.get(), downloadContext_->getNumPieces()));
-  msg->setBtMessageValidator(validator);
   setCommonProperty(msg);
   return msg;
 }
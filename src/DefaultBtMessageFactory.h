@@ -37,6 +37,7 @@
 
 #include "BtMessageFactory.h"
 #include "Command.h"
+#include "BtMessagePool.h"
 
 namespace aria2 {
 
@@ -53,6 +54,9 @@ class DHTNode;
 class DHTRoutingTable;
 class DHTTaskQueue;
 class DHTTaskFactory;
+class BtHaveMessage;
+class BtRequestMessage;
+class BtPieceMessage;
 
 class DefaultBtMessageFactory : public BtMessageFactory {
 private:
@@ -82,6 +86,12 @@ private:
 
   bool metadataGetMode_;
 
+  // Pools of the messages sent and received most frequently. Both
+  // received and created messages are taken from them.
+  BtMessagePool<BtHaveMessage> havePool_;
+  BtMessagePool<BtRequestMessage> requestPool_;
+  BtMessagePool<BtPieceMessage> piecePool_;
+
   void setCommonProperty(const SharedHandle<AbstractBtMessage>& msg);
 public:
   DefaultBtMessageFactory();
@@ -115,18 +115,19 @@ void DefaultBtMessageReceiver::sendHandshake() {
 }
 
 BtMessageHandle DefaultBtMessageReceiver::receiveMessage() {
+  const unsigned char* data;
   size_t dataLength = 0;
-  // Give 0 to PeerConnection::receiveMessage() to prevent memcpy.
-  if(!peerConnection_->receiveMessage(0, dataLength)) {
+  if(!peerConnection_->receiveMessage(data, dataLength)) {
     return SharedHandle<BtMessage>();
   }
-  BtMessageHandle msg =
-    messageFactory_->createBtMessage(peerConnection_->getBuffer(), dataLength);
+  BtMessageHandle msg = messageFactory_->createBtMessage(data, dataLength);
   msg->validate();
   if(msg->getId() == BtPieceMessage::ID) {
+    // The block is not copied. It is written from the buffer of
+    // PeerConnection before the next message is received.
     SharedHandle<BtPieceMessage> piecemsg =
       static_pointer_cast<BtPieceMessage>(msg);
-    piecemsg->setRawMessage(peerConnection_->detachBuffer());
+    piecemsg->setBlock(data+9);
   }
   return msg;
 }
@@ -36,6 +36,8 @@
 
 #include <cstring>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #include "PieceStorage.h"
 #include "Piece.h"
@@ -54,6 +56,8 @@
 #include "fmt.h"
 #include "array_fun.h"
 #include "DownloadContext.h"
+#include "DefaultDiskWriter.h"
+#include "bitfield.h"
 #ifdef ENABLE_BITTORRENT
 # include "PeerStorage.h"
 # include "BtRuntime.h"
@@ -64,6 +68,7 @@ namespace aria2 {
 
 const std::string DefaultBtProgressInfoFile::V0000("0000");
 const std::string DefaultBtProgressInfoFile::V0001("0001");
+const std::string DefaultBtProgressInfoFile::V0002("0002");
 
 namespace {
 std::string createFilename
@@ -82,7 +87,12 @@ DefaultBtProgressInfoFile::DefaultBtProgressInfoFile
   : dctx_(dctx),
     pieceStorage_(pieceStorage),
     option_(option),
-    filename_(createFilename(dctx_, getSuffix()))
+    filename_(createFilename(dctx_, getSuffix())),
+    savedUploadLength_(0),
+    uploadLengthOffset_(0),
+    bitfieldOffset_(0),
+    journalOffset_(0),
+    fileLength_(0)
 {}
 
 DefaultBtProgressInfoFile::~DefaultBtProgressInfoFile() {}
@@ -90,6 +100,7 @@ DefaultBtProgressInfoFile::~DefaultBtProgressInfoFile() {}
 void DefaultBtProgressInfoFile::updateFilename()
 {
   filename_ = createFilename(dctx_, getSuffix());
+  resetSavedState();
 }
 
 bool DefaultBtProgressInfoFile::isTorrentDownload()
@@ -102,10 +113,120 @@ bool DefaultBtProgressInfoFile::isTorrentDownload()
 }
 
 // Since version 0001, Integers are saved in binary form, network byte order.
+//
+// Version 0002 can be updated in place. It has the same header as
+// version 0001 up to bitfieldLength, followed by:
+//
+//   padding: 0-7 bytes, so that bitfield starts at 8 bytes boundary
+//   bitfield: bitfieldLength bytes, padded with 0 to 8 bytes boundary
+//   journal: the sequence of records
+//
+// Each journal record is:
+//
+//   recordLength: 32 bits
+//   payload: recordLength bytes, the number of in-flight pieces and
+//            in-flight pieces in the same form as version 0001
+//   checksum: 32 bits, FNV-1a of payload
+//
+// uploadLength and the words of the bitfield are overwritten in place
+// and a record is appended to the journal when in-flight pieces
+// change. The last valid record holds the current in-flight pieces.
+// A torn record at the end of the file is ignored. The journal is
+// compacted by rewriting the whole file when it grows too large.
 void DefaultBtProgressInfoFile::save()
 {
   A2_LOG_INFO(fmt(MSG_SAVING_SEGMENT_FILE, filename_.c_str()));
+  uint64_t uploadLength = getUploadLength();
+  std::string record = createInFlightRecord();
+  if(!updateInPlace(record, uploadLength)) {
+    saveAll(record, uploadLength);
+  }
+  A2_LOG_INFO(MSG_SAVED_SEGMENT_FILE);
+}
+
+uint64_t DefaultBtProgressInfoFile::getUploadLength()
+{
+#ifdef ENABLE_BITTORRENT
+  if(isTorrentDownload()) {
+    TransferStat stat = peerStorage_->calculateStat();
+    return stat.getAllTimeUploadLength();
+  }
+#endif // ENABLE_BITTORRENT
+  return 0;
+}
+
+namespace {
+// The journal is compacted when it exceeds the larger of this and the
+// size of the header and bitfield.
+const int64_t JOURNAL_COMPACTION_SIZE = 64*1024;
+
+// recordLength and checksum
+const size_t RECORD_OVERHEAD = 8;
+
+// Returns the number of padding bytes to put after offset to make it
+// 8 bytes aligned.
+size_t padding(int64_t offset)
+{
+  return (8-offset%8)%8;
+}
+
+uint32_t checksum(const std::string& data)
+{
+  uint32_t h = 2166136261u;
+  for(std::string::const_iterator i = data.begin(), eoi = data.end();
+      i != eoi; ++i) {
+    h ^= static_cast<unsigned char>(*i);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+template<typename T>
+void appendInt(std::string& s, T x)
+{
+  s.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+std::string createJournalRecord(const std::string& payload)
+{
+  std::string s;
+  s.reserve(payload.size()+RECORD_OVERHEAD);
+  appendInt(s, htonl(payload.size()));
+  s += payload;
+  appendInt(s, htonl(checksum(payload)));
+  return s;
+}
+} // namespace
+
+std::string DefaultBtProgressInfoFile::createInFlightRecord()
+{
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.reserve(pieceStorage_->countInFlightPiece());
+  pieceStorage_->getInFlightPieces(inFlightPieces);
+  std::string record;
+  // the number of in-flight piece: 32 bits
+  appendInt(record, htonl(inFlightPieces.size()));
+  for(std::vector<SharedHandle<Piece> >::const_iterator itr =
+        inFlightPieces.begin(), eoi = inFlightPieces.end();
+      itr != eoi; ++itr) {
+    appendInt(record, htonl((*itr)->getIndex()));
+    appendInt(record, htonl((*itr)->getLength()));
+    appendInt(record, htonl((*itr)->getBitfieldLength()));
+    record.append(reinterpret_cast<const char*>((*itr)->getBitfield()),
+                  (*itr)->getBitfieldLength());
+  }
+  return record;
+}
+
+void DefaultBtProgressInfoFile::saveAll
+(const std::string& record, uint64_t uploadLength)
+{
+  resetSavedState();
   std::string filenameTemp = filename_+"__temp";
+  int64_t uploadLengthOffset;
+  int64_t bitfieldOffset;
+  int64_t journalOffset;
+  int64_t fileLength;
   {
     std::ofstream o(filenameTemp.c_str(), std::ios::out|std::ios::binary);
     if(!o) {
@@ -119,8 +240,8 @@ void DefaultBtProgressInfoFile::save()
 #endif // !ENABLE_BITTORRENT
 
     // file version: 16 bits
-    // values: '1'
-    char version[] = { 0x00u, 0x01u };
+    // values: '2'
+    char version[] = { 0x00u, 0x02u };
     o.write(version, sizeof(version));
     // extension: 32 bits
     // If this is BitTorrent download, then 0x00000001
@@ -158,54 +279,125 @@ void DefaultBtProgressInfoFile::save()
     o.write(reinterpret_cast<const char*>(&totalLengthNL),
             sizeof(totalLengthNL));
     // uploadLength: 64 bits
-    uint64_t uploadLengthNL = 0;
-#ifdef ENABLE_BITTORRENT
-    if(torrentDownload) {
-      TransferStat stat = peerStorage_->calculateStat();
-      uploadLengthNL = hton64(stat.getAllTimeUploadLength());
-    }
-#endif // ENABLE_BITTORRENT
+    uploadLengthOffset = o.tellp();
+    uint64_t uploadLengthNL = hton64(uploadLength);
     o.write(reinterpret_cast<const char*>(&uploadLengthNL),
             sizeof(uploadLengthNL));
     // bitfieldLength: 32 bits
-    uint32_t bitfieldLengthNL = htonl(pieceStorage_->getBitfieldLength());
+    size_t bitfieldLength = pieceStorage_->getBitfieldLength();
+    uint32_t bitfieldLengthNL = htonl(bitfieldLength);
     o.write(reinterpret_cast<const char*>(&bitfieldLengthNL),
             sizeof(bitfieldLengthNL));
+    const char zeros[8] = { 0 };
+    o.write(zeros, padding(o.tellp()));
     // bitfield
+    bitfieldOffset = o.tellp();
     o.write(reinterpret_cast<const char*>(pieceStorage_->getBitfield()),
-            pieceStorage_->getBitfieldLength());
-    // the number of in-flight piece: 32 bits
-    // TODO implement this
-    uint32_t numInFlightPieceNL = htonl(pieceStorage_->countInFlightPiece());
-    o.write(reinterpret_cast<const char*>(&numInFlightPieceNL),
-            sizeof(numInFlightPieceNL));
-    std::vector<SharedHandle<Piece> > inFlightPieces;
-    inFlightPieces.reserve(pieceStorage_->countInFlightPiece());
-    pieceStorage_->getInFlightPieces(inFlightPieces);
-    for(std::vector<SharedHandle<Piece> >::const_iterator itr =
-          inFlightPieces.begin(), eoi = inFlightPieces.end();
-        itr != eoi; ++itr) {
-      uint32_t indexNL = htonl((*itr)->getIndex());
-      o.write(reinterpret_cast<const char*>(&indexNL), sizeof(indexNL));
-      uint32_t lengthNL = htonl((*itr)->getLength());
-      o.write(reinterpret_cast<const char*>(&lengthNL), sizeof(lengthNL));
-      uint32_t bitfieldLengthNL = htonl((*itr)->getBitfieldLength());
-      o.write(reinterpret_cast<const char*>(&bitfieldLengthNL),
-              sizeof(bitfieldLengthNL));
-      o.write(reinterpret_cast<const char*>((*itr)->getBitfield()),
-              (*itr)->getBitfieldLength());
-    }
+            bitfieldLength);
+    o.write(zeros, padding(bitfieldLength));
+    // journal
+    journalOffset = o.tellp();
+    std::string journalRecord = createJournalRecord(record);
+    o.write(journalRecord.data(), journalRecord.size());
     o.flush();
     if(!o) {
       throw DL_ABORT_EX
         (fmt(EX_SEGMENT_FILE_WRITE, filename_.c_str()));
     }
-    A2_LOG_INFO(MSG_SAVED_SEGMENT_FILE);
+    fileLength = o.tellp();
   }
   if(!File(filenameTemp).renameTo(filename_)) {
     throw DL_ABORT_EX
       (fmt(EX_SEGMENT_FILE_WRITE, filename_.c_str()));
   }
+  savedBitfield_.assign(pieceStorage_->getBitfield(),
+                        pieceStorage_->getBitfield()+
+                        pieceStorage_->getBitfieldLength());
+  savedUploadLength_ = uploadLength;
+  lastRecord_ = record;
+  uploadLengthOffset_ = uploadLengthOffset;
+  bitfieldOffset_ = bitfieldOffset;
+  journalOffset_ = journalOffset;
+  fileLength_ = fileLength;
+}
+
+bool DefaultBtProgressInfoFile::updateInPlace
+(const std::string& record, uint64_t uploadLength)
+{
+  size_t bitfieldLength = pieceStorage_->getBitfieldLength();
+  if(fileLength_ == 0 || savedBitfield_.size() != bitfieldLength) {
+    return false;
+  }
+  bool appendRecord = record != lastRecord_;
+  int64_t journalLength = fileLength_-journalOffset_;
+  if(appendRecord) {
+    journalLength += record.size()+RECORD_OVERHEAD;
+  }
+  if(journalLength > std::max(JOURNAL_COMPACTION_SIZE, journalOffset_)) {
+    A2_LOG_DEBUG(fmt("Compacting journal of %s", filename_.c_str()));
+    return false;
+  }
+  File f(filename_);
+  if(!f.isFile() || static_cast<int64_t>(f.size()) != fileLength_) {
+    // The file was removed or is not the one we wrote.
+    return false;
+  }
+  try {
+    DefaultDiskWriter writer(filename_);
+    writer.openExistingFile();
+    if(uploadLength != savedUploadLength_) {
+      uint64_t uploadLengthNL = hton64(uploadLength);
+      writer.writeData(reinterpret_cast<const unsigned char*>(&uploadLengthNL),
+                       sizeof(uploadLengthNL), uploadLengthOffset_);
+      savedUploadLength_ = uploadLength;
+    }
+    // Write the runs of changed 64 bits words.
+    const unsigned char* bitfield = pieceStorage_->getBitfield();
+    const size_t wordSize = 8;
+    size_t numWords = (bitfieldLength+wordSize-1)/wordSize;
+    for(size_t i = 0; i < numWords;) {
+      size_t first = i*wordSize;
+      size_t last = first;
+      for(; i < numWords; ++i) {
+        size_t off = i*wordSize;
+        size_t len = std::min(wordSize, bitfieldLength-off);
+        if(memcmp(bitfield+off, &savedBitfield_[off], len) == 0) {
+          break;
+        }
+        last = off+len;
+      }
+      if(first == last) {
+        ++i;
+        continue;
+      }
+      writer.writeData(bitfield+first, last-first, bitfieldOffset_+first);
+      memcpy(&savedBitfield_[first], bitfield+first, last-first);
+    }
+    if(appendRecord) {
+      std::string journalRecord = createJournalRecord(record);
+      writer.writeData
+        (reinterpret_cast<const unsigned char*>(journalRecord.data()),
+         journalRecord.size(), fileLength_);
+      fileLength_ += journalRecord.size();
+      lastRecord_ = record;
+    }
+  } catch(RecoverableException& e) {
+    A2_LOG_INFO_EX(fmt("Failed to update %s in place.", filename_.c_str()), e);
+    resetSavedState();
+    return false;
+  }
+  return true;
+}
+
+void DefaultBtProgressInfoFile::resetSavedState()
+{
+  savedBitfield_.clear();
+  savedUploadLength_ = 0;
+  lastRecord_.clear();
+  uploadLengthOffset_ = 0;
+  bitfieldOffset_ = 0;
+  journalOffset_ = 0;
+  fileLength_ = 0;
 }
 
 #define CHECK_STREAM(in, length)                                        \
@@ -218,12 +410,21 @@ void DefaultBtProgressInfoFile::save()
     throw DL_ABORT_EX(fmt(EX_SEGMENT_FILE_READ, filename_.c_str()));    \
   }
 
+#define SKIP_PADDING(in, length)                                        \
+  {                                                                     \
+    char pad[8];                                                        \
+    size_t padLength = length;                                          \
+    in.read(pad, padLength);                                            \
+    CHECK_STREAM(in, static_cast<int>(padLength));                      \
+  }
+
 // It is assumed that integers are saved as:
 // 1) host byte order if version == 0000
-// 2) network byte order if version == 0001
+// 2) network byte order if version >= 0001
 void DefaultBtProgressInfoFile::load() 
 {
   A2_LOG_INFO(fmt(MSG_LOADING_SEGMENT_FILE, filename_.c_str()));
+  resetSavedState();
   std::ifstream in(filename_.c_str(), std::ios::in|std::ios::binary);
   if(!in) {
     throw DL_ABORT_EX
@@ -238,6 +439,8 @@ void DefaultBtProgressInfoFile::load()
     version = 0;
   } else if(DefaultBtProgressInfoFile::V0001 == versionHex) {
     version = 1;
+  } else if(DefaultBtProgressInfoFile::V0002 == versionHex) {
+    version = 2;
   } else {
     throw DL_ABORT_EX
       (fmt("Unsupported ctrl file version: %s",
@@ -302,6 +505,7 @@ void DefaultBtProgressInfoFile::load()
            util::itos(dctx_->getTotalLength()).c_str(),
            util::itos(totalLength).c_str()));
   }
+  int64_t uploadLengthOffset = in.tellg();
   uint64_t uploadLength;
   in.read(reinterpret_cast<char*>(&uploadLength), sizeof(uploadLength));
   CHECK_STREAM(in, sizeof(uploadLength));
@@ -328,18 +532,66 @@ void DefaultBtProgressInfoFile::load()
            expectedBitfieldLength,
            bitfieldLength));
   }
-
+  if(version >= 2) {
+    SKIP_PADDING(in, padding(in.tellg()));
+  }
+  int64_t bitfieldOffset = in.tellg();
   array_ptr<unsigned char> savedBitfield(new unsigned char[bitfieldLength]);
   in.read(reinterpret_cast<char*>
           (static_cast<unsigned char*>(savedBitfield)), bitfieldLength);
   CHECK_STREAM(in, static_cast<int>(bitfieldLength));
+  // Since version 0002, in-flight pieces are read from the last valid
+  // journal record.
+  std::istringstream rin;
+  std::string record;
+  int64_t journalOffset = 0;
+  int64_t journalEnd = 0;
+  if(version >= 2) {
+    SKIP_PADDING(in, padding(bitfieldLength));
+    journalOffset = journalEnd = in.tellg();
+    uint64_t fileLength = File(filename_).size();
+    while(1) {
+      uint32_t recordLength;
+      in.read(reinterpret_cast<char*>(&recordLength), sizeof(recordLength));
+      if(in.gcount() != sizeof(recordLength)) {
+        break;
+      }
+      recordLength = ntohl(recordLength);
+      if(recordLength > fileLength-journalEnd) {
+        break;
+      }
+      std::string payload(recordLength, '\0');
+      in.read(&payload[0], recordLength);
+      if(in.gcount() != static_cast<int>(recordLength)) {
+        break;
+      }
+      uint32_t sum;
+      in.read(reinterpret_cast<char*>(&sum), sizeof(sum));
+      if(in.gcount() != sizeof(sum) || ntohl(sum) != checksum(payload)) {
+        break;
+      }
+      record.swap(payload);
+      journalEnd += recordLength+RECORD_OVERHEAD;
+    }
+    if(record.empty()) {
+      // saveAll() always writes a record. The file was truncated.
+      A2_LOG_INFO(fmt("No valid journal record found in %s",
+                      filename_.c_str()));
+      appendInt(record, static_cast<uint32_t>(0));
+    } else if(static_cast<int64_t>(fileLength) != journalEnd) {
+      A2_LOG_INFO(fmt("Ignored torn journal record in %s",
+                      filename_.c_str()));
+    }
+    rin.str(record);
+  }
+  std::istream& pin = version >= 2 ? rin : static_cast<std::istream&>(in);
   if(pieceLength == dctx_->getPieceLength()) {
     pieceStorage_->setBitfield(savedBitfield, bitfieldLength);
 
     uint32_t numInFlightPiece;
-    in.read(reinterpret_cast<char*>(&numInFlightPiece),
-            sizeof(numInFlightPiece));
-    CHECK_STREAM(in, sizeof(numInFlightPiece));
+    pin.read(reinterpret_cast<char*>(&numInFlightPiece),
+             sizeof(numInFlightPiece));
+    CHECK_STREAM(pin, sizeof(numInFlightPiece));
     if(version >= 1) {
       numInFlightPiece = ntohl(numInFlightPiece);
     }
@@ -347,8 +599,8 @@ void DefaultBtProgressInfoFile::load()
     inFlightPieces.reserve(numInFlightPiece);
     while(numInFlightPiece--) {
       uint32_t index;
-      in.read(reinterpret_cast<char*>(&index), sizeof(index));
-      CHECK_STREAM(in, sizeof(index));
+      pin.read(reinterpret_cast<char*>(&index), sizeof(index));
+      CHECK_STREAM(pin, sizeof(index));
       if(version >= 1) {
         index = ntohl(index);
       }
@@ -357,8 +609,8 @@ void DefaultBtProgressInfoFile::load()
           (fmt("piece index out of range: %u", index));
       }
       uint32_t length;
-      in.read(reinterpret_cast<char*>(&length), sizeof(length));
-      CHECK_STREAM(in, sizeof(length));
+      pin.read(reinterpret_cast<char*>(&length), sizeof(length));
+      CHECK_STREAM(pin, sizeof(length));
       if(version >= 1) {
         length = ntohl(length);
       }
@@ -368,9 +620,9 @@ void DefaultBtProgressInfoFile::load()
       }
       SharedHandle<Piece> piece(new Piece(index, length));
       uint32_t bitfieldLength;
-      in.read(reinterpret_cast<char*>(&bitfieldLength),
-              sizeof(bitfieldLength));
-      CHECK_STREAM(in, sizeof(bitfieldLength));
+      pin.read(reinterpret_cast<char*>(&bitfieldLength),
+               sizeof(bitfieldLength));
+      CHECK_STREAM(pin, sizeof(bitfieldLength));
       if(version >= 1) {
         bitfieldLength = ntohl(bitfieldLength);
       }
@@ -383,9 +635,15 @@ void DefaultBtProgressInfoFile::load()
       }
       array_ptr<unsigned char> pieceBitfield
         (new unsigned char[bitfieldLength]);
-      in.read(reinterpret_cast<char*>
-              (static_cast<unsigned char*>(pieceBitfield)), bitfieldLength);
-      CHECK_STREAM(in, static_cast<int>(bitfieldLength));
+      pin.read(reinterpret_cast<char*>
+               (static_cast<unsigned char*>(pieceBitfield)), bitfieldLength);
+      CHECK_STREAM(pin, static_cast<int>(bitfieldLength));
+      if(version >= 2 &&
+         bitfield::test(static_cast<const unsigned char*>(savedBitfield),
+                        dctx_->getNumPieces(), index)) {
+        // The bitfield was updated after this record was written.
+        continue;
+      }
       piece->setBitfield(pieceBitfield, bitfieldLength);
 
 #ifdef ENABLE_MESSAGE_DIGEST
@@ -397,11 +655,21 @@ void DefaultBtProgressInfoFile::load()
       inFlightPieces.push_back(piece);
     }
     pieceStorage_->addInFlightPiece(inFlightPieces);
+    if(version >= 2) {
+      const unsigned char* p = savedBitfield;
+      savedBitfield_.assign(p, p+bitfieldLength);
+      savedUploadLength_ = uploadLength;
+      lastRecord_ = record;
+      uploadLengthOffset_ = uploadLengthOffset;
+      bitfieldOffset_ = bitfieldOffset;
+      journalOffset_ = journalOffset;
+      fileLength_ = journalEnd;
+    }
   } else {
     uint32_t numInFlightPiece;
-    in.read(reinterpret_cast<char*>(&numInFlightPiece),
-            sizeof(numInFlightPiece));
-    CHECK_STREAM(in, sizeof(numInFlightPiece));
+    pin.read(reinterpret_cast<char*>(&numInFlightPiece),
+             sizeof(numInFlightPiece));
+    CHECK_STREAM(pin, sizeof(numInFlightPiece));
     if(version >= 1) {
       numInFlightPiece = ntohl(numInFlightPiece);
     }
@@ -428,6 +696,7 @@ void DefaultBtProgressInfoFile::removeFile()
     File f(filename_);
     f.remove();
   }
+  resetSavedState();
 }
 
 bool DefaultBtProgressInfoFile::exists()
@@ -37,6 +37,8 @@
 
 #include "BtProgressInfoFile.h"
 
+#include <vector>
+
 namespace aria2 {
 
 class DownloadContext;
@@ -56,10 +58,39 @@ private:
   const Option* option_;
   std::string filename_;
 
+  // The state of the control file as of the last save() or load().
+  // save() uses it to update the file in place. fileLength_ is 0 if
+  // the file must be rewritten.
+  std::vector<unsigned char> savedBitfield_;
+  uint64_t savedUploadLength_;
+  std::string lastRecord_;
+  int64_t uploadLengthOffset_;
+  int64_t bitfieldOffset_;
+  int64_t journalOffset_;
+  int64_t fileLength_;
+
   bool isTorrentDownload();
 
+  uint64_t getUploadLength();
+
+  // Returns the payload of the journal record which holds all
+  // in-flight pieces.
+  std::string createInFlightRecord();
+
+  // Writes the whole control file to the temporary file and renames
+  // it to filename_.
+  void saveAll(const std::string& record, uint64_t uploadLength);
+
+  // Writes the changed bitfield words and uploadLength in place and
+  // appends record to the journal. Returns false if the file must be
+  // rewritten instead.
+  bool updateInPlace(const std::string& record, uint64_t uploadLength);
+
+  void resetSavedState();
+
   static const std::string V0000;
   static const std::string V0001;
+  static const std::string V0002;
 public:
   DefaultBtProgressInfoFile(const SharedHandle<DownloadContext>& btContext,
                             const SharedHandle<PieceStorage>& pieceStorage,
@@ -36,6 +36,7 @@
 
 #include <numeric>
 #include <algorithm>
+#include <iterator>
 
 #include "DownloadContext.h"
 #include "Piece.h"
@@ -60,6 +61,7 @@
 #include "PieceStatMan.h"
 #include "wallclock.h"
 #include "bitfield.h"
+#include "WrDiskCache.h"
 #ifdef ENABLE_BITTORRENT
 # include "bittorrent_helper.h"
 #endif // ENABLE_BITTORRENT
@@ -81,6 +83,12 @@ DefaultPieceStorage::DefaultPieceStorage
 
 DefaultPieceStorage::~DefaultPieceStorage()
 {
+  if(wrDiskCache_) {
+    for(std::deque<SharedHandle<Piece> >::const_iterator i =
+          usedPieces_.begin(), eoi = usedPieces_.end(); i != eoi; ++i) {
+      (*i)->releaseWrCache(wrDiskCache_.get());
+    }
+  }
   delete bitfieldMan_;
 }
 
@@ -98,6 +106,9 @@ SharedHandle<Piece> DefaultPieceStorage::checkOutPiece(size_t index)
 
 #endif // ENABLE_MESSAGE_DIGEST
 
+    if(wrDiskCache_) {
+      piece->initWrCache(wrDiskCache_.get(), diskAdaptor_);
+    }
     addUsedPiece(piece);
     return piece;
   } else {
@@ -175,11 +186,9 @@ void DefaultPieceStorage::getMissingPiece
       return;
     }
     std::vector<size_t> indexes;
-    for(size_t i = 0; i < blocks; ++i) {
-      if(bitfield::test(misbitfield, blocks, i)) {
-        indexes.push_back(i);
-      }
-    }
+    bitfield::getFirstNMissingIndex
+      (std::back_inserter(indexes), blocks,
+       static_cast<const unsigned char*>(misbitfield), blocks);
     std::random_shuffle(indexes.begin(), indexes.end());
     for(std::vector<size_t>::const_iterator i = indexes.begin(),
           eoi = indexes.end(); i != eoi && misBlock < minMissingBlocks; ++i) {
@@ -368,6 +377,10 @@ void DefaultPieceStorage::deleteUsedPiece(const SharedHandle<Piece>& piece)
     std::lower_bound(usedPieces_.begin(), usedPieces_.end(), piece,
                      DerefLess<SharedHandle<Piece> >());
   if(i != usedPieces_.end() && *(*i) == *piece) {
+    if(wrDiskCache_) {
+      (*i)->flushWrCache(wrDiskCache_.get());
+      (*i)->releaseWrCache(wrDiskCache_.get());
+    }
     usedPieces_.erase(i);
   }
 }
@@ -423,6 +436,7 @@ void DefaultPieceStorage::completePiece(const SharedHandle<Piece>& piece)
   bitfieldMan_->setBit(piece->getIndex());
   bitfieldMan_->unsetUseBit(piece->getIndex());
   addPieceStats(piece->getIndex());
+  pieceStatMan_->setPieceOwned(piece->getIndex(), true);
   if(downloadFinished()) {
     downloadContext_->resetDownloadStopTime();
     if(isSelectiveDownloadingMode()) {
@@ -597,6 +611,7 @@ void DefaultPieceStorage::setBitfield(const unsigned char* bitfield,
 {
   bitfieldMan_->setBitfield(bitfield, bitfieldLength);
   addPieceStats(bitfield, bitfieldLength);
+  updateOwnedPieces();
 }
 
 size_t DefaultPieceStorage::getBitfieldLength()
@@ -613,6 +628,17 @@ DiskAdaptorHandle DefaultPieceStorage::getDiskAdaptor() {
   return diskAdaptor_;
 }
 
+void DefaultPieceStorage::flushWrDiskCacheEntry()
+{
+  if(!wrDiskCache_) {
+    return;
+  }
+  for(std::deque<SharedHandle<Piece> >::const_iterator i =
+        usedPieces_.begin(), eoi = usedPieces_.end(); i != eoi; ++i) {
+    (*i)->flushWrCache(wrDiskCache_.get());
+  }
+}
+
 size_t DefaultPieceStorage::getPieceLength(size_t index)
 {
   return bitfieldMan_->getBlockLength(index);
@@ -671,9 +697,16 @@ void DefaultPieceStorage::removeAdvertisedPiece(time_t elapsed)
   }
 }
 
+void DefaultPieceStorage::updateOwnedPieces()
+{
+  pieceStatMan_->setOwnedPieces(bitfieldMan_->getBitfield(),
+                                bitfieldMan_->getBitfieldLength());
+}
+
 void DefaultPieceStorage::markAllPiecesDone()
 {
   bitfieldMan_->setAllBit();
+  updateOwnedPieces();
 }
 
 void DefaultPieceStorage::markPiecesDone(uint64_t length)
@@ -683,6 +716,12 @@ void DefaultPieceStorage::markPiecesDone(uint64_t length)
   } else if(length == 0) {
     // TODO this would go to markAllPiecesUndone()
     bitfieldMan_->clearAllBit();
+    if(wrDiskCache_) {
+      for(std::deque<SharedHandle<Piece> >::const_iterator i =
+            usedPieces_.begin(), eoi = usedPieces_.end(); i != eoi; ++i) {
+        (*i)->releaseWrCache(wrDiskCache_.get());
+      }
+    }
     usedPieces_.clear();
   } else {
     size_t numPiece = length/bitfieldMan_->getBlockLength();
@@ -707,11 +746,13 @@ void DefaultPieceStorage::markPiecesDone(uint64_t length)
       addUsedPiece(p);
     }
   }
+  updateOwnedPieces();
 }
 
 void DefaultPieceStorage::markPieceMissing(size_t index)
 {
   bitfieldMan_->unsetBit(index);
+  pieceStatMan_->setPieceOwned(index, false);
 }
 
 void DefaultPieceStorage::addInFlightPiece
@@ -774,4 +815,10 @@ size_t DefaultPieceStorage::getNextUsedIndex(size_t index)
   return bitfieldMan_->countBlock();
 }
 
+void DefaultPieceStorage::setWrDiskCache
+(const SharedHandle<WrDiskCache>& wrDiskCache)
+{
+  wrDiskCache_ = wrDiskCache;
+}
+
 } // namespace aria2
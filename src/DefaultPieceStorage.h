@@ -86,6 +86,10 @@ private:
 
   SharedHandle<PieceSelector> pieceSelector_;
 
+  // Shared with RequestGroupMan so that cache entries can be
+  // released safely in the destructor.
+  SharedHandle<WrDiskCache> wrDiskCache_;
+
 #ifdef ENABLE_BITTORRENT
   void getMissingPiece
   (std::vector<SharedHandle<Piece> >& pieces,
@@ -105,6 +109,10 @@ private:
 
   size_t getInFlightPieceCompletedLength() const;
 
+  // Tells pieceStatMan_ which pieces we have after bitfieldMan_ is
+  // modified in bulk.
+  void updateOwnedPieces();
+
 public:
   // Setting randomPieceStatsOrdering to true means a piece is chosen in
   // random when more than 2 pieces has the same rarity.
@@ -218,6 +226,13 @@ public:
 
   virtual SharedHandle<DiskAdaptor> getDiskAdaptor();
 
+  virtual WrDiskCache* getWrDiskCache()
+  {
+    return wrDiskCache_.get();
+  }
+
+  virtual void flushWrDiskCacheEntry();
+
   virtual size_t getPieceLength(size_t index);
 
   virtual void advertisePiece(cuid_t cuid, size_t index);
@@ -278,6 +293,10 @@ public:
   {
     return pieceSelector_;
   }
+
+  // If wrDiskCache is not 0, pieces checked out after this call
+  // buffer their data in wrDiskCache.
+  void setWrDiskCache(const SharedHandle<WrDiskCache>& wrDiskCache);
 };
 
 typedef SharedHandle<DefaultPieceStorage> DefaultPieceStorageHandle;
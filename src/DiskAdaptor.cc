@@ -33,14 +33,52 @@
  */
 /* copyright --> */
 #include "DiskAdaptor.h"
+
+#include <cstring>
+#include <vector>
+
 #include "FileEntry.h"
+#include "WrDiskCacheEntry.h"
 
 namespace aria2 {
 
+namespace {
+// Upper bound of the length of data written by one writeData() call
+// in writeCache().
+const size_t MAX_COALESCED_LENGTH = 1024*1024;
+} // namespace
+
 DiskAdaptor::DiskAdaptor()
   : fallocate_(false)
 {}
 
 DiskAdaptor::~DiskAdaptor() {}
 
+void DiskAdaptor::writeCache(const WrDiskCacheEntry* entry)
+{
+  const WrDiskCacheEntry::DataCellSet& dataSet = entry->getDataSet();
+  std::vector<unsigned char> buf;
+  for(WrDiskCacheEntry::DataCellSet::const_iterator i = dataSet.begin(),
+        eoi = dataSet.end(); i != eoi;) {
+    WrDiskCacheEntry::DataCellSet::const_iterator j = i;
+    size_t len = (*j)->len;
+    for(++j; j != eoi && (*j)->goff == (*i)->goff+static_cast<off_t>(len) &&
+          len+(*j)->len <= MAX_COALESCED_LENGTH; ++j) {
+      len += (*j)->len;
+    }
+    if(len == (*i)->len) {
+      writeData((*i)->data, (*i)->len, (*i)->goff);
+    } else {
+      buf.resize(len);
+      size_t off = 0;
+      for(WrDiskCacheEntry::DataCellSet::const_iterator k = i; k != j; ++k) {
+        memcpy(&buf[off], (*k)->data, (*k)->len);
+        off += (*k)->len;
+      }
+      writeData(&buf[0], len, (*i)->goff);
+    }
+    i = j;
+  }
+}
+
 } // namespace aria2
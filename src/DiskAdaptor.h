@@ -46,6 +46,7 @@ namespace aria2 {
 
 class FileEntry;
 class FileAllocationIterator;
+class WrDiskCacheEntry;
 
 class DiskAdaptor:public BinaryStream {
 private:
@@ -102,6 +103,19 @@ public:
   // successfully changed.
   virtual size_t utime(const Time& actime, const Time& modtime) = 0;
 
+  // Returns the file descriptor from which len bytes at offset can be
+  // read, and stores the offset of the data in that file in
+  // fileOffset.  Returns -1 if the data is not stored in a single
+  // file. The default implementation returns -1.
+  virtual int getFdForRead(off_t& fileOffset, off_t offset, size_t len)
+  {
+    return -1;
+  }
+
+  // Writes data cached in entry.  Contiguous data are coalesced and
+  // written by one writeData() call.
+  void writeCache(const WrDiskCacheEntry* entry);
+
   void enableFallocate()
   {
     fallocate_ = true;
@@ -85,6 +85,11 @@ public:
   // opens file in read/write mode. This is an optional
   // functionality. The default implementation is do noting.
   virtual void disableReadOnly() {}
+
+  // Returns the file descriptor of the opened file, or -1 if the
+  // file is not opened or the data is not stored in a file. The
+  // default implementation returns -1.
+  virtual int getFd() const { return -1; }
 };
 
 typedef SharedHandle<DiskWriter> DiskWriterHandle;
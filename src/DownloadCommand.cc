@@ -62,6 +62,7 @@
 #include "SinkStreamFilter.h"
 #include "FileEntry.h"
 #include "SocketRecvBuffer.h"
+#include "Piece.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "MessageDigest.h"
 # include "message_digest_helper.h"
@@ -72,10 +73,6 @@
 
 namespace aria2 {
 
-namespace {
-const size_t BUFSIZE = 16*1024;
-} // namespace
-
 DownloadCommand::DownloadCommand
 (cuid_t cuid,
  const SharedHandle<Request>& req,
@@ -105,13 +102,20 @@ DownloadCommand::DownloadCommand
   peerStat_->downloadStart();
   getSegmentMan()->registerPeerStat(peerStat_);
 
-  streamFilter_.reset(new SinkStreamFilter(pieceHashValidationEnabled_));
+  sinkFilter_.reset(new SinkStreamFilter(getPieceStorage()->getWrDiskCache(),
+                                         pieceHashValidationEnabled_));
+  streamFilter_ = sinkFilter_;
   streamFilter_->init();
   sinkFilterOnly_ = true;
+  getSocketRecvBuffer()->setMaxCapacity
+    (getOption()->getAsInt(PREF_MAX_RECV_BUFFER_SIZE));
   checkSocketRecvBuffer();
 }
 
 DownloadCommand::~DownloadCommand() {
+  // The buffer may be used by the command which sends the next
+  // request, so it does not keep the memory grown for the body.
+  getSocketRecvBuffer()->resetCapacity();
   peerStat_->downloadStop();
   getSegmentMan()->updateFastestPeerStat(peerStat_);
 }
@@ -139,27 +143,22 @@ bool DownloadCommand::executeInternal() {
     // read data from socket here, we will get EOF and leaves 2nd
     // response unprocessed.  To prevent this, we don't read from
     // socket when buffer is not empty.
-    eof = getSocketRecvBuffer()->recv() == 0 &&
-      !getSocket()->wantRead() && !getSocket()->wantWrite();
+    size_t len = 0;
+    if(sinkFilterOnly_ && segment->getLength() > 0 &&
+       sinkFilter_->isWrCacheUsed(segment)) {
+      len = getSinkLength(segment, getSocketRecvBuffer()->getCapacity());
+    }
+    if(len > 0) {
+      eof = receiveToWrCache(diskAdaptor, segment, len);
+    } else {
+      eof = getSocketRecvBuffer()->recv() == 0 &&
+        !getSocket()->wantRead() && !getSocket()->wantWrite();
+    }
   }
   if(!eof) {
     size_t bufSize;
     if(sinkFilterOnly_) {
-      if(segment->getLength() > 0) {
-        if(static_cast<uint64_t>(segment->getPosition()+segment->getLength()) <=
-           static_cast<uint64_t>(getFileEntry()->getLastOffset())) {
-          bufSize = std::min(segment->getLength()-segment->getWrittenLength(),
-                             getSocketRecvBuffer()->getBufferLength());
-        } else {
-          bufSize =
-            std::min
-            (static_cast<size_t>
-             (getFileEntry()->getLastOffset()-segment->getPositionToWrite()),
-             getSocketRecvBuffer()->getBufferLength());
-        }
-      } else {
-        bufSize = getSocketRecvBuffer()->getBufferLength();
-      }
+      bufSize = getSinkLength(segment, getSocketRecvBuffer()->getBufferLength());
       streamFilter_->transform(diskAdaptor, segment,
                                getSocketRecvBuffer()->getBuffer(), bufSize);
     } else {
@@ -174,6 +173,7 @@ bool DownloadCommand::executeInternal() {
     }
     getSocketRecvBuffer()->shiftBuffer(bufSize);
     peerStat_->updateDownloadLength(bufSize);
+    getRequestGroup()->updateDownloadLength(bufSize);
   }
   getSegmentMan()->updateDownloadSpeedFor(peerStat_);
   bool segmentPartComplete = false;
@@ -233,14 +233,23 @@ bool DownloadCommand::executeInternal() {
             validatePieceHash
               (segment, expectedPieceHash, segment->getHashString());
           } else {
-            messageDigest_->reset();
-            validatePieceHash
-              (segment, expectedPieceHash,
-               message_digest::hexDigest
-               (messageDigest_,
-                getPieceStorage()->getDiskAdaptor(),
-                segment->getPosition(),
-                segment->getLength()));
+            SharedHandle<Piece> piece = segment->getPiece();
+            if(piece && piece->getWrDiskCacheEntry()) {
+              validatePieceHash
+                (segment, expectedPieceHash,
+                 piece->getHashStringWithWrCache
+                 (getDownloadContext()->getPieceLength(),
+                  getPieceStorage()->getDiskAdaptor()));
+            } else {
+              messageDigest_->reset();
+              validatePieceHash
+                (segment, expectedPieceHash,
+                 message_digest::hexDigest
+                 (messageDigest_,
+                  getPieceStorage()->getDiskAdaptor(),
+                  segment->getPosition(),
+                  segment->getLength()));
+            }
           }
         } else {
           getSegmentMan()->completeSegment(getCuid(), segment);
@@ -268,6 +277,38 @@ bool DownloadCommand::executeInternal() {
   }
 }
 
+size_t DownloadCommand::getSinkLength
+(const SharedHandle<Segment>& segment, size_t len) const
+{
+  if(segment->getLength() == 0) {
+    return len;
+  }
+  if(static_cast<uint64_t>(segment->getPosition()+segment->getLength()) <=
+     static_cast<uint64_t>(getFileEntry()->getLastOffset())) {
+    return std::min(segment->getLength()-segment->getWrittenLength(), len);
+  } else {
+    return std::min
+      (static_cast<size_t>
+       (getFileEntry()->getLastOffset()-segment->getPositionToWrite()),
+       len);
+  }
+}
+
+bool DownloadCommand::receiveToWrCache
+(const SharedHandle<DiskAdaptor>& diskAdaptor,
+ const SharedHandle<Segment>& segment, size_t len)
+{
+  size_t rlen = len;
+  unsigned char* buf = getSocketRecvBuffer()->recvOwned(rlen);
+  if(!buf) {
+    return !getSocket()->wantRead() && !getSocket()->wantWrite();
+  }
+  sinkFilter_->transformOwned(diskAdaptor, segment, buf, rlen);
+  peerStat_->updateDownloadLength(rlen);
+  getRequestGroup()->updateDownloadLength(rlen);
+  return false;
+}
+
 void DownloadCommand::checkLowestDownloadSpeed() const
 {
   if(lowestDownloadSpeedLimit_ > 0 &&
@@ -362,6 +403,10 @@ void DownloadCommand::validatePieceHash(const SharedHandle<Segment>& segment,
                     util::itos(segment->getPosition(), true).c_str(),
                     expectedPieceHash.c_str(),
                     actualPieceHash.c_str()));
+    SharedHandle<Piece> piece = segment->getPiece();
+    if(piece && getPieceStorage()->getWrDiskCache()) {
+      piece->clearWrCache(getPieceStorage()->getWrDiskCache());
+    }
     segment->clear();
     getSegmentMan()->cancelSegment(getCuid());
     throw DL_RETRY_EX
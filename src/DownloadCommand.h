@@ -43,6 +43,8 @@ namespace aria2 {
 
 class PeerStat;
 class StreamFilter;
+class SinkStreamFilter;
+class DiskAdaptor;
 #ifdef ENABLE_MESSAGE_DIGEST
 class MessageDigest;
 #endif // ENABLE_MESSAGE_DIGEST
@@ -69,7 +71,21 @@ private:
 
   SharedHandle<StreamFilter> streamFilter_;
 
+  // The innermost filter of streamFilter_.
+  SharedHandle<SinkStreamFilter> sinkFilter_;
+
   bool sinkFilterOnly_;
+
+  // Returns the number of bytes, up to len, which sink filter can
+  // write for segment without going beyond the segment or the file.
+  size_t getSinkLength(const SharedHandle<Segment>& segment, size_t len) const;
+
+  // Reads data from socket directly into a buffer which is handed to
+  // write cache, so that the data is not copied from receive
+  // buffer. See SocketRecvBuffer::recvOwned(). Returns true if EOF is
+  // reached.
+  bool receiveToWrCache(const SharedHandle<DiskAdaptor>& diskAdaptor,
+                        const SharedHandle<Segment>& segment, size_t len);
 protected:
   virtual bool executeInternal();
 
@@ -65,6 +65,7 @@
 #include "BtProgressInfoFile.h"
 #include "DownloadContext.h"
 #include "fmt.h"
+#include "TLSSessionCache.h"
 #ifdef ENABLE_BITTORRENT
 # include "BtRegistry.h"
 #endif // ENABLE_BITTORRENT
@@ -98,7 +99,8 @@ DownloadEngine::DownloadEngine(const SharedHandle<EventPoll>& eventPoll)
 #ifdef ENABLE_ASYNC_DNS
     asyncDNSServers_(0),
 #endif // ENABLE_ASYNC_DNS
-    dnsCache_(new DNSCache())
+    dnsCache_(new DNSCache()),
+    tlsSessionCache_(new TLSSessionCache())
 {
   unsigned char sessionId[20];
   util::generateRandomKey(sessionId);
@@ -106,6 +108,9 @@ DownloadEngine::DownloadEngine(const SharedHandle<EventPoll>& eventPoll)
 }
 
 DownloadEngine::~DownloadEngine() {
+  A2_LOG_DEBUG(fmt("TLS session cache: hit=%lu, miss=%lu",
+                   static_cast<unsigned long>(tlsSessionCache_->countHit()),
+                   static_cast<unsigned long>(tlsSessionCache_->countMiss())));
   cleanQueue();
   setAsyncDNSServers(0);
 }
@@ -113,11 +118,83 @@ DownloadEngine::~DownloadEngine() {
 void DownloadEngine::cleanQueue() {
   std::for_each(commands_.begin(), commands_.end(), Deleter());
   commands_.clear();
+  std::vector<Command*> sleepingCommands;
+  for(std::set<std::pair<int64_t, Command*> >::const_iterator i =
+        sleepingCommands_.begin(), eoi = sleepingCommands_.end();
+      i != eoi; ++i) {
+    (*i).second->sleepingIn_ = 0;
+    sleepingCommands.push_back((*i).second);
+  }
+  sleepingCommands_.clear();
+  std::for_each(sleepingCommands.begin(), sleepingCommands.end(), Deleter());
+}
+
+void DownloadEngine::executeCommand(Command::STATUS statusFilter)
+{
+  size_t max = commands_.size();
+  for(size_t i = 0; i < max; ++i) {
+    Command* com = commands_.front();
+    commands_.pop_front();
+    if(com->statusMatch(statusFilter)) {
+      com->transitStatus();
+      if(com->execute()) {
+        delete com;
+        com = 0;
+      }
+    } else {
+      sleepCommand(com);
+    }
+    if(com) {
+      com->clearIOEvents();
+    }
+  }
+}
+
+void DownloadEngine::sleepCommand(Command* command)
+{
+  command->sleepingIn_ = this;
+  command->deadline_ =
+    global::wallclock.getTimeInMillis()+DEFAULT_REFRESH_INTERVAL;
+  sleepingCommands_.insert(std::make_pair(command->deadline_, command));
+}
+
+void DownloadEngine::wakeupCommand(Command* command)
+{
+  removeSleepingCommand(command);
+  commands_.push_back(command);
+}
+
+void DownloadEngine::removeSleepingCommand(Command* command)
+{
+  sleepingCommands_.erase(std::make_pair(command->deadline_, command));
+  command->sleepingIn_ = 0;
+}
+
+void DownloadEngine::wakeupSleepingCommands(bool all)
+{
+  int64_t now = global::wallclock.getTimeInMillis();
+  // If the system time was changed backward, deadlines may be far in
+  // the future.
+  if(!sleepingCommands_.empty() &&
+     (*sleepingCommands_.rbegin()).first-now > DEFAULT_REFRESH_INTERVAL) {
+    all = true;
+  }
+  while(!sleepingCommands_.empty()) {
+    Command* command = (*sleepingCommands_.begin()).second;
+    if(!all && now < command->deadline_) {
+      break;
+    }
+    removeSleepingCommand(command);
+    // Command is run regardless of its status, just like it was run
+    // in the periodic refresh.
+    command->status_ = Command::STATUS_ACTIVE;
+    commands_.push_back(command);
+  }
 }
 
 namespace {
-void executeCommand(std::deque<Command*>& commands,
-                    Command::STATUS statusFilter)
+void executeRoutineCommand(std::deque<Command*>& commands,
+                           Command::STATUS statusFilter)
 {
   size_t max = commands.size();
   for(size_t i = 0; i < max; ++i) {
@@ -141,21 +218,26 @@ void executeCommand(std::deque<Command*>& commands,
 
 void DownloadEngine::run()
 {
-  Timer cp;
-  cp.reset(0);
-  while(!commands_.empty() || !routineCommands_.empty()) {
+  // All commands are run in the first iteration.
+  refreshInterval_ = 0;
+  while(!commands_.empty() || !sleepingCommands_.empty() ||
+        !routineCommands_.empty()) {
     global::wallclock.reset();
     calculateStatistics();
-    if(cp.differenceInMillis(global::wallclock) >= refreshInterval_) {
+    // Sleeping commands are run when their status becomes active by
+    // I/O events or their deadline passes, so that the cost of each
+    // iteration does not depend on the number of idle commands.
+    if(refreshInterval_ == 0) {
       refreshInterval_ = DEFAULT_REFRESH_INTERVAL;
-      cp = global::wallclock;
-      executeCommand(commands_, Command::STATUS_ALL);
+      wakeupSleepingCommands(true);
+      executeCommand(Command::STATUS_ALL);
     } else {
-      executeCommand(commands_, Command::STATUS_ACTIVE);
+      wakeupSleepingCommands(false);
+      executeCommand(Command::STATUS_ACTIVE);
     }
-    executeCommand(routineCommands_, Command::STATUS_ALL);
+    executeRoutineCommand(routineCommands_, Command::STATUS_ALL);
     afterEachIteration();
-    if(!commands_.empty()) {
+    if(!commands_.empty() || !sleepingCommands_.empty()) {
       waitData();
     }
     noWait_ = false;
@@ -169,8 +251,16 @@ void DownloadEngine::waitData()
   if(noWait_) {
     tv.tv_sec = tv.tv_usec = 0;
   } else {
+    int64_t timeout = refreshInterval_;
+    if(!sleepingCommands_.empty()) {
+      // Wake up when the earliest deadline passes.
+      int64_t remaining = (*sleepingCommands_.begin()).first-
+        global::wallclock.getTimeInMillis();
+      timeout = std::max(static_cast<int64_t>(0),
+                         std::min(timeout, remaining));
+    }
     tv.tv_sec = 0;
-    tv.tv_usec = refreshInterval_*1000;
+    tv.tv_usec = timeout*1000;
   }
   eventPoll_->poll(tv);
 }
@@ -203,6 +293,16 @@ bool DownloadEngine::deleteSocketForWriteCheck(const SocketHandle& socket,
                                   EventPoll::EVENT_WRITE);
 }
 
+bool DownloadEngine::addFdForReadCheck(sock_t fd, Command* command)
+{
+  return eventPoll_->addEvents(fd, command, EventPoll::EVENT_READ);
+}
+
+bool DownloadEngine::deleteFdForReadCheck(sock_t fd, Command* command)
+{
+  return eventPoll_->deleteEvents(fd, command, EventPoll::EVENT_READ);
+}
+
 void DownloadEngine::calculateStatistics()
 {
   if(statCalc_) {
@@ -538,11 +638,18 @@ void DownloadEngine::setRefreshInterval(int64_t interval)
 
 void DownloadEngine::addCommand(const std::vector<Command*>& commands)
 {
-  commands_.insert(commands_.end(), commands.begin(), commands.end());
+  for(std::vector<Command*>::const_iterator i = commands.begin(),
+        eoi = commands.end(); i != eoi; ++i) {
+    addCommand(*i);
+  }
 }
 
 void DownloadEngine::addCommand(Command* command)
 {
+  // A sleeping command must not be pushed twice by a later wakeup.
+  if(command->sleepingIn_) {
+    removeSleepingCommand(command);
+  }
   commands_.push_back(command);
 }
 
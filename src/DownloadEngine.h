@@ -40,6 +40,7 @@
 #include <string>
 #include <deque>
 #include <map>
+#include <set>
 #include <vector>
 
 #include "SharedHandle.h"
@@ -50,6 +51,7 @@
 #include "FileAllocationMan.h"
 #include "CheckIntegrityMan.h"
 #include "DNSCache.h"
+#include "Command.h"
 #ifdef ENABLE_ASYNC_DNS
 # include "AsyncNameResolver.h"
 #endif // ENABLE_ASYNC_DNS
@@ -64,7 +66,7 @@ class CookieStorage;
 class AuthConfigFactory;
 class Request;
 class EventPoll;
-class Command;
+class TLSSessionCache;
 #ifdef ENABLE_BITTORRENT
 class BtRegistry;
 #endif // ENABLE_BITTORRENT
@@ -141,6 +143,8 @@ private:
 
   SharedHandle<DNSCache> dnsCache_;
 
+  SharedHandle<TLSSessionCache> tlsSessionCache_;
+
   SharedHandle<AuthConfigFactory> authConfigFactory_;
 
   /**
@@ -157,7 +161,21 @@ private:
   std::multimap<std::string, SocketPoolEntry>::iterator
   findSocketPoolEntry(const std::string& key);
 
+  // Commands run in the next iteration. A command whose status is
+  // not active is moved to sleepingCommands_ instead of being run.
   std::deque<Command*> commands_;
+  // Commands waiting for I/O events or their deadline, ordered by
+  // deadline.
+  std::set<std::pair<int64_t, Command*> > sleepingCommands_;
+
+  void executeCommand(Command::STATUS statusFilter);
+
+  void sleepCommand(Command* command);
+
+  // Moves sleeping commands whose deadline has passed to commands_.
+  // If all is true, all sleeping commands are moved.
+  void wakeupSleepingCommands(bool all);
+
   SharedHandle<RequestGroupMan> requestGroupMan_;
   SharedHandle<FileAllocationMan> fileAllocationMan_;
   SharedHandle<CheckIntegrityMan> checkIntegrityMan_;
@@ -179,6 +197,10 @@ public:
                               Command* command);
   bool deleteSocketForWriteCheck(const SharedHandle<SocketCore>& socket,
                                  Command* command);
+  // Registers fd, which is not necessarily a socket, for read
+  // check. This is used to wake up the event loop from other threads.
+  bool addFdForReadCheck(sock_t fd, Command* command);
+  bool deleteFdForReadCheck(sock_t fd, Command* command);
 
 #ifdef ENABLE_ASYNC_DNS
 
@@ -192,6 +214,18 @@ public:
 
   void addCommand(Command* command);
 
+  // Moves sleeping command to commands_ so that it is run in the next
+  // iteration. Called when the status of command becomes active.
+  void wakeupCommand(Command* command);
+
+  // Forgets sleeping command. Called when command is deleted.
+  void removeSleepingCommand(Command* command);
+
+  size_t countSleepingCommand() const
+  {
+    return sleepingCommands_.size();
+  }
+
   const SharedHandle<RequestGroupMan>& getRequestGroupMan() const
   {
     return requestGroupMan_;
@@ -317,6 +351,11 @@ public:
 
   void removeCachedIPAddress(const std::string& hostname, uint16_t port);
 
+  const SharedHandle<TLSSessionCache>& getTLSSessionCache() const
+  {
+    return tlsSessionCache_;
+  }
+
   void setAuthConfigFactory(const SharedHandle<AuthConfigFactory>& factory);
 
   const SharedHandle<AuthConfigFactory>& getAuthConfigFactory() const
@@ -141,8 +141,11 @@ DownloadEngineFactory::newDownloadEngine
   e->setFileAllocationMan
     (SharedHandle<FileAllocationMan>(new FileAllocationMan()));
 #ifdef ENABLE_MESSAGE_DIGEST
-  e->setCheckIntegrityMan
-    (SharedHandle<CheckIntegrityMan>(new CheckIntegrityMan()));
+  {
+    SharedHandle<CheckIntegrityMan> ciman(new CheckIntegrityMan());
+    ciman->setMaxPicked(op->getAsInt(PREF_MAX_CONCURRENT_CHECKS));
+    e->setCheckIntegrityMan(ciman);
+  }
 #endif // ENABLE_MESSAGE_DIGEST
   e->addRoutineCommand(new FillRequestGroupCommand(e->newCUID(), e.get()));
   e->addRoutineCommand(new FileAllocationDispatcherCommand
@@ -45,11 +45,13 @@
 #include "util.h"
 #include "a2functional.h"
 #include "fmt.h"
+#include "wallclock.h"
 
 namespace aria2 {
 
 EpollEventPoll::KSocketEntry::KSocketEntry(sock_t s):
-  SocketEntry<KCommandEvent, KADNSEvent>(s) {}
+  SocketEntry<KCommandEvent, KADNSEvent>(s),
+  registeredEvents_(0) {}
 
 int accumulateEvent(int events, const EpollEventPoll::KEvent& event)
 {
@@ -83,7 +85,13 @@ struct epoll_event EpollEventPoll::KSocketEntry::getEvents()
 
 EpollEventPoll::EpollEventPoll()
   : epEventsSize_(EPOLL_EVENTS_MAX),
-    epEvents_(new struct epoll_event[epEventsSize_])
+    epEvents_(new struct epoll_event[epEventsSize_]),
+    numCtl_(0),
+    numCtlSkipped_(0),
+    numWait_(0),
+    lastNumCtl_(0),
+    lastNumCtlSkipped_(0),
+    lastNumWait_(0)
 {
   epfd_ = epoll_create(EPOLL_EVENTS_MAX);
 }
@@ -115,13 +123,24 @@ void EpollEventPoll::poll(const struct timeval& tv)
   int timeout = tv.tv_sec*1000+tv.tv_usec/1000;
 
   int res;
-  while((res = epoll_wait(epfd_, epEvents_, EPOLL_EVENTS_MAX, timeout)) == -1 &&
-        errno == EINTR);
+  while((res = epoll_wait(epfd_, epEvents_, epEventsSize_, timeout)) == -1 &&
+        errno == EINTR) {
+    ++numWait_;
+  }
+  ++numWait_;
 
   if(res > 0) {
     for(int i = 0; i < res; ++i) {
       KSocketEntry* p = reinterpret_cast<KSocketEntry*>(epEvents_[i].data.ptr);
-      p->processEvents(epEvents_[i].events);
+      int desired = p->getEvents().events;
+      int events = epEvents_[i].events;
+      if(events&~desired&(EPOLLIN|EPOLLOUT)) {
+        // The event was removed by deleteEvents() but not from
+        // epoll. Since epoll is level-triggered, remove it now so that
+        // it does not fire again.
+        updateEvents(EPOLL_CTL_MOD, *p);
+      }
+      p->processEvents(events&(desired|EPOLLERR|EPOLLHUP));
     }
   }
 
@@ -141,6 +160,47 @@ void EpollEventPoll::poll(const struct timeval& tv)
 
   // TODO timeout of name resolver is determined in Command(AbstractCommand,
   // DHTEntryPoint...Command)
+
+  if(lastStat_.difference(global::wallclock) >= STAT_INTERVAL) {
+    logStat();
+  }
+}
+
+void EpollEventPoll::logStat()
+{
+  time_t elapsed = std::max(static_cast<time_t>(1),
+                            lastStat_.difference(global::wallclock));
+  A2_LOG_DEBUG(fmt("epoll: %llu epoll_ctl/s, %llu epoll_ctl skipped/s,"
+                   " %llu epoll_wait/s, %lu sockets",
+                   static_cast<unsigned long long>
+                   ((numCtl_-lastNumCtl_)/elapsed),
+                   static_cast<unsigned long long>
+                   ((numCtlSkipped_-lastNumCtlSkipped_)/elapsed),
+                   static_cast<unsigned long long>
+                   ((numWait_-lastNumWait_)/elapsed),
+                   static_cast<unsigned long>(socketEntries_.size())));
+  lastNumCtl_ = numCtl_;
+  lastNumCtlSkipped_ = numCtlSkipped_;
+  lastNumWait_ = numWait_;
+  lastStat_ = global::wallclock;
+}
+
+int EpollEventPoll::updateEvents(int op, KSocketEntry& socketEntry)
+{
+  struct epoll_event epEvent = socketEntry.getEvents();
+  ++numCtl_;
+  int r = epoll_ctl(epfd_, op, socketEntry.getSocket(), &epEvent);
+  if(r == -1 && op == EPOLL_CTL_MOD) {
+    // try EPOLL_CTL_ADD: There is a chance that previously socket X is
+    // added to epoll, but it is closed and is not yet removed from
+    // SocketEntries. In this case, EPOLL_CTL_MOD is failed with ENOENT.
+    ++numCtl_;
+    r = epoll_ctl(epfd_, EPOLL_CTL_ADD, socketEntry.getSocket(), &epEvent);
+  }
+  if(r == 0) {
+    socketEntry.setRegisteredEvents(epEvent.events);
+  }
+  return r;
 }
 
 namespace {
@@ -176,16 +236,12 @@ bool EpollEventPoll::addEvents(sock_t socket,
 
     event.addSelf(*i);
 
-    struct epoll_event epEvent = (*i)->getEvents();
-    r = epoll_ctl(epfd_, EPOLL_CTL_MOD, (*i)->getSocket(), &epEvent);
-    if(r == -1) {
-      // try EPOLL_CTL_ADD: There is a chance that previously socket X is
-      // added to epoll, but it is closed and is not yet removed from
-      // SocketEntries. In this case, EPOLL_CTL_MOD is failed with ENOENT.
-
-      r = epoll_ctl(epfd_, EPOLL_CTL_ADD, (*i)->getSocket(),
-                    &epEvent);
+    if((*i)->getEvents().events&~(*i)->getRegisteredEvents()) {
+      r = updateEvents(EPOLL_CTL_MOD, *(*i));
       errNum = errno;
+    } else {
+      // The events are already registered.
+      ++numCtlSkipped_;
     }
   } else {
     socketEntries_.insert(i, socketEntry);
@@ -197,8 +253,7 @@ bool EpollEventPoll::addEvents(sock_t socket,
 
     event.addSelf(socketEntry);
 
-    struct epoll_event epEvent = socketEntry->getEvents();
-    r = epoll_ctl(epfd_, EPOLL_CTL_ADD, socketEntry->getSocket(), &epEvent);
+    r = updateEvents(EPOLL_CTL_ADD, *socketEntry);
     errNum = errno;
   }
   if(r == -1) {
@@ -243,19 +298,14 @@ bool EpollEventPoll::deleteEvents(sock_t socket,
       // In kernel before 2.6.9, epoll_ctl with EPOLL_CTL_DEL requires non-null
       // pointer of epoll_event.
       struct epoll_event ev = {0,{0}};
+      ++numCtl_;
       r = epoll_ctl(epfd_, EPOLL_CTL_DEL, (*i)->getSocket(), &ev);
       errNum = errno;
       socketEntries_.erase(i);
     } else {
-      // If socket is closed, then it seems it is automatically removed from
-      // epoll, so following EPOLL_CTL_MOD may fail.
-      struct epoll_event epEvent = (*i)->getEvents();
-      r = epoll_ctl(epfd_, EPOLL_CTL_MOD, (*i)->getSocket(), &epEvent);
-      errNum = errno;
-      if(r == -1) {
-        A2_LOG_DEBUG(fmt("Failed to delete socket event, but may be ignored:%s",
-                         util::safeStrerror(errNum).c_str()));
-      }
+      // The events stay registered to epoll until they fire, because
+      // commands often add them again soon. See poll().
+      ++numCtlSkipped_;
     }
     if(r == -1) {
       A2_LOG_DEBUG(fmt("Failed to delete socket event:%s",
@@ -42,6 +42,7 @@
 #include <deque>
 
 #include "Event.h"
+#include "TimerA2.h"
 #ifdef ENABLE_ASYNC_DNS
 # include "AsyncNameResolver.h"
 #endif // ENABLE_ASYNC_DNS
@@ -60,10 +61,24 @@ private:
 
   class KSocketEntry:
     public SocketEntry<KCommandEvent, KADNSEvent> {
+  private:
+    // Events registered to epoll. This may include events no longer
+    // desired, because they are removed lazily.
+    int registeredEvents_;
   public:
     KSocketEntry(sock_t socket);
 
     struct epoll_event getEvents();
+
+    int getRegisteredEvents() const
+    {
+      return registeredEvents_;
+    }
+
+    void setRegisteredEvents(int events)
+    {
+      registeredEvents_ = events;
+    }
   };
 
   friend int accumulateEvent(int events, const KEvent& event);
@@ -82,6 +97,26 @@ private:
 
   static const size_t EPOLL_EVENTS_MAX = 1024;
 
+  // The number of epoll_ctl calls made and avoided.
+  uint64_t numCtl_;
+  uint64_t numCtlSkipped_;
+  uint64_t numWait_;
+
+  // Values of the counters above when statistics were logged last
+  // time.
+  uint64_t lastNumCtl_;
+  uint64_t lastNumCtlSkipped_;
+  uint64_t lastNumWait_;
+  Timer lastStat_;
+
+  static const time_t STAT_INTERVAL = 10;
+
+  // Calls epoll_ctl with events desired by socketEntry. If op is
+  // EPOLL_CTL_MOD and it fails, EPOLL_CTL_ADD is tried.
+  int updateEvents(int op, KSocketEntry& socketEntry);
+
+  void logStat();
+
   bool addEvents(sock_t socket, const KEvent& event);
 
   bool deleteEvents(sock_t socket, const KEvent& event);
@@ -114,6 +149,21 @@ public:
   (const SharedHandle<AsyncNameResolver>& resolver, Command* command);
 #endif // ENABLE_ASYNC_DNS
 
+  uint64_t getNumCtl() const
+  {
+    return numCtl_;
+  }
+
+  uint64_t getNumCtlSkipped() const
+  {
+    return numCtlSkipped_;
+  }
+
+  uint64_t getNumWait() const
+  {
+    return numWait_;
+  }
+
   static const int IEV_READ = EPOLLIN;
   static const int IEV_WRITE = EPOLLOUT;
   static const int IEV_ERROR = EPOLLERR;
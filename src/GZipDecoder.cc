@@ -73,40 +73,39 @@ void GZipDecoder::release()
   }
 }
 
-std::string GZipDecoder::decode(const unsigned char* in, size_t length)
+void GZipDecoder::decode
+(std::string& out, const unsigned char* in, size_t length)
 {
-  std::string out;
-
   if(length == 0) {
-    return out;
+    return;
   }
 
   strm_->avail_in = length;
   strm_->next_in = const_cast<unsigned char*>(in);
 
-  unsigned char outbuf[OUTBUF_LENGTH];
   while(1) {
+    // Inflate directly into the tail of out.
+    size_t offset = out.size();
+    out.resize(offset+OUTBUF_LENGTH);
     strm_->avail_out = OUTBUF_LENGTH;
-    strm_->next_out = outbuf;
+    strm_->next_out = reinterpret_cast<unsigned char*>(&out[offset]);
 
     int ret = ::inflate(strm_, Z_NO_FLUSH);
 
     if(ret == Z_STREAM_END) {
       finished_ = true;
     } else if(ret != Z_OK) {
+      out.resize(offset);
       throw DL_ABORT_EX(fmt("libz::inflate() failed. cause:%s",
                             strm_->msg));
     }
 
-    size_t produced = OUTBUF_LENGTH-strm_->avail_out;
-
-    out.append(&outbuf[0], &outbuf[produced]);
+    out.resize(out.size()-strm_->avail_out);
 
     if(strm_->avail_out > 0) {
       break;
     }
   }
-  return out;
 }
 
 bool GZipDecoder::finished()
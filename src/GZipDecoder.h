@@ -57,7 +57,10 @@ public:
 
   virtual void init();
 
-  virtual std::string decode(const unsigned char* inbuf, size_t inlen);
+  using Decoder::decode;
+
+  virtual void decode(std::string& out,
+                      const unsigned char* inbuf, size_t inlen);
 
   virtual bool finished();
 
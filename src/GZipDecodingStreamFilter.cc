@@ -45,7 +45,8 @@ const std::string GZipDecodingStreamFilter::NAME("GZipDecodingStreamFilter");
 
 GZipDecodingStreamFilter::GZipDecodingStreamFilter
 (const SharedHandle<StreamFilter>& delegate):
-  StreamFilter(delegate), strm_(0), finished_(false), bytesProcessed_(0) {}
+  StreamFilter(delegate), strm_(0), finished_(false), bytesProcessed_(0),
+  outbuf_(0) {}
 
 GZipDecodingStreamFilter::~GZipDecodingStreamFilter()
 {
@@ -56,6 +57,7 @@ void GZipDecodingStreamFilter::init()
 {
   finished_ = false;
   release();
+  outbuf_ = new unsigned char[OUTBUF_LENGTH];
   strm_ = new z_stream();
   strm_->zalloc = Z_NULL;
   strm_->zfree = Z_NULL;
@@ -76,6 +78,8 @@ void GZipDecodingStreamFilter::release()
     delete strm_;
     strm_ = 0;
   }
+  delete [] outbuf_;
+  outbuf_ = 0;
 }
 
 ssize_t GZipDecodingStreamFilter::transform
@@ -92,10 +96,9 @@ ssize_t GZipDecodingStreamFilter::transform
   strm_->avail_in = inlen;
   strm_->next_in = const_cast<unsigned char*>(inbuf);
 
-  unsigned char outbuf[OUTBUF_LENGTH];
   while(1) {
     strm_->avail_out = OUTBUF_LENGTH;
-    strm_->next_out = outbuf;
+    strm_->next_out = outbuf_;
 
     int ret = ::inflate(strm_, Z_NO_FLUSH);
 
@@ -108,7 +111,17 @@ ssize_t GZipDecodingStreamFilter::transform
 
     size_t produced = OUTBUF_LENGTH-strm_->avail_out;
 
-    outlen += getDelegate()->transform(out, segment, outbuf, produced);
+    if(produced == OUTBUF_LENGTH &&
+       getDelegate()->acceptsOwnedBuffer(segment)) {
+      // Inflated data goes to the write cache as is. Partially filled
+      // buffers are copied instead so that the cache does not hold
+      // unused memory.
+      unsigned char* buf = outbuf_;
+      outbuf_ = new unsigned char[OUTBUF_LENGTH];
+      outlen += getDelegate()->transformOwned(out, segment, buf, produced);
+    } else {
+      outlen += getDelegate()->transform(out, segment, outbuf_, produced);
+    }
     if(strm_->avail_out > 0) {
       break;
     }
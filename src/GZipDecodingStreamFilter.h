@@ -49,6 +49,10 @@ private:
 
   size_t bytesProcessed_;
 
+  // Output buffer reused across transform() calls. It is handed over
+  // to the delegate when the delegate accepts owned buffers.
+  unsigned char* outbuf_;
+
   static const size_t OUTBUF_LENGTH = 16*1024;
 public:
   GZipDecodingStreamFilter
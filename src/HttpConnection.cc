@@ -35,6 +35,7 @@
 #include "HttpConnection.h"
 
 #include <sstream>
+#include <algorithm>
 
 #include "util.h"
 #include "message.h"
@@ -61,9 +62,10 @@
 namespace aria2 {
 
 HttpRequestEntry::HttpRequestEntry
-(const SharedHandle<HttpRequest>& httpRequest)
+(const SharedHandle<HttpRequest>& httpRequest, bool rttSample)
   : httpRequest_(httpRequest),
-    proc_(new HttpHeaderProcessor())
+    proc_(new HttpHeaderProcessor()),
+    rttSample_(rttSample)
 {}
 
 HttpRequestEntry::~HttpRequestEntry() {}
@@ -75,7 +77,8 @@ HttpConnection::HttpConnection
   : cuid_(cuid),
     socket_(socket),
     socketRecvBuffer_(socketRecvBuffer),
-    socketBuffer_(socket)
+    socketBuffer_(socket),
+    lastRtt_(0)
 {}
 
 HttpConnection::~HttpConnection() {}
@@ -107,7 +110,8 @@ void HttpConnection::sendRequest(const SharedHandle<HttpRequest>& httpRequest)
                   eraseConfidentialInfo(request).c_str()));
   socketBuffer_.pushStr(request);
   socketBuffer_.send();
-  SharedHandle<HttpRequestEntry> entry(new HttpRequestEntry(httpRequest));
+  SharedHandle<HttpRequestEntry> entry
+    (new HttpRequestEntry(httpRequest, outstandingHttpRequests_.empty()));
   outstandingHttpRequests_.push_back(entry);
 }
 
@@ -147,6 +151,13 @@ SharedHandle<HttpResponse> HttpConnection::receiveResponse()
     A2_LOG_INFO(fmt(MSG_RECEIVE_RESPONSE,
                     cuid_,
                     proc->getHeaderString().c_str()));
+    if(entry->isRttSample()) {
+      // 0 means not measured. Round up sub-millisecond RTT.
+      lastRtt_ = std::max(static_cast<int64_t>(1),
+                          entry->getSentTime().differenceInMillis());
+    } else {
+      lastRtt_ = 0;
+    }
     assert(socketRecvBuffer_->getBufferLength() >= putbackDataLength);
     shiftBufferLength = socketRecvBuffer_->getBufferLength()-putbackDataLength;
     httpResponse.reset(new HttpResponse());
@@ -166,7 +177,16 @@ bool HttpConnection::isIssued(const SharedHandle<Segment>& segment) const
   for(HttpRequestEntries::const_iterator itr = outstandingHttpRequests_.begin(),
         eoi = outstandingHttpRequests_.end(); itr != eoi; ++itr) {
     SharedHandle<HttpRequest> httpRequest = (*itr)->getHttpRequest();
-    if(*httpRequest->getSegment() == *segment) {
+    const SharedHandle<Segment>& requested = httpRequest->getSegment();
+    if(*requested == *segment) {
+      return true;
+    }
+    // Contiguous segments are requested by the request for the first
+    // one with the merged range.
+    if(requested->getIndex() < segment->getIndex() &&
+       httpRequest->getEndByte() > 0 &&
+       httpRequest->getFileEntry()->gtoloff(segment->getPosition()) <=
+       httpRequest->getEndByte()) {
       return true;
     }
   }
@@ -43,6 +43,7 @@
 #include "SharedHandle.h"
 #include "SocketBuffer.h"
 #include "Command.h"
+#include "TimerA2.h"
 
 namespace aria2 {
 
@@ -58,8 +59,14 @@ class HttpRequestEntry {
 private:
   SharedHandle<HttpRequest> httpRequest_;
   SharedHandle<HttpHeaderProcessor> proc_;
+  // The time when the request was sent.
+  Timer sentTime_;
+  // True if no other request was outstanding when this request was
+  // sent, so that the time to its response header is an RTT sample.
+  bool rttSample_;
 public:
-  HttpRequestEntry(const SharedHandle<HttpRequest>& httpRequest);
+  HttpRequestEntry(const SharedHandle<HttpRequest>& httpRequest,
+                   bool rttSample = false);
 
   ~HttpRequestEntry();
 
@@ -72,6 +79,16 @@ public:
   {
     return proc_;
   }
+
+  const Timer& getSentTime() const
+  {
+    return sentTime_;
+  }
+
+  bool isRttSample() const
+  {
+    return rttSample_;
+  }
 };
 
 typedef SharedHandle<HttpRequestEntry> HttpRequestEntryHandle;
@@ -87,6 +104,8 @@ private:
 
   HttpRequestEntries outstandingHttpRequests_;
 
+  int64_t lastRtt_;
+
   std::string eraseConfidentialInfo(const std::string& request);
 public:
   HttpConnection
@@ -124,8 +143,25 @@ public:
 
   SharedHandle<HttpRequest> getFirstHttpRequest() const;
 
+  // Returns true if segment is requested by one of outstanding
+  // requests, either by itself or as a part of a merged range.
   bool isIssued(const SharedHandle<Segment>& segment) const;
 
+  size_t countOutstandingRequest() const
+  {
+    return outstandingHttpRequests_.size();
+  }
+
+  // Returns the time in milliseconds from sending the request to
+  // receiving the header of the last response returned by
+  // receiveResponse(). Returns 0 if the request was pipelined behind
+  // another request, because then the time includes the transfer of
+  // the preceding responses.
+  int64_t getLastRtt() const
+  {
+    return lastRtt_;
+  }
+
   bool sendBufferIsEmpty() const;
 
   void sendPendingData();
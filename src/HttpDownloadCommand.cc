@@ -52,6 +52,8 @@
 #include "SinkStreamFilter.h"
 #include "util.h"
 #include "SocketRecvBuffer.h"
+#include "RequestGroupMan.h"
+#include "ServerStat.h"
 
 namespace aria2 {
 
@@ -75,6 +77,28 @@ HttpDownloadCommand::~HttpDownloadCommand() {}
 bool HttpDownloadCommand::prepareForNextSegment() {
   bool downloadFinished = getRequestGroup()->downloadFinished();
   if(getRequest()->isPipeliningEnabled() && !downloadFinished) {
+    const SharedHandle<Segment>& segment = getSegments().front();
+    if(segment->complete() &&
+       getRequestEndOffset() > getFileEntry()->gtoloff
+       (segment->getPosition()+segment->getLength())) {
+      // The request covered several contiguous segments. Keep reading
+      // the same response into the next one, which HttpRequestCommand
+      // has already checked out.
+      SharedHandle<Segment> nextSegment;
+      const std::vector<SharedHandle<Segment> >& segments = getSegments();
+      for(size_t i = 1; i < segments.size(); ++i) {
+        if(segments[i]->getIndex() == segment->getIndex()+1) {
+          nextSegment = segments[i];
+          break;
+        }
+      }
+      if(!nextSegment || nextSegment->getWrittenLength() > 0) {
+        return prepareForRetry(0);
+      }
+      checkSocketRecvBuffer();
+      getDownloadEngine()->addCommand(this);
+      return false;
+    }
     HttpRequestCommand* command =
       new HttpRequestCommand(getCuid(), getRequest(), getFileEntry(),
                              getRequestGroup(), httpConnection_,
@@ -124,6 +148,9 @@ bool HttpDownloadCommand::prepareForNextSegment() {
       
       if(lastOffset ==
          httpResponse_->getHttpHeader()->getRange()->getEndByte()+1) {
+        getDownloadEngine()->getRequestGroupMan()->getOrCreateServerStat
+          (getRequest()->getHost(), getRequest()->getProtocol())->
+          increasePipeliningFailures();
         return prepareForRetry(0);
       }
     }
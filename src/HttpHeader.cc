@@ -34,6 +34,7 @@
 /* copyright --> */
 #include "HttpHeader.h"
 
+#include <cstring>
 #include <istream>
 
 #include "Range.h"
@@ -42,30 +43,6 @@
 
 namespace aria2 {
 
-const std::string HttpHeader::LOCATION("Location");
-
-const std::string HttpHeader::TRANSFER_ENCODING("Transfer-Encoding");
-
-const std::string HttpHeader::CONTENT_ENCODING("Content-Encoding");
-
-const std::string HttpHeader::CONTENT_DISPOSITION("Content-Disposition");
-
-const std::string HttpHeader::SET_COOKIE("Set-Cookie");
-
-const std::string HttpHeader::CONTENT_TYPE("Content-Type");
-
-const std::string HttpHeader::RETRY_AFTER("Retry-After");
-
-const std::string HttpHeader::CONNECTION("Connection");
-
-const std::string HttpHeader::CONTENT_LENGTH("Content-Length");
-
-const std::string HttpHeader::CONTENT_RANGE("Content-Range");
-
-const std::string HttpHeader::LAST_MODIFIED("Last-Modified");
-
-const std::string HttpHeader::ACCEPT_ENCODING("Accept-Encoding");
-
 const char HttpHeader::HTTP_1_1[] = "HTTP/1.1";
 const char HttpHeader::CLOSE[] = "close";
 const char HttpHeader::CHUNKED[] = "chunked";
@@ -75,17 +52,97 @@ const char HttpHeader::DEFLATE[] = "deflate";
 HttpHeader::HttpHeader() {}
 HttpHeader::~HttpHeader() {}
 
-void HttpHeader::put(const std::string& name, const std::string& value) {
-  std::multimap<std::string, std::string>::value_type vt
-    (util::toLower(name), value);
-  table_.insert(vt);
+namespace {
+// Lowercased names of InterestingHeader, in the same order.
+const char* INTERESTING_HEADER_NAMES[] = {
+  "location",
+  "transfer-encoding",
+  "content-encoding",
+  "content-disposition",
+  "set-cookie",
+  "content-type",
+  "retry-after",
+  "connection",
+  "content-length",
+  "content-range",
+  "last-modified",
+  "accept-encoding"
+};
+} // namespace
+
+namespace {
+// Returns true if [first, last) equals lowercased name, ignoring the
+// case of [first, last).
+bool fieldNameEquals(const char* first, const char* last, const char* name)
+{
+  for(; first != last; ++first, ++name) {
+    char c = *first;
+    if('A' <= c && c <= 'Z') {
+      c += 'a'-'A';
+    }
+    if(c != *name) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+int HttpHeader::idInterestingHeader(const char* first, const char* last)
+{
+  size_t len = last-first;
+  for(int i = 0; i < MAX_INTERESTING_HEADER; ++i) {
+    const char* name = INTERESTING_HEADER_NAMES[i];
+    if(strlen(name) == len && fieldNameEquals(first, last, name)) {
+      return i;
+    }
+  }
+  return MAX_INTERESTING_HEADER;
+}
+
+int HttpHeader::idInterestingHeader(const std::string& name)
+{
+  return idInterestingHeader(name.data(), name.data()+name.size());
+}
+
+void HttpHeader::put(const std::string& name, const std::string& value)
+{
+  int hdKey = idInterestingHeader(name);
+  if(hdKey == MAX_INTERESTING_HEADER) {
+    std::multimap<std::string, std::string>::value_type vt
+      (util::toLower(name), value);
+    table_.insert(vt);
+  } else {
+    put(hdKey, value);
+  }
+}
+
+void HttpHeader::put(int hdKey, const std::string& value)
+{
+  fields_[hdKey].push_back(value);
+}
+
+bool HttpHeader::defined(const std::string& name) const
+{
+  int hdKey = idInterestingHeader(name);
+  if(hdKey == MAX_INTERESTING_HEADER) {
+    return table_.count(util::toLower(name)) >= 1;
+  } else {
+    return defined(hdKey);
+  }
 }
 
-bool HttpHeader::defined(const std::string& name) const {
-  return table_.count(util::toLower(name)) >= 1;
+bool HttpHeader::defined(int hdKey) const
+{
+  return !fields_[hdKey].empty();
 }
 
-const std::string& HttpHeader::getFirst(const std::string& name) const {
+const std::string& HttpHeader::getFirst(const std::string& name) const
+{
+  int hdKey = idInterestingHeader(name);
+  if(hdKey != MAX_INTERESTING_HEADER) {
+    return getFirst(hdKey);
+  }
   std::multimap<std::string, std::string>::const_iterator itr =
     table_.find(util::toLower(name));
   if(itr == table_.end()) {
@@ -95,8 +152,21 @@ const std::string& HttpHeader::getFirst(const std::string& name) const {
   }
 }
 
+const std::string& HttpHeader::getFirst(int hdKey) const
+{
+  if(fields_[hdKey].empty()) {
+    return A2STR::NIL;
+  } else {
+    return fields_[hdKey].front();
+  }
+}
+
 std::vector<std::string> HttpHeader::get(const std::string& name) const
 {
+  int hdKey = idInterestingHeader(name);
+  if(hdKey != MAX_INTERESTING_HEADER) {
+    return get(hdKey);
+  }
   std::vector<std::string> v;
   std::string n(util::toLower(name));
   std::pair<std::multimap<std::string, std::string>::const_iterator,
@@ -110,18 +180,37 @@ std::vector<std::string> HttpHeader::get(const std::string& name) const
   return v;
 }
 
+const std::vector<std::string>& HttpHeader::get(int hdKey) const
+{
+  return fields_[hdKey];
+}
+
 unsigned int HttpHeader::getFirstAsUInt(const std::string& name) const {
   return getFirstAsULLInt(name);
 }
 
-uint64_t HttpHeader::getFirstAsULLInt(const std::string& name) const {
-  const std::string& value = getFirst(name);
+unsigned int HttpHeader::getFirstAsUInt(int hdKey) const {
+  return getFirstAsULLInt(hdKey);
+}
+
+namespace {
+uint64_t parseFirstAsULLInt(const std::string& value)
+{
   if(value.empty()) {
     return 0;
   } else {
     return util::parseULLInt(value);
   }
 }
+} // namespace
+
+uint64_t HttpHeader::getFirstAsULLInt(const std::string& name) const {
+  return parseFirstAsULLInt(getFirst(name));
+}
+
+uint64_t HttpHeader::getFirstAsULLInt(int hdKey) const {
+  return parseFirstAsULLInt(getFirst(hdKey));
+}
 
 RangeHandle HttpHeader::getRange() const
 {
@@ -217,6 +306,9 @@ void HttpHeader::fill(std::istream& in)
 
 void HttpHeader::clearField()
 {
+  for(int i = 0; i < MAX_INTERESTING_HEADER; ++i) {
+    fields_[i].clear();
+  }
   table_.clear();
 }
 
@@ -49,7 +49,30 @@ namespace aria2 {
 class Range;
 
 class HttpHeader {
+public:
+  // Header fields aria2 looks up frequently. Their values are kept in
+  // an array indexed by this enum, so that looking them up does not
+  // need to lowercase the name and search table_.
+  enum InterestingHeader {
+    LOCATION,
+    TRANSFER_ENCODING,
+    CONTENT_ENCODING,
+    CONTENT_DISPOSITION,
+    SET_COOKIE,
+    CONTENT_TYPE,
+    RETRY_AFTER,
+    CONNECTION,
+    CONTENT_LENGTH,
+    CONTENT_RANGE,
+    LAST_MODIFIED,
+    ACCEPT_ENCODING,
+    MAX_INTERESTING_HEADER
+  };
 private:
+  // Values of the fields in InterestingHeader.
+  std::vector<std::string> fields_[MAX_INTERESTING_HEADER];
+
+  // Other fields, keyed by lowercased field name.
   std::multimap<std::string, std::string> table_;
 
   // HTTP status code, e.g. 200
@@ -68,11 +91,17 @@ public:
   ~HttpHeader();
 
   void put(const std::string& name, const std::string& value);
+  void put(int hdKey, const std::string& value);
   bool defined(const std::string& name) const;
+  bool defined(int hdKey) const;
   const std::string& getFirst(const std::string& name) const;
+  const std::string& getFirst(int hdKey) const;
   std::vector<std::string> get(const std::string& name) const;
+  const std::vector<std::string>& get(int hdKey) const;
   unsigned int getFirstAsUInt(const std::string& name) const;
+  unsigned int getFirstAsUInt(int hdKey) const;
   uint64_t getFirstAsULLInt(const std::string& name) const;
+  uint64_t getFirstAsULLInt(int hdKey) const;
 
   SharedHandle<Range> getRange() const;
 
@@ -109,32 +138,16 @@ public:
 
   void fill(std::istream& in);
 
-  // Clears table_. responseStatus_ and version_ are unchanged.
+  // Clears fields_ and table_. responseStatus_ and version_ are
+  // unchanged.
   void clearField();
 
-  static const std::string LOCATION;
-
-  static const std::string TRANSFER_ENCODING;
-  
-  static const std::string CONTENT_ENCODING;
-
-  static const std::string CONTENT_DISPOSITION;
-  
-  static const std::string SET_COOKIE;
-  
-  static const std::string CONTENT_TYPE;
-  
-  static const std::string RETRY_AFTER;
-  
-  static const std::string CONNECTION;
-
-  static const std::string CONTENT_LENGTH;
-
-  static const std::string CONTENT_RANGE;
-
-  static const std::string LAST_MODIFIED;
+  // Returns InterestingHeader value of the field name in the range
+  // [first, last), compared case-insensitively. If the name is not
+  // one of them, returns MAX_INTERESTING_HEADER.
+  static int idInterestingHeader(const char* first, const char* last);
 
-  static const std::string ACCEPT_ENCODING;
+  static int idInterestingHeader(const std::string& name);
 
   static const char HTTP_1_1[];
 
@@ -34,7 +34,7 @@
 /* copyright --> */
 #include "HttpHeaderProcessor.h"
 
-#include <sstream>
+#include <cstring>
 #include <vector>
 
 #include "HttpHeader.h"
@@ -48,7 +48,12 @@
 namespace aria2 {
 
 HttpHeaderProcessor::HttpHeaderProcessor():
-  limit_(21/*lines*/*8190/*per line*/) {}
+  limit_(21/*lines*/*8190/*per line*/),
+  state_(FIRST_LINE),
+  lineStart_(0),
+  firstLineEnd_(0),
+  headerEnd_(0),
+  putBackDataLength_(0) {}
 // The above values come from Apache's documentation
 // http://httpd.apache.org/docs/2.2/en/mod/core.html: See
 // LimitRequestFieldSize and LimitRequestLine directive.  Also the
@@ -59,14 +64,33 @@ HttpHeaderProcessor::~HttpHeaderProcessor() {}
 
 void HttpHeaderProcessor::update(const unsigned char* data, size_t length)
 {
-  checkHeaderLimit(length);
-  buf_ += std::string(&data[0], &data[length]);
+  if(state_ == HEADER_END) {
+    putBackDataLength_ += length;
+    return;
+  }
+  const unsigned char* first = data;
+  const unsigned char* last = data+length;
+  while(first != last) {
+    const unsigned char* lf =
+      reinterpret_cast<const unsigned char*>(memchr(first, '\n', last-first));
+    const unsigned char* end = lf ? lf+1 : last;
+    checkHeaderLimit(end-first);
+    buf_.append(&first[0], &end[0]);
+    first = end;
+    if(!lf) {
+      break;
+    }
+    processLine(buf_.size()-1);
+    if(state_ == HEADER_END) {
+      break;
+    }
+  }
+  putBackDataLength_ = last-first;
 }
 
 void HttpHeaderProcessor::update(const std::string& data)
 {
-  checkHeaderLimit(data.size());
-  buf_ += data;
+  update(reinterpret_cast<const unsigned char*>(data.data()), data.size());
 }
 
 void HttpHeaderProcessor::checkHeaderLimit(size_t incomingLength)
@@ -77,23 +101,73 @@ void HttpHeaderProcessor::checkHeaderLimit(size_t incomingLength)
   }
 }
 
-bool HttpHeaderProcessor::eoh() const
+namespace {
+bool isLws(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+} // namespace
+
+void HttpHeaderProcessor::processLine(size_t lf)
 {
-  if(buf_.find("\r\n\r\n") == std::string::npos &&
-     buf_.find("\n\n") == std::string::npos) {
-    return false;
+  size_t lineEnd = lf;
+  if(lineEnd > lineStart_ && buf_[lineEnd-1] == '\r') {
+    --lineEnd;
+  }
+  if(lineEnd == lineStart_) {
+    state_ = HEADER_END;
+  } else if(state_ == FIRST_LINE) {
+    firstLineEnd_ = lineEnd;
+    headerEnd_ = lineEnd;
+    state_ = FIELD_LINE;
   } else {
-    return true;
+    headerEnd_ = lineEnd;
+    size_t first = lineStart_;
+    while(first != lineEnd && isLws(buf_[first])) {
+      ++first;
+    }
+    size_t last = lineEnd;
+    while(last != first && isLws(buf_[last-1])) {
+      --last;
+    }
+    if(first != lineStart_ && !fields_.empty()) {
+      // Continuation line extends the value of the previous field.
+      if(first != last) {
+        fields_.back().valueLast = last;
+      }
+    } else if(first != last) {
+      HeaderField field;
+      field.nameFirst = first;
+      size_t colon = buf_.find(':', first);
+      if(colon == std::string::npos || colon >= last) {
+        field.nameLast = last;
+        field.valueFirst = field.valueLast = last;
+      } else {
+        field.nameLast = colon;
+        while(field.nameLast != first && isLws(buf_[field.nameLast-1])) {
+          --field.nameLast;
+        }
+        field.valueFirst = colon+1;
+        while(field.valueFirst != last && isLws(buf_[field.valueFirst])) {
+          ++field.valueFirst;
+        }
+        field.valueLast = last;
+      }
+      fields_.push_back(field);
+    }
   }
+  lineStart_ = lf+1;
+}
+
+bool HttpHeaderProcessor::eoh() const
+{
+  return state_ == HEADER_END;
 }
 
 size_t HttpHeaderProcessor::getPutBackDataLength() const
 {
-  std::string::size_type delimpos = std::string::npos;
-  if((delimpos = buf_.find("\r\n\r\n")) != std::string::npos) {
-    return buf_.size()-(delimpos+4);
-  } else if((delimpos = buf_.find("\n\n")) != std::string::npos) {
-    return buf_.size()-(delimpos+2);
+  if(state_ == HEADER_END) {
+    return putBackDataLength_;
   } else {
     return 0;
   }
@@ -102,27 +176,77 @@ size_t HttpHeaderProcessor::getPutBackDataLength() const
 void HttpHeaderProcessor::clear()
 {
   buf_.erase();
+  state_ = FIRST_LINE;
+  lineStart_ = 0;
+  firstLineEnd_ = 0;
+  headerEnd_ = 0;
+  putBackDataLength_ = 0;
+  fields_.clear();
+}
+
+std::string HttpHeaderProcessor::getFieldValue(const HeaderField& field) const
+{
+  std::string value;
+  const char* data = buf_.data();
+  size_t first = field.valueFirst;
+  while(1) {
+    const char* lf = reinterpret_cast<const char*>
+      (memchr(data+first, '\n', field.valueLast-first));
+    if(!lf) {
+      value.append(data+first, data+field.valueLast);
+      break;
+    }
+    // Folded value. Continuation lines are joined by single space.
+    size_t last = lf-data;
+    while(last != first && isLws(data[last-1])) {
+      --last;
+    }
+    value.append(data+first, data+last);
+    value += ' ';
+    first = lf-data+1;
+    while(first != field.valueLast && isLws(data[first])) {
+      ++first;
+    }
+  }
+  return value;
+}
+
+void HttpHeaderProcessor::putFields
+(const SharedHandle<HttpHeader>& httpHeader) const
+{
+  const char* data = buf_.data();
+  for(std::vector<HeaderField>::const_iterator i = fields_.begin(),
+        eoi = fields_.end(); i != eoi; ++i) {
+    const char* nameFirst = data+(*i).nameFirst;
+    const char* nameLast = data+(*i).nameLast;
+    int hdKey = HttpHeader::idInterestingHeader(nameFirst, nameLast);
+    if(hdKey == HttpHeader::MAX_INTERESTING_HEADER) {
+      httpHeader->put(std::string(nameFirst, nameLast), getFieldValue(*i));
+    } else {
+      httpHeader->put(hdKey, getFieldValue(*i));
+    }
+  }
 }
 
 SharedHandle<HttpHeader> HttpHeaderProcessor::getHttpResponseHeader()
 {
-  std::string::size_type delimpos = std::string::npos;
-  if(((delimpos = buf_.find("\r\n")) == std::string::npos &&
-      (delimpos = buf_.find("\n")) == std::string::npos) ||
-     delimpos < 12) {
-    throw DL_RETRY_EX(EX_NO_STATUS_HEADER);
+  if(state_ == FIRST_LINE || firstLineEnd_ < 12) {
+    throw DL_RETRY_EX2(EX_NO_STATUS_HEADER, error_code::HTTP_PROTOCOL_ERROR);
+  }
+  // The first line is not a status line, for example, the remaining
+  // body of the previous response.
+  if(!util::startsWith(buf_, "HTTP/")) {
+    throw DL_RETRY_EX2(EX_NO_STATUS_HEADER, error_code::HTTP_PROTOCOL_ERROR);
   }
   int32_t statusCode;
   if(!util::parseIntNoThrow(statusCode, buf_.substr(9, 3))) {
-    throw DL_RETRY_EX("Status code could not be parsed as integer.");
+    throw DL_RETRY_EX2("Status code could not be parsed as integer.",
+                       error_code::HTTP_PROTOCOL_ERROR);
   }
   HttpHeaderHandle httpHeader(new HttpHeader());
   httpHeader->setVersion(buf_.substr(0, 8));
   httpHeader->setStatusCode(statusCode);
-  std::istringstream strm(buf_);
-  // TODO 1st line(HTTP/1.1 200...) is also send to HttpHeader, but it should
-  // not.
-  httpHeader->fill(strm);
+  putFields(httpHeader);
   return httpHeader;
 }
 
@@ -131,14 +255,12 @@ SharedHandle<HttpHeader> HttpHeaderProcessor::getHttpRequestHeader()
   // The minimum case of the first line is:
   // GET / HTTP/1.x
   // At least 14bytes before \r\n or \n.
-  std::string::size_type delimpos = std::string::npos;
-  if(((delimpos = buf_.find("\r\n")) == std::string::npos &&
-      (delimpos = buf_.find("\n")) == std::string::npos) ||
-     delimpos < 14) {
+  if(state_ == FIRST_LINE || firstLineEnd_ < 14) {
     throw DL_RETRY_EX(EX_NO_STATUS_HEADER);
   }
   std::vector<std::string> firstLine;
-  util::split(buf_.substr(0, delimpos), std::back_inserter(firstLine)," ",true);
+  util::split(buf_.substr(0, firstLineEnd_), std::back_inserter(firstLine),
+              " ", true);
   if(firstLine.size() != 3) {
     throw DL_ABORT_EX2("Malformed HTTP request header.",
                        error_code::HTTP_PROTOCOL_ERROR);
@@ -147,19 +269,16 @@ SharedHandle<HttpHeader> HttpHeaderProcessor::getHttpRequestHeader()
   httpHeader->setMethod(firstLine[0]);
   httpHeader->setRequestPath(firstLine[1]);
   httpHeader->setVersion(firstLine[2]);
-  std::istringstream strm(buf_.substr(delimpos));
-  httpHeader->fill(strm);
+  putFields(httpHeader);
   return httpHeader;
 }
 
 std::string HttpHeaderProcessor::getHeaderString() const
 {
-  std::string::size_type delimpos = std::string::npos;
-  if((delimpos = buf_.find("\r\n\r\n")) == std::string::npos &&
-     (delimpos = buf_.find("\n\n")) == std::string::npos) {
-    return buf_;
+  if(state_ == HEADER_END) {
+    return buf_.substr(0, headerEnd_);
   } else {
-    return buf_.substr(0, delimpos);
+    return buf_;
   }
 }
 
@@ -39,18 +39,59 @@
 #include "SharedHandle.h"
 #include <utility>
 #include <string>
+#include <vector>
 
 namespace aria2 {
 
 class HttpHeader;
 
+// Parses HTTP header incrementally. Each call of update() scans only
+// the newly received bytes and resumes from the line it stopped at.
+// Header fields are recorded as offsets into buf_ and converted to
+// strings only when HttpHeader is created.
 class HttpHeaderProcessor {
 private:
+  enum State {
+    FIRST_LINE,
+    FIELD_LINE,
+    HEADER_END
+  };
+
+  // Offsets into buf_ of a header field. valueLast may span
+  // continuation lines.
+  struct HeaderField {
+    size_t nameFirst;
+    size_t nameLast;
+    size_t valueFirst;
+    size_t valueLast;
+  };
+
+  // Received header bytes. Bytes beyond the end of header are not
+  // stored.
   std::string buf_;
   size_t limit_;
+  State state_;
+  // Offset in buf_ where the line being received starts.
+  size_t lineStart_;
+  // Offset in buf_ of the end of the first line, excluding CR LF.
+  size_t firstLineEnd_;
+  // Offset in buf_ of the end of the last non-empty line, excluding
+  // CR LF.
+  size_t headerEnd_;
+  // The number of bytes beyond the end of header in the last
+  // update().
+  size_t putBackDataLength_;
+  std::vector<HeaderField> fields_;
 
   void checkHeaderLimit(size_t incomingLength);
 
+  // Processes the line which ends with LF at buf_[lf].
+  void processLine(size_t lf);
+
+  std::string getFieldValue(const HeaderField& field) const;
+
+  void putFields(const SharedHandle<HttpHeader>& httpHeader) const;
+
 public:
   HttpHeaderProcessor();
 
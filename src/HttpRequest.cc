@@ -90,7 +90,9 @@ off_t HttpRequest::getEndByte() const
     return 0;
   } else {
     if(request_->isPipeliningEnabled()) {
-      off_t endByte =
+      // endOffsetOverride_ extends the range over the contiguous
+      // segments merged into this request.
+      off_t endByte = endOffsetOverride_ > 0 ? endOffsetOverride_-1 :
         fileEntry_->gtoloff(segment_->getPosition()+segment_->getLength()-1);
       return std::min(endByte, static_cast<off_t>(fileEntry_->getLength()-1));
     } else {
@@ -120,10 +120,27 @@ createHttpRequest(const SharedHandle<Request>& req,
 }
 } // namespace
 
+size_t HttpRequestCommand::countMergeableSegment
+(const std::vector<SharedHandle<Segment> >& segments, size_t first) const
+{
+  size_t last = first+1;
+  // Only segments without written data can be merged, because the
+  // merged response is written to each segment from its beginning.
+  while(last < segments.size() &&
+        segments[last]->getIndex() == segments[last-1]->getIndex()+1 &&
+        segments[last]->getWrittenLength() == 0 &&
+        !httpConnection_->isIssued(segments[last])) {
+    ++last;
+  }
+  return last-first;
+}
+
 bool HttpRequestCommand::executeInternal() {
   //socket->setBlockingMode();
   if(getRequest()->getProtocol() == Request::PROTO_HTTPS) {
-    getSocket()->prepareSecureConnection();
+    getSocket()->prepareSecureConnection
+      (getDownloadEngine()->getTLSSessionCache(),
+       getRequest()->getHost(), getRequest()->getPort());
     if(!getSocket()->initiateSecureConnection(getRequest()->getHost())) {
       setReadCheckSocketIf(getSocket(), getSocket()->wantRead());
       setWriteCheckSocketIf(getSocket(), getSocket()->wantWrite());
@@ -174,20 +191,38 @@ bool HttpRequestCommand::executeInternal() {
       }
       httpConnection_->sendRequest(httpRequest);
     } else {
-      for(std::vector<SharedHandle<Segment> >::const_iterator itr =
-            getSegments().begin(), eoi = getSegments().end();
-          itr != eoi; ++itr) {
-        const SharedHandle<Segment>& segment = *itr;
+      const std::vector<SharedHandle<Segment> >& segments = getSegments();
+      for(size_t i = 0, len = segments.size(); i < len; ++i) {
+        const SharedHandle<Segment>& segment = segments[i];
         if(!httpConnection_->isIssued(segment)) {
           off_t endOffset = 0;
           if(getRequestGroup()->getTotalLength() > 0 &&
              getPieceStorage()) {
-            size_t nextIndex =
-              getPieceStorage()->getNextUsedIndex(segment->getIndex());
-            endOffset = std::min
-              (static_cast<off_t>(getFileEntry()->getLength()),
-               getFileEntry()->gtoloff
-               (static_cast<off_t>(segment->getSegmentLength())*nextIndex));
+            if(getRequest()->isPipeliningEnabled()) {
+              size_t last = countMergeableSegment(segments, i)+i-1;
+              if(last > i) {
+                A2_LOG_DEBUG
+                  (fmt("CUID#%lld - Merging segment#%lu-%lu into one"
+                       " request.",
+                       getCuid(),
+                       static_cast<unsigned long>(segment->getIndex()),
+                       static_cast<unsigned long>
+                       (segments[last]->getIndex())));
+                endOffset = std::min
+                  (static_cast<off_t>(getFileEntry()->getLength()),
+                   getFileEntry()->gtoloff
+                   (segments[last]->getPosition()+
+                    segments[last]->getLength()));
+                i = last;
+              }
+            } else {
+              size_t nextIndex =
+                getPieceStorage()->getNextUsedIndex(segment->getIndex());
+              endOffset = std::min
+                (static_cast<off_t>(getFileEntry()->getLength()),
+                 getFileEntry()->gtoloff
+                 (static_cast<off_t>(segment->getSegmentLength())*nextIndex));
+            }
           }
           SharedHandle<HttpRequest> httpRequest
             (createHttpRequest(getRequest(),
@@ -37,6 +37,8 @@
 
 #include "AbstractCommand.h"
 
+#include <vector>
+
 namespace aria2 {
 
 class HttpConnection;
@@ -53,6 +55,11 @@ private:
   SharedHandle<Request> proxyRequest_;
 
   SharedHandle<HttpConnection> httpConnection_;
+
+  // Returns the number of segments, starting at segments[first], which
+  // are contiguous and can be requested with one merged range.
+  size_t countMergeableSegment
+  (const std::vector<SharedHandle<Segment> >& segments, size_t first) const;
 protected:
   virtual bool executeInternal();
 public:
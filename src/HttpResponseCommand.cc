@@ -72,6 +72,7 @@
 #include "ChunkedDecodingStreamFilter.h"
 #include "uri.h"
 #include "SocketRecvBuffer.h"
+#include "ServerStat.h"
 #ifdef HAVE_LIBZ
 # include "GZipDecodingStreamFilter.h"
 #endif // HAVE_LIBZ
@@ -147,7 +148,19 @@ HttpResponseCommand::~HttpResponseCommand() {}
 bool HttpResponseCommand::executeInternal()
 {
   SharedHandle<HttpRequest> httpRequest =httpConnection_->getFirstHttpRequest();
-  SharedHandle<HttpResponse> httpResponse = httpConnection_->receiveResponse();
+  SharedHandle<HttpResponse> httpResponse;
+  try {
+    httpResponse = httpConnection_->receiveResponse();
+  } catch(RecoverableException& e) {
+    // A malformed status line, or a status line not where a response
+    // should begin, means the server broke the pipeline. Network
+    // errors and EOF are not counted.
+    if(e.getErrorCode() == error_code::HTTP_PROTOCOL_ERROR &&
+       getRequest()->isPipeliningEnabled()) {
+      getServerStat()->increasePipeliningFailures();
+    }
+    throw;
+  }
   if(!httpResponse) {
     // The server has not responded to our request yet.
     // For socket->wantRead() == true, setReadCheckSocket(socket) is already
@@ -156,8 +169,21 @@ bool HttpResponseCommand::executeInternal()
     getDownloadEngine()->addCommand(this);
     return false;
   }
+  if(httpConnection_->getLastRtt() > 0) {
+    getServerStat()->updateRtt(httpConnection_->getLastRtt());
+  }
   // check HTTP status number
-  httpResponse->validateResponse();
+  try {
+    httpResponse->validateResponse();
+  } catch(RecoverableException& e) {
+    if(e.getErrorCode() == error_code::CANNOT_RESUME &&
+       getRequest()->isPipeliningEnabled()) {
+      // The server ignored the range of pipelined request. Don't
+      // pipeline requests to it again.
+      getServerStat()->setPipeliningBroken();
+    }
+    throw;
+  }
   httpResponse->retrieveCookie();
 
   SharedHandle<HttpHeader> httpHeader = httpResponse->getHttpHeader();
@@ -168,7 +194,9 @@ bool HttpResponseCommand::executeInternal()
     (httpResponse->supportsPersistentConnection());
   if(getRequest()->isPipeliningEnabled()) {
     getRequest()->setMaxPipelinedRequest
-      (getOption()->getAsInt(PREF_MAX_HTTP_PIPELINING));
+      (getServerStat()->calculatePipelineDepth
+       (getOption()->getAsInt(PREF_MAX_HTTP_PIPELINING),
+        getDownloadContext()->getPieceLength()));
   } else {
     getRequest()->setMaxPipelinedRequest(1);
   }
@@ -493,6 +521,12 @@ void HttpResponseCommand::poolConnection()
   }
 }
 
+SharedHandle<ServerStat> HttpResponseCommand::getServerStat() const
+{
+  return getDownloadEngine()->getRequestGroupMan()->getOrCreateServerStat
+    (getRequest()->getHost(), getRequest()->getProtocol());
+}
+
 void HttpResponseCommand::onDryRunFileFound()
 {
   getPieceStorage()->markAllPiecesDone();
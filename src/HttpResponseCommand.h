@@ -45,6 +45,7 @@ class HttpDownloadCommand;
 class HttpResponse;
 class SocketCore;
 class StreamFilter;
+class ServerStat;
 
 // HttpResponseCommand receives HTTP response header from remote
 // server.  Because network I/O is non-blocking, execute() returns
@@ -74,6 +75,8 @@ private:
   void poolConnection();
 
   void onDryRunFileFound();
+
+  SharedHandle<ServerStat> getServerStat() const;
 protected:
   bool executeInternal();
 
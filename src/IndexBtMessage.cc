@@ -39,7 +39,21 @@
 
 namespace aria2 {
 
+void IndexBtMessage::parse(const unsigned char* data, size_t dataLength)
+{
+  bittorrent::assertPayloadLengthEqual(5, dataLength, getName());
+  bittorrent::assertID(getId(), data, getName());
+  index_ = bittorrent::getIntParam(data, 1);
+}
+
 unsigned char* IndexBtMessage::createMessage()
+{
+  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
+  writeMessage(msg);
+  return msg;
+}
+
+bool IndexBtMessage::writeMessage(unsigned char* msg)
 {
   /**
    * len --- 5, 4bytes
@@ -47,10 +61,9 @@ unsigned char* IndexBtMessage::createMessage()
    * piece index --- index, 4bytes
    * total: 9bytes
    */
-  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
   bittorrent::createPeerMessageString(msg, MESSAGE_LENGTH, 5, getId());
   bittorrent::setIntParam(&msg[5], index_);
-  return msg;
+  return true;
 }
 
 size_t IndexBtMessage::getMessageLength()
@@ -49,10 +49,8 @@ protected:
   template<typename T>
   static SharedHandle<T> create(const unsigned char* data, size_t dataLength)
   {
-    bittorrent::assertPayloadLengthEqual(5, dataLength, T::NAME);
-    bittorrent::assertID(T::ID, data, T::NAME);
     SharedHandle<T> message(new T());
-    message->setIndex(bittorrent::getIntParam(data, 1));
+    message->parse(data, dataLength);
     return message;
   }
 public:
@@ -64,8 +62,14 @@ public:
 
   size_t getIndex() const { return index_; }
 
+  // Sets the index from the payload data. Throws DlAbortEx if data is
+  // not a message of this type.
+  void parse(const unsigned char* data, size_t dataLength);
+
   virtual unsigned char* createMessage();
 
+  virtual bool writeMessage(unsigned char* msg);
+
   virtual size_t getMessageLength();
 
   virtual std::string toString() const;
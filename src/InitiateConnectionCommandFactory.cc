@@ -44,6 +44,10 @@
 #include "prefs.h"
 #include "SocketCore.h"
 #include "SocketRecvBuffer.h"
+#include "RequestGroupMan.h"
+#include "ServerStat.h"
+#include "LogFactory.h"
+#include "Logger.h"
 
 namespace aria2 {
 
@@ -66,7 +70,13 @@ InitiateConnectionCommandFactory::createInitiateConnectionCommand
       req->setKeepAliveHint(true);
     }
     if(requestGroup->getOption()->getAsBool(PREF_ENABLE_HTTP_PIPELINING)) {
-      req->setPipeliningHint(true);
+      if(e->getRequestGroupMan()->getOrCreateServerStat
+         (req->getHost(), req->getProtocol())->isPipeliningBroken()) {
+        A2_LOG_INFO(fmt("Pipelining is disabled for %s because it failed"
+                        " before.", req->getHost().c_str()));
+      } else {
+        req->setPipeliningHint(true);
+      }
     }
 
     return
@@ -36,6 +36,7 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 #include "util.h"
 #include "message.h"
@@ -50,6 +51,9 @@
 #include "MessageDigest.h"
 #include "fmt.h"
 #include "DlAbortEx.h"
+#ifdef HAVE_PTHREAD
+# include "PieceHashWorkerPool.h"
+#endif // HAVE_PTHREAD
 
 namespace aria2 {
 
@@ -65,10 +69,18 @@ IteratableChunkChecksumValidator::IteratableChunkChecksumValidator
                               dctx_->getTotalLength())),
     currentIndex_(0),
     buffer_(0)
+#ifdef HAVE_PTHREAD
+  , groupId_(0),
+    numInFlight_(0),
+    numFinished_(0)
+#endif // HAVE_PTHREAD
 {}
 
 IteratableChunkChecksumValidator::~IteratableChunkChecksumValidator()
 {
+#ifdef HAVE_PTHREAD
+  closeGroup();
+#endif // HAVE_PTHREAD
 #ifdef HAVE_POSIX_MEMALIGN
   free(buffer_);
 #else // !HAVE_POSIX_MEMALIGN
@@ -79,6 +91,12 @@ IteratableChunkChecksumValidator::~IteratableChunkChecksumValidator()
 
 void IteratableChunkChecksumValidator::validateChunk()
 {
+#ifdef HAVE_PTHREAD
+  if(workerPool_) {
+    validateChunkWithWorkerPool();
+    return;
+  }
+#endif // HAVE_PTHREAD
   if(!finished()) {
     std::string actualChecksum;
     try {
@@ -109,21 +127,134 @@ void IteratableChunkChecksumValidator::validateChunk()
   }
 }
 
-std::string IteratableChunkChecksumValidator::calculateActualChecksum()
+#ifdef HAVE_PTHREAD
+namespace {
+// Maps the range [offset, offset+length) in the download to the
+// regions of files.
+void createSpans
+(std::vector<PieceHashWorkerPool::Span>& spans,
+ const std::vector<SharedHandle<FileEntry> >& fileEntries,
+ off_t offset, size_t length)
+{
+  off_t last = offset+length;
+  for(std::vector<SharedHandle<FileEntry> >::const_iterator i =
+        fileEntries.begin(), eoi = fileEntries.end(); i != eoi; ++i) {
+    off_t first = std::max(offset, (*i)->getOffset());
+    off_t end = std::min(last, (*i)->getLastOffset());
+    if(first < end) {
+      PieceHashWorkerPool::Span span;
+      span.path = (*i)->getPath();
+      span.offset = first-(*i)->getOffset();
+      span.length = end-first;
+      spans.push_back(span);
+    }
+  }
+}
+} // namespace
+
+void IteratableChunkChecksumValidator::validateChunkWithWorkerPool()
+{
+  std::vector<PieceHashWorkerPool::Result> results;
+  workerPool_->drainWakeupFd(groupId_);
+  workerPool_->takeResults(groupId_, results);
+  for(std::vector<PieceHashWorkerPool::Result>::const_iterator i =
+        results.begin(), eoi = results.end(); i != eoi; ++i) {
+    if((*i).match) {
+      bitfield_->setBit((*i).index);
+    } else {
+      if((*i).error.empty()) {
+        A2_LOG_INFO(fmt(EX_INVALID_CHUNK_CHECKSUM,
+                        static_cast<unsigned long>((*i).index),
+                        util::itos((off_t)(*i).index*dctx_->getPieceLength(),
+                                   true).c_str(),
+                        dctx_->getPieceHashes()[(*i).index].c_str(),
+                        (*i).actualHash.c_str()));
+      } else {
+        A2_LOG_DEBUG(fmt("Failed to validate piece index=%lu."
+                         " Some part of file may be missing."
+                         " Continue operation. cause: %s",
+                         static_cast<unsigned long>((*i).index),
+                         (*i).error.c_str()));
+      }
+      bitfield_->unsetBit((*i).index);
+    }
+  }
+  numInFlight_ -= results.size();
+  numFinished_ += results.size();
+  // Keep some jobs queued for each thread, so that threads do not
+  // starve while the event loop is busy.
+  const size_t maxInFlight = workerPool_->getNumThreads()*4;
+  while(currentIndex_ < dctx_->getNumPieces() && numInFlight_ < maxInFlight) {
+    PieceHashWorkerPool::Job job;
+    job.index = currentIndex_;
+    job.hashType = dctx_->getPieceHashAlgo();
+    job.expectedHash = dctx_->getPieceHashes()[currentIndex_];
+    createSpans(job.spans, dctx_->getFileEntries(),
+                (off_t)currentIndex_*dctx_->getPieceLength(),
+                getPieceLength(currentIndex_));
+    workerPool_->submit(groupId_, job);
+    ++currentIndex_;
+    ++numInFlight_;
+  }
+  if(groupId_ && finished()) {
+    closeGroup();
+    pieceStorage_->setBitfield(bitfield_->getBitfield(),
+                               bitfield_->getBitfieldLength());
+  }
+}
+
+void IteratableChunkChecksumValidator::closeGroup()
+{
+  if(groupId_) {
+    workerPool_->closeGroup(groupId_);
+    groupId_ = 0;
+  }
+}
+
+int IteratableChunkChecksumValidator::getWakeupFd() const
+{
+  return groupId_ ? workerPool_->getWakeupFd(groupId_) : -1;
+}
+
+void IteratableChunkChecksumValidator::setWorkerPool
+(const SharedHandle<PieceHashWorkerPool>& workerPool)
+{
+  workerPool_ = workerPool;
+}
+#endif // HAVE_PTHREAD
+
+size_t IteratableChunkChecksumValidator::getPieceLength(size_t index) const
 {
-  off_t offset = getCurrentOffset();
-  size_t length;
   // When validating last piece
-  if(currentIndex_+1 == dctx_->getNumPieces()) {
-    length = dctx_->getTotalLength()-offset;
+  if(index+1 == dctx_->getNumPieces()) {
+    return dctx_->getTotalLength()-(off_t)index*dctx_->getPieceLength();
   } else {
-    length = dctx_->getPieceLength();
+    return dctx_->getPieceLength();
   }
-  return digest(offset, length);
+}
+
+std::string IteratableChunkChecksumValidator::calculateActualChecksum()
+{
+  return digest(getCurrentOffset(), getPieceLength(currentIndex_));
 }
 
 void IteratableChunkChecksumValidator::init()
 {
+#ifdef HAVE_PTHREAD
+  if(workerPool_) {
+    closeGroup();
+    groupId_ = workerPool_->openGroup();
+    if(groupId_) {
+      numInFlight_ = 0;
+      numFinished_ = 0;
+      bitfield_->clearAllBit();
+      currentIndex_ = 0;
+      return;
+    }
+    // Hash pieces in this thread.
+    workerPool_.reset();
+  }
+#endif // HAVE_PTHREAD
 #ifdef HAVE_POSIX_MEMALIGN
   free(buffer_);
   buffer_ = reinterpret_cast<unsigned char*>
@@ -175,6 +306,16 @@ std::string IteratableChunkChecksumValidator::digest(off_t offset, size_t length
 
 bool IteratableChunkChecksumValidator::finished() const
 {
+#ifdef HAVE_PTHREAD
+  if(workerPool_) {
+    if(numFinished_ >= dctx_->getNumPieces()) {
+      pieceStorage_->getDiskAdaptor()->disableDirectIO();
+      return true;
+    } else {
+      return false;
+    }
+  }
+#endif // HAVE_PTHREAD
   if(currentIndex_ >= dctx_->getNumPieces()) {
     pieceStorage_->getDiskAdaptor()->disableDirectIO();
     return true;
@@ -185,6 +326,12 @@ bool IteratableChunkChecksumValidator::finished() const
 
 off_t IteratableChunkChecksumValidator::getCurrentOffset() const
 {
+#ifdef HAVE_PTHREAD
+  if(workerPool_) {
+    off_t offset = (off_t)numFinished_*dctx_->getPieceLength();
+    return std::min(offset, (off_t)dctx_->getTotalLength());
+  }
+#endif // HAVE_PTHREAD
   return (off_t)currentIndex_*dctx_->getPieceLength();
 }
 
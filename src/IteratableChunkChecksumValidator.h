@@ -43,6 +43,9 @@ class DownloadContext;
 class PieceStorage;
 class BitfieldMan;
 class MessageDigest;
+#ifdef HAVE_PTHREAD
+class PieceHashWorkerPool;
+#endif // HAVE_PTHREAD
 
 class IteratableChunkChecksumValidator:public IteratableValidator
 {
@@ -53,6 +56,20 @@ private:
   size_t currentIndex_;
   SharedHandle<MessageDigest> ctx_;
   unsigned char* buffer_;
+#ifdef HAVE_PTHREAD
+  SharedHandle<PieceHashWorkerPool> workerPool_;
+  int64_t groupId_;
+  // The number of pieces submitted to workerPool_ but not finished.
+  size_t numInFlight_;
+  // The number of pieces whose results are received.
+  size_t numFinished_;
+
+  void validateChunkWithWorkerPool();
+
+  void closeGroup();
+#endif // HAVE_PTHREAD
+
+  size_t getPieceLength(size_t index) const;
 
   std::string calculateActualChecksum();
 
@@ -73,6 +90,19 @@ public:
   virtual off_t getCurrentOffset() const;
 
   virtual uint64_t getTotalLength() const;
+
+#ifdef HAVE_PTHREAD
+  virtual bool isAsync() const
+  {
+    return workerPool_;
+  }
+
+  virtual int getWakeupFd() const;
+
+  // Pieces are hashed by worker threads in workerPool. Must be called
+  // before init().
+  void setWorkerPool(const SharedHandle<PieceHashWorkerPool>& workerPool);
+#endif // HAVE_PTHREAD
 };
 
 typedef SharedHandle<IteratableChunkChecksumValidator> IteratableChunkChecksumValidatorHandle;
@@ -63,6 +63,21 @@ public:
   virtual off_t getCurrentOffset() const = 0;
 
   virtual uint64_t getTotalLength() const = 0;
+
+  // Returns true if the validation is done by other threads and
+  // validateChunk() only collects their results.
+  virtual bool isAsync() const
+  {
+    return false;
+  }
+
+  // If isAsync() returns true, returns the file descriptor which
+  // becomes readable when validateChunk() has results to collect.
+  // Otherwise returns -1.
+  virtual int getWakeupFd() const
+  {
+    return -1;
+  }
 };
 
 typedef SharedHandle<IteratableValidator> IteratableValidatorHandle;
@@ -33,22 +33,21 @@
  */
 /* copyright --> */
 #include "LongestSequencePieceSelector.h"
+#include "array_fun.h"
 #include "bitfield.h"
 
+using namespace aria2::expr;
+
 namespace aria2 {
 
 namespace {
 size_t getStartIndex
 (size_t from, const unsigned char* bitfield, size_t nbits)
 {
-  while(from < nbits && !bitfield::test(bitfield, nbits, from)) {
-    ++from;
-  }
   if(nbits <= from) {
     return nbits;
-  } else {
-    return from;
   }
+  return bitfield::findFirstSet(bitfield, from, nbits);
 }
 } // namespace
 
@@ -56,10 +55,10 @@ namespace {
 size_t getEndIndex
 (size_t from, const unsigned char* bitfield, size_t nbits)
 {
-  while(from < nbits && bitfield::test(bitfield, nbits, from)) {
-    ++from;
+  if(nbits <= from) {
+    return from;
   }
-  return from;
+  return bitfield::findFirstSet(~array(bitfield), from, nbits);
 }
 } // namespace
 
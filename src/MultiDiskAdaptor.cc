@@ -451,6 +451,23 @@ ssize_t MultiDiskAdaptor::readData
   return totalReadLength;
 }
 
+int MultiDiskAdaptor::getFdForRead
+(off_t& fileOffset, off_t offset, size_t len)
+{
+  DiskWriterEntries::const_iterator first =
+    findFirstDiskWriterEntry(diskWriterEntries_, offset);
+  fileOffset = offset-(*first)->getFileEntry()->getOffset();
+  if(calculateLength(*first, fileOffset, len) < len) {
+    // The data spans multiple files.
+    return -1;
+  }
+  openIfNot(*first, &DiskWriterEntry::openFile);
+  if(!(*first)->isOpen()) {
+    return -1;
+  }
+  return (*first)->getDiskWriter()->getFd();
+}
+
 bool MultiDiskAdaptor::fileExists()
 {
   return std::find_if(getFileEntries().begin(), getFileEntries().end(),
@@ -150,6 +150,8 @@ public:
 
   virtual ssize_t readData(unsigned char* data, size_t len, off_t offset);
 
+  virtual int getFdForRead(off_t& fileOffset, off_t offset, size_t len);
+
   virtual bool fileExists();
 
   virtual uint64_t size();
@@ -35,9 +35,15 @@
 #include "MultiUrlRequestInfo.h"
 
 #include <signal.h>
+#ifndef __MINGW32__
+# include <sys/wait.h>
+#endif // !__MINGW32__
 
+#include <cerrno>
 #include <cstring>
 #include <ostream>
+#include <algorithm>
+#include <map>
 
 #include "RequestGroupMan.h"
 #include "DownloadEngine.h"
@@ -51,6 +57,7 @@
 #include "util.h"
 #include "Option.h"
 #include "StatCalc.h"
+#include "NullStatCalc.h"
 #include "CookieStorage.h"
 #include "File.h"
 #include "Netrc.h"
@@ -58,6 +65,7 @@
 #include "SessionSerializer.h"
 #include "TimeA2.h"
 #include "fmt.h"
+#include "array_fun.h"
 #ifdef ENABLE_SSL
 # include "SocketCore.h"
 # include "TLSContext.h"
@@ -91,6 +99,19 @@ void handler(int signal) {
 }
 } // namespace
 
+#ifndef __MINGW32__
+namespace {
+// The signal received by the parent of the shard processes, which is
+// forwarded to them.
+volatile sig_atomic_t shardSignal = 0;
+
+void shardHandler(int signal)
+{
+  shardSignal = signal;
+}
+} // namespace
+#endif // !__MINGW32__
+
 namespace {
 
 ares_addr_node* parseAsyncDNSServers(const std::string& serversOpt)
@@ -158,6 +179,173 @@ void MultiUrlRequestInfo::printMessageForContinue()
 }
 
 error_code::Value MultiUrlRequestInfo::execute()
+{
+#ifndef __MINGW32__
+  size_t numShards = option_->getAsInt(PREF_ENGINE_SHARDS);
+  if(numShards > 1 && requestGroups_.size() > 1
+#ifdef ENABLE_XML_RPC
+     && !option_->getAsBool(PREF_ENABLE_XML_RPC)
+#endif // ENABLE_XML_RPC
+     ) {
+    return runShards(std::min(numShards, requestGroups_.size()));
+  }
+#endif // !__MINGW32__
+  return runDownloadEngine();
+}
+
+#ifndef __MINGW32__
+error_code::Value MultiUrlRequestInfo::runShards(size_t numShards)
+{
+  // Assign downloads to shards in round-robin. A download which
+  // belongs to another one, such as .torrent file listed in Metalink,
+  // goes to the shard of its owner, because the owner depends on it.
+  std::vector<size_t> shardOf(requestGroups_.size());
+  std::map<gid_t, size_t> gidToShard;
+  size_t numOwners = 0;
+  for(size_t i = 0; i < requestGroups_.size(); ++i) {
+    if(requestGroups_[i]->belongsTo() == 0) {
+      shardOf[i] = numOwners++%numShards;
+      gidToShard[requestGroups_[i]->getGID()] = shardOf[i];
+    }
+  }
+  for(size_t i = 0; i < requestGroups_.size(); ++i) {
+    if(requestGroups_[i]->belongsTo() != 0) {
+      std::map<gid_t, size_t>::const_iterator itr =
+        gidToShard.find(requestGroups_[i]->belongsTo());
+      shardOf[i] = itr == gidToShard.end() ? 0 : (*itr).second;
+    }
+  }
+  A2_LOG_NOTICE(fmt("Running %lu downloads in %lu processes.",
+                    static_cast<unsigned long>(requestGroups_.size()),
+                    static_cast<unsigned long>(numShards)));
+  summaryOut_ << std::flush;
+#ifdef SIGCHLD
+  // Set to default so that waitpid() can get the exit status.
+  util::setGlobalSignalHandler(SIGCHLD, SIG_DFL, 0);
+#endif // SIGCHLD
+  std::vector<pid_t> pids;
+  for(size_t shard = 0; shard < numShards; ++shard) {
+    pid_t pid = fork();
+    if(pid == -1) {
+      int errNum = errno;
+      A2_LOG_ERROR(fmt("fork() failed. cause: %s",
+                       util::safeStrerror(errNum).c_str()));
+      for(std::vector<pid_t>::const_iterator i = pids.begin(),
+            eoi = pids.end(); i != eoi; ++i) {
+        kill(*i, SIGTERM);
+      }
+      break;
+    } else if(pid == 0) {
+#ifdef SIGCHLD
+      util::setGlobalSignalHandler(SIGCHLD, SIG_IGN, 0);
+#endif // SIGCHLD
+      std::vector<SharedHandle<RequestGroup> > groups;
+      for(size_t i = 0; i < requestGroups_.size(); ++i) {
+        if(shardOf[i] == shard) {
+          groups.push_back(requestGroups_[i]);
+        }
+      }
+      requestGroups_.swap(groups);
+      setShardOption(option_.get(), shard, numShards);
+      if(shard > 0) {
+        statCalc_.reset(new NullStatCalc());
+      }
+      return runDownloadEngine();
+    }
+    pids.push_back(pid);
+  }
+  error_code::Value returnValue =
+    pids.size() == numShards ? error_code::FINISHED : error_code::UNKNOWN_ERROR;
+  // SIGINT from the terminal is delivered to the shards directly.
+  util::setGlobalSignalHandler(SIGINT, SIG_IGN, 0);
+#ifdef SIGHUP
+  util::setGlobalSignalHandler(SIGHUP, shardHandler, 0);
+#endif // SIGHUP
+  util::setGlobalSignalHandler(SIGTERM, shardHandler, 0);
+  for(size_t numRunning = pids.size(); numRunning > 0;) {
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if(pid == -1) {
+      if(errno == EINTR) {
+        if(shardSignal) {
+          for(std::vector<pid_t>::const_iterator i = pids.begin(),
+                eoi = pids.end(); i != eoi; ++i) {
+            kill(*i, shardSignal);
+          }
+          shardSignal = 0;
+        }
+        continue;
+      }
+      break;
+    }
+    --numRunning;
+    if(returnValue == error_code::FINISHED) {
+      if(WIFEXITED(status)) {
+        returnValue = static_cast<error_code::Value>(WEXITSTATUS(status));
+      } else {
+        returnValue = error_code::UNKNOWN_ERROR;
+      }
+    }
+  }
+#ifdef SIGHUP
+  util::setGlobalSignalHandler(SIGHUP, SIG_DFL, 0);
+#endif // SIGHUP
+  util::setGlobalSignalHandler(SIGINT, SIG_DFL, 0);
+  util::setGlobalSignalHandler(SIGTERM, SIG_DFL, 0);
+#ifdef SIGCHLD
+  util::setGlobalSignalHandler(SIGCHLD, SIG_IGN, 0);
+#endif // SIGCHLD
+  return returnValue;
+}
+#endif // !__MINGW32__
+
+namespace {
+// Returns the share of the shard-th of numShards shards when total is
+// divided among them as evenly as possible. The share is at least 1.
+int32_t divideForShard(int32_t total, size_t shard, size_t numShards)
+{
+  int32_t share = total/numShards;
+  if(shard < total%numShards) {
+    ++share;
+  }
+  return std::max(share, static_cast<int32_t>(1));
+}
+} // namespace
+
+void setShardOption(Option* option, size_t shard, size_t numShards)
+{
+  // 0 means no limit for the speed limits.
+  const std::string* limits[] = {
+    &PREF_MAX_OVERALL_DOWNLOAD_LIMIT, &PREF_MAX_OVERALL_UPLOAD_LIMIT
+  };
+  for(size_t i = 0; i < A2_ARRAY_LEN(limits); ++i) {
+    int32_t limit = option->getAsInt(*limits[i]);
+    if(limit > 0) {
+      option->put(*limits[i],
+                  util::itos(divideForShard(limit, shard, numShards)));
+    }
+  }
+  option->put(PREF_MAX_CONCURRENT_DOWNLOADS,
+              util::itos(divideForShard
+                         (option->getAsInt(PREF_MAX_CONCURRENT_DOWNLOADS),
+                          shard, numShards)));
+  if(shard > 0) {
+    // A shard loading the DHT routing table of another one would use
+    // the same node ID.
+    const std::string suffix = "."+util::uitos(shard);
+    const std::string* files[] = {
+      &PREF_SAVE_SESSION, &PREF_SAVE_COOKIES, &PREF_SERVER_STAT_OF,
+      &PREF_DHT_FILE_PATH, &PREF_DHT_FILE_PATH6
+    };
+    for(size_t i = 0; i < A2_ARRAY_LEN(files); ++i) {
+      if(!option->blank(*files[i])) {
+        option->put(*files[i], option->get(*files[i])+suffix);
+      }
+    }
+  }
+}
+
+error_code::Value MultiUrlRequestInfo::runDownloadEngine()
 {
   error_code::Value returnValue = error_code::FINISHED;
   try {
@@ -60,6 +60,15 @@ private:
   std::ostream& summaryOut_;
 
   void printMessageForContinue();
+
+  // Runs DownloadEngine for requestGroups_ in this process.
+  error_code::Value runDownloadEngine();
+
+#ifndef __MINGW32__
+  // Distributes requestGroups_ among numShards child processes, each
+  // of which calls runDownloadEngine(), and waits for them.
+  error_code::Value runShards(size_t numShards);
+#endif // !__MINGW32__
 public:
   MultiUrlRequestInfo
   (const std::vector<SharedHandle<RequestGroup> >& requestGroups,
@@ -78,6 +87,12 @@ public:
 
 typedef SharedHandle<MultiUrlRequestInfo> MultiUrlRequestInfoHandle;
 
+// Changes option for the shard-th process of numShards engine
+// shards. The overall speed limits and --max-concurrent-downloads are
+// divided among the shards. The second and later shards append
+// ".shard" to the names of the files they write.
+void setShardOption(Option* option, size_t shard, size_t numShards);
+
 } // namespace aria2
 
 #endif // D_MULTI_URL_REQUEST_INFO_H
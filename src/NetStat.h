@@ -0,0 +1,86 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_NET_STAT_H
+#define D_NET_STAT_H
+
+#include "common.h"
+#include "SpeedCalc.h"
+
+namespace aria2 {
+
+// Aggregated transfer statistics. RequestGroup and RequestGroupMan
+// update their NetStat as bytes are transferred, so that the speed
+// of a download or of all downloads is obtained in constant time
+// without iterating connections.
+class NetStat {
+private:
+  SpeedCalc downloadSpeed_;
+  SpeedCalc uploadSpeed_;
+  uint64_t sessionDownloadLength_;
+  uint64_t sessionUploadLength_;
+public:
+  NetStat();
+
+  ~NetStat();
+
+  // Returns current download speed in byte per sec.
+  unsigned int calculateDownloadSpeed();
+
+  // Returns current upload speed in byte per sec.
+  unsigned int calculateUploadSpeed();
+
+  void updateDownloadLength(size_t bytes);
+
+  void updateUploadLength(size_t bytes);
+
+  // Returns the number of bytes downloaded since the program started.
+  uint64_t getSessionDownloadLength() const
+  {
+    return sessionDownloadLength_;
+  }
+
+  // Returns the number of bytes uploaded since the program started.
+  uint64_t getSessionUploadLength() const
+  {
+    return sessionUploadLength_;
+  }
+
+  // Resets speed. The session lengths are not changed.
+  void resetSpeed();
+};
+
+} // namespace aria2
+
+#endif // D_NET_STAT_H
@@ -194,6 +194,15 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_ADVANCED);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new UnitNumberOptionHandler
+                                   (PREF_DISK_CACHE,
+                                    TEXT_DISK_CACHE,
+                                    "16M",
+                                    0));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<NumberOptionHandler> op(new NumberOptionHandler
                                          (PREF_DNS_TIMEOUT,
@@ -237,6 +246,17 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     handlers.push_back(op);
   }
 #endif // ENABLE_XML_RPC
+#ifndef __MINGW32__
+  {
+    SharedHandle<OptionHandler> op(new NumberOptionHandler
+                                   (PREF_ENGINE_SHARDS,
+                                    TEXT_ENGINE_SHARDS,
+                                    "1",
+                                    1, 64));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
+#endif // !__MINGW32__
   {
     std::string params[] = {
 #ifdef HAVE_EPOLL
@@ -294,6 +314,17 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_BASIC);
     handlers.push_back(op);
   }
+#ifdef ENABLE_MESSAGE_DIGEST
+  {
+    SharedHandle<OptionHandler> op(new NumberOptionHandler
+                                   (PREF_HASH_CHECK_THREADS,
+                                    TEXT_HASH_CHECK_THREADS,
+                                    "1",
+                                    0, 64));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
+#endif // ENABLE_MESSAGE_DIGEST
   {
     SharedHandle<OptionHandler> op(new BooleanOptionHandler
                                    (PREF_HUMAN_READABLE,
@@ -379,6 +410,17 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_HTTP);
     handlers.push_back(op);
   }
+#ifdef ENABLE_MESSAGE_DIGEST
+  {
+    SharedHandle<OptionHandler> op(new NumberOptionHandler
+                                   (PREF_MAX_CONCURRENT_CHECKS,
+                                    TEXT_MAX_CONCURRENT_CHECKS,
+                                    "1",
+                                    1));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
+#endif // ENABLE_MESSAGE_DIGEST
   {
     SharedHandle<OptionHandler> op(new NumberOptionHandler
                                    (PREF_MAX_DOWNLOAD_RESULT,
@@ -650,6 +692,17 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_HTTP);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new UnitNumberOptionHandler
+                                   (PREF_MAX_RECV_BUFFER_SIZE,
+                                    TEXT_MAX_RECV_BUFFER_SIZE,
+                                    "256K",
+                                    16*1024, 16*1024*1024));
+    op->addTag(TAG_ADVANCED);
+    op->addTag(TAG_FTP);
+    op->addTag(TAG_HTTP);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new NumberOptionHandler
                                    (PREF_MAX_TRIES,
@@ -93,22 +93,43 @@ void PeerConnection::pushStr(const std::string& data)
 void PeerConnection::pushBytes(unsigned char* data, size_t len)
 {
   if(encryptionEnabled_) {
-    unsigned char* chunk = new unsigned char[len];
+    // We own data, so encrypt it in place. ARC4 is a stream cipher
+    // and both backends allow the input and output to be the same
+    // buffer.
     try {
-      encryptor_->encrypt(chunk, len, data, len);
+      encryptor_->encrypt(data, len, data, len);
     } catch(RecoverableException& e) {
       delete [] data;
-      delete [] chunk;
       throw;
     }
-    delete [] data;
-    socketBuffer_.pushBytes(chunk, len);
+  }
+  socketBuffer_.pushBytes(data, len);
+}
+
+void PeerConnection::pushInlineBytes(const unsigned char* data, size_t len)
+{
+  assert(len <= SocketBuffer::INLINE_BUF_SIZE);
+  if(encryptionEnabled_) {
+    unsigned char chunk[SocketBuffer::INLINE_BUF_SIZE];
+    encryptor_->encrypt(chunk, len, data, len);
+    socketBuffer_.pushInlineBytes(chunk, len);
   } else {
-    socketBuffer_.pushBytes(data, len);
+    socketBuffer_.pushInlineBytes(data, len);
+  }
+}
+
+bool PeerConnection::pushFileData
+(const SharedHandle<DiskAdaptor>& diskAdaptor, off_t offset, size_t len)
+{
+  if(encryptionEnabled_) {
+    return false;
   }
+  return socketBuffer_.pushFile(diskAdaptor, offset, len);
 }
 
-bool PeerConnection::receiveMessage(unsigned char* data, size_t& dataLength) {
+bool PeerConnection::receiveMessage
+(const unsigned char*& data, size_t& dataLength)
+{
   if(resbufLength_ == 0 && 4 > lenbufLength_) {
     // read payload size, 32bit unsigned integer
     size_t remaining = 4-lenbufLength_;
@@ -168,9 +189,7 @@ bool PeerConnection::receiveMessage(unsigned char* data, size_t& dataLength) {
   // we got whole payload.
   resbufLength_ = 0;
   lenbufLength_ = 0;
-  if(data) {
-    memcpy(data, resbuf_, currentPayloadLength_);
-  }
+  data = resbuf_;
   dataLength = currentPayloadLength_;
   return true;
 }
@@ -212,13 +231,11 @@ bool PeerConnection::receiveHandshake(unsigned char* data, size_t& dataLength,
 void PeerConnection::readData
 (unsigned char* data, size_t& length, bool encryption)
 {
+  socket_->readData(data, length);
   if(encryption) {
-    unsigned char temp[MAX_PAYLOAD_LEN];
-    assert(MAX_PAYLOAD_LEN >= length);
-    socket_->readData(temp, length);
-    decryptor_->decrypt(data, length, temp, length);
-  } else {
-    socket_->readData(data, length);
+    // ARC4 is a stream cipher and both backends allow the input and
+    // output to be the same buffer, so decrypt in place.
+    decryptor_->decrypt(data, length, data, length);
   }
 }
 
@@ -251,11 +268,4 @@ ssize_t PeerConnection::sendPendingData()
   return writtenLength;
 }
 
-unsigned char* PeerConnection::detachBuffer()
-{
-  unsigned char* detachbuf = resbuf_;
-  resbuf_ = new unsigned char[MAX_PAYLOAD_LEN];
-  return detachbuf;
-}
-
 } // namespace aria2
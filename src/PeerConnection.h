@@ -49,6 +49,7 @@ class Peer;
 class SocketCore;
 class ARC4Encryptor;
 class ARC4Decryptor;
+class DiskAdaptor;
 
 // The maximum length of payload. Messages beyond that length are
 // dropped.
@@ -90,9 +91,26 @@ public:
   // ownership of data, so caller must not delete or alter it.
   void pushBytes(unsigned char* data, size_t len);
 
+  // Copies len bytes of data into send buffer without allocating
+  // memory. len must not exceed SocketBuffer::INLINE_BUF_SIZE.
+  void pushInlineBytes(const unsigned char* data, size_t len);
+
   void pushStr(const std::string& data);
 
-  bool receiveMessage(unsigned char* data, size_t& dataLength);
+  // Pushes len bytes at offset in diskAdaptor into send buffer. The
+  // data is sent from the file directly without copying it into user
+  // space. Returns false if it is not possible, for example,
+  // encryption is enabled. In this case, nothing is pushed and the
+  // caller must read the data and push it by pushBytes().
+  bool pushFileData(const SharedHandle<DiskAdaptor>& diskAdaptor,
+                    off_t offset, size_t len);
+
+  // Receives a message. Returns true if the whole message is
+  // received. Then data points to its payload in the buffer of this
+  // object and dataLength is the length of the payload. The payload
+  // is not copied, so it is only valid until the next call of this
+  // function.
+  bool receiveMessage(const unsigned char*& data, size_t& dataLength);
 
   /**
    * Returns true if a handshake message is fully received, otherwise returns
@@ -121,8 +139,6 @@ public:
   {
     return resbufLength_;
   }
-
-  unsigned char* detachBuffer();
 };
 
 typedef SharedHandle<PeerConnection> PeerConnectionHandle;
@@ -33,18 +33,29 @@
  */
 /* copyright --> */
 #include "Piece.h"
+
+#include <cassert>
+#include <algorithm>
+
 #include "util.h"
 #include "BitfieldMan.h"
 #include "A2STR.h"
 #include "util.h"
 #include "a2functional.h"
+#include "WrDiskCache.h"
+#include "WrDiskCacheEntry.h"
+#include "DiskAdaptor.h"
+#include "DlAbortEx.h"
+#include "message.h"
+#include "fmt.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "MessageDigest.h"
 #endif // ENABLE_MESSAGE_DIGEST
 
 namespace aria2 {
 
-Piece::Piece():index_(0), length_(0), blockLength_(BLOCK_LENGTH), bitfield_(0)
+Piece::Piece():index_(0), length_(0), blockLength_(BLOCK_LENGTH), bitfield_(0),
+              wrCache_(0)
 #ifdef ENABLE_MESSAGE_DIGEST
               , nextBegin_(0)
 #endif // ENABLE_MESSAGE_DIGEST
@@ -52,7 +63,8 @@ Piece::Piece():index_(0), length_(0), blockLength_(BLOCK_LENGTH), bitfield_(0)
 
 Piece::Piece(size_t index, size_t length, size_t blockLength):
   index_(index), length_(length), blockLength_(blockLength),
-  bitfield_(new BitfieldMan(blockLength_, length))
+  bitfield_(new BitfieldMan(blockLength_, length)),
+  wrCache_(0)
 #ifdef ENABLE_MESSAGE_DIGEST
                                                              , nextBegin_(0)
 #endif // ENABLE_MESSAGE_DIGEST
@@ -60,6 +72,7 @@ Piece::Piece(size_t index, size_t length, size_t blockLength):
 
 Piece::~Piece()
 {
+  delete wrCache_;
   delete bitfield_;
 }
 
@@ -233,6 +246,116 @@ void Piece::destroyHashContext()
   nextBegin_ = 0;
 }
 
+namespace {
+void updateHashWithRead
+(const SharedHandle<MessageDigest>& mdctx,
+ const SharedHandle<DiskAdaptor>& adaptor,
+ off_t offset, size_t len)
+{
+  const size_t BUFSIZE = 4096;
+  unsigned char buf[BUFSIZE];
+  while(len > 0) {
+    size_t readLength = std::min(len, BUFSIZE);
+    if(adaptor->readData(buf, readLength, offset) !=
+       static_cast<ssize_t>(readLength)) {
+      throw DL_ABORT_EX(fmt(EX_FILE_READ, "n/a", "data is too short"));
+    }
+    mdctx->update(buf, readLength);
+    offset += readLength;
+    len -= readLength;
+  }
+}
+} // namespace
+
+std::string Piece::getHashStringWithWrCache
+(size_t pieceLength, const SharedHandle<DiskAdaptor>& adaptor)
+{
+  SharedHandle<MessageDigest> mdctx(MessageDigest::create(hashAlgo_));
+  off_t start = static_cast<off_t>(index_)*pieceLength;
+  off_t goff = start;
+  if(wrCache_) {
+    const WrDiskCacheEntry::DataCellSet& dataSet = wrCache_->getDataSet();
+    for(WrDiskCacheEntry::DataCellSet::const_iterator i = dataSet.begin(),
+          eoi = dataSet.end(); i != eoi; ++i) {
+      if(goff < (*i)->goff) {
+        updateHashWithRead(mdctx, adaptor, goff, (*i)->goff-goff);
+      }
+      mdctx->update((*i)->data, (*i)->len);
+      goff = (*i)->goff+(*i)->len;
+    }
+  }
+  updateHashWithRead(mdctx, adaptor, goff, start+length_-goff);
+  return mdctx->hexDigest();
+}
+
 #endif // ENABLE_MESSAGE_DIGEST
 
+void Piece::initWrCache
+(WrDiskCache* diskCache, const SharedHandle<DiskAdaptor>& diskAdaptor)
+{
+  assert(!wrCache_);
+  wrCache_ = new WrDiskCacheEntry(diskAdaptor);
+}
+
+void Piece::updateWrCache(WrDiskCache* diskCache, const unsigned char* data,
+                          size_t len, off_t goff)
+{
+  assert(wrCache_);
+  if(!wrCache_->cacheData(data, len, goff)) {
+    // In end game mode, same block may be received more than once.
+    // Write out cached data first, so that newer data supersedes
+    // older one.
+    flushWrCache(diskCache);
+    wrCache_->cacheData(data, len, goff);
+  }
+  diskCache->update(wrCache_, len);
+}
+
+void Piece::acquireWrCache(WrDiskCache* diskCache, unsigned char* data,
+                           size_t len, off_t goff)
+{
+  assert(wrCache_);
+  if(len == 0) {
+    delete [] data;
+    return;
+  }
+  if(!wrCache_->acquireData(data, len, goff)) {
+    // See updateWrCache()
+    flushWrCache(diskCache);
+    wrCache_->acquireData(data, len, goff);
+  }
+  diskCache->update(wrCache_, len);
+}
+
+void Piece::flushWrCache(WrDiskCache* diskCache)
+{
+  if(!wrCache_) {
+    return;
+  }
+  size_t size = wrCache_->getSize();
+  wrCache_->writeToDisk();
+  wrCache_->clear();
+  diskCache->update(wrCache_, -static_cast<ssize_t>(size));
+}
+
+void Piece::clearWrCache(WrDiskCache* diskCache)
+{
+  if(!wrCache_) {
+    return;
+  }
+  size_t size = wrCache_->getSize();
+  wrCache_->clear();
+  diskCache->update(wrCache_, -static_cast<ssize_t>(size));
+}
+
+void Piece::releaseWrCache(WrDiskCache* diskCache)
+{
+  if(!wrCache_) {
+    return;
+  }
+  diskCache->remove(wrCache_);
+  delete wrCache_;
+  wrCache_ = 0;
+}
+
 } // namespace aria2
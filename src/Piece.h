@@ -46,6 +46,9 @@
 namespace aria2 {
 
 class BitfieldMan;
+class WrDiskCache;
+class WrDiskCacheEntry;
+class DiskAdaptor;
 
 #ifdef ENABLE_MESSAGE_DIGEST
 
@@ -59,6 +62,7 @@ private:
   size_t length_;
   size_t blockLength_;
   BitfieldMan* bitfield_;
+  WrDiskCacheEntry* wrCache_;
 
 #ifdef ENABLE_MESSAGE_DIGEST
 
@@ -170,12 +174,48 @@ public:
 
   void destroyHashContext();
 
+  // Calculates hash value of this piece using data in the write cache
+  // and, for the ranges which are not cached, data read from adaptor.
+  // Returns hash value in ASCII hexadecimal form.
+  std::string getHashStringWithWrCache
+  (size_t pieceLength, const SharedHandle<DiskAdaptor>& adaptor);
+
 #endif // ENABLE_MESSAGE_DIGEST
 
   /**
    * Loses current bitfield state.
    */
   void reconfigure(size_t length);
+
+  // Creates write cache for this piece.  Data given to
+  // updateWrCache() is stored in memory until it is flushed.
+  void initWrCache(WrDiskCache* diskCache,
+                   const SharedHandle<DiskAdaptor>& diskAdaptor);
+
+  // Caches len bytes of data which is going to be written at global
+  // offset goff.  initWrCache() must be called before this call.
+  void updateWrCache(WrDiskCache* diskCache, const unsigned char* data,
+                     size_t len, off_t goff);
+
+  // Same as updateWrCache() but the cache gets ownership of data,
+  // which must be allocated by new[], instead of copying it.
+  void acquireWrCache(WrDiskCache* diskCache, unsigned char* data,
+                      size_t len, off_t goff);
+
+  // Writes cached data to disk and releases it.
+  void flushWrCache(WrDiskCache* diskCache);
+
+  // Releases cached data without writing it to disk.
+  void clearWrCache(WrDiskCache* diskCache);
+
+  // Discards cached data and deletes write cache.  After this call,
+  // getWrDiskCacheEntry() returns 0.
+  void releaseWrCache(WrDiskCache* diskCache);
+
+  WrDiskCacheEntry* getWrDiskCacheEntry() const
+  {
+    return wrCache_;
+  }
 };
 
 } // namespace aria2
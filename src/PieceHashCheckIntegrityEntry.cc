@@ -37,6 +37,7 @@
 #include "IteratableChunkChecksumValidator.h"
 #include "DownloadContext.h"
 #include "PieceStorage.h"
+#include "RequestGroupMan.h"
 
 namespace aria2 {
 
@@ -61,6 +62,12 @@ void PieceHashCheckIntegrityEntry::initValidator()
     (new IteratableChunkChecksumValidator
      (getRequestGroup()->getDownloadContext(),
       getRequestGroup()->getPieceStorage()));
+#ifdef HAVE_PTHREAD
+  if(getRequestGroup()->getRequestGroupMan()) {
+    validator->setWorkerPool
+      (getRequestGroup()->getRequestGroupMan()->getPieceHashWorkerPool());
+  }
+#endif // HAVE_PTHREAD
   validator->init();
   setValidator(validator);
 #endif // ENABLE_MESSAGE_DIGEST
@@ -0,0 +1,326 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "PieceHashWorkerPool.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include "a2io.h"
+#include "MessageDigest.h"
+#include "Exception.h"
+#include "util.h"
+#include "fmt.h"
+#include "message.h"
+#include "array_fun.h"
+#include "LogFactory.h"
+#include "Logger.h"
+
+namespace aria2 {
+
+#define BUFSIZE (256*1024)
+
+PieceHashWorkerPool::PieceHashWorkerPool(size_t numThreads)
+  : numThreads_(numThreads),
+    shutdown_(false),
+    nextGroupId_(1)
+{
+  pthread_mutex_init(&mutex_, 0);
+  pthread_cond_init(&cond_, 0);
+}
+
+namespace {
+void closeWakeupFds(int* fds)
+{
+  for(size_t i = 0; i < 2; ++i) {
+    close(fds[i]);
+  }
+}
+} // namespace
+
+PieceHashWorkerPool::~PieceHashWorkerPool()
+{
+  stop();
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&mutex_);
+  for(std::map<int64_t, Group>::iterator i = groups_.begin(),
+        eoi = groups_.end(); i != eoi; ++i) {
+    closeWakeupFds((*i).second.wakeupFds);
+  }
+}
+
+bool PieceHashWorkerPool::start()
+{
+  for(size_t i = 0; i < numThreads_; ++i) {
+    pthread_t thread;
+    int r = pthread_create(&thread, 0, &PieceHashWorkerPool::run, this);
+    if(r != 0) {
+      A2_LOG_ERROR(fmt("Failed to create hash check thread. cause: %s",
+                       util::safeStrerror(r).c_str()));
+      stop();
+      return false;
+    }
+    threads_.push_back(thread);
+  }
+  return true;
+}
+
+void PieceHashWorkerPool::stop()
+{
+  pthread_mutex_lock(&mutex_);
+  shutdown_ = true;
+  pthread_cond_broadcast(&cond_);
+  pthread_mutex_unlock(&mutex_);
+  for(std::vector<pthread_t>::iterator i = threads_.begin(),
+        eoi = threads_.end(); i != eoi; ++i) {
+    pthread_join(*i, 0);
+  }
+  threads_.clear();
+}
+
+void* PieceHashWorkerPool::run(void* arg)
+{
+  reinterpret_cast<PieceHashWorkerPool*>(arg)->work();
+  return 0;
+}
+
+void PieceHashWorkerPool::work()
+{
+  array_ptr<unsigned char> buf(new unsigned char[BUFSIZE]);
+  pthread_mutex_lock(&mutex_);
+  while(1) {
+    while(!shutdown_ && jobs_.empty()) {
+      pthread_cond_wait(&cond_, &mutex_);
+    }
+    if(shutdown_) {
+      break;
+    }
+    int64_t groupId = jobs_.front().first;
+    Job job = jobs_.front().second;
+    jobs_.pop_front();
+    pthread_mutex_unlock(&mutex_);
+
+    Result result = process(job, buf, BUFSIZE);
+
+    pthread_mutex_lock(&mutex_);
+    std::map<int64_t, Group>::iterator itr = groups_.find(groupId);
+    if(itr != groups_.end()) {
+      // Only the first result since last takeResults() needs to
+      // wake up the consumer.
+      if((*itr).second.results.empty()) {
+        char c = 0;
+        while(write((*itr).second.wakeupFds[1], &c, 1) == -1 &&
+              errno == EINTR);
+      }
+      (*itr).second.results.push_back(result);
+    }
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+sock_t PieceHashWorkerPool::getWakeupFd(int64_t groupId)
+{
+  sock_t fd = -1;
+  pthread_mutex_lock(&mutex_);
+  std::map<int64_t, Group>::const_iterator itr = groups_.find(groupId);
+  if(itr != groups_.end()) {
+    fd = (*itr).second.wakeupFds[0];
+  }
+  pthread_mutex_unlock(&mutex_);
+  return fd;
+}
+
+void PieceHashWorkerPool::drainWakeupFd(int64_t groupId)
+{
+  // The pipe is closed only by closeGroup(), which is called by the
+  // consumer itself, so it is safe to read it without the lock.
+  sock_t fd = getWakeupFd(groupId);
+  if(fd == -1) {
+    return;
+  }
+  char buf[256];
+  ssize_t r;
+  while((r = read(fd, buf, sizeof(buf))) > 0 || (r == -1 && errno == EINTR));
+}
+
+int64_t PieceHashWorkerPool::openGroup()
+{
+  int fds[2];
+  if(pipe(fds) == -1) {
+    int errNum = errno;
+    A2_LOG_ERROR(fmt("Failed to create wakeup pipe for hash check."
+                     " cause: %s", util::safeStrerror(errNum).c_str()));
+    return 0;
+  }
+  for(size_t i = 0; i < A2_ARRAY_LEN(fds); ++i) {
+    fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL)|O_NONBLOCK);
+  }
+  pthread_mutex_lock(&mutex_);
+  int64_t groupId = nextGroupId_++;
+  Group& group = groups_[groupId];
+  group.wakeupFds[0] = fds[0];
+  group.wakeupFds[1] = fds[1];
+  pthread_mutex_unlock(&mutex_);
+  return groupId;
+}
+
+namespace {
+class GroupIdEq {
+private:
+  int64_t groupId_;
+public:
+  GroupIdEq(int64_t groupId):groupId_(groupId) {}
+
+  bool operator()(const std::pair<int64_t, PieceHashWorkerPool::Job>& job)
+    const
+  {
+    return job.first == groupId_;
+  }
+};
+} // namespace
+
+void PieceHashWorkerPool::closeGroup(int64_t groupId)
+{
+  pthread_mutex_lock(&mutex_);
+  std::map<int64_t, Group>::iterator itr = groups_.find(groupId);
+  if(itr != groups_.end()) {
+    closeWakeupFds((*itr).second.wakeupFds);
+    groups_.erase(itr);
+  }
+  jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(), GroupIdEq(groupId)),
+              jobs_.end());
+  pthread_mutex_unlock(&mutex_);
+}
+
+void PieceHashWorkerPool::submit(int64_t groupId, const Job& job)
+{
+  pthread_mutex_lock(&mutex_);
+  jobs_.push_back(std::make_pair(groupId, job));
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+void PieceHashWorkerPool::takeResults
+(int64_t groupId, std::vector<Result>& results)
+{
+  pthread_mutex_lock(&mutex_);
+  std::map<int64_t, Group>::iterator itr = groups_.find(groupId);
+  if(itr != groups_.end()) {
+    std::vector<Result>& groupResults = (*itr).second.results;
+    results.insert(results.end(), groupResults.begin(), groupResults.end());
+    groupResults.clear();
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+namespace {
+// Reads span and updates ctx. Returns empty string on success,
+// otherwise returns error message.
+std::string updateHash
+(MessageDigest* ctx, const PieceHashWorkerPool::Span& span,
+ unsigned char* buf, size_t bufSize)
+{
+  int fd;
+  while((fd = open(span.path.c_str(), O_RDONLY|O_BINARY)) == -1 &&
+        errno == EINTR);
+  if(fd == -1) {
+    int errNum = errno;
+    return fmt(EX_FILE_OPEN, span.path.c_str(),
+               util::safeStrerror(errNum).c_str());
+  }
+  std::string error;
+  off_t offset = span.offset;
+  size_t rem = span.length;
+#ifndef HAVE_PREAD
+  if(a2lseek(fd, offset, SEEK_SET) == (off_t)-1) {
+    int errNum = errno;
+    close(fd);
+    return fmt(EX_FILE_SEEK, span.path.c_str(),
+               util::safeStrerror(errNum).c_str());
+  }
+#endif // !HAVE_PREAD
+  while(rem > 0) {
+    size_t len = std::min(rem, bufSize);
+    ssize_t r;
+#ifdef HAVE_PREAD
+    while((r = pread(fd, buf, len, offset)) == -1 && errno == EINTR);
+#else // !HAVE_PREAD
+    while((r = read(fd, buf, len)) == -1 && errno == EINTR);
+#endif // !HAVE_PREAD
+    if(r == -1) {
+      int errNum = errno;
+      error = fmt(EX_FILE_READ, span.path.c_str(),
+                  util::safeStrerror(errNum).c_str());
+      break;
+    }
+    if(r == 0) {
+      error = fmt(EX_FILE_READ, span.path.c_str(), "data is too short");
+      break;
+    }
+    ctx->update(buf, r);
+    offset += r;
+    rem -= r;
+  }
+  close(fd);
+  return error;
+}
+} // namespace
+
+PieceHashWorkerPool::Result PieceHashWorkerPool::process
+(const Job& job, unsigned char* buf, size_t bufSize)
+{
+  Result result;
+  result.index = job.index;
+  result.match = false;
+  try {
+    SharedHandle<MessageDigest> ctx = MessageDigest::create(job.hashType);
+    for(std::vector<Span>::const_iterator i = job.spans.begin(),
+          eoi = job.spans.end(); i != eoi; ++i) {
+      result.error = updateHash(ctx.get(), *i, buf, bufSize);
+      if(!result.error.empty()) {
+        return result;
+      }
+    }
+    result.actualHash = ctx->hexDigest();
+    result.match = result.actualHash == job.expectedHash;
+  } catch(Exception& e) {
+    result.error = e.what();
+  }
+  return result;
+}
+
+} // namespace aria2
@@ -0,0 +1,157 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_PIECE_HASH_WORKER_POOL_H
+#define D_PIECE_HASH_WORKER_POOL_H
+
+#include "common.h"
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "a2netcompat.h"
+
+namespace aria2 {
+
+// Computes piece hashes in worker threads so that hash checking does
+// not block the event loop. The main thread submits jobs and takes
+// results. Worker threads only touch the data copied into Job and
+// never access DiskAdaptor or any other object shared with the main
+// thread. Each group has its own wakeup pipe. When a result of the
+// group becomes available, 1 byte is written to the pipe so that the
+// consumer of the group can watch it with EventPoll.
+class PieceHashWorkerPool {
+public:
+  // Region of a file which forms a part of a piece.
+  struct Span {
+    std::string path;
+    // Offset in the file
+    off_t offset;
+    size_t length;
+  };
+
+  struct Job {
+    size_t index;
+    std::string hashType;
+    // Expected hash in hex digest.
+    std::string expectedHash;
+    std::vector<Span> spans;
+  };
+
+  struct Result {
+    size_t index;
+    bool match;
+    // Actual hash in hex digest. Empty if an error occurred.
+    std::string actualHash;
+    // Error message when data could not be read.
+    std::string error;
+  };
+private:
+  struct Group {
+    // Finished results which are not taken yet.
+    std::vector<Result> results;
+    int wakeupFds[2];
+  };
+
+  size_t numThreads_;
+  std::vector<pthread_t> threads_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  bool shutdown_;
+  // Pending jobs with the ID of the group they belong to.
+  std::deque<std::pair<int64_t, Job> > jobs_;
+  std::map<int64_t, Group> groups_;
+  int64_t nextGroupId_;
+
+  static void* run(void* arg);
+
+  void work();
+
+  // Joins all threads.
+  void stop();
+
+  PieceHashWorkerPool(const PieceHashWorkerPool&);
+  PieceHashWorkerPool& operator=(const PieceHashWorkerPool&);
+public:
+  PieceHashWorkerPool(size_t numThreads);
+
+  // Joins all threads. Pending jobs are discarded.
+  ~PieceHashWorkerPool();
+
+  // Creates worker threads. Returns true if all of them are created
+  // successfully. Otherwise, the threads already created are joined
+  // and returns false.
+  bool start();
+
+  size_t getNumThreads() const
+  {
+    return numThreads_;
+  }
+
+  // Returns new group ID, or 0 if the wakeup pipe for the group
+  // cannot be created. Each validator uses its own group to submit
+  // jobs and take results.
+  int64_t openGroup();
+
+  // Discards pending jobs and results of the group and closes its
+  // wakeup pipe. The results of the jobs of this group which are
+  // being processed now are also discarded.
+  void closeGroup(int64_t groupId);
+
+  // Returns the read end of the wakeup pipe of the group, or -1 if
+  // there is no such group.
+  sock_t getWakeupFd(int64_t groupId);
+
+  // Reads all data from the wakeup pipe of the group. Call this
+  // before takeResults(), so that a result posted after
+  // takeResults() always wakes up the consumer again.
+  void drainWakeupFd(int64_t groupId);
+
+  void submit(int64_t groupId, const Job& job);
+
+  // Moves finished results of the group to results.
+  void takeResults(int64_t groupId, std::vector<Result>& results);
+
+  // Computes hash of job in the current thread. buf is used to read
+  // data from files.
+  static Result process(const Job& job, unsigned char* buf, size_t bufSize);
+};
+
+} // namespace aria2
+
+#endif // D_PIECE_HASH_WORKER_POOL_H
@@ -34,145 +34,172 @@
 /* copyright --> */
 #include "PieceStatMan.h"
 
+#include <cassert>
 #include <algorithm>
 
 #include "SimpleRandomizer.h"
+#include "array_fun.h"
 #include "bitfield.h"
 
-namespace aria2 {
+using namespace aria2::expr;
 
-PieceStat::PieceStat(size_t index):order_(0), index_(index), count_(0) {}
+namespace aria2 {
 
-void PieceStat::addCount()
+PieceStatMan::PieceStatMan(size_t pieceNum, bool randomShuffle):
+  counts_(pieceNum),
+  order_(pieceNum),
+  pos_(pieceNum),
+  buckets_(1),
+  ownedBegin_(pieceNum),
+  owned_(pieceNum)
 {
-  if(count_ < SIZE_MAX) {
-    ++count_;
+  for(size_t i = 0; i < pieceNum; ++i) {
+    order_[i] = i;
   }
-}
-
-void PieceStat::subCount()
-{
-  if(count_ > 0) {
-    --count_;
+  // we need some randomness in ordering.
+  if(randomShuffle) {
+    std::random_shuffle(order_.begin(), order_.end(),
+                        *(SimpleRandomizer::getInstance().get()));
+  }
+  for(size_t i = 0; i < pieceNum; ++i) {
+    pos_[order_[i]] = i;
   }
 }
 
-namespace {
-class GenPieceStat {
-private:
-  size_t index_;
-public:
-  GenPieceStat():index_(0) {}
+PieceStatMan::~PieceStatMan() {}
 
-  SharedHandle<PieceStat> operator()()
-  {
-    return SharedHandle<PieceStat>(new PieceStat(index_++));
-  }
-};
-} // namespace
+void PieceStatMan::swapOrder(size_t index, size_t p)
+{
+  size_t q = pos_[index];
+  size_t other = order_[p];
+  order_[q] = other;
+  pos_[other] = q;
+  order_[p] = index;
+  pos_[index] = p;
+}
 
-PieceStatMan::PieceStatMan(size_t pieceNum, bool randomShuffle):
-  pieceStats_(pieceNum),
-  sortedPieceStatIndexes_(pieceNum)
+void PieceStatMan::addCount(size_t index)
 {
-  std::generate(pieceStats_.begin(), pieceStats_.end(), GenPieceStat());
-  std::vector<SharedHandle<PieceStat> > sortedPieceStats(pieceStats_);
-  // we need some randomness in ordering.
-  if(randomShuffle) {
-    std::random_shuffle(sortedPieceStats.begin(), sortedPieceStats.end(),
-                        *(SimpleRandomizer::getInstance().get()));
+  size_t count = counts_[index];
+  if(count == SIZE_MAX) {
+    return;
   }
-  {
-    size_t order = 0;
-    for(std::vector<SharedHandle<PieceStat> >::const_iterator i =
-          sortedPieceStats.begin(), eoi = sortedPieceStats.end();
-        i != eoi; ++i) {
-      sortedPieceStatIndexes_[order] = (*i)->getIndex();
-      (*i)->setOrder(order++);
+  if(!owned_[index]) {
+    if(count+1 == buckets_.size()) {
+      buckets_.push_back(ownedBegin_);
     }
-  }  
+    // Move the piece to the end of its bucket and make it the first
+    // piece of the next bucket.
+    swapOrder(index, buckets_[count+1]-1);
+    --buckets_[count+1];
+  }
+  counts_[index] = count+1;
 }
 
-PieceStatMan::~PieceStatMan() {}
-
-namespace {
-class PieceStatRarer {
-private:
-  const std::vector<SharedHandle<PieceStat> >& pieceStats_;
-public:
-  PieceStatRarer(const std::vector<SharedHandle<PieceStat> >& ps):
-    pieceStats_(ps) {}
-
-  bool operator()(size_t lhs, size_t rhs) const
-  {
-    return *pieceStats_[lhs] < *pieceStats_[rhs];
+void PieceStatMan::subCount(size_t index)
+{
+  size_t count = counts_[index];
+  if(count == 0) {
+    return;
+  }
+  if(!owned_[index]) {
+    // Move the piece to the beginning of its bucket and make it the
+    // last piece of the previous bucket.
+    swapOrder(index, buckets_[count]);
+    ++buckets_[count];
   }
-};
-} // namespace
+  counts_[index] = count-1;
+}
 
 void PieceStatMan::addPieceStats(const unsigned char* bitfield,
                                  size_t bitfieldLength)
 {
-  const size_t nbits = pieceStats_.size();
+  const size_t nbits = counts_.size();
   assert(nbits <= bitfieldLength*8);
-  for(size_t i = 0; i < nbits; ++i) {
-    if(bitfield::test(bitfield, nbits, i)) {
-      pieceStats_[i]->addCount();
-    }
+  for(size_t i = bitfield::findFirstSet(bitfield, 0, nbits); i < nbits;
+      i = bitfield::findFirstSet(bitfield, i+1, nbits)) {
+    addCount(i);
   }
-  std::sort(sortedPieceStatIndexes_.begin(), sortedPieceStatIndexes_.end(),
-            PieceStatRarer(pieceStats_));
 }
 
 void PieceStatMan::subtractPieceStats(const unsigned char* bitfield,
                                       size_t bitfieldLength)
 {
-  const size_t nbits = pieceStats_.size();
+  const size_t nbits = counts_.size();
   assert(nbits <= bitfieldLength*8);
-  for(size_t i = 0; i < nbits; ++i) {
-    if(bitfield::test(bitfield, nbits, i)) {
-      pieceStats_[i]->subCount();
-    }
+  for(size_t i = bitfield::findFirstSet(bitfield, 0, nbits); i < nbits;
+      i = bitfield::findFirstSet(bitfield, i+1, nbits)) {
+    subCount(i);
   }
-  std::sort(sortedPieceStatIndexes_.begin(), sortedPieceStatIndexes_.end(),
-            PieceStatRarer(pieceStats_));
 }
 
 void PieceStatMan::updatePieceStats(const unsigned char* newBitfield,
                                     size_t newBitfieldLength,
                                     const unsigned char* oldBitfield)
 {
-  const size_t nbits = pieceStats_.size();
+  const size_t nbits = counts_.size();
   assert(nbits <= newBitfieldLength*8);
-  for(size_t i = 0; i < nbits; ++i) {
-    bool inNew = bitfield::test(newBitfield, nbits, i);
-    bool inOld = bitfield::test(oldBitfield, nbits, i);
-    if(inNew) {
-      if(!inOld) {
-        pieceStats_[i]->addCount();
+  // Only visit the pieces which the peer newly got or lost.
+  for(size_t i = bitfield::findFirstSet
+        (array(newBitfield)&~array(oldBitfield), 0, nbits); i < nbits;
+      i = bitfield::findFirstSet
+        (array(newBitfield)&~array(oldBitfield), i+1, nbits)) {
+    addCount(i);
+  }
+  for(size_t i = bitfield::findFirstSet
+        (~array(newBitfield)&array(oldBitfield), 0, nbits); i < nbits;
+      i = bitfield::findFirstSet
+        (~array(newBitfield)&array(oldBitfield), i+1, nbits)) {
+    subCount(i);
+  }
+}
+
+void PieceStatMan::addPieceStats(size_t index)
+{
+  addCount(index);
+}
+
+void PieceStatMan::setPieceOwned(size_t index, bool owned)
+{
+  if(owned_[index] == owned) {
+    return;
+  }
+  owned_[index] = owned;
+  if(owned) {
+    // Carry the piece over the remaining buckets to the beginning of
+    // the owned pieces.
+    for(size_t count = counts_[index], last = buckets_.size()-1;
+        count <= last; ++count) {
+      swapOrder(index, bucketEnd(count)-1);
+      if(count < last) {
+        --buckets_[count+1];
+      } else {
+        --ownedBegin_;
       }
-    } else if(inOld) {
-      pieceStats_[i]->subCount();
+    }
+  } else {
+    // The count may have grown beyond the last bucket while we had
+    // the piece.
+    while(buckets_.size() <= counts_[index]) {
+      buckets_.push_back(ownedBegin_);
+    }
+    swapOrder(index, ownedBegin_);
+    ++ownedBegin_;
+    for(size_t count = buckets_.size()-1; count > counts_[index]; --count) {
+      swapOrder(index, buckets_[count]);
+      ++buckets_[count];
     }
   }
-  std::sort(sortedPieceStatIndexes_.begin(), sortedPieceStatIndexes_.end(),
-            PieceStatRarer(pieceStats_));
 }
 
-void PieceStatMan::addPieceStats(size_t index)
+void PieceStatMan::setOwnedPieces(const unsigned char* bitfield,
+                                  size_t bitfieldLength)
 {
-  std::vector<size_t>::iterator cur =
-    std::lower_bound(sortedPieceStatIndexes_.begin(),
-                     sortedPieceStatIndexes_.end(),
-                     index, PieceStatRarer(pieceStats_));
-
-  pieceStats_[index]->addCount();
-
-  std::vector<size_t>::iterator to =
-    std::upper_bound(cur+1, sortedPieceStatIndexes_.end(),
-                     index, PieceStatRarer(pieceStats_));
-  
-  std::rotate(cur, cur+1, to);
+  const size_t nbits = counts_.size();
+  assert(nbits <= bitfieldLength*8);
+  for(size_t i = 0; i < nbits; ++i) {
+    setPieceOwned(i, bitfield::test(bitfield, nbits, i));
+  }
 }
 
 } // namespace aria2
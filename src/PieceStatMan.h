@@ -37,59 +37,46 @@
 
 #include "common.h"
 
+#include <cstdlib>
 #include <vector>
 
-#include "SharedHandle.h"
-
 namespace aria2 {
 
-class PieceStat {
+// Keeps the number of peers which have each piece, and the piece
+// indexes ordered by that number, rarest first.  The pieces are kept
+// in buckets, one for each count, laid out in a flat array, so that
+// incrementing or decrementing the count of a piece is O(1).  The
+// order of pieces which have the same count is arbitrary.  Pieces
+// which we already have are moved after all buckets, so that piece
+// selection does not need to scan them.
+class PieceStatMan {
 private:
-  size_t order_;
-  size_t index_;
-  size_t count_;
-public:
-  PieceStat(size_t index);
-
-  bool operator<(const PieceStat& pieceStat) const
+  // Piece index -> number of peers which have the piece.
+  std::vector<size_t> counts_;
+  // Piece indexes in rarest first order. Pieces which we have follow
+  // them.
+  std::vector<size_t> order_;
+  // Piece index -> position in order_.
+  std::vector<size_t> pos_;
+  // Count -> the position of the first piece of the bucket in order_.
+  // The bucket ends where the next bucket begins, or at
+  // ownedBegin_ for the last one.
+  std::vector<size_t> buckets_;
+  // The position of the first piece we have in order_.
+  size_t ownedBegin_;
+  // Piece index -> true if we have the piece.
+  std::vector<bool> owned_;
+
+  size_t bucketEnd(size_t count) const
   {
-    if(count_ == pieceStat.count_) {
-      return order_ < pieceStat.order_;
-    } else {
-      return count_ < pieceStat.count_;
-    }
+    return count+1 < buckets_.size() ? buckets_[count+1] : ownedBegin_;
   }
 
-  void addCount();
-  void subCount();
+  void swapOrder(size_t index, size_t p);
 
-  size_t getOrder() const
-  {
-    return order_;
-  }
+  void addCount(size_t index);
 
-  void setOrder(size_t order)
-  {
-    order_ = order;
-  }
-
-  size_t getIndex() const
-  {
-    return index_;
-  }
-
-  size_t getCount() const
-  {
-    return count_;
-  }
-
-};
-
-class PieceStatMan {
-private:
-  std::vector<SharedHandle<PieceStat> > pieceStats_;
-
-  std::vector<size_t> sortedPieceStatIndexes_;
+  void subCount(size_t index);
 public:
   PieceStatMan(size_t pieceNum, bool randomShuffle);
 
@@ -107,17 +94,35 @@ public:
                         size_t newBitfieldLength,
                         const unsigned char* oldBitfield);
 
-  // Returns piece index in rarest first order.
+  // Tells whether we have the piece index.  Pieces we have are moved
+  // to the end of getRarerPieceIndexes().
+  void setPieceOwned(size_t index, bool owned);
+
+  // Calls setPieceOwned() for all pieces based on bitfield, which
+  // represents the pieces we have.
+  void setOwnedPieces(const unsigned char* bitfield, size_t bitfieldLength);
+
+  // Returns piece index in rarest first order.  The first
+  // countMissingPieces() elements are the pieces we don't have.
   const std::vector<size_t>& getRarerPieceIndexes() const
   {
-    return sortedPieceStatIndexes_;
+    return order_;
   }
 
-  const std::vector<SharedHandle<PieceStat> >& getPieceStats() const
+  size_t countMissingPieces() const
   {
-    return pieceStats_;
+    return ownedBegin_;
   }
 
+  size_t getCount(size_t index) const
+  {
+    return counts_[index];
+  }
+
+  size_t getNumPieces() const
+  {
+    return counts_.size();
+  }
 };
 
 } // namespace aria2
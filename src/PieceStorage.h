@@ -51,6 +51,7 @@ class Piece;
 class Peer;
 #endif // ENABLE_BITTORRENT
 class DiskAdaptor;
+class WrDiskCache;
 
 class PieceStorage {
 public:
@@ -219,6 +220,12 @@ public:
   virtual void setEndGamePieceNum(size_t num) = 0;
 
   virtual SharedHandle<DiskAdaptor> getDiskAdaptor() = 0;
+
+  // Returns the write cache, or 0 if the write cache is disabled.
+  virtual WrDiskCache* getWrDiskCache() = 0;
+
+  // Writes data in the write cache of in-flight pieces to disk.
+  virtual void flushWrDiskCacheEntry() = 0;
   
   virtual size_t getPieceLength(size_t index) = 0;
 
@@ -47,7 +47,23 @@ RangeBtMessage::RangeBtMessage(uint8_t id,
    begin_(begin),
    length_(length) {}
 
+void RangeBtMessage::parse(const unsigned char* data, size_t dataLength)
+{
+  bittorrent::assertPayloadLengthEqual(13, dataLength, getName());
+  bittorrent::assertID(getId(), data, getName());
+  index_ = bittorrent::getIntParam(data, 1);
+  begin_ = bittorrent::getIntParam(data, 5);
+  length_ = bittorrent::getIntParam(data, 9);
+}
+
 unsigned char* RangeBtMessage::createMessage()
+{
+  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
+  writeMessage(msg);
+  return msg;
+}
+
+bool RangeBtMessage::writeMessage(unsigned char* msg)
 {
   /**
    * len --- 13, 4bytes
@@ -57,12 +73,11 @@ unsigned char* RangeBtMessage::createMessage()
    * length -- length, 4bytes
    * total: 17bytes
    */
-  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
   bittorrent::createPeerMessageString(msg, MESSAGE_LENGTH, 13, getId());
   bittorrent::setIntParam(&msg[5], index_);
   bittorrent::setIntParam(&msg[9], begin_);
   bittorrent::setIntParam(&msg[13], length_);
-  return msg;
+  return true;
 }
 
 size_t RangeBtMessage::getMessageLength()
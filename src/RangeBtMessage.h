@@ -52,12 +52,8 @@ protected:
   static SharedHandle<T> create
   (const unsigned char* data, size_t dataLength)
   {
-    bittorrent::assertPayloadLengthEqual(13, dataLength, T::NAME);
-    bittorrent::assertID(T::ID, data, T::NAME);
     SharedHandle<T> message(new T());
-    message->setIndex(bittorrent::getIntParam(data, 1));
-    message->setBegin(bittorrent::getIntParam(data, 5));
-    message->setLength(bittorrent::getIntParam(data, 9));
+    message->parse(data, dataLength);
     return message;
   }
 public:
@@ -76,8 +72,14 @@ public:
 
   void setLength(size_t length) { length_ = length; }
 
+  // Sets the index, begin and length from the payload data. Throws
+  // DlAbortEx if data is not a message of this type.
+  void parse(const unsigned char* data, size_t dataLength);
+
   virtual unsigned char* createMessage();
 
+  virtual bool writeMessage(unsigned char* msg);
+
   virtual size_t getMessageLength();
 
   virtual std::string toString() const;
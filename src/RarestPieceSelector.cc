@@ -68,10 +68,13 @@ bool RarestPieceSelector::select
 {
   const std::vector<size_t>& pieceIndexes =
     pieceStatMan_->getRarerPieceIndexes();
+  // Pieces we already have are not in the bitfield.  Skip them.
+  std::vector<size_t>::const_iterator last =
+    pieceIndexes.begin()+pieceStatMan_->countMissingPieces();
   std::vector<size_t>::const_iterator i =
-    std::find_if(pieceIndexes.begin(), pieceIndexes.end(),
+    std::find_if(pieceIndexes.begin(), last,
                  FindRarestPiece(bitfield, nbits));
-  if(i == pieceIndexes.end()) {
+  if(i == last) {
     return false;
   } else {
     index = *i;
@@ -213,6 +213,7 @@ error_code::Value RequestGroup::downloadResult() const
 void RequestGroup::closeFile()
 {
   if(pieceStorage_) {
+    pieceStorage_->flushWrDiskCacheEntry();
     pieceStorage_->getDiskAdaptor()->closeFile();
   }
 }
@@ -630,6 +631,9 @@ void RequestGroup::initPieceStorage()
     if(diskWriterFactory_) {
       ps->setDiskWriterFactory(diskWriterFactory_);
     }
+    if(requestGroupMan_) {
+      ps->setWrDiskCache(requestGroupMan_->getWrDiskCache());
+    }
     tempPieceStorage.swap(psHolder);
   } else {
     UnknownLengthPieceStorage* ps =
@@ -976,21 +980,35 @@ void RequestGroup::decreaseNumCommand()
 TransferStat RequestGroup::calculateStat() const
 {
   TransferStat stat;
+  stat.setDownloadSpeed(netStat_.calculateDownloadSpeed());
+  stat.setUploadSpeed(netStat_.calculateUploadSpeed());
+  stat.setSessionDownloadLength(netStat_.getSessionDownloadLength());
+  stat.setSessionUploadLength(netStat_.getSessionUploadLength());
 #ifdef ENABLE_BITTORRENT
-  if(peerStorage_) {
-    stat = peerStorage_->calculateStat();
+  if(btRuntime_) {
+    stat.setAllTimeUploadLength(btRuntime_->getUploadLengthAtStartup()+
+                                stat.getSessionUploadLength());
   }
 #endif // ENABLE_BITTORRENT
-  if(segmentMan_) {
-    stat.setDownloadSpeed
-      (stat.getDownloadSpeed()+segmentMan_->calculateDownloadSpeed());
-    stat.setSessionDownloadLength
-      (stat.getSessionDownloadLength()+
-       segmentMan_->calculateSessionDownloadLength());
-  }
   return stat;
 }
 
+void RequestGroup::updateDownloadLength(size_t bytes)
+{
+  netStat_.updateDownloadLength(bytes);
+  if(requestGroupMan_) {
+    requestGroupMan_->getNetStat().updateDownloadLength(bytes);
+  }
+}
+
+void RequestGroup::updateUploadLength(size_t bytes)
+{
+  netStat_.updateUploadLength(bytes);
+  if(requestGroupMan_) {
+    requestGroupMan_->getNetStat().updateUploadLength(bytes);
+  }
+}
+
 void RequestGroup::setHaltRequested(bool f, HaltReason haltReason)
 {
   haltRequested_ = f;
@@ -1292,6 +1310,11 @@ bool RequestGroup::doesUploadSpeedExceed()
 void RequestGroup::saveControlFile() const
 {
   if(saveControlFile_) {
+    // Control file must not record blocks which are only in the
+    // write cache.
+    if(pieceStorage_) {
+      pieceStorage_->flushWrDiskCacheEntry();
+    }
     progressInfoFile_->save();
   }
 }
@@ -43,6 +43,7 @@
 
 #include "SharedHandle.h"
 #include "TransferStat.h"
+#include "NetStat.h"
 #include "TimeA2.h"
 #include "Request.h"
 #include "error_code.h"
@@ -147,6 +148,10 @@ private:
   PeerStorage* peerStorage_;
 #endif // ENABLE_BITTORRENT
 
+  // Transfer statistics of this download. This is mutable because
+  // calculating speed updates internal state of SpeedCalc.
+  mutable NetStat netStat_;
+
   // This flag just indicates that the downloaded file is not saved disk but
   // just sits in memory.
   bool inMemoryDownload_;
@@ -261,8 +266,21 @@ public:
     return gid_;
   }
 
+  // Returns transfer statistics of this download. This is constant
+  // time operation.
   TransferStat calculateStat() const;
 
+  // Accounts bytes transferred by this download. RequestGroupMan's
+  // NetStat is also updated.
+  void updateDownloadLength(size_t bytes);
+
+  void updateUploadLength(size_t bytes);
+
+  NetStat& getNetStat()
+  {
+    return netStat_;
+  }
+
   const SharedHandle<DownloadContext>& getDownloadContext() const
   {
     return downloadContext_;
@@ -523,6 +541,11 @@ public:
     requestGroupMan_ = requestGroupMan;
   }
 
+  RequestGroupMan* getRequestGroupMan() const
+  {
+    return requestGroupMan_;
+  }
+
   int getResumeFailureCount() const
   {
     return resumeFailureCount_;
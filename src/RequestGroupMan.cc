@@ -74,6 +74,10 @@
 #include "uri.h"
 #include "Triplet.h"
 #include "Signature.h"
+#include "WrDiskCache.h"
+#if defined ENABLE_MESSAGE_DIGEST && defined HAVE_PTHREAD
+# include "PieceHashWorkerPool.h"
+#endif // ENABLE_MESSAGE_DIGEST && HAVE_PTHREAD
 
 namespace aria2 {
 
@@ -94,10 +98,38 @@ RequestGroupMan::RequestGroupMan
     removedErrorResult_(0),
     removedLastErrorResult_(error_code::FINISHED),
     maxDownloadResult_(option->getAsInt(PREF_MAX_DOWNLOAD_RESULT))
-{}
+#if defined ENABLE_MESSAGE_DIGEST && defined HAVE_PTHREAD
+  , pieceHashWorkerPoolInitialized_(false)
+#endif // ENABLE_MESSAGE_DIGEST && HAVE_PTHREAD
+{
+  size_t diskCacheSize = option->getAsLLInt(PREF_DISK_CACHE);
+  if(diskCacheSize > 0) {
+    wrDiskCache_.reset(new WrDiskCache(diskCacheSize));
+  }
+}
 
 RequestGroupMan::~RequestGroupMan() {}
 
+#if defined ENABLE_MESSAGE_DIGEST && defined HAVE_PTHREAD
+const SharedHandle<PieceHashWorkerPool>&
+RequestGroupMan::getPieceHashWorkerPool()
+{
+  if(!pieceHashWorkerPoolInitialized_) {
+    pieceHashWorkerPoolInitialized_ = true;
+    int numThreads = option_->getAsInt(PREF_HASH_CHECK_THREADS);
+    if(numThreads > 0) {
+      pieceHashWorkerPool_.reset(new PieceHashWorkerPool(numThreads));
+      if(!pieceHashWorkerPool_->start()) {
+        A2_LOG_ERROR("Failed to start hash check threads. Hash check is"
+                     " done without them.");
+        pieceHashWorkerPool_.reset();
+      }
+    }
+  }
+  return pieceHashWorkerPool_;
+}
+#endif // ENABLE_MESSAGE_DIGEST && HAVE_PTHREAD
+
 bool RequestGroupMan::downloadFinished()
 {
 #ifdef ENABLE_XML_RPC
@@ -508,8 +540,10 @@ void RequestGroupMan::fillRequestGroupFromReserver(DownloadEngine* e)
       // reference.
       groupToAdd->dropPieceStorage();
       configureRequestGroup(groupToAdd);
-      createInitialCommand(groupToAdd, commands, e);
+      // RequestGroupMan must be set before creating commands because
+      // its write cache is passed to PieceStorage.
       groupToAdd->setRequestGroupMan(this);
+      createInitialCommand(groupToAdd, commands, e);
       if(commands.empty()) {
         requestQueueCheck();
       }
@@ -729,10 +763,10 @@ void RequestGroupMan::forceHalt()
 TransferStat RequestGroupMan::calculateStat()
 {
   TransferStat s;
-  for(std::deque<SharedHandle<RequestGroup> >::const_iterator i =
-        requestGroups_.begin(), eoi = requestGroups_.end(); i != eoi; ++i) {
-    s += (*i)->calculateStat();
-  }
+  s.setDownloadSpeed(netStat_.calculateDownloadSpeed());
+  s.setUploadSpeed(netStat_.calculateUploadSpeed());
+  s.setSessionDownloadLength(netStat_.getSessionDownloadLength());
+  s.setSessionUploadLength(netStat_.getSessionUploadLength());
   return s;
 }
 
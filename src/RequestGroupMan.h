@@ -45,6 +45,7 @@
 #include "SharedHandle.h"
 #include "DownloadResult.h"
 #include "TransferStat.h"
+#include "NetStat.h"
 #include "RequestGroup.h"
 
 namespace aria2 {
@@ -55,6 +56,10 @@ struct DownloadResult;
 class ServerStatMan;
 class ServerStat;
 class Option;
+class WrDiskCache;
+#if defined ENABLE_MESSAGE_DIGEST && defined HAVE_PTHREAD
+class PieceHashWorkerPool;
+#endif // ENABLE_MESSAGE_DIGEST && HAVE_PTHREAD
 
 class RequestGroupMan {
 private:
@@ -85,6 +90,19 @@ private:
 
   size_t maxDownloadResult_;
 
+  // Write cache shared by all downloads. Null if disabled.
+  SharedHandle<WrDiskCache> wrDiskCache_;
+
+  // Transfer statistics of all downloads, updated by RequestGroup.
+  NetStat netStat_;
+
+#if defined ENABLE_MESSAGE_DIGEST && defined HAVE_PTHREAD
+  // Worker threads for hash check. Created lazily by
+  // getPieceHashWorkerPool().
+  SharedHandle<PieceHashWorkerPool> pieceHashWorkerPool_;
+  bool pieceHashWorkerPoolInitialized_;
+#endif // ENABLE_MESSAGE_DIGEST && HAVE_PTHREAD
+
   std::string
   formatDownloadResult(const std::string& status,
                        const SharedHandle<DownloadResult>& downloadResult) const;
@@ -134,6 +152,19 @@ public:
 
   SharedHandle<RequestGroup> findRequestGroup(gid_t gid) const;
 
+  const SharedHandle<WrDiskCache>& getWrDiskCache() const
+  {
+    return wrDiskCache_;
+  }
+
+#if defined ENABLE_MESSAGE_DIGEST && defined HAVE_PTHREAD
+  // Returns worker pool for hash check. Threads are started on first
+  // call, so that they are not created before aria2 daemonizes
+  // itself. Returns null if --hash-check-threads is 0 or threads
+  // cannot be started.
+  const SharedHandle<PieceHashWorkerPool>& getPieceHashWorkerPool();
+#endif // ENABLE_MESSAGE_DIGEST && HAVE_PTHREAD
+
   const std::deque<SharedHandle<RequestGroup> >& getReservedGroups() const
   {
     return reservedGroups_;
@@ -164,8 +195,15 @@ public:
 
   bool isSameFileBeingDownloaded(RequestGroup* requestGroup) const;
 
+  // Returns transfer statistics of all downloads. This is constant
+  // time operation.
   TransferStat calculateStat();
 
+  NetStat& getNetStat()
+  {
+    return netStat_;
+  }
+
   class DownloadStat {
   private:
     size_t completed_;
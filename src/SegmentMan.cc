@@ -53,11 +53,12 @@
 #include "FileEntry.h"
 #include "wallclock.h"
 #include "fmt.h"
+#include "bitfield.h"
 
 namespace aria2 {
 
 SegmentEntry::SegmentEntry(cuid_t cuid, const SharedHandle<Segment>& segment)
-  : cuid(cuid), segment(segment)
+  : cuid(cuid), segment(segment), stolen(false)
 {}
 
 SegmentEntry::~SegmentEntry() {}
@@ -220,6 +221,23 @@ SharedHandle<Segment> SegmentMan::getSegmentWithIndex
   return checkoutSegment(cuid, pieceStorage_->getMissingPiece(index));
 }
 
+SharedHandle<Segment> SegmentMan::getCleanSegmentAfter
+(cuid_t cuid,
+ const SharedHandle<Segment>& segment,
+ const SharedHandle<FileEntry>& fileEntry)
+{
+  SharedHandle<Segment> next =
+    getSegmentWithIndex(cuid, segment->getIndex()+1);
+  if(next &&
+     (next->getWrittenLength() > 0 ||
+      next->getPosition() < fileEntry->getOffset() ||
+      fileEntry->getLastOffset() <= next->getPosition())) {
+    cancelSegment(cuid, next);
+    return SharedHandle<Segment>();
+  }
+  return next;
+}
+
 SharedHandle<Segment> SegmentMan::getCleanSegmentIfOwnerIsIdle
 (cuid_t cuid, size_t index)
 {
@@ -236,6 +254,11 @@ SharedHandle<Segment> SegmentMan::getCleanSegmentIfOwnerIsIdle
       if(segmentEntry->cuid == cuid) {
         return segmentEntry->segment;
       }
+      // The thief may not have started downloading yet, but taking
+      // the segment back would let both connections download it.
+      if(segmentEntry->stolen) {
+        return SharedHandle<Segment>();
+      }
       cuid_t owner = segmentEntry->cuid;
       SharedHandle<PeerStat> ps = getPeerStat(owner);
       if(!ps || ps->getStatus() == PeerStat::IDLE) {
@@ -249,6 +272,88 @@ SharedHandle<Segment> SegmentMan::getCleanSegmentIfOwnerIsIdle
   return SharedHandle<Segment>();
 }
 
+SharedHandle<Segment> SegmentMan::stealSegment(cuid_t cuid)
+{
+  return stealSegment(cuid, 0, downloadContext_->getNumPieces());
+}
+
+SharedHandle<Segment> SegmentMan::stealSegment
+(cuid_t cuid, const SharedHandle<FileEntry>& fileEntry)
+{
+  if(fileEntry->getLength() == 0) {
+    return SharedHandle<Segment>();
+  }
+  size_t pieceLength = downloadContext_->getPieceLength();
+  return stealSegment(cuid, fileEntry->getOffset()/pieceLength,
+                      (fileEntry->getLastOffset()-1)/pieceLength+1);
+}
+
+SharedHandle<Segment> SegmentMan::stealSegment
+(cuid_t cuid, size_t beginIndex, size_t endIndex)
+{
+  SharedHandle<PeerStat> victim;
+  unsigned int victimSpeed = 0;
+  size_t victimIndex = 0;
+  size_t numFree = 0;
+  for(SegmentEntries::const_iterator itr = usedSegmentEntries_.begin(),
+        eoi = usedSegmentEntries_.end(); itr != eoi; ++itr) {
+    const SharedHandle<SegmentEntry>& segmentEntry = *itr;
+    if(segmentEntry->cuid == cuid ||
+       segmentEntry->segment->getIndex() < beginIndex ||
+       endIndex <= segmentEntry->segment->getIndex()) {
+      continue;
+    }
+    // Segments of idle owners are taken by getCleanSegmentIfOwnerIsIdle().
+    // Also wait until the speed of the owner is measured.
+    SharedHandle<PeerStat> ps = getPeerStat(segmentEntry->cuid);
+    if(!ps || ps->getStatus() != PeerStat::ACTIVE ||
+       ps->getDownloadStartTime().difference(global::wallclock) < 1) {
+      continue;
+    }
+    size_t n = countStealablePieceFrom(segmentEntry->segment->getIndex()+1,
+                                       endIndex);
+    if(n == 0) {
+      continue;
+    }
+    unsigned int speed = ps->calculateDownloadSpeed();
+    if(!victim || speed < victimSpeed) {
+      victim = ps;
+      victimSpeed = speed;
+      victimIndex = segmentEntry->segment->getIndex();
+      numFree = n;
+    }
+  }
+  if(!victim) {
+    return SharedHandle<Segment>();
+  }
+  SharedHandle<PeerStat> thief = getPeerStat(cuid);
+  unsigned int thiefSpeed = thief ? thief->calculateDownloadSpeed() : 0;
+  size_t numKeep;
+  if(thiefSpeed == 0) {
+    // The speed of cuid is not known yet. Split them in half.
+    numKeep = numFree/2;
+  } else if(thiefSpeed <= victimSpeed) {
+    return SharedHandle<Segment>();
+  } else {
+    numKeep = static_cast<uint64_t>(numFree)*victimSpeed/
+      (victimSpeed+thiefSpeed);
+  }
+  size_t index = victimIndex+1+numKeep;
+  A2_LOG_INFO(fmt("CUID#%lld - Stealing segment#%lu from CUID#%lld."
+                  " %lu of %lu free segments are left to CUID#%lld.",
+                  cuid,
+                  static_cast<unsigned long>(index),
+                  victim->getCuid(),
+                  static_cast<unsigned long>(numKeep),
+                  static_cast<unsigned long>(numFree),
+                  victim->getCuid()));
+  SharedHandle<Segment> segment = getSegmentWithIndex(cuid, index);
+  if(segment) {
+    usedSegmentEntries_.back()->stolen = true;
+  }
+  return segment;
+}
+
 void SegmentMan::cancelSegment(const SharedHandle<Segment>& segment)
 {
   A2_LOG_DEBUG(fmt("Canceling segment#%lu",
@@ -462,6 +567,22 @@ size_t SegmentMan::countFreePieceFrom(size_t index) const
   return downloadContext_->getNumPieces()-index;
 }
 
+size_t SegmentMan::countStealablePieceFrom
+(size_t index, size_t endIndex) const
+{
+  if(endIndex <= index) {
+    return 0;
+  }
+  for(size_t i = index; i < endIndex; ++i) {
+    if(pieceStorage_->hasPiece(i) || pieceStorage_->isPieceUsed(i) ||
+       bitfield::test(ignoreBitfield_.getFilterBitfield(),
+                      ignoreBitfield_.countBlock(), i)) {
+      return i-index;
+    }
+  }
+  return endIndex-index;
+}
+
 void SegmentMan::ignoreSegmentFor(const SharedHandle<FileEntry>& fileEntry)
 {
   A2_LOG_DEBUG(fmt("ignoring segment for path=%s, offset=%s, length=%s",
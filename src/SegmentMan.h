@@ -59,6 +59,11 @@ class FileEntry;
 struct SegmentEntry {
   cuid_t cuid;
   SharedHandle<Segment> segment;
+  // True if segment was checked out by SegmentMan::stealSegment().
+  // Such a segment is not taken back by
+  // SegmentMan::getCleanSegmentIfOwnerIsIdle() even if its owner has
+  // not started downloading yet.
+  bool stolen;
 
   SegmentEntry(cuid_t cuid, const SharedHandle<Segment>& segment);
   ~SegmentEntry();
@@ -107,6 +112,14 @@ private:
                                         const SharedHandle<Piece>& piece);
 
   void cancelSegment(const SharedHandle<Segment>& segment);
+
+  // Returns the number of pieces from index up to endIndex which are
+  // neither downloaded, used nor ignored.
+  size_t countStealablePieceFrom(size_t index, size_t endIndex) const;
+
+  // Implements stealSegment() for the pieces in [beginIndex, endIndex).
+  SharedHandle<Segment> stealSegment
+  (cuid_t cuid, size_t beginIndex, size_t endIndex);
 public:
   SegmentMan(const Option* option,
              const SharedHandle<DownloadContext>& downloadContext,
@@ -158,12 +171,35 @@ public:
    */
   SharedHandle<Segment> getSegmentWithIndex(cuid_t cuid, size_t index);
 
+  // Checks out the segment right after segment for cuid if it is in
+  // the range of fileEntry and nothing is written to it. Otherwise
+  // returns null. HTTP pipelining uses this to request contiguous
+  // segments with one Range.
+  SharedHandle<Segment> getCleanSegmentAfter
+  (cuid_t cuid,
+   const SharedHandle<Segment>& segment,
+   const SharedHandle<FileEntry>& fileEntry);
+
   // Returns a currently used segment whose index is index and written
   // length is 0.  The current owner(in idle state) of segment cancels
   // the segment and cuid command acquires the ownership of the
   // segment.  If no such segment exists, returns null.
   SharedHandle<Segment> getCleanSegmentIfOwnerIsIdle(cuid_t cuid, size_t index);
 
+  // Used when getSegment() returns null. Finds the slowest active
+  // connection which has free pieces right after its segment and
+  // checks out a piece in the middle of them for cuid, so that these
+  // free pieces are split between the two connections in proportion
+  // to their download speed. The slow connection stops at the stolen
+  // piece because it cannot check it out. Returns null if there is
+  // no such connection or cuid is not faster than it.
+  SharedHandle<Segment> stealSegment(cuid_t cuid);
+
+  // Same as stealSegment(cuid), but only the pieces which overlap
+  // fileEntry are considered. Used for multi-file downloads.
+  SharedHandle<Segment> stealSegment
+  (cuid_t cuid, const SharedHandle<FileEntry>& fileEntry);
+
   /**
    * Updates download status.
    */
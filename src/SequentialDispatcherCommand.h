@@ -70,9 +70,10 @@ public:
     if(e_->getRequestGroupMan()->downloadFinished() || e_->isHaltRequested()) {
       return true;
     }
-    if(picker_->hasNext() && !picker_->isPicked()) {
-      e_->addCommand(createCommand(picker_->pickNext()));
-
+    if(picker_->canPickNext()) {
+      while(picker_->canPickNext()) {
+        e_->addCommand(createCommand(picker_->pickNext()));
+      }
       e_->setNoWait(true);
     }
 
@@ -38,30 +38,66 @@
 #include "common.h"
 
 #include <deque>
+#include <algorithm>
 
 #include "SharedHandle.h"
 
 namespace aria2 {
 
+// Picks entries in FIFO order. By default, only one entry can be
+// picked at a time. setMaxPicked() allows several entries to be
+// picked concurrently.
 template<typename T>
 class SequentialPicker {
 private:
   std::deque<SharedHandle<T> > entries_;
-  SharedHandle<T> pickedEntry_;
+  std::deque<SharedHandle<T> > pickedEntries_;
+  size_t maxPicked_;
 public:
+  SequentialPicker():maxPicked_(1) {}
+
   bool isPicked() const
   {
-    return pickedEntry_;
+    return !pickedEntries_.empty();
   }
 
+  // Returns the entry picked first among the entries being picked.
   SharedHandle<T> getPickedEntry() const
   {
-    return pickedEntry_;
+    if(pickedEntries_.empty()) {
+      return SharedHandle<T>();
+    } else {
+      return pickedEntries_.front();
+    }
+  }
+
+  const std::deque<SharedHandle<T> >& getPickedEntries() const
+  {
+    return pickedEntries_;
   }
 
+  size_t countPickedEntry() const
+  {
+    return pickedEntries_.size();
+  }
+
+  // Drops the entry picked first.
   void dropPickedEntry()
   {
-    pickedEntry_.reset();
+    if(!pickedEntries_.empty()) {
+      pickedEntries_.pop_front();
+    }
+  }
+
+  void dropPickedEntry(const SharedHandle<T>& entry)
+  {
+    for(typename std::deque<SharedHandle<T> >::iterator i =
+          pickedEntries_.begin(), eoi = pickedEntries_.end(); i != eoi; ++i) {
+      if((*i).get() == entry.get()) {
+        pickedEntries_.erase(i);
+        break;
+      }
+    }
   }
 
   bool hasNext() const
@@ -69,13 +105,20 @@ public:
     return !entries_.empty();
   }
 
+  // Returns true if next entry is available and the number of picked
+  // entries is less than the limit.
+  bool canPickNext() const
+  {
+    return hasNext() && pickedEntries_.size() < maxPicked_;
+  }
+
   SharedHandle<T> pickNext()
   {
     SharedHandle<T> r;
     if(hasNext()) {
       r = entries_.front();
       entries_.pop_front();
-      pickedEntry_ = r;
+      pickedEntries_.push_back(r);
     }
     return r;
   }
@@ -89,6 +132,16 @@ public:
   {
     return entries_.size();
   }
+
+  void setMaxPicked(size_t maxPicked)
+  {
+    maxPicked_ = std::max(static_cast<size_t>(1), maxPicked);
+  }
+
+  size_t getMaxPicked() const
+  {
+    return maxPicked_;
+  }
 };
 
 } // namespace aria2
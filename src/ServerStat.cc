@@ -56,7 +56,10 @@ ServerStat::ServerStat(const std::string& hostname, const std::string& protocol)
     singleConnectionAvgSpeed_(0),
     multiConnectionAvgSpeed_(0),
     counter_(0),
-    status_(OK)
+    status_(OK),
+    rtt_(0),
+    pipeliningFailures_(0),
+    pipeliningBroken_(false)
 {}
 
 ServerStat::~ServerStat() {}
@@ -189,6 +192,62 @@ void ServerStat::setError()
   setStatusInternal(ERROR);
 }
 
+void ServerStat::updateRtt(unsigned int rtt)
+{
+  if(rtt_ == 0) {
+    rtt_ = rtt;
+  } else {
+    // Same smoothing as TCP's SRTT.
+    rtt_ = (rtt_*7+rtt)/8;
+  }
+}
+
+namespace {
+// The number of pipelining failures after which pipelining is no
+// longer used for the server.
+const unsigned int MAX_PIPELINING_FAILURES = 3;
+} // namespace
+
+void ServerStat::increasePipeliningFailures()
+{
+  ++pipeliningFailures_;
+  A2_LOG_DEBUG(fmt("ServerStat: pipelining failed %u times for %s (%s)",
+                   pipeliningFailures_,
+                   hostname_.c_str(),
+                   protocol_.c_str()));
+}
+
+void ServerStat::setPipeliningBroken()
+{
+  A2_LOG_DEBUG(fmt("ServerStat: pipelining is broken for %s (%s)",
+                   hostname_.c_str(),
+                   protocol_.c_str()));
+  pipeliningBroken_ = true;
+}
+
+bool ServerStat::isPipeliningBroken() const
+{
+  return pipeliningBroken_ || pipeliningFailures_ >= MAX_PIPELINING_FAILURES;
+}
+
+unsigned int ServerStat::calculatePipelineDepth
+(unsigned int maxDepth, size_t segmentLength) const
+{
+  if(isPipeliningBroken() || maxDepth <= 1) {
+    return 1;
+  }
+  unsigned int depth = maxDepth;
+  if(rtt_ > 0 && downloadSpeed_ > 0 && segmentLength > 0) {
+    uint64_t bytesInRtt = static_cast<uint64_t>(downloadSpeed_)*rtt_/1000;
+    uint64_t n = (bytesInRtt+segmentLength-1)/segmentLength+1;
+    if(n < depth) {
+      depth = n;
+    }
+  }
+  depth >>= pipeliningFailures_;
+  return std::max(depth, 1U);
+}
+
 bool ServerStat::operator<(const ServerStat& serverStat) const
 {
   int c = hostname_.compare(serverStat.hostname_);
@@ -142,6 +142,40 @@ public:
   // set status ERROR and update lastUpdated_
   void setError();
 
+  // Returns smoothed round trip time of HTTP request in milliseconds,
+  // or 0 if it has not been measured.
+  unsigned int getRtt() const
+  {
+    return rtt_;
+  }
+
+  // Updates smoothed RTT with a new sample in milliseconds.
+  void updateRtt(unsigned int rtt);
+
+  unsigned int getPipeliningFailures() const
+  {
+    return pipeliningFailures_;
+  }
+
+  // Records that pipelined requests to this server failed, e.g. the
+  // server closed connection while requests were outstanding.
+  void increasePipeliningFailures();
+
+  // Records that this server is known to mishandle pipelined
+  // requests, e.g. it responded with a range which was not requested.
+  void setPipeliningBroken();
+
+  // Returns true if pipelining must not be used for this server.
+  bool isPipeliningBroken() const;
+
+  // Returns the number of requests to pipeline to this server. It is
+  // the number of segments of segmentLength bytes the server can send
+  // in one RTT plus 1, so that the connection does not idle while a
+  // request travels to the server. The value is capped by maxDepth
+  // and halved for each recorded pipelining failure.
+  unsigned int calculatePipelineDepth
+  (unsigned int maxDepth, size_t segmentLength) const;
+
   bool operator<(const ServerStat& serverStat) const;
 
   bool operator==(const ServerStat& serverStat) const;
@@ -160,6 +194,12 @@ private:
 
   STATUS status_;
 
+  unsigned int rtt_;
+
+  unsigned int pipeliningFailures_;
+
+  bool pipeliningBroken_;
+
   Time lastUpdated_;
 
   void setStatusInternal(STATUS status);
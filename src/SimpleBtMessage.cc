@@ -36,6 +36,7 @@
 #include "message.h"
 #include "Peer.h"
 #include "PeerConnection.h"
+#include "SocketBuffer.h"
 #include "Logger.h"
 #include "LogFactory.h"
 #include "util.h"
@@ -60,11 +61,19 @@ void SimpleBtMessage::send() {
                     getPeer()->getIPAddress().c_str(),
                     getPeer()->getPort(),
                     toString().c_str()));
-    unsigned char* msg = createMessage();
-    size_t msgLength = getMessageLength();
-    A2_LOG_DEBUG(fmt("msglength = %lu bytes",
-                     static_cast<unsigned long>(msgLength)));
-    getPeerConnection()->pushBytes(msg, msgLength);
+    unsigned char buf[SocketBuffer::INLINE_BUF_SIZE];
+    if(writeMessage(buf)) {
+      size_t msgLength = getMessageLength();
+      A2_LOG_DEBUG(fmt("msglength = %lu bytes",
+                       static_cast<unsigned long>(msgLength)));
+      getPeerConnection()->pushInlineBytes(buf, msgLength);
+    } else {
+      unsigned char* msg = createMessage();
+      size_t msgLength = getMessageLength();
+      A2_LOG_DEBUG(fmt("msglength = %lu bytes",
+                       static_cast<unsigned long>(msgLength)));
+      getPeerConnection()->pushBytes(msg, msgLength);
+    }
   }
   getPeerConnection()->sendPendingData();
   setSendingInProgress(!getPeerConnection()->sendBufferIsEmpty());
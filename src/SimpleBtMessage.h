@@ -47,6 +47,13 @@ public:
 
   virtual unsigned char* createMessage() = 0;
 
+  // Writes the message into msg, which has room for
+  // SocketBuffer::INLINE_BUF_SIZE bytes, and returns true.  Returns
+  // false if the message is not written, in which case send() uses
+  // createMessage() instead.  Short messages sent frequently override
+  // this so that sending them does not allocate memory.
+  virtual bool writeMessage(unsigned char* msg) { return false; }
+
   virtual size_t getMessageLength() = 0;
 
   virtual void onSendComplete() {};
@@ -35,12 +35,15 @@
 #include "SinkStreamFilter.h"
 #include "BinaryStream.h"
 #include "Segment.h"
+#include "Piece.h"
+#include "array_fun.h"
 
 namespace aria2 {
 
 const std::string SinkStreamFilter::NAME("SinkStreamFilter");
 
-SinkStreamFilter::SinkStreamFilter(bool hashUpdate):
+SinkStreamFilter::SinkStreamFilter(WrDiskCache* wrDiskCache, bool hashUpdate):
+  wrDiskCache_(wrDiskCache),
   hashUpdate_(hashUpdate),
   bytesProcessed_(0) {}
 
@@ -50,7 +53,16 @@ ssize_t SinkStreamFilter::transform
  const unsigned char* inbuf, size_t inlen)
 {
   if(inlen > 0) {
-    out->writeData(inbuf, inlen, segment->getPositionToWrite());
+    SharedHandle<Piece> piece;
+    if(wrDiskCache_) {
+      piece = segment->getPiece();
+    }
+    if(piece && piece->getWrDiskCacheEntry()) {
+      piece->updateWrCache(wrDiskCache_, inbuf, inlen,
+                           segment->getPositionToWrite());
+    } else {
+      out->writeData(inbuf, inlen, segment->getPositionToWrite());
+    }
 #ifdef ENABLE_MESSAGE_DIGEST
     if(hashUpdate_) {
       segment->updateHash(segment->getWrittenLength(), inbuf, inlen);
@@ -62,4 +74,35 @@ ssize_t SinkStreamFilter::transform
   return bytesProcessed_;
 }
 
+ssize_t SinkStreamFilter::transformOwned
+(const SharedHandle<BinaryStream>& out,
+ const SharedHandle<Segment>& segment,
+ unsigned char* inbuf, size_t inlen)
+{
+  if(!isWrCacheUsed(segment)) {
+    array_ptr<unsigned char> buf(inbuf);
+    return transform(out, segment, inbuf, inlen);
+  }
+#ifdef ENABLE_MESSAGE_DIGEST
+  if(hashUpdate_) {
+    segment->updateHash(segment->getWrittenLength(), inbuf, inlen);
+  }
+#endif // ENABLE_MESSAGE_DIGEST
+  off_t goff = segment->getPositionToWrite();
+  segment->updateWrittenLength(inlen);
+  segment->getPiece()->acquireWrCache(wrDiskCache_, inbuf, inlen, goff);
+  bytesProcessed_ = inlen;
+  return bytesProcessed_;
+}
+
+bool SinkStreamFilter::isWrCacheUsed
+(const SharedHandle<Segment>& segment) const
+{
+  if(!wrDiskCache_) {
+    return false;
+  }
+  SharedHandle<Piece> piece = segment->getPiece();
+  return piece && piece->getWrDiskCacheEntry();
+}
+
 } // namespace aria2
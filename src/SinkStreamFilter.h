@@ -39,13 +39,19 @@
 
 namespace aria2 {
 
+class WrDiskCache;
+
 class SinkStreamFilter:public StreamFilter {
 private:
+  WrDiskCache* wrDiskCache_;
+
   bool hashUpdate_;
 
   size_t bytesProcessed_;
 public:
-  SinkStreamFilter(bool hashUpdate = false);
+  // If wrDiskCache is not 0 and the segment's piece has write cache,
+  // data is written to the cache instead of out.
+  SinkStreamFilter(WrDiskCache* wrDiskCache = 0, bool hashUpdate = false);
 
   virtual void init() {}
 
@@ -54,6 +60,21 @@ public:
    const SharedHandle<Segment>& segment,
    const unsigned char* inbuf, size_t inlen);
 
+  // If the data is written to write cache, inbuf is stored in the
+  // cache without copying.
+  virtual ssize_t transformOwned
+  (const SharedHandle<BinaryStream>& out,
+   const SharedHandle<Segment>& segment,
+   unsigned char* inbuf, size_t inlen);
+
+  virtual bool acceptsOwnedBuffer(const SharedHandle<Segment>& segment) const
+  {
+    return isWrCacheUsed(segment);
+  }
+
+  // Returns true if the data for segment is written to write cache.
+  bool isWrCacheUsed(const SharedHandle<Segment>& segment) const;
+
   virtual bool finished()
   {
     return true;
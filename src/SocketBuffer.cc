@@ -35,15 +35,102 @@
 #include "SocketBuffer.h"
 
 #include <cassert>
+#include <cstring>
 #include <algorithm>
 
 #include "SocketCore.h"
+#include "DiskAdaptor.h"
+#include "a2io.h"
 #include "DlAbortEx.h"
 #include "message.h"
 #include "fmt.h"
 
 namespace aria2 {
 
+struct SocketBuffer::FileData {
+  SharedHandle<DiskAdaptor> diskAdaptor;
+  // The offset of data in diskAdaptor.
+  off_t offset;
+
+  FileData(const SharedHandle<DiskAdaptor>& diskAdaptor, off_t offset):
+    diskAdaptor(diskAdaptor), offset(offset) {}
+};
+
+SocketBuffer::BufEntry::BufEntry(unsigned char* bytes, size_t len):
+  type(TYPE_BYTES), bytesLen(len)
+{
+  this->bytes = bytes;
+}
+
+SocketBuffer::BufEntry::BufEntry(const std::string& s):
+  bytesLen(s.size())
+{
+  if(bytesLen <= INLINE_BUF_SIZE) {
+    type = TYPE_INLINE;
+    memcpy(inlineBuf, s.data(), bytesLen);
+  } else {
+    type = TYPE_STR;
+    str = new std::string(s);
+  }
+}
+
+SocketBuffer::BufEntry::BufEntry(const unsigned char* data, size_t len):
+  type(TYPE_INLINE), bytesLen(len)
+{
+  assert(len <= INLINE_BUF_SIZE);
+  memcpy(inlineBuf, data, len);
+}
+
+SocketBuffer::BufEntry::BufEntry(FileData* file, size_t len):
+  type(TYPE_FILE), bytesLen(len)
+{
+  this->file = file;
+}
+
+SocketBuffer::BufEntry::BufEntry(const BufEntry& c)
+{
+  copyFrom(c);
+}
+
+SocketBuffer::BufEntry& SocketBuffer::BufEntry::operator=(const BufEntry& c)
+{
+  if(this != &c) {
+    copyFrom(c);
+  }
+  return *this;
+}
+
+void SocketBuffer::BufEntry::copyFrom(const BufEntry& c)
+{
+  type = c.type;
+  bytesLen = c.bytesLen;
+  switch(type) {
+  case TYPE_BYTES:
+    bytes = c.bytes;
+    break;
+  case TYPE_STR:
+    str = c.str;
+    break;
+  case TYPE_INLINE:
+    memcpy(inlineBuf, c.inlineBuf, bytesLen);
+    break;
+  case TYPE_FILE:
+    file = c.file;
+    break;
+  }
+}
+
+void SocketBuffer::BufEntry::deleteBuf()
+{
+  if(type == TYPE_BYTES) {
+    delete [] bytes;
+  } else if(type == TYPE_STR) {
+    delete str;
+  } else if(type == TYPE_FILE) {
+    delete file;
+  }
+}
+
 SocketBuffer::SocketBuffer(const SharedHandle<SocketCore>& socket):
   socket_(socket), offset_(0) {}
 
@@ -63,6 +150,85 @@ void SocketBuffer::pushStr(const std::string& data)
   bufq_.push_back(BufEntry(data));
 }
 
+void SocketBuffer::pushInlineBytes(const unsigned char* bytes, size_t len)
+{
+  bufq_.push_back(BufEntry(bytes, len));
+}
+
+bool SocketBuffer::pushFile(const SharedHandle<DiskAdaptor>& diskAdaptor,
+                            off_t offset, size_t len)
+{
+  if(!socket_->isSendFileAvailable()) {
+    return false;
+  }
+  bufq_.push_back(BufEntry(new FileData(diskAdaptor, offset), len));
+  return true;
+}
+
+ssize_t SocketBuffer::sendFileData(BufEntry& buf, size_t len)
+{
+  off_t fileOffset;
+  const SharedHandle<DiskAdaptor>& diskAdaptor = buf.file->diskAdaptor;
+  int fd = diskAdaptor->getFdForRead
+    (fileOffset, buf.file->offset+offset_, len);
+  if(fd == -1) {
+    unsigned char* bytes = new unsigned char[buf.bytesLen];
+    ssize_t r;
+    try {
+      r = diskAdaptor->readData(bytes, buf.bytesLen, buf.file->offset);
+    } catch(RecoverableException& e) {
+      delete [] bytes;
+      throw;
+    }
+    if(r != static_cast<ssize_t>(buf.bytesLen)) {
+      delete [] bytes;
+      throw DL_ABORT_EX(EX_DATA_READ);
+    }
+    buf.deleteBuf();
+    buf = BufEntry(bytes, buf.bytesLen);
+    return socket_->writeData(bytes+offset_, len);
+  }
+  ssize_t slen = socket_->sendFile(fd, fileOffset, len);
+  if(slen == 0 && !socket_->wantWrite()) {
+    throw DL_ABORT_EX(EX_DATA_READ);
+  }
+  return slen;
+}
+
+ssize_t SocketBuffer::sendVector(size_t& len)
+{
+  a2iovec iov[A2_IOV_MAX];
+  size_t iovcnt = 0;
+  len = 0;
+  for(std::deque<BufEntry>::const_iterator i = bufq_.begin(),
+        eoi = bufq_.end(); i != eoi && iovcnt < A2_IOV_MAX &&
+        (*i).type != TYPE_FILE; ++i) {
+    size_t offset = iovcnt == 0 ? offset_ : 0;
+    iov[iovcnt].iov_base =
+      const_cast<unsigned char*>((*i).data())+offset;
+    iov[iovcnt].iov_len = (*i).size()-offset;
+    len += iov[iovcnt].iov_len;
+    ++iovcnt;
+  }
+  return socket_->writeVector(iov, iovcnt);
+}
+
+void SocketBuffer::consume(size_t len)
+{
+  while(len > 0) {
+    BufEntry& buf = bufq_[0];
+    size_t r = buf.size()-offset_;
+    if(len < r) {
+      offset_ += len;
+      break;
+    }
+    len -= r;
+    offset_ = 0;
+    buf.deleteBuf();
+    bufq_.pop_front();
+  }
+}
+
 ssize_t SocketBuffer::send()
 {
   size_t totalslen = 0;
@@ -73,28 +239,21 @@ ssize_t SocketBuffer::send()
       bufq_.pop_front();
       continue;
     }
-    const char* data;
-    ssize_t r;
-    if(buf.type == TYPE_BYTES) {
-      data = reinterpret_cast<const char*>(buf.bytes);
-      r = buf.bytesLen-offset_;
+    size_t r;
+    ssize_t slen;
+    if(buf.type == TYPE_FILE) {
+      r = buf.size()-offset_;
+      slen = sendFileData(buf, r);
     } else {
-      const std::string& str = *buf.str;
-      data = str.data();
-      r = str.size()-offset_;
+      slen = sendVector(r);
     }
-    ssize_t slen = socket_->writeData(data+offset_, r);
     if(slen == 0 && !socket_->wantRead() && !socket_->wantWrite()) {
       throw DL_ABORT_EX(fmt(EX_SOCKET_SEND, "Connection closed."));
     }
     totalslen += slen;
-    if(slen < r) {
-      offset_ += slen;
+    consume(slen);
+    if(static_cast<size_t>(slen) < r) {
       break;
-    } else {
-      offset_ = 0;
-      buf.deleteBuf();
-      bufq_.pop_front();
     }
   }
   return totalslen;
@@ -45,43 +45,91 @@
 namespace aria2 {
 
 class SocketCore;
+class DiskAdaptor;
 
 class SocketBuffer {
+public:
+  // Data up to this length are copied into the queue entry itself,
+  // so that pushStr() and pushInlineBytes() do not allocate memory
+  // for short messages.
+  static const size_t INLINE_BUF_SIZE = 64;
 private:
   enum BUF_TYPE {
     TYPE_BYTES,
-    TYPE_STR
+    TYPE_STR,
+    TYPE_INLINE,
+    TYPE_FILE
   };
+  // The state of TYPE_FILE entry. It is allocated separately so that
+  // it does not make the entries of in-memory data larger.
+  struct FileData;
+
   struct BufEntry {
     BUF_TYPE type;
-    unsigned char* bytes;
+    // The length of bytes, inlineBuf or the length of data in file.
     size_t bytesLen;
-    std::string* str;
+    union {
+      unsigned char* bytes;
+      std::string* str;
+      FileData* file;
+      unsigned char inlineBuf[INLINE_BUF_SIZE];
+    };
 
-    void deleteBuf()
+    void deleteBuf();
+
+    size_t size() const
     {
-      if(type == TYPE_BYTES) {
-        delete [] bytes;
-      } else if(type == TYPE_STR) {
-        delete str;
+      if(type == TYPE_STR) {
+        return str->size();
+      } else {
+        return bytesLen;
       }
     }
-    
-    size_t size() const
+
+    // Returns the pointer to the data. Not applicable to TYPE_FILE.
+    const unsigned char* data() const
     {
       if(type == TYPE_BYTES) {
-        return bytesLen;
+        return bytes;
+      } else if(type == TYPE_STR) {
+        return reinterpret_cast<const unsigned char*>(str->data());
       } else {
-        return str->size();
+        return inlineBuf;
       }
     }
 
-    BufEntry(unsigned char* bytes, size_t len):
-      type(TYPE_BYTES), bytes(bytes), bytesLen(len) {}
+    BufEntry(unsigned char* bytes, size_t len);
+
+    BufEntry(const std::string& str);
+
+    // Copies data into inlineBuf. len must not exceed INLINE_BUF_SIZE.
+    BufEntry(const unsigned char* data, size_t len);
+
+    // Takes ownership of file.
+    BufEntry(FileData* file, size_t len);
+
+    // Copies only the member of the union which is in use. The
+    // ownership of the buffer is not transferred. deleteBuf() must be
+    // called for exactly one of the copies.
+    BufEntry(const BufEntry& c);
 
-    BufEntry(const std::string& str):
-      type(TYPE_STR), str(new std::string(str)) {}
+    BufEntry& operator=(const BufEntry& c);
+
+    void copyFrom(const BufEntry& c);
   };
+
+  // Sends the file data in buf using SocketCore::sendFile(). If the
+  // data is not available as a file, buf is converted to TYPE_BYTES
+  // and sent by SocketCore::writeData().
+  ssize_t sendFileData(BufEntry& buf, size_t len);
+
+  // Sends consecutive in-memory entries from the front of bufq_ with
+  // a single SocketCore::writeVector() call. Stores the number of
+  // bytes tried to send in len.
+  ssize_t sendVector(size_t& len);
+
+  // Removes len bytes of sent data from the front of bufq_.
+  void consume(size_t len);
     
   SharedHandle<SocketCore> socket_;
 
@@ -108,6 +156,17 @@ public:
   // Feeds data into queue. This function doesn't send data.
   void pushStr(const std::string& data);
 
+  // Copies len bytes pointed by bytes into queue. len must not exceed
+  // INLINE_BUF_SIZE. This function doesn't send data.
+  void pushInlineBytes(const unsigned char* bytes, size_t len);
+
+  // Feeds len bytes at offset in diskAdaptor into queue. The data is
+  // sent from the file to the socket directly when possible. Returns
+  // false if the socket cannot do that. In this case, nothing is
+  // pushed.
+  bool pushFile(const SharedHandle<DiskAdaptor>& diskAdaptor,
+                off_t offset, size_t len);
+
   // Sends data in queue.  Returns the number of bytes sent.
   ssize_t send();
 
@@ -38,9 +38,13 @@
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
 #endif // HAVE_IFADDRS_H
+#if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif // HAVE_SENDFILE && HAVE_SYS_SENDFILE_H
 
 #include <cerrno>
 #include <cstring>
+#include <algorithm>
 
 #ifdef HAVE_LIBGNUTLS
 # include <gnutls/x509.h>
@@ -55,6 +59,7 @@
 #include "a2functional.h"
 #include "LogFactory.h"
 #include "A2STR.h"
+#include "TLSSessionCache.h"
 #ifdef ENABLE_SSL
 # include "TLSContext.h"
 #endif // ENABLE_SSL
@@ -127,6 +132,15 @@ SharedHandle<TLSContext> SocketCore::tlsContext_;
 void SocketCore::setTLSContext(const SharedHandle<TLSContext>& tlsContext)
 {
   tlsContext_ = tlsContext;
+#ifdef HAVE_LIBSSL
+  if(tlsContext_) {
+    // Client sessions are kept in TLSSessionCache, not in SSL_CTX.
+    SSL_CTX_set_session_cache_mode
+      (tlsContext_->getSSLCtx(),
+       SSL_SESS_CACHE_CLIENT|SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(tlsContext_->getSSLCtx(), newTLSSessionCallback);
+  }
+#endif // HAVE_LIBSSL
 }
 #endif // ENABLE_SSL
 
@@ -152,12 +166,16 @@ void SocketCore::init()
   wantRead_ = false;
   wantWrite_ = false;
 
+#ifdef ENABLE_SSL
+  tlsSessionPort_ = 0;
+#endif // ENABLE_SSL
 #ifdef HAVE_LIBSSL
   // for SSL
   ssl = NULL;
 #endif // HAVE_LIBSSL
 #ifdef HAVE_LIBGNUTLS
   sslSession_ = 0;
+  tlsSessionRefreshPending_ = false;
 #endif //HAVE_LIBGNUTLS
 }
 
@@ -757,6 +775,70 @@ ssize_t SocketCore::writeData(const char* data, size_t len)
   return ret;
 }
 
+ssize_t SocketCore::writeVector(const a2iovec* iov, size_t iovcnt)
+{
+#ifdef HAVE_WRITEV
+  if(!secure_) {
+    ssize_t ret = 0;
+    wantRead_ = false;
+    wantWrite_ = false;
+    while((ret = writev(sockfd_, iov, iovcnt)) == -1 &&
+          SOCKET_ERRNO == A2_EINTR);
+    int errNum = SOCKET_ERRNO;
+    if(ret == -1) {
+      if(A2_WOULDBLOCK(errNum)) {
+        wantWrite_ = true;
+        ret = 0;
+      } else {
+        throw DL_RETRY_EX(fmt(EX_SOCKET_SEND, errorMsg(errNum).c_str()));
+      }
+    }
+    return ret;
+  }
+#endif // HAVE_WRITEV
+  ssize_t total = 0;
+  for(size_t i = 0; i < iovcnt; ++i) {
+    ssize_t ret = writeData(static_cast<const char*>(iov[i].iov_base),
+                            iov[i].iov_len);
+    total += ret;
+    if(ret < static_cast<ssize_t>(iov[i].iov_len)) {
+      break;
+    }
+  }
+  return total;
+}
+
+bool SocketCore::isSendFileAvailable() const
+{
+#if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+  return !secure_;
+#else // !(HAVE_SENDFILE && HAVE_SYS_SENDFILE_H)
+  return false;
+#endif // !(HAVE_SENDFILE && HAVE_SYS_SENDFILE_H)
+}
+
+ssize_t SocketCore::sendFile(int fd, off_t offset, size_t len)
+{
+  ssize_t ret = 0;
+  wantRead_ = false;
+  wantWrite_ = false;
+#if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+  while((ret = sendfile(sockfd_, fd, &offset, len)) == -1 && errno == EINTR);
+  int errNum = errno;
+  if(ret == -1) {
+    if(A2_WOULDBLOCK(errNum)) {
+      wantWrite_ = true;
+      ret = 0;
+    } else {
+      throw DL_RETRY_EX(fmt(EX_SOCKET_SEND, errorMsg(errNum).c_str()));
+    }
+  }
+#else // !(HAVE_SENDFILE && HAVE_SYS_SENDFILE_H)
+  throw DL_ABORT_EX(fmt(EX_SOCKET_SEND, "sendfile is not available."));
+#endif // !(HAVE_SENDFILE && HAVE_SYS_SENDFILE_H)
+  return ret;
+}
+
 void SocketCore::readData(char* data, size_t& len)
 {
   ssize_t ret = 0;
@@ -797,6 +879,9 @@ void SocketCore::readData(char* data, size_t& len)
       ret = 0;
     } else if(ret < 0) {
       throw DL_RETRY_EX(fmt(EX_SOCKET_RECV, gnutls_strerror(ret)));
+    } else if(ret > 0 && tlsSessionRefreshPending_) {
+      tlsSessionRefreshPending_ = false;
+      storeTLSSession();
     }
 #endif // HAVE_LIBGNUTLS
   }
@@ -804,9 +889,16 @@ void SocketCore::readData(char* data, size_t& len)
   len = ret;
 }
 
-void SocketCore::prepareSecureConnection()
+void SocketCore::prepareSecureConnection
+(const SharedHandle<TLSSessionCache>& sessionCache,
+ const std::string& hostname, uint16_t port)
 {
   if(!secure_) {
+#ifdef ENABLE_SSL
+    tlsSessionCache_ = sessionCache;
+    tlsSessionHostname_ = hostname;
+    tlsSessionPort_ = port;
+#endif // ENABLE_SSL
 #ifdef HAVE_LIBSSL
     // for SSL
     ssl = SSL_new(tlsContext_->getSSLCtx());
@@ -820,6 +912,19 @@ void SocketCore::prepareSecureConnection()
         (fmt(EX_SSL_INIT_FAILURE,
              ERR_error_string(ERR_get_error(), 0)));
     }
+    SSL_set_app_data(ssl, this);
+    std::string sessionData;
+    if(tlsSessionCache_ &&
+       tlsSessionCache_->find
+       (sessionData, tlsSessionHostname_, tlsSessionPort_)) {
+      const unsigned char* p =
+        reinterpret_cast<const unsigned char*>(sessionData.data());
+      SSL_SESSION* session = d2i_SSL_SESSION(0, &p, sessionData.size());
+      if(session) {
+        SSL_set_session(ssl, session);
+        SSL_SESSION_free(session);
+      }
+    }
 #endif // HAVE_LIBSSL
 #ifdef HAVE_LIBGNUTLS
     int r;
@@ -837,11 +942,52 @@ void SocketCore::prepareSecureConnection()
     gnutls_credentials_set(sslSession_, GNUTLS_CRD_CERTIFICATE,
                            tlsContext_->getCertCred());
     gnutls_transport_set_ptr(sslSession_, (gnutls_transport_ptr_t)sockfd_);
+    std::string sessionData;
+    if(tlsSessionCache_ &&
+       tlsSessionCache_->find
+       (sessionData, tlsSessionHostname_, tlsSessionPort_)) {
+      gnutls_session_set_data(sslSession_, sessionData.data(),
+                              sessionData.size());
+    }
 #endif // HAVE_LIBGNUTLS
     secure_ = 1;
   }
 }
 
+#ifdef HAVE_LIBGNUTLS
+void SocketCore::storeTLSSession()
+{
+  gnutls_datum_t sessionData;
+  if(gnutls_session_get_data2(sslSession_, &sessionData) ==
+     GNUTLS_E_SUCCESS) {
+    tlsSessionCache_->put
+      (tlsSessionHostname_, tlsSessionPort_,
+       std::string(&sessionData.data[0],
+                   &sessionData.data[sessionData.size]));
+    gnutls_free(sessionData.data);
+  }
+}
+#endif // HAVE_LIBGNUTLS
+
+#ifdef HAVE_LIBSSL
+int SocketCore::newTLSSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+  SocketCore* socket = static_cast<SocketCore*>(SSL_get_app_data(ssl));
+  if(socket && socket->tlsSessionCache_) {
+    int len = i2d_SSL_SESSION(session, 0);
+    if(len > 0) {
+      std::string sessionData(len, '\0');
+      unsigned char* p = reinterpret_cast<unsigned char*>(&sessionData[0]);
+      i2d_SSL_SESSION(session, &p);
+      socket->tlsSessionCache_->put
+        (socket->tlsSessionHostname_, socket->tlsSessionPort_, sessionData);
+    }
+  }
+  // We don't keep the reference to session.
+  return 0;
+}
+#endif // HAVE_LIBSSL
+
 bool SocketCore::initiateSecureConnection(const std::string& hostname)
 {
   if(secure_ == 1) {
@@ -922,6 +1068,12 @@ bool SocketCore::initiateSecureConnection(const std::string& hostname)
         throw DL_ABORT_EX(MSG_HOSTNAME_NOT_MATCH);
       }
     }
+    // The resumed session keeps the peer certificate and the
+    // verification result, so it is verified in the same way.
+    if(SSL_session_reused(ssl)) {
+      A2_LOG_DEBUG(fmt("TLS session resumed. host=%s",
+                       tlsSessionHostname_.c_str()));
+    }
 #endif // HAVE_LIBSSL
 #ifdef HAVE_LIBGNUTLS
     int ret = gnutls_handshake(sslSession_);
@@ -1005,6 +1157,15 @@ bool SocketCore::initiateSecureConnection(const std::string& hostname)
         }
       }
     }
+    if(gnutls_session_is_resumed(sslSession_)) {
+      A2_LOG_DEBUG(fmt("TLS session resumed. host=%s",
+                       tlsSessionHostname_.c_str()));
+    } else if(tlsSessionCache_) {
+      storeTLSSession();
+      // In TLSv1.3, the session ticket arrives after the handshake,
+      // so the session data is taken again after the first read.
+      tlsSessionRefreshPending_ = true;
+    }
 #endif // HAVE_LIBGNUTLS
     secure_ = 2;
     return true;
@@ -1076,6 +1237,134 @@ ssize_t SocketCore::readDataFrom(char* data, size_t len,
   return r;
 }
 
+size_t SocketCore::readDatagrams(Datagram* dgrams, size_t num)
+{
+  wantRead_ = false;
+  wantWrite_ = false;
+  size_t count = 0;
+  while(count < num) {
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[A2_MMSG_MAX];
+    struct iovec iovs[A2_MMSG_MAX];
+    size_t n = std::min(num-count, static_cast<size_t>(A2_MMSG_MAX));
+    memset(msgs, 0, sizeof(msgs[0])*n);
+    for(size_t i = 0; i < n; ++i) {
+      Datagram& dgram = dgrams[count+i];
+      iovs[i].iov_base = dgram.data;
+      iovs[i].iov_len = dgram.length;
+      msgs[i].msg_hdr.msg_name = &dgram.addr;
+      msgs[i].msg_hdr.msg_namelen = sizeof(dgram.addr);
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int r;
+    while((r = recvmmsg(sockfd_, msgs, n, 0, 0)) == -1 &&
+          A2_EINTR == SOCKET_ERRNO);
+    int errNum = SOCKET_ERRNO;
+    if(r == -1) {
+      if(A2_WOULDBLOCK(errNum)) {
+        wantRead_ = true;
+        break;
+      } else if(count == 0) {
+        throw DL_RETRY_EX(fmt(EX_SOCKET_RECV, errorMsg(errNum).c_str()));
+      } else {
+        break;
+      }
+    }
+    for(int i = 0; i < r; ++i) {
+      Datagram& dgram = dgrams[count+i];
+      dgram.length = msgs[i].msg_len;
+      dgram.addrlen = msgs[i].msg_hdr.msg_namelen;
+      dgram.truncated = msgs[i].msg_hdr.msg_flags&MSG_TRUNC;
+    }
+    count += r;
+    if(static_cast<size_t>(r) < n) {
+      break;
+    }
+#else // !HAVE_RECVMMSG
+    Datagram& dgram = dgrams[count];
+    dgram.addrlen = sizeof(dgram.addr);
+    ssize_t r;
+    while((r = recvfrom(sockfd_, reinterpret_cast<char*>(dgram.data),
+                        dgram.length, 0,
+                        reinterpret_cast<struct sockaddr*>(&dgram.addr),
+                        &dgram.addrlen)) == -1 &&
+          A2_EINTR == SOCKET_ERRNO);
+    int errNum = SOCKET_ERRNO;
+    if(r == -1) {
+      if(A2_WOULDBLOCK(errNum)) {
+        wantRead_ = true;
+        break;
+      } else if(count == 0) {
+        throw DL_RETRY_EX(fmt(EX_SOCKET_RECV, errorMsg(errNum).c_str()));
+      } else {
+        break;
+      }
+    }
+    dgram.length = r;
+    dgram.truncated = false;
+    ++count;
+#endif // !HAVE_RECVMMSG
+  }
+  return count;
+}
+
+size_t SocketCore::writeDatagrams(const Datagram* dgrams, size_t num)
+{
+  wantRead_ = false;
+  wantWrite_ = false;
+  size_t count = 0;
+  while(count < num) {
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[A2_MMSG_MAX];
+    struct iovec iovs[A2_MMSG_MAX];
+    size_t n = std::min(num-count, static_cast<size_t>(A2_MMSG_MAX));
+    memset(msgs, 0, sizeof(msgs[0])*n);
+    for(size_t i = 0; i < n; ++i) {
+      const Datagram& dgram = dgrams[count+i];
+      iovs[i].iov_base = dgram.data;
+      iovs[i].iov_len = dgram.length;
+      msgs[i].msg_hdr.msg_name =
+        const_cast<struct sockaddr_storage*>(&dgram.addr);
+      msgs[i].msg_hdr.msg_namelen = dgram.addrlen;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int r;
+    while((r = sendmmsg(sockfd_, msgs, n, 0)) == -1 &&
+          A2_EINTR == SOCKET_ERRNO);
+#else // !HAVE_SENDMMSG
+    const Datagram& dgram = dgrams[count];
+    const size_t n = 1;
+    ssize_t r;
+    while((r = sendto(sockfd_, reinterpret_cast<const char*>(dgram.data),
+                      dgram.length, 0,
+                      reinterpret_cast<const struct sockaddr*>(&dgram.addr),
+                      dgram.addrlen)) == -1 &&
+          A2_EINTR == SOCKET_ERRNO);
+    if(r != -1) {
+      r = 1;
+    }
+#endif // !HAVE_SENDMMSG
+    int errNum = SOCKET_ERRNO;
+    if(r == -1) {
+      if(A2_WOULDBLOCK(errNum)) {
+        wantWrite_ = true;
+        break;
+      } else if(count == 0) {
+        throw DL_ABORT_EX(fmt(EX_SOCKET_SEND, errorMsg(errNum).c_str()));
+      } else {
+        break;
+      }
+    }
+    count += r;
+    if(static_cast<size_t>(r) < n) {
+      break;
+    }
+  }
+  return count;
+}
+
 std::string SocketCore::getSocketError() const
 {
   int error;
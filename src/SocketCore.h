@@ -63,6 +63,25 @@ namespace aria2 {
 #ifdef ENABLE_SSL
 class TLSContext;
 #endif // ENABLE_SSL
+class TLSSessionCache;
+
+// A datagram read by SocketCore::readDatagrams() or written by
+// SocketCore::writeDatagrams().
+struct Datagram {
+  unsigned char* data;
+  // The length of the datagram. When reading, this is the capacity of
+  // data on input.
+  size_t length;
+  struct sockaddr_storage addr;
+  socklen_t addrlen;
+  // True if the received datagram did not fit in data and was
+  // truncated.
+  bool truncated;
+};
+
+// The maximum number of datagrams SocketCore::readDatagrams() and
+// SocketCore::writeDatagrams() handle in one system call.
+#define A2_MMSG_MAX 64
 
 class SocketCore {
   friend bool operator==(const SocketCore& s1, const SocketCore& s2);
@@ -86,6 +105,12 @@ private:
 
 #if ENABLE_SSL
   static SharedHandle<TLSContext> tlsContext_;
+
+  // The TLS session is resumed from and stored to tlsSessionCache_
+  // with the key tlsSessionHostname_ and tlsSessionPort_.
+  SharedHandle<TLSSessionCache> tlsSessionCache_;
+  std::string tlsSessionHostname_;
+  uint16_t tlsSessionPort_;
 #endif // ENABLE_SSL
 
 #ifdef HAVE_LIBSSL
@@ -93,11 +118,22 @@ private:
   SSL* ssl;
 
   int sslHandleEAGAIN(int ret);
+
+  // Called by OpenSSL when a new session is established. In TLSv1.3,
+  // this happens after the handshake.
+  static int newTLSSessionCallback(SSL* ssl, SSL_SESSION* session);
 #endif // HAVE_LIBSSL
 #ifdef HAVE_LIBGNUTLS
   gnutls_session_t sslSession_;
 
+  // True if the session data should be stored again after the first
+  // application data is read.
+  bool tlsSessionRefreshPending_;
+
   void gnutlsRecordCheckDirection();
+
+  // Stores the session data of sslSession_ in tlsSessionCache_.
+  void storeTLSSession();
 #endif // HAVE_LIBGNUTLS
 
   void init();
@@ -245,6 +281,25 @@ public:
   ssize_t writeData(const char* data, size_t len,
                     const std::string& host, uint16_t port);
 
+  // Writes iovcnt buffers in iov, in order, with a single system call
+  // if possible. iovcnt must be in range [1, A2_IOV_MAX]. Like
+  // writeData(), the data may be written partially and the size of
+  // written data is returned. If writev(2) is not available or the
+  // socket is secure, the buffers are written by writeData() one by
+  // one.
+  ssize_t writeVector(const a2iovec* iov, size_t iovcnt);
+
+  // Returns true if sendFile() can be used for this socket. This
+  // requires sendfile(2) and a socket which is not secure.
+  bool isSendFileAvailable() const;
+
+  // Sends up to len bytes at offset of the file fd without copying
+  // them to user space. Like writeData(), returns the size of written
+  // data and sets wantWrite_ if the socket gets EAGAIN.  Returns 0 if
+  // the end of file is reached. Call this function only when
+  // isSendFileAvailable() returns true.
+  ssize_t sendFile(int fd, off_t offset, size_t len);
+
   ssize_t writeData(const unsigned char* data, size_t len,
                     const std::string& host,
                     uint16_t port)
@@ -286,6 +341,20 @@ public:
     return readDataFrom(reinterpret_cast<char*>(data), len, sender);
   }
 
+  // Reads at most num datagrams into dgrams and returns the number of
+  // datagrams read. dgrams[i].length must be the capacity of
+  // dgrams[i].data. Up to A2_MMSG_MAX datagrams are read with one
+  // system call if recvmmsg(2) is available. Otherwise, recvfrom(2)
+  // is called for each datagram.
+  size_t readDatagrams(Datagram* dgrams, size_t num);
+
+  // Writes at most num datagrams in dgrams to their addresses and
+  // returns the number of datagrams written. Up to A2_MMSG_MAX
+  // datagrams are written with one system call if sendmmsg(2) is
+  // available. Otherwise, sendto(2) is called for each datagram. If
+  // writing the first datagram fails, exception is thrown.
+  size_t writeDatagrams(const Datagram* dgrams, size_t num);
+
   /**
    * Makes this socket secure.
    * If the system has not OpenSSL, then this method do nothing.
@@ -295,7 +364,13 @@ public:
    */
   bool initiateSecureConnection(const std::string& hostname="");
 
-  void prepareSecureConnection();
+  // Prepares TLS session. Every TLS connection passes the engine's
+  // sessionCache and the host and port of the server, so that the
+  // session stored for them is resumed and the new session is stored
+  // there after the handshake. sessionCache may be null.
+  void prepareSecureConnection
+  (const SharedHandle<TLSSessionCache>& sessionCache,
+   const std::string& hostname, uint16_t port);
 
   bool operator==(const SocketCore& s) {
     return sockfd_ == s.sockfd_;
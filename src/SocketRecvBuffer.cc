@@ -35,9 +35,13 @@
 #include "SocketRecvBuffer.h"
 
 #include <cstring>
+#include <cassert>
+#include <algorithm>
 
 #include "SocketCore.h"
+#include "RecoverableException.h"
 #include "LogFactory.h"
+#include "fmt.h"
 
 namespace aria2 {
 
@@ -45,7 +49,9 @@ SocketRecvBuffer::SocketRecvBuffer
 (const SharedHandle<SocketCore>& socket,
  size_t capacity)
   : socket_(socket),
+    initialCapacity_(capacity),
     capacity_(capacity),
+    maxCapacity_(capacity),
     buf_(new unsigned char[capacity_]),
     bufLen_(0)
 {}
@@ -61,12 +67,70 @@ ssize_t SocketRecvBuffer::recv()
   if(len > 0) {
     socket_->readData(buf_+bufLen_, len);
     bufLen_ += len;
+    if(bufLen_ == capacity_) {
+      updateCapacity(capacity_, capacity_);
+    }
   } else {
     A2_LOG_DEBUG("Buffer full");
   }
   return len;
 }
 
+void SocketRecvBuffer::updateCapacity(size_t capacity, size_t len)
+{
+  if(len < capacity || capacity < capacity_ || capacity_ >= maxCapacity_) {
+    return;
+  }
+  size_t newCapacity = std::min(capacity_*2, maxCapacity_);
+  unsigned char* buf = new unsigned char[newCapacity];
+  memcpy(buf, buf_, bufLen_);
+  delete [] buf_;
+  buf_ = buf;
+  capacity_ = newCapacity;
+  A2_LOG_DEBUG(fmt("Receive buffer grew to %lu bytes",
+                   static_cast<unsigned long>(capacity_)));
+}
+
+unsigned char* SocketRecvBuffer::recvOwned(size_t& len)
+{
+  size_t capacity = len;
+  unsigned char* buf = new unsigned char[capacity];
+  try {
+    socket_->readData(buf, len);
+  } catch(RecoverableException& e) {
+    delete [] buf;
+    throw;
+  }
+  updateCapacity(capacity, len);
+  if(len == 0) {
+    delete [] buf;
+    return 0;
+  }
+  if(len < capacity) {
+    unsigned char* data = new unsigned char[len];
+    memcpy(data, buf, len);
+    delete [] buf;
+    return data;
+  }
+  return buf;
+}
+
+void SocketRecvBuffer::resetCapacity()
+{
+  maxCapacity_ = initialCapacity_;
+  size_t newCapacity = std::max(initialCapacity_, bufLen_);
+  if(newCapacity >= capacity_) {
+    return;
+  }
+  unsigned char* buf = new unsigned char[newCapacity];
+  memcpy(buf, buf_, bufLen_);
+  delete [] buf_;
+  buf_ = buf;
+  capacity_ = newCapacity;
+  A2_LOG_DEBUG(fmt("Receive buffer shrank to %lu bytes",
+                   static_cast<unsigned long>(capacity_)));
+}
+
 void SocketRecvBuffer::shiftBuffer(size_t offset)
 {
   assert(offset <= bufLen_);
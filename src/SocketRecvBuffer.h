@@ -51,6 +51,25 @@ public:
   // Reads data from socket as much as capacity allows. Returns the
   // number of bytes read.
   ssize_t recv();
+  // Tells this object that len bytes were read from socket when
+  // capacity bytes were requested. If the read filled whole
+  // capacity, the socket probably has more data, so the capacity is
+  // doubled up to the maximum capacity. recv() calls this function
+  // internally. Call this function when data is read from socket
+  // without using this object.
+  void updateCapacity(size_t capacity, size_t len);
+  // Reads at most len bytes from socket into a newly allocated
+  // buffer instead of the buffer of this object, so that the data can
+  // be handed over without copying. On return, len is the number of
+  // bytes read. Data of a short read is copied into a buffer of its
+  // size, so the returned buffer has no unused space. Returns 0 if no
+  // data was read. Otherwise, the caller must delete[] the returned
+  // buffer. The capacity is updated as recv() does.
+  unsigned char* recvOwned(size_t& len);
+  // Shrinks the buffer to the initial capacity and makes it the
+  // maximum capacity again. If the buffer holds more data than the
+  // initial capacity, it is shrunk to the length of the data.
+  void resetCapacity();
   // Shifts buffer by offset bytes. offset must satisfy offset <=
   // getBufferLength().
   void shiftBuffer(size_t offset);
@@ -60,6 +79,18 @@ public:
     bufLen_ = 0;
   }
 
+  size_t getCapacity() const
+  {
+    return capacity_;
+  }
+
+  // Sets the maximum capacity. By default, it is the same as the
+  // initial capacity and the buffer never grows.
+  void setMaxCapacity(size_t maxCapacity)
+  {
+    maxCapacity_ = maxCapacity;
+  }
+
   const SharedHandle<SocketCore>& getSocket() const
   {
     return socket_;
@@ -81,7 +112,9 @@ public:
   }
 private:
   SharedHandle<SocketCore> socket_;
+  size_t initialCapacity_;
   size_t capacity_;
+  size_t maxCapacity_;
   unsigned char* buf_;
   size_t bufLen_;
 };
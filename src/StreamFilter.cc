@@ -33,6 +33,7 @@
  */
 /* copyright --> */
 #include "StreamFilter.h"
+#include "array_fun.h"
 
 namespace aria2 {
 
@@ -42,6 +43,15 @@ StreamFilter::StreamFilter
 
 StreamFilter::~StreamFilter() {}
 
+ssize_t StreamFilter::transformOwned
+(const SharedHandle<BinaryStream>& out,
+ const SharedHandle<Segment>& segment,
+ unsigned char* inbuf, size_t inlen)
+{
+  array_ptr<unsigned char> buf(inbuf);
+  return transform(out, segment, inbuf, inlen);
+}
+
 bool StreamFilter::installDelegate(const SharedHandle<StreamFilter>& filter)
 {
   if(!delegate_) {
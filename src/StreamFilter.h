@@ -61,6 +61,21 @@ public:
                             const SharedHandle<Segment>& segment,
                             const unsigned char* inbuf, size_t inlen) = 0;
 
+  // Same as transform() but takes ownership of inbuf, which must be
+  // allocated by new[]. The default implementation calls transform()
+  // and deletes inbuf.
+  virtual ssize_t transformOwned(const SharedHandle<BinaryStream>& out,
+                                 const SharedHandle<Segment>& segment,
+                                 unsigned char* inbuf, size_t inlen);
+
+  // Returns true if transformOwned() can keep inbuf without copying
+  // it for segment. The producer can then hand its output buffer over
+  // instead of reusing it.
+  virtual bool acceptsOwnedBuffer(const SharedHandle<Segment>& segment) const
+  {
+    return false;
+  }
+
   virtual bool finished() = 0;
 
   // The call of release() will free allocated resources.
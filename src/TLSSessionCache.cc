@@ -0,0 +1,113 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "TLSSessionCache.h"
+#include "wallclock.h"
+
+namespace aria2 {
+
+TLSSessionCache::CacheEntry::CacheEntry
+(const std::string& hostname, uint16_t port, const std::string& session)
+  : hostname_(hostname),
+    port_(port),
+    session_(session),
+    registeredTime_(global::wallclock)
+{}
+
+TLSSessionCache::TLSSessionCache(size_t maxSize, time_t timeout)
+  : maxSize_(maxSize),
+    timeout_(timeout),
+    numHit_(0),
+    numMiss_(0)
+{}
+
+TLSSessionCache::~TLSSessionCache() {}
+
+std::deque<TLSSessionCache::CacheEntry>::iterator TLSSessionCache::find
+(const std::string& hostname, uint16_t port)
+{
+  for(std::deque<CacheEntry>::iterator i = entries_.begin(),
+        eoi = entries_.end(); i != eoi; ++i) {
+    if((*i).port_ == port && (*i).hostname_ == hostname) {
+      return i;
+    }
+  }
+  return entries_.end();
+}
+
+bool TLSSessionCache::find
+(std::string& session, const std::string& hostname, uint16_t port)
+{
+  std::deque<CacheEntry>::iterator i = find(hostname, port);
+  if(i != entries_.end() &&
+     (*i).registeredTime_.difference(global::wallclock) >= timeout_) {
+    entries_.erase(i);
+    i = entries_.end();
+  }
+  if(i == entries_.end()) {
+    ++numMiss_;
+    return false;
+  }
+  ++numHit_;
+  session = (*i).session_;
+  if(i != entries_.begin()) {
+    CacheEntry e = *i;
+    entries_.erase(i);
+    entries_.push_front(e);
+  }
+  return true;
+}
+
+void TLSSessionCache::put
+(const std::string& hostname, uint16_t port, const std::string& session)
+{
+  std::deque<CacheEntry>::iterator i = find(hostname, port);
+  if(i != entries_.end()) {
+    entries_.erase(i);
+  }
+  entries_.push_front(CacheEntry(hostname, port, session));
+  if(entries_.size() > maxSize_) {
+    entries_.pop_back();
+  }
+}
+
+void TLSSessionCache::remove(const std::string& hostname, uint16_t port)
+{
+  std::deque<CacheEntry>::iterator i = find(hostname, port);
+  if(i != entries_.end()) {
+    entries_.erase(i);
+  }
+}
+
+} // namespace aria2
@@ -0,0 +1,111 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2006 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_TLS_SESSION_CACHE_H
+#define D_TLS_SESSION_CACHE_H
+
+#include "common.h"
+
+#include <string>
+#include <deque>
+
+#include "TimerA2.h"
+
+namespace aria2 {
+
+// Caches TLS sessions per host and port so that reconnecting to the
+// same server can resume the session instead of doing a full
+// handshake. The session is stored as the serialized form produced by
+// the TLS library, so this class does not depend on it.
+class TLSSessionCache {
+private:
+  struct CacheEntry {
+    std::string hostname_;
+    uint16_t port_;
+    std::string session_;
+    Timer registeredTime_;
+
+    CacheEntry(const std::string& hostname, uint16_t port,
+               const std::string& session);
+  };
+
+  // The most recently used entry comes first.
+  std::deque<CacheEntry> entries_;
+
+  size_t maxSize_;
+
+  time_t timeout_;
+
+  size_t numHit_;
+
+  size_t numMiss_;
+
+  std::deque<CacheEntry>::iterator find
+  (const std::string& hostname, uint16_t port);
+public:
+  // At most maxSize sessions are kept. A session is discarded timeout
+  // seconds after it was stored.
+  TLSSessionCache(size_t maxSize = 256, time_t timeout = 3600);
+
+  ~TLSSessionCache();
+
+  // Stores the session for hostname and port in session and returns
+  // true if it is found. Otherwise returns false.
+  bool find(std::string& session, const std::string& hostname, uint16_t port);
+
+  // Stores session for hostname and port, replacing the existing one.
+  void put
+  (const std::string& hostname, uint16_t port, const std::string& session);
+
+  void remove(const std::string& hostname, uint16_t port);
+
+  size_t size() const
+  {
+    return entries_.size();
+  }
+
+  size_t countHit() const
+  {
+    return numHit_;
+  }
+
+  size_t countMiss() const
+  {
+    return numMiss_;
+  }
+};
+
+} // namespace aria2
+
+#endif // D_TLS_SESSION_CACHE_H
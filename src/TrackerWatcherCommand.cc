@@ -63,9 +63,127 @@
 #include "a2functional.h"
 #include "util.h"
 #include "fmt.h"
+#include "UDPTrackerClient.h"
+#include "UDPTrackerRequest.h"
+#include "UDPTrackerCommand.h"
+#include "UDPTrackerNameResolveCommand.h"
 
 namespace aria2 {
 
+HTTPAnnRequest::HTTPAnnRequest(const SharedHandle<RequestGroup>& rg)
+  : rg_(rg)
+{}
+
+HTTPAnnRequest::~HTTPAnnRequest()
+{}
+
+bool HTTPAnnRequest::stopped() const
+{
+  return rg_->getNumCommand() == 0;
+}
+
+bool HTTPAnnRequest::success() const
+{
+  return rg_->downloadFinished();
+}
+
+void HTTPAnnRequest::stop(DownloadEngine* e)
+{
+  rg_->setForceHaltRequested(true);
+}
+
+bool HTTPAnnRequest::issue(DownloadEngine* e)
+{
+  try {
+    std::vector<Command*>* commands = new std::vector<Command*>();
+    auto_delete_container<std::vector<Command*> > commandsDel(commands);
+    rg_->createInitialCommand(*commands, e);
+    e->addCommand(*commands);
+    commands->clear();
+    A2_LOG_DEBUG("added tracker request command");
+    return true;
+  } catch(RecoverableException& ex) {
+    A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, ex);
+    return false;
+  }
+}
+
+bool HTTPAnnRequest::processResponse
+(const SharedHandle<BtAnnounce>& btAnnounce)
+{
+  try {
+    std::stringstream strm;
+    unsigned char data[2048];
+    rg_->getPieceStorage()->getDiskAdaptor()->openFile();
+    while(1) {
+      ssize_t dataLength = rg_->getPieceStorage()->
+        getDiskAdaptor()->readData(data, sizeof(data), strm.tellp());
+      if(dataLength == 0) {
+        break;
+      }
+      strm.write(reinterpret_cast<const char*>(data), dataLength);
+    }
+    std::string res = strm.str();
+    btAnnounce->processAnnounceResponse
+      (reinterpret_cast<const unsigned char*>(res.c_str()), res.size());
+    return true;
+  } catch(RecoverableException& e) {
+    A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
+    return false;
+  }
+}
+
+UDPAnnRequest::UDPAnnRequest
+(const SharedHandle<UDPTrackerClient>& client,
+ const SharedHandle<UDPTrackerRequest>& req)
+  : client_(client),
+    req_(req)
+{}
+
+UDPAnnRequest::~UDPAnnRequest()
+{}
+
+bool UDPAnnRequest::stopped() const
+{
+  return req_->state == UDPT_STA_COMPLETE;
+}
+
+bool UDPAnnRequest::success() const
+{
+  return req_->state == UDPT_STA_COMPLETE &&
+    req_->error == UDPT_ERR_SUCCESS;
+}
+
+void UDPAnnRequest::stop(DownloadEngine* e)
+{
+  // UDPTrackerClient drops completed requests from its queues.
+  req_->state = UDPT_STA_COMPLETE;
+  req_->error = UDPT_ERR_SHUTDOWN;
+}
+
+bool UDPAnnRequest::issue(DownloadEngine* e)
+{
+  if(util::isNumericHost(req_->remoteAddr)) {
+    client_->addRequest(req_);
+  } else {
+    e->addCommand(new UDPTrackerNameResolveCommand(e->newCUID(), e, client_,
+                                                   req_));
+  }
+  return true;
+}
+
+bool UDPAnnRequest::processResponse
+(const SharedHandle<BtAnnounce>& btAnnounce)
+{
+  try {
+    btAnnounce->processUDPTrackerResponse(req_);
+    return true;
+  } catch(RecoverableException& e) {
+    A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
+    return false;
+  }
+}
+
 TrackerWatcherCommand::TrackerWatcherCommand
 (cuid_t cuid, RequestGroup* requestGroup, DownloadEngine* e)
   : Command(cuid),
@@ -78,17 +196,20 @@ TrackerWatcherCommand::TrackerWatcherCommand
 TrackerWatcherCommand::~TrackerWatcherCommand()
 {
   requestGroup_->decreaseNumCommand();
+  if(udpTrackerClient_) {
+    udpTrackerClient_->decreaseWatchers();
+  }
 }
 
 bool TrackerWatcherCommand::execute() {
   if(requestGroup_->isForceHaltRequested()) {
-    if(!trackerRequestGroup_) {
+    if(!trackerRequest_) {
       return true;
-    } else if(trackerRequestGroup_->getNumCommand() == 0 ||
-              trackerRequestGroup_->downloadFinished()) {
+    } else if(trackerRequest_->stopped() ||
+              trackerRequest_->success()) {
       return true;
     } else {
-      trackerRequestGroup_->setForceHaltRequested(true);
+      trackerRequest_->stop(e_);
       e_->addCommand(this);
       return false;
     }
@@ -97,71 +218,42 @@ bool TrackerWatcherCommand::execute() {
     A2_LOG_DEBUG("no more announce");
     return true;
   }
-  if(!trackerRequestGroup_) {
-    trackerRequestGroup_ = createAnnounce();
-    if(trackerRequestGroup_) {
-      try {
-        std::vector<Command*>* commands = new std::vector<Command*>();
-        auto_delete_container<std::vector<Command*> > commandsDel(commands);
-        trackerRequestGroup_->createInitialCommand(*commands, e_);
-        e_->addCommand(*commands);
-        commands->clear();
-        A2_LOG_DEBUG("added tracker request command");
-      } catch(RecoverableException& ex) {
-        A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, ex);
-      }
+  if(!trackerRequest_) {
+    trackerRequest_ = createAnnounce();
+    if(trackerRequest_) {
+      trackerRequest_->issue(e_);
+      A2_LOG_DEBUG("tracker request created");
     }
-  } else if(trackerRequestGroup_->downloadFinished()){
-    try {
-      std::string trackerResponse = getTrackerResponse(trackerRequestGroup_);
-
-      processTrackerResponse(trackerResponse);
-      btAnnounce_->announceSuccess();
-      btAnnounce_->resetAnnounce();
-    } catch(RecoverableException& ex) {
-      A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, ex);      
-      btAnnounce_->announceFailure();
+  } else if(trackerRequest_->stopped()) {
+    // For HTTP tracker, stopped() waits until getNumCommand() == 0.
+    // Because we reset trackerRequest_, if its RequestGroup is still
+    // used in other Command, we will get Segmentation fault.
+    if(trackerRequest_->success()) {
+      if(trackerRequest_->processResponse(btAnnounce_)) {
+        btAnnounce_->announceSuccess();
+        btAnnounce_->resetAnnounce();
+        addConnection();
+      } else {
+        btAnnounce_->announceFailure();
+        if(btAnnounce_->isAllAnnounceFailed()) {
+          btAnnounce_->resetAnnounce();
+        }
+      }
+    } else {
+      // handle errors here
+      btAnnounce_->announceFailure(); // inside it, trackers = 0.
       if(btAnnounce_->isAllAnnounceFailed()) {
         btAnnounce_->resetAnnounce();
       }
     }
-    trackerRequestGroup_.reset();
-  } else if(trackerRequestGroup_->getNumCommand() == 0){
-    // handle errors here
-    btAnnounce_->announceFailure(); // inside it, trackers = 0.
-    trackerRequestGroup_.reset();
-    if(btAnnounce_->isAllAnnounceFailed()) {
-      btAnnounce_->resetAnnounce();
-    }
+    trackerRequest_.reset();
   }
   e_->addCommand(this);
   return false;
 }
 
-std::string TrackerWatcherCommand::getTrackerResponse
-(const SharedHandle<RequestGroup>& requestGroup)
+void TrackerWatcherCommand::addConnection()
 {
-  std::stringstream strm;
-  unsigned char data[2048];
-  requestGroup->getPieceStorage()->getDiskAdaptor()->openFile();
-  while(1) {
-    ssize_t dataLength = requestGroup->getPieceStorage()->
-      getDiskAdaptor()->readData(data, sizeof(data), strm.tellp());
-    if(dataLength == 0) {
-      break;
-    }
-    strm.write(reinterpret_cast<const char*>(data), dataLength);
-  }
-  return strm.str();
-}
-
-// TODO we have to deal with the exception thrown By BtAnnounce
-void TrackerWatcherCommand::processTrackerResponse
-(const std::string& trackerResponse)
-{
-  btAnnounce_->processAnnounceResponse
-    (reinterpret_cast<const unsigned char*>(trackerResponse.c_str()),
-     trackerResponse.size());
   while(!btRuntime_->isHalt() && btRuntime_->lessThanMinPeers()) {
     SharedHandle<Peer> peer = peerStorage_->getUnusedPeer();
     if(!peer) {
@@ -180,13 +272,93 @@ void TrackerWatcherCommand::processTrackerResponse
   }
 }
 
-SharedHandle<RequestGroup> TrackerWatcherCommand::createAnnounce() {
-  SharedHandle<RequestGroup> rg;
-  if(btAnnounce_->isAnnounceReady()) {
-    rg = createRequestGroup(btAnnounce_->getAnnounceUrl());
-    btAnnounce_->announceStart(); // inside it, trackers++.
+namespace {
+// Parses UDP tracker URI, which is udp://host:port/..., and stores
+// host and port. Returns false if uri is malformed.
+bool parseUDPTrackerUri
+(std::string& host, uint16_t& port, const std::string& uri)
+{
+  std::string::const_iterator first = uri.begin()+6; // skip "udp://"
+  std::string::const_iterator last = first;
+  for(; last != uri.end() && *last != '/' && *last != '?'; ++last);
+  std::string authority(first, last);
+  std::string::size_type portSep;
+  if(!authority.empty() && authority[0] == '[') {
+    std::string::size_type rbracket = authority.find(']');
+    if(rbracket == std::string::npos) {
+      return false;
+    }
+    host = authority.substr(1, rbracket-1);
+    portSep = rbracket+1;
+    if(portSep == authority.size() || authority[portSep] != ':') {
+      return false;
+    }
+  } else {
+    portSep = authority.rfind(':');
+    if(portSep == std::string::npos) {
+      return false;
+    }
+    host = authority.substr(0, portSep);
+  }
+  uint32_t portNum;
+  if(host.empty() ||
+     !util::parseUIntNoThrow(portNum, authority.substr(portSep+1)) ||
+     portNum == 0 || portNum > 65535) {
+    return false;
+  }
+  port = portNum;
+  return true;
+}
+} // namespace
+
+SharedHandle<AnnRequest> TrackerWatcherCommand::createAnnounce() {
+  SharedHandle<AnnRequest> treq;
+  while(!btAnnounce_->isAllAnnounceFailed() &&
+        btAnnounce_->isAnnounceReady()) {
+    std::string uri = btAnnounce_->getAnnounceUrl();
+    if(util::startsWith(uri, "udp://")) {
+      std::string host;
+      uint16_t port;
+      if(parseUDPTrackerUri(host, port, uri)) {
+        treq = createUDPAnnRequest(host, port);
+      } else {
+        A2_LOG_ERROR(fmt("Bad UDP tracker URI %s", uri.c_str()));
+      }
+    } else {
+      treq = createHTTPAnnRequest(uri);
+    }
+    if(treq) {
+      btAnnounce_->announceStart(); // inside it, trackers++.
+      break;
+    }
+    // Could not issue request for this tracker. Try next one.
+    btAnnounce_->announceFailure();
+  }
+  if(btAnnounce_->isAllAnnounceFailed()) {
+    btAnnounce_->resetAnnounce();
+  }
+  return treq;
+}
+
+SharedHandle<AnnRequest>
+TrackerWatcherCommand::createUDPAnnRequest
+(const std::string& host, uint16_t port)
+{
+  SharedHandle<UDPTrackerRequest> req =
+    btAnnounce_->createUDPTrackerRequest(host, port);
+  if(!req) {
+    return SharedHandle<AnnRequest>();
+  }
+  if(!udpTrackerClient_) {
+    try {
+      udpTrackerClient_ = UDPTrackerCommand::getClient(e_);
+    } catch(RecoverableException& ex) {
+      A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, ex);
+      return SharedHandle<AnnRequest>();
+    }
+    udpTrackerClient_->increaseWatchers();
   }
-  return rg;
+  return SharedHandle<AnnRequest>(new UDPAnnRequest(udpTrackerClient_, req));
 }
 
 namespace {
@@ -209,8 +381,8 @@ bool backupTrackerIsAvailable
 }
 } // namespace
 
-SharedHandle<RequestGroup>
-TrackerWatcherCommand::createRequestGroup(const std::string& uri)
+SharedHandle<AnnRequest>
+TrackerWatcherCommand::createHTTPAnnRequest(const std::string& uri)
 {
   std::vector<std::string> uris;
   uris.push_back(uri);
@@ -247,7 +419,7 @@ TrackerWatcherCommand::createRequestGroup(const std::string& uri)
   util::removeMetalinkContentTypes(rg);
   A2_LOG_INFO(fmt("Creating tracker request group GID#%s",
                   util::itos(rg->getGID()).c_str()));
-  return rg;
+  return SharedHandle<AnnRequest>(new HTTPAnnRequest(rg));
 }
 
 void TrackerWatcherCommand::setBtRuntime
@@ -0,0 +1,446 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "UDPTrackerClient.h"
+
+#include <cstring>
+
+#include "UDPTrackerRequest.h"
+#include "bittorrent_helper.h"
+#include "util.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+namespace {
+// Magic constant of BEP 15 connect request
+const int64_t UDPT_INITIAL_CONNECTION_ID = 0x41727101980LL;
+} // namespace
+
+namespace {
+int64_t getLLIntParam(const unsigned char* data, size_t pos)
+{
+  uint64_t hi = bittorrent::getIntParam(data, pos);
+  uint64_t lo = bittorrent::getIntParam(data, pos+4);
+  return static_cast<int64_t>((hi << 32) | lo);
+}
+} // namespace
+
+namespace {
+void setLLIntParam(unsigned char* dest, int64_t param)
+{
+  uint64_t v = static_cast<uint64_t>(param);
+  bittorrent::setIntParam(dest, static_cast<uint32_t>(v >> 32));
+  bittorrent::setIntParam(dest+4, static_cast<uint32_t>(v & 0xffffffffu));
+}
+} // namespace
+
+UDPTrackerClient::UDPTrackerClient()
+  : numWatchers_(0)
+{}
+
+UDPTrackerClient::~UDPTrackerClient()
+{
+  for(std::deque<SharedHandle<UDPTrackerRequest> >::iterator i =
+        pendingRequests_.begin(), eoi = pendingRequests_.end(); i != eoi; ++i) {
+    (*i)->state = UDPT_STA_COMPLETE;
+    (*i)->error = UDPT_ERR_SHUTDOWN;
+  }
+  for(std::deque<SharedHandle<UDPTrackerRequest> >::iterator i =
+        connectRequests_.begin(), eoi = connectRequests_.end(); i != eoi; ++i) {
+    (*i)->state = UDPT_STA_COMPLETE;
+    (*i)->error = UDPT_ERR_SHUTDOWN;
+  }
+  for(std::list<SharedHandle<UDPTrackerRequest> >::iterator i =
+        inflightRequests_.begin(), eoi = inflightRequests_.end(); i != eoi;
+      ++i) {
+    (*i)->state = UDPT_STA_COMPLETE;
+    (*i)->error = UDPT_ERR_SHUTDOWN;
+  }
+}
+
+void UDPTrackerClient::addRequest(const SharedHandle<UDPTrackerRequest>& req)
+{
+  req->state = UDPT_STA_PENDING;
+  req->error = UDPT_ERR_SUCCESS;
+  req->failCount = 0;
+  pendingRequests_.push_back(req);
+}
+
+SharedHandle<UDPTrackerRequest> UDPTrackerClient::findInflightRequest
+(const std::string& remoteAddr, uint16_t remotePort, int32_t transactionId,
+ bool remove)
+{
+  for(std::list<SharedHandle<UDPTrackerRequest> >::iterator i =
+        inflightRequests_.begin(), eoi = inflightRequests_.end(); i != eoi;
+      ++i) {
+    if((*i)->remoteAddr == remoteAddr && (*i)->remotePort == remotePort &&
+       (*i)->transactionId == transactionId) {
+      SharedHandle<UDPTrackerRequest> req = *i;
+      if(remove) {
+        inflightRequests_.erase(i);
+      }
+      return req;
+    }
+  }
+  return SharedHandle<UDPTrackerRequest>();
+}
+
+void UDPTrackerClient::failConnect
+(const std::string& remoteAddr, uint16_t remotePort, int error)
+{
+  connectionIdCache_.erase(std::make_pair(remoteAddr, remotePort));
+  for(std::deque<SharedHandle<UDPTrackerRequest> >::iterator i =
+        connectRequests_.begin(); i != connectRequests_.end();) {
+    if((*i)->remoteAddr == remoteAddr && (*i)->remotePort == remotePort) {
+      (*i)->state = UDPT_STA_COMPLETE;
+      (*i)->error = error;
+      i = connectRequests_.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+int UDPTrackerClient::receiveReply
+(const unsigned char* data, size_t length, const std::string& remoteAddr,
+ uint16_t remotePort, const Timer& now)
+{
+  if(length < 8) {
+    return -1;
+  }
+  int32_t action = bittorrent::getIntParam(data, 0);
+  int32_t transactionId = bittorrent::getIntParam(data, 4);
+  SharedHandle<UDPTrackerRequest> req =
+    findInflightRequest(remoteAddr, remotePort, transactionId, true);
+  if(!req) {
+    return -1;
+  }
+  req->reply.reset(new UDPTrackerReply());
+  req->reply->action = action;
+  req->reply->transactionId = transactionId;
+  req->state = UDPT_STA_COMPLETE;
+  req->error = UDPT_ERR_SUCCESS;
+  if(action == UDPT_ACT_CONNECT && req->action == UDPT_ACT_CONNECT &&
+     length >= 16) {
+    int64_t connectionId = getLLIntParam(data, 8);
+    A2_LOG_INFO(fmt("UDPT received CONNECT reply from %s:%u TRID=%08x,"
+                    " connectionId=%016llx",
+                    remoteAddr.c_str(), remotePort, transactionId,
+                    static_cast<unsigned long long>(connectionId)));
+    setConnectionId(remoteAddr, remotePort, connectionId, now);
+    // Put back the requests waiting for this connection in their
+    // original order.
+    for(std::deque<SharedHandle<UDPTrackerRequest> >::reverse_iterator i =
+          connectRequests_.rbegin(), eoi = connectRequests_.rend(); i != eoi;
+        ++i) {
+      if((*i)->remoteAddr == remoteAddr && (*i)->remotePort == remotePort) {
+        pendingRequests_.push_front(*i);
+      }
+    }
+    for(std::deque<SharedHandle<UDPTrackerRequest> >::iterator i =
+          connectRequests_.begin(); i != connectRequests_.end();) {
+      if((*i)->remoteAddr == remoteAddr && (*i)->remotePort == remotePort) {
+        i = connectRequests_.erase(i);
+      } else {
+        ++i;
+      }
+    }
+  } else if(action == UDPT_ACT_ANNOUNCE && req->action == UDPT_ACT_ANNOUNCE &&
+            length >= 20) {
+    req->reply->interval = bittorrent::getIntParam(data, 8);
+    req->reply->leechers = bittorrent::getIntParam(data, 12);
+    req->reply->seeders = bittorrent::getIntParam(data, 16);
+    // IPv6 trackers return 18 bytes compact peers (BEP 15).
+    int family =
+      remoteAddr.find(':') == std::string::npos ? AF_INET : AF_INET6;
+    size_t compactLen = bittorrent::getCompactLength(family);
+    for(size_t i = 20; i+compactLen <= length; i += compactLen) {
+      std::pair<std::string, uint16_t> hostport =
+        bittorrent::unpackcompact(data+i, family);
+      if(!hostport.first.empty()) {
+        req->reply->peers.push_back(hostport);
+      }
+    }
+    A2_LOG_INFO(fmt("UDPT received ANNOUNCE reply from %s:%u TRID=%08x,"
+                    " interval=%d, leechers=%d, seeders=%d, num_peers=%d",
+                    remoteAddr.c_str(), remotePort, transactionId,
+                    req->reply->interval, req->reply->leechers,
+                    req->reply->seeders,
+                    static_cast<int>(req->reply->peers.size())));
+  } else {
+    if(action == UDPT_ACT_ERROR) {
+      req->reply->errorMessage.assign(&data[8], &data[length]);
+      A2_LOG_INFO(fmt("UDPT received ERROR reply from %s:%u TRID=%08x, %s",
+                      remoteAddr.c_str(), remotePort, transactionId,
+                      req->reply->errorMessage.c_str()));
+    } else {
+      A2_LOG_INFO(fmt("UDPT received malformed %s reply from %s:%u"
+                      " TRID=%08x",
+                      getUDPTrackerActionStr(action),
+                      remoteAddr.c_str(), remotePort, transactionId));
+    }
+    req->error = UDPT_ERR_TRACKER;
+    if(req->action == UDPT_ACT_CONNECT) {
+      failConnect(remoteAddr, remotePort, UDPT_ERR_TRACKER);
+    }
+  }
+  return 0;
+}
+
+ssize_t UDPTrackerClient::createRequest
+(unsigned char* data, size_t length, std::string& remoteAddr,
+ uint16_t& remotePort, const Timer& now)
+{
+  while(!pendingRequests_.empty()) {
+    SharedHandle<UDPTrackerRequest> req = pendingRequests_.front();
+    if(req->state == UDPT_STA_COMPLETE) {
+      // Cancelled by the owner.
+      pendingRequests_.pop_front();
+      continue;
+    }
+    remoteAddr = req->remoteAddr;
+    remotePort = req->remotePort;
+    if(req->action == UDPT_ACT_CONNECT) {
+      return createUDPTrackerConnect(data, length, req);
+    }
+    UDPTrackerConnection* c = getConnectionId(remoteAddr, remotePort, now);
+    if(!c) {
+      SharedHandle<UDPTrackerRequest> creq(new UDPTrackerRequest());
+      creq->action = UDPT_ACT_CONNECT;
+      creq->remoteAddr = remoteAddr;
+      creq->remotePort = remotePort;
+      creq->transactionId = generateTransactionId();
+      connectionIdCache_[std::make_pair(remoteAddr, remotePort)] =
+        UDPTrackerConnection();
+      pendingRequests_.pop_front();
+      connectRequests_.push_back(req);
+      pendingRequests_.push_front(creq);
+      return createUDPTrackerConnect(data, length, creq);
+    }
+    if(c->state == UDPT_CST_CONNECTING) {
+      pendingRequests_.pop_front();
+      connectRequests_.push_back(req);
+      continue;
+    }
+    req->connectionId = c->connectionId;
+    req->transactionId = generateTransactionId();
+    return createUDPTrackerAnnounce(data, length, req);
+  }
+  return -1;
+}
+
+void UDPTrackerClient::requestSent(const Timer& now)
+{
+  if(pendingRequests_.empty()) {
+    return;
+  }
+  SharedHandle<UDPTrackerRequest> req = pendingRequests_.front();
+  pendingRequests_.pop_front();
+  A2_LOG_INFO(fmt("UDPT sent %s to %s:%u TRID=%08x",
+                  getUDPTrackerActionStr(req->action),
+                  req->remoteAddr.c_str(), req->remotePort,
+                  req->transactionId));
+  req->dispatched = now;
+  inflightRequests_.push_back(req);
+}
+
+void UDPTrackerClient::requestFail(int error)
+{
+  if(pendingRequests_.empty()) {
+    return;
+  }
+  SharedHandle<UDPTrackerRequest> req = pendingRequests_.front();
+  pendingRequests_.pop_front();
+  A2_LOG_INFO(fmt("UDPT failed to send %s to %s:%u",
+                  getUDPTrackerActionStr(req->action),
+                  req->remoteAddr.c_str(), req->remotePort));
+  req->state = UDPT_STA_COMPLETE;
+  req->error = error;
+  if(req->action == UDPT_ACT_CONNECT) {
+    failConnect(req->remoteAddr, req->remotePort, error);
+  }
+}
+
+void UDPTrackerClient::handleTimeout(const Timer& now)
+{
+  for(std::list<SharedHandle<UDPTrackerRequest> >::iterator i =
+        inflightRequests_.begin(); i != inflightRequests_.end();) {
+    SharedHandle<UDPTrackerRequest> req = *i;
+    if(req->state == UDPT_STA_COMPLETE) {
+      i = inflightRequests_.erase(i);
+      continue;
+    }
+    if(req->dispatched.difference(now) < getTimeout(req->failCount)) {
+      ++i;
+      continue;
+    }
+    i = inflightRequests_.erase(i);
+    if(req->failCount >= MAX_RETRY) {
+      A2_LOG_INFO(fmt("UDPT timeout %s to %s:%u TRID=%08x",
+                      getUDPTrackerActionStr(req->action),
+                      req->remoteAddr.c_str(), req->remotePort,
+                      req->transactionId));
+      req->state = UDPT_STA_COMPLETE;
+      req->error = UDPT_ERR_TIMEOUT;
+      if(req->action == UDPT_ACT_CONNECT) {
+        failConnect(req->remoteAddr, req->remotePort, UDPT_ERR_TIMEOUT);
+      }
+    } else {
+      ++req->failCount;
+      A2_LOG_INFO(fmt("UDPT retransmit %s to %s:%u (%d)",
+                      getUDPTrackerActionStr(req->action),
+                      req->remoteAddr.c_str(), req->remotePort,
+                      req->failCount));
+      pendingRequests_.push_back(req);
+    }
+  }
+}
+
+UDPTrackerConnection* UDPTrackerClient::getConnectionId
+(const std::string& remoteAddr, uint16_t remotePort, const Timer& now)
+{
+  ConnectionIdCache::iterator i =
+    connectionIdCache_.find(std::make_pair(remoteAddr, remotePort));
+  if(i == connectionIdCache_.end()) {
+    return 0;
+  }
+  if((*i).second.state == UDPT_CST_CONNECTED &&
+     (*i).second.lastUpdated.difference(now) >= CONNECTION_ID_TTL) {
+    connectionIdCache_.erase(i);
+    return 0;
+  }
+  return &(*i).second;
+}
+
+void UDPTrackerClient::setConnectionId
+(const std::string& remoteAddr, uint16_t remotePort, int64_t connectionId,
+ const Timer& now)
+{
+  connectionIdCache_[std::make_pair(remoteAddr, remotePort)] =
+    UDPTrackerConnection(UDPT_CST_CONNECTED, connectionId, now);
+}
+
+void UDPTrackerClient::increaseWatchers()
+{
+  ++numWatchers_;
+}
+
+void UDPTrackerClient::decreaseWatchers()
+{
+  --numWatchers_;
+}
+
+int32_t UDPTrackerClient::generateTransactionId()
+{
+  int32_t tid;
+  util::generateRandomData(reinterpret_cast<unsigned char*>(&tid),
+                           sizeof(tid));
+  return tid;
+}
+
+time_t UDPTrackerClient::getTimeout(int failCount)
+{
+  return 15*(1 << failCount);
+}
+
+ssize_t createUDPTrackerConnect
+(unsigned char* data, size_t length, const SharedHandle<UDPTrackerRequest>& req)
+{
+  if(length < 16) {
+    return -1;
+  }
+  setLLIntParam(data, UDPT_INITIAL_CONNECTION_ID);
+  bittorrent::setIntParam(&data[8], req->action);
+  bittorrent::setIntParam(&data[12], req->transactionId);
+  return 16;
+}
+
+ssize_t createUDPTrackerAnnounce
+(unsigned char* data, size_t length, const SharedHandle<UDPTrackerRequest>& req)
+{
+  if(length < 98 || req->infohash.size() != INFO_HASH_LENGTH ||
+     req->peerId.size() != PEER_ID_LENGTH) {
+    return -1;
+  }
+  setLLIntParam(data, req->connectionId);
+  bittorrent::setIntParam(&data[8], req->action);
+  bittorrent::setIntParam(&data[12], req->transactionId);
+  memcpy(&data[16], req->infohash.data(), INFO_HASH_LENGTH);
+  memcpy(&data[36], req->peerId.data(), PEER_ID_LENGTH);
+  setLLIntParam(&data[56], req->downloaded);
+  setLLIntParam(&data[64], req->left);
+  setLLIntParam(&data[72], req->uploaded);
+  bittorrent::setIntParam(&data[80], req->event);
+  // ip is already in network byte order.
+  memcpy(&data[84], &req->ip, sizeof(req->ip));
+  bittorrent::setIntParam(&data[88], req->key);
+  bittorrent::setIntParam(&data[92], req->numWant);
+  bittorrent::setShortIntParam(&data[96], req->port);
+  return 98;
+}
+
+const char* getUDPTrackerActionStr(int action)
+{
+  switch(action) {
+  case UDPT_ACT_CONNECT:
+    return "CONNECT";
+  case UDPT_ACT_ANNOUNCE:
+    return "ANNOUNCE";
+  case UDPT_ACT_ERROR:
+    return "ERROR";
+  default:
+    return "(unknown)";
+  }
+}
+
+const char* getUDPTrackerEventStr(int event)
+{
+  switch(event) {
+  case UDPT_EVT_NONE:
+    return "NONE";
+  case UDPT_EVT_COMPLETED:
+    return "COMPLETED";
+  case UDPT_EVT_STARTED:
+    return "STARTED";
+  case UDPT_EVT_STOPPED:
+    return "STOPPED";
+  default:
+    return "(unknown)";
+  }
+}
+
+} // namespace aria2
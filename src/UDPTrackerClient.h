@@ -0,0 +1,200 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_UDP_TRACKER_CLIENT_H
+#define D_UDP_TRACKER_CLIENT_H
+
+#include "common.h"
+
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+
+#include "SharedHandle.h"
+#include "TimerA2.h"
+
+namespace aria2 {
+
+struct UDPTrackerRequest;
+
+enum UDPTrackerConnectionState {
+  UDPT_CST_CONNECTING,
+  UDPT_CST_CONNECTED
+};
+
+struct UDPTrackerConnection {
+  int state;
+  int64_t connectionId;
+  Timer lastUpdated;
+  UDPTrackerConnection()
+    : state(UDPT_CST_CONNECTING),
+      connectionId(0),
+      lastUpdated(0)
+  {}
+  UDPTrackerConnection(int state, int64_t connectionId,
+                       const Timer& lastUpdated)
+    : state(state),
+      connectionId(connectionId),
+      lastUpdated(lastUpdated)
+  {}
+};
+
+// Client side of UDP tracker protocol (BEP 15). This class does not
+// own a socket: the caller feeds received datagrams to receiveReply()
+// and asks createRequest() for the next datagram to send. This makes
+// it possible to share one UDP socket among all torrents and to drive
+// the protocol without network in unit tests.
+class UDPTrackerClient {
+public:
+  UDPTrackerClient();
+  ~UDPTrackerClient();
+
+  // Queues req. The connect request is created internally when
+  // needed.
+  void addRequest(const SharedHandle<UDPTrackerRequest>& req);
+
+  // Processes datagram received from remoteAddr:remotePort. Returns 0
+  // if it matches in-flight request, or -1.
+  int receiveReply
+  (const unsigned char* data, size_t length, const std::string& remoteAddr,
+   uint16_t remotePort, const Timer& now);
+
+  // Writes the datagram of the next request to data and returns its
+  // length. The destination is stored in remoteAddr and
+  // remotePort. Returns -1 if there is nothing to send. The request
+  // stays in the queue until requestSent() or requestFail() is
+  // called.
+  ssize_t createRequest
+  (unsigned char* data, size_t length, std::string& remoteAddr,
+   uint16_t& remotePort, const Timer& now);
+
+  // Tells that the request returned by the last createRequest() was
+  // sent.
+  void requestSent(const Timer& now);
+
+  // Tells that the request returned by the last createRequest()
+  // could not be sent.
+  void requestFail(int error);
+
+  // Retransmits or fails in-flight requests whose timer expired.
+  void handleTimeout(const Timer& now);
+
+  // Returns cached connection for remoteAddr:remotePort, or 0. The
+  // expired connection is removed from the cache.
+  UDPTrackerConnection* getConnectionId
+  (const std::string& remoteAddr, uint16_t remotePort, const Timer& now);
+
+  void setConnectionId
+  (const std::string& remoteAddr, uint16_t remotePort, int64_t connectionId,
+   const Timer& now);
+
+  void increaseWatchers();
+
+  void decreaseWatchers();
+
+  int getNumWatchers() const
+  {
+    return numWatchers_;
+  }
+
+  bool noRequest() const
+  {
+    return pendingRequests_.empty() && connectRequests_.empty() &&
+      inflightRequests_.empty();
+  }
+
+  const std::deque<SharedHandle<UDPTrackerRequest> >&
+  getPendingRequests() const
+  {
+    return pendingRequests_;
+  }
+
+  const std::deque<SharedHandle<UDPTrackerRequest> >&
+  getConnectRequests() const
+  {
+    return connectRequests_;
+  }
+
+  const std::list<SharedHandle<UDPTrackerRequest> >&
+  getInflightRequests() const
+  {
+    return inflightRequests_;
+  }
+
+  // Timeout of the request which has been retransmitted failCount
+  // times: 15*2^failCount seconds.
+  static time_t getTimeout(int failCount);
+
+  // The number of retransmissions before the request fails.
+  static const int MAX_RETRY = 2;
+
+  // Lifetime of connection ID in seconds.
+  static const time_t CONNECTION_ID_TTL = 60;
+private:
+  SharedHandle<UDPTrackerRequest> findInflightRequest
+  (const std::string& remoteAddr, uint16_t remotePort, int32_t transactionId,
+   bool remove);
+
+  void failConnect
+  (const std::string& remoteAddr, uint16_t remotePort, int error);
+
+  int32_t generateTransactionId();
+
+  typedef std::map<std::pair<std::string, uint16_t>, UDPTrackerConnection>
+  ConnectionIdCache;
+  ConnectionIdCache connectionIdCache_;
+  // Requests waiting to be sent.
+  std::deque<SharedHandle<UDPTrackerRequest> > pendingRequests_;
+  // Requests waiting for the connect reply.
+  std::deque<SharedHandle<UDPTrackerRequest> > connectRequests_;
+  std::list<SharedHandle<UDPTrackerRequest> > inflightRequests_;
+  int numWatchers_;
+};
+
+// Writes BEP 15 packet for req to data, which must be at least
+// length bytes. Returns the number of bytes written, or -1.
+ssize_t createUDPTrackerConnect
+(unsigned char* data, size_t length, const SharedHandle<UDPTrackerRequest>& req);
+
+ssize_t createUDPTrackerAnnounce
+(unsigned char* data, size_t length, const SharedHandle<UDPTrackerRequest>& req);
+
+const char* getUDPTrackerActionStr(int action);
+
+const char* getUDPTrackerEventStr(int event);
+
+} // namespace aria2
+
+#endif // D_UDP_TRACKER_CLIENT_H
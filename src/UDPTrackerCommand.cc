@@ -0,0 +1,206 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "UDPTrackerCommand.h"
+#include "DownloadEngine.h"
+#include "RequestGroupMan.h"
+#include "BtRegistry.h"
+#include "UDPTrackerClient.h"
+#include "UDPTrackerRequest.h"
+#include "SocketCore.h"
+#include "DlAbortEx.h"
+#include "Option.h"
+#include "prefs.h"
+#include "A2STR.h"
+#include "message.h"
+#include "Logger.h"
+#include "LogFactory.h"
+#include "wallclock.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+UDPTrackerCommand::UDPTrackerCommand
+(cuid_t cuid, DownloadEngine* e,
+ const SharedHandle<SocketCore>& socket,
+ const SharedHandle<SocketCore>& socket6,
+ const SharedHandle<UDPTrackerClient>& client)
+  : Command(cuid),
+    e_(e),
+    socket_(socket),
+    socket6_(socket6),
+    client_(client)
+{
+  if(socket_) {
+    e_->addSocketForReadCheck(socket_, this);
+  }
+  if(socket6_) {
+    e_->addSocketForReadCheck(socket6_, this);
+  }
+}
+
+UDPTrackerCommand::~UDPTrackerCommand()
+{
+  if(socket_) {
+    e_->deleteSocketForReadCheck(socket_, this);
+  }
+  if(socket6_) {
+    e_->deleteSocketForReadCheck(socket6_, this);
+  }
+  if(e_->getBtRegistry()->getUDPTrackerClient().get() == client_.get()) {
+    e_->getBtRegistry()->setUDPTrackerClient
+      (SharedHandle<UDPTrackerClient>());
+  }
+}
+
+bool UDPTrackerCommand::execute()
+{
+  if((e_->getRequestGroupMan()->downloadFinished() || e_->isHaltRequested()) &&
+     client_->getNumWatchers() == 0) {
+    return true;
+  }
+  if(socket_) {
+    receiveReplies(socket_);
+  }
+  if(socket6_) {
+    receiveReplies(socket6_);
+  }
+  client_->handleTimeout(global::wallclock);
+  sendRequests();
+  e_->addCommand(this);
+  return false;
+}
+
+void UDPTrackerCommand::receiveReplies
+(const SharedHandle<SocketCore>& socket)
+{
+  unsigned char data[64*1024];
+  try {
+    for(size_t i = 0; i < 20; ++i) {
+      std::pair<std::string, uint16_t> remoteHost;
+      ssize_t length = socket->readDataFrom(data, sizeof(data), remoteHost);
+      if(length == 0) {
+        break;
+      }
+      if(client_->receiveReply(data, length, remoteHost.first,
+                               remoteHost.second, global::wallclock) == -1) {
+        A2_LOG_DEBUG(fmt("UDPT discarded unexpected datagram from %s:%u",
+                         remoteHost.first.c_str(), remoteHost.second));
+      }
+    }
+  } catch(RecoverableException& e) {
+    A2_LOG_INFO_EX("UDPT failed to receive datagram", e);
+  }
+}
+
+void UDPTrackerCommand::sendRequests()
+{
+  unsigned char data[100];
+  while(1) {
+    std::string remoteAddr;
+    uint16_t remotePort;
+    ssize_t length = client_->createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, global::wallclock);
+    if(length == -1) {
+      break;
+    }
+    const SharedHandle<SocketCore>& socket =
+      remoteAddr.find(':') == std::string::npos ? socket_ : socket6_;
+    if(!socket) {
+      A2_LOG_INFO(fmt("UDPT no socket to send datagram to %s:%u",
+                      remoteAddr.c_str(), remotePort));
+      client_->requestFail(UDPT_ERR_NETWORK);
+      continue;
+    }
+    try {
+      if(socket->writeData(data, length, remoteAddr, remotePort) == 0) {
+        // The socket buffer is full. Try again in the next turn.
+        break;
+      }
+      client_->requestSent(global::wallclock);
+    } catch(RecoverableException& e) {
+      A2_LOG_INFO_EX(fmt("UDPT failed to send datagram to %s:%u",
+                         remoteAddr.c_str(), remotePort), e);
+      client_->requestFail(UDPT_ERR_NETWORK);
+    }
+  }
+}
+
+namespace {
+// Opens non-blocking UDP socket of the given family. Returns null on
+// failure, so that one unavailable family does not disable UDP
+// tracker.
+SharedHandle<SocketCore> openSocket(int family)
+{
+  SharedHandle<SocketCore> socket(new SocketCore(SOCK_DGRAM));
+  try {
+    socket->bind(A2STR::NIL, 0, family);
+    socket->setNonBlockingMode();
+    std::pair<std::string, uint16_t> addr;
+    socket->getAddrInfo(addr);
+    A2_LOG_INFO(fmt("UDPT: listening to port %u (%s)", addr.second,
+                    family == AF_INET ? "IPv4" : "IPv6"));
+  } catch(RecoverableException& e) {
+    A2_LOG_INFO_EX(fmt("UDPT: failed to open %s socket",
+                       family == AF_INET ? "IPv4" : "IPv6"), e);
+    socket.reset();
+  }
+  return socket;
+}
+} // namespace
+
+SharedHandle<UDPTrackerClient> UDPTrackerCommand::getClient
+(DownloadEngine* e)
+{
+  SharedHandle<UDPTrackerClient> client =
+    e->getBtRegistry()->getUDPTrackerClient();
+  if(client) {
+    return client;
+  }
+  SharedHandle<SocketCore> socket = openSocket(AF_INET);
+  SharedHandle<SocketCore> socket6;
+  if(!e->getOption()->getAsBool(PREF_DISABLE_IPV6)) {
+    socket6 = openSocket(AF_INET6);
+  }
+  if(!socket && !socket6) {
+    throw DL_ABORT_EX("UDPT: failed to open UDP socket");
+  }
+  client.reset(new UDPTrackerClient());
+  e->addCommand(new UDPTrackerCommand(e->newCUID(), e, socket, socket6,
+                                      client));
+  e->getBtRegistry()->setUDPTrackerClient(client);
+  return client;
+}
+
+} // namespace aria2
@@ -0,0 +1,182 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "UDPTrackerNameResolveCommand.h"
+#include "DownloadEngine.h"
+#include "NameResolver.h"
+#include "DlAbortEx.h"
+#include "prefs.h"
+#include "message.h"
+#include "util.h"
+#include "Option.h"
+#include "UDPTrackerClient.h"
+#include "UDPTrackerRequest.h"
+#include "Logger.h"
+#include "LogFactory.h"
+#include "fmt.h"
+#ifdef ENABLE_ASYNC_DNS
+#include "AsyncNameResolver.h"
+#endif // ENABLE_ASYNC_DNS
+
+namespace aria2 {
+
+UDPTrackerNameResolveCommand::UDPTrackerNameResolveCommand
+(cuid_t cuid, DownloadEngine* e,
+ const SharedHandle<UDPTrackerClient>& client,
+ const SharedHandle<UDPTrackerRequest>& req)
+  : Command(cuid),
+    e_(e),
+    client_(client),
+    req_(req)
+{
+  setStatus(Command::STATUS_ONESHOT_REALTIME);
+}
+
+UDPTrackerNameResolveCommand::~UDPTrackerNameResolveCommand()
+{
+#ifdef ENABLE_ASYNC_DNS
+  disableNameResolverCheck(resolver_);
+#endif // ENABLE_ASYNC_DNS
+}
+
+bool UDPTrackerNameResolveCommand::execute()
+{
+  if(req_->state == UDPT_STA_COMPLETE) {
+    // Cancelled by UDPAnnRequest::stop().
+    return true;
+  }
+  const std::string& hostname = req_->remoteAddr;
+  std::string addr = e_->findCachedIPAddress(hostname, req_->remotePort);
+  if(!addr.empty()) {
+    onSuccess(addr);
+    return true;
+  }
+  int family;
+  if(e_->getOption()->getAsBool(PREF_DISABLE_IPV6)) {
+    family = AF_INET;
+  } else {
+    family = AF_UNSPEC;
+  }
+  try {
+#ifdef ENABLE_ASYNC_DNS
+    if(e_->getOption()->getAsBool(PREF_ASYNC_DNS)) {
+      if(!resolver_) {
+        if(!e_->getOption()->getAsBool(PREF_ENABLE_ASYNC_DNS6)) {
+          family = AF_INET;
+        }
+        resolver_.reset(new AsyncNameResolver(family,
+                                              e_->getAsyncDNSServers()));
+      }
+      if(!resolveHostname(hostname, resolver_)) {
+        e_->addCommand(this);
+        return false;
+      }
+      addr = resolver_->getResolvedAddresses().front();
+    } else
+#endif // ENABLE_ASYNC_DNS
+      {
+        NameResolver res;
+        res.setSocktype(SOCK_DGRAM);
+        res.setFamily(family);
+        std::vector<std::string> addrs;
+        res.resolve(addrs, hostname);
+        addr = addrs.front();
+      }
+  } catch(RecoverableException& e) {
+    A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
+    onFailure();
+    return true;
+  }
+  e_->cacheIPAddress(hostname, addr, req_->remotePort);
+  onSuccess(addr);
+  return true;
+}
+
+void UDPTrackerNameResolveCommand::onSuccess(const std::string& addr)
+{
+  req_->remoteAddr = addr;
+  client_->addRequest(req_);
+}
+
+void UDPTrackerNameResolveCommand::onFailure()
+{
+  req_->state = UDPT_STA_COMPLETE;
+  req_->error = UDPT_ERR_NETWORK;
+}
+
+#ifdef ENABLE_ASYNC_DNS
+
+bool UDPTrackerNameResolveCommand::resolveHostname
+(const std::string& hostname,
+ const SharedHandle<AsyncNameResolver>& resolver)
+{
+  switch(resolver->getStatus()) {
+  case AsyncNameResolver::STATUS_READY:
+    A2_LOG_INFO(fmt(MSG_RESOLVING_HOSTNAME,
+                    getCuid(),
+                    hostname.c_str()));
+    resolver->resolve(hostname);
+    setNameResolverCheck(resolver);
+    return false;
+  case AsyncNameResolver::STATUS_SUCCESS:
+    A2_LOG_INFO(fmt(MSG_NAME_RESOLUTION_COMPLETE,
+                    getCuid(),
+                    resolver->getHostname().c_str(),
+                    resolver->getResolvedAddresses().front().c_str()));
+    return true;
+  case AsyncNameResolver::STATUS_ERROR:
+    throw DL_ABORT_EX
+      (fmt(MSG_NAME_RESOLUTION_FAILED,
+           getCuid(),
+           hostname.c_str(),
+           resolver->getError().c_str()));
+  default:
+    return false;
+  }
+}
+
+void UDPTrackerNameResolveCommand::setNameResolverCheck
+(const SharedHandle<AsyncNameResolver>& resolver)
+{
+  e_->addNameResolverCheck(resolver, this);
+}
+
+void UDPTrackerNameResolveCommand::disableNameResolverCheck
+(const SharedHandle<AsyncNameResolver>& resolver)
+{
+  e_->deleteNameResolverCheck(resolver, this);
+}
+#endif // ENABLE_ASYNC_DNS
+
+} // namespace aria2
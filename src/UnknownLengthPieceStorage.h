@@ -219,6 +219,14 @@ public:
   virtual void setEndGamePieceNum(size_t num) {}
 
   virtual SharedHandle<DiskAdaptor> getDiskAdaptor();
+
+  // Write cache is not used for a download of unknown length.
+  virtual WrDiskCache* getWrDiskCache()
+  {
+    return 0;
+  }
+
+  virtual void flushWrDiskCacheEntry() {}
   
   virtual size_t getPieceLength(size_t index);
 
@@ -0,0 +1,96 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "WrDiskCache.h"
+#include "WrDiskCacheEntry.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+WrDiskCache::WrDiskCache(size_t totalSizeLimit)
+  : totalSizeLimit_(totalSizeLimit),
+    total_(0),
+    clock_(0)
+{}
+
+WrDiskCache::~WrDiskCache() {}
+
+bool WrDiskCache::LastUpdateLess::operator()
+  (const WrDiskCacheEntry* lhs, const WrDiskCacheEntry* rhs) const
+{
+  return lhs->getLastUpdate() < rhs->getLastUpdate();
+}
+
+void WrDiskCache::update(WrDiskCacheEntry* ent, ssize_t delta)
+{
+  if(ent->getLastUpdate() != 0) {
+    set_.erase(ent);
+    ent->setLastUpdate(0);
+  }
+  total_ += delta;
+  if(ent->getSize() > 0) {
+    ent->setLastUpdate(++clock_);
+    set_.insert(ent);
+  }
+  ensureLimit();
+}
+
+void WrDiskCache::remove(WrDiskCacheEntry* ent)
+{
+  if(ent->getLastUpdate() != 0) {
+    set_.erase(ent);
+    ent->setLastUpdate(0);
+    total_ -= ent->getSize();
+  }
+}
+
+void WrDiskCache::ensureLimit()
+{
+  while(total_ > totalSizeLimit_ && !set_.empty()) {
+    WrDiskCacheEntry* ent = *set_.begin();
+    A2_LOG_DEBUG(fmt("Flushing write cache entry: size=%lu, cache size=%lu",
+                     static_cast<unsigned long>(ent->getSize()),
+                     static_cast<unsigned long>(total_)));
+    // Write out first so that ent stays registered if writing fails.
+    ent->writeToDisk();
+    set_.erase(ent);
+    ent->setLastUpdate(0);
+    total_ -= ent->getSize();
+    ent->clear();
+  }
+}
+
+} // namespace aria2
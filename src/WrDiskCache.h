@@ -0,0 +1,104 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_WR_DISK_CACHE_H
+#define D_WR_DISK_CACHE_H
+
+#include "common.h"
+
+#include <sys/types.h>
+
+#include <set>
+
+namespace aria2 {
+
+class WrDiskCacheEntry;
+
+// Bounded write cache shared by all downloads.  Each
+// WrDiskCacheEntry holding some data is registered here.  When the
+// total amount of cached data exceeds the limit, entries are written
+// to disk in least recently updated first order.
+class WrDiskCache {
+public:
+  WrDiskCache(size_t totalSizeLimit);
+  ~WrDiskCache();
+
+  // Tells that the size of ent has changed by delta bytes.  The
+  // caller must update ent before calling this function.  ent is
+  // registered if it holds some data and unregistered otherwise.
+  // If the total size exceeds the limit, least recently updated
+  // entries are written to disk.
+  void update(WrDiskCacheEntry* ent, ssize_t delta);
+
+  // Unregisters ent without writing its data to disk.
+  void remove(WrDiskCacheEntry* ent);
+
+  // Writes the data of least recently updated entries to disk until
+  // the total size gets under the limit.
+  void ensureLimit();
+
+  size_t getSize() const
+  {
+    return total_;
+  }
+
+  size_t getTotalSizeLimit() const
+  {
+    return totalSizeLimit_;
+  }
+
+  size_t countEntry() const
+  {
+    return set_.size();
+  }
+private:
+  WrDiskCache(const WrDiskCache&);
+  WrDiskCache& operator=(const WrDiskCache&);
+
+  struct LastUpdateLess {
+    bool operator()(const WrDiskCacheEntry* lhs,
+                    const WrDiskCacheEntry* rhs) const;
+  };
+
+  typedef std::set<WrDiskCacheEntry*, LastUpdateLess> EntrySet;
+
+  size_t totalSizeLimit_;
+  size_t total_;
+  int64_t clock_;
+  EntrySet set_;
+};
+
+} // namespace aria2
+
+#endif // D_WR_DISK_CACHE_H
@@ -0,0 +1,130 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "WrDiskCacheEntry.h"
+
+#include <cstring>
+
+#include "DiskAdaptor.h"
+
+namespace aria2 {
+
+WrDiskCacheEntry::WrDiskCacheEntry
+(const SharedHandle<DiskAdaptor>& diskAdaptor)
+  : diskAdaptor_(diskAdaptor),
+    size_(0),
+    lastUpdate_(0)
+{}
+
+WrDiskCacheEntry::~WrDiskCacheEntry()
+{
+  clear();
+}
+
+bool WrDiskCacheEntry::findInsertionPoint
+(size_t len, off_t goff, DataCellSet::iterator& hint)
+{
+  DataCell key;
+  key.goff = goff;
+  // The first cell whose offset is strictly greater than goff.
+  DataCellSet::iterator i = set_.upper_bound(&key);
+  if(i != set_.end() && (*i)->goff < goff+static_cast<off_t>(len)) {
+    return false;
+  }
+  if(i != set_.begin()) {
+    DataCellSet::iterator prev = i;
+    --prev;
+    if((*prev)->goff+static_cast<off_t>((*prev)->len) > goff) {
+      return false;
+    }
+  }
+  hint = i;
+  return true;
+}
+
+void WrDiskCacheEntry::insertCell
+(DataCellSet::iterator hint, unsigned char* data, size_t len, off_t goff)
+{
+  DataCell* cell = new DataCell();
+  cell->goff = goff;
+  cell->data = data;
+  cell->len = len;
+  set_.insert(hint, cell);
+  size_ += len;
+}
+
+bool WrDiskCacheEntry::cacheData
+(const unsigned char* data, size_t len, off_t goff)
+{
+  if(len == 0) {
+    return true;
+  }
+  DataCellSet::iterator hint;
+  if(!findInsertionPoint(len, goff, hint)) {
+    return false;
+  }
+  unsigned char* copy = new unsigned char[len];
+  memcpy(copy, data, len);
+  insertCell(hint, copy, len, goff);
+  return true;
+}
+
+bool WrDiskCacheEntry::acquireData
+(unsigned char* data, size_t len, off_t goff)
+{
+  DataCellSet::iterator hint;
+  if(len == 0 || !findInsertionPoint(len, goff, hint)) {
+    return false;
+  }
+  insertCell(hint, data, len, goff);
+  return true;
+}
+
+void WrDiskCacheEntry::writeToDisk()
+{
+  diskAdaptor_->writeCache(this);
+}
+
+void WrDiskCacheEntry::clear()
+{
+  for(DataCellSet::iterator i = set_.begin(), eoi = set_.end(); i != eoi;
+      ++i) {
+    delete [] (*i)->data;
+    delete *i;
+  }
+  set_.clear();
+  size_ = 0;
+}
+
+} // namespace aria2
@@ -0,0 +1,136 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_WR_DISK_CACHE_ENTRY_H
+#define D_WR_DISK_CACHE_ENTRY_H
+
+#include "common.h"
+
+#include <set>
+
+#include "SharedHandle.h"
+#include "a2functional.h"
+
+namespace aria2 {
+
+class DiskAdaptor;
+
+// Holds the data of a Piece which is not yet written to disk.  Each
+// chunk of data is stored in DataCell and DataCells are ordered by
+// their global offset.  DataCells never overlap each other.
+class WrDiskCacheEntry {
+public:
+  struct DataCell {
+    // global offset
+    off_t goff;
+    unsigned char* data;
+    size_t len;
+    bool operator<(const DataCell& rhs) const
+    {
+      return goff < rhs.goff;
+    }
+  };
+
+  typedef std::set<DataCell*, DerefLess<DataCell*> > DataCellSet;
+
+  WrDiskCacheEntry(const SharedHandle<DiskAdaptor>& diskAdaptor);
+  ~WrDiskCacheEntry();
+
+  // Copies len bytes of data, which is going to be written at global
+  // offset goff, into the cache.  If the range [goff, goff+len)
+  // overlaps already cached data, this function caches nothing and
+  // returns false.  Otherwise returns true.
+  bool cacheData(const unsigned char* data, size_t len, off_t goff);
+
+  // Same as cacheData() but stores data itself, which must be
+  // allocated by new[], instead of its copy.  If this function
+  // returns true, this object gets ownership of data.
+  bool acquireData(unsigned char* data, size_t len, off_t goff);
+
+  // Writes all cached data to disk.  Cached data is left untouched.
+  // Call clear() to release it.
+  void writeToDisk();
+
+  // Releases all cached data.
+  void clear();
+
+  // Returns the number of bytes cached.
+  size_t getSize() const
+  {
+    return size_;
+  }
+
+  const DataCellSet& getDataSet() const
+  {
+    return set_;
+  }
+
+  const SharedHandle<DiskAdaptor>& getDiskAdaptor() const
+  {
+    return diskAdaptor_;
+  }
+
+  // Used by WrDiskCache to order entries in least recently updated
+  // first.  0 means that this entry is not registered in WrDiskCache.
+  int64_t getLastUpdate() const
+  {
+    return lastUpdate_;
+  }
+
+  void setLastUpdate(int64_t clock)
+  {
+    lastUpdate_ = clock;
+  }
+private:
+  WrDiskCacheEntry(const WrDiskCacheEntry&);
+  WrDiskCacheEntry& operator=(const WrDiskCacheEntry&);
+
+  // Returns true if the range [goff, goff+len) does not overlap
+  // cached data.  The position where the range is inserted is stored
+  // in hint.
+  bool findInsertionPoint
+  (size_t len, off_t goff, DataCellSet::iterator& hint);
+
+  void insertCell(DataCellSet::iterator hint, unsigned char* data,
+                  size_t len, off_t goff);
+
+  SharedHandle<DiskAdaptor> diskAdaptor_;
+  DataCellSet set_;
+  size_t size_;
+  int64_t lastUpdate_;
+};
+
+} // namespace aria2
+
+#endif // D_WR_DISK_CACHE_ENTRY_H
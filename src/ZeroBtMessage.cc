@@ -38,15 +38,21 @@
 namespace aria2 {
 
 unsigned char* ZeroBtMessage::createMessage()
+{
+  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
+  writeMessage(msg);
+  return msg;
+}
+
+bool ZeroBtMessage::writeMessage(unsigned char* msg)
 {
   /**
    * len --- 1, 4bytes
    * id --- ?, 1byte
    * total: 5bytes
    */
-  unsigned char* msg = new unsigned char[MESSAGE_LENGTH];
   bittorrent::createPeerMessageString(msg, MESSAGE_LENGTH, 1, getId());
-  return msg;
+  return true;
 }
 
 size_t ZeroBtMessage::getMessageLength()
@@ -46,6 +46,10 @@
 #ifdef HAVE_IO_H
 # include <io.h>
 #endif // HAVE_IO_H
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif // HAVE_SYS_UIO_H
+#include <climits>
 
 // in some platforms following definitions are missing:
 #ifndef EINPROGRESS
@@ -137,6 +141,23 @@
 # define a2mkdir(path, openMode) mkdir(path, openMode)
 #endif // !__MINGW32__
 
+// Scatter/gather I/O vector. If writev is not available, the same
+// layout is defined here and the vector is written one by one.
+#if defined HAVE_WRITEV && defined HAVE_SYS_UIO_H
+typedef struct iovec a2iovec;
+#else // !(HAVE_WRITEV && HAVE_SYS_UIO_H)
+struct a2iovec {
+  void* iov_base;
+  size_t iov_len;
+};
+#endif // !(HAVE_WRITEV && HAVE_SYS_UIO_H)
+
+#ifdef IOV_MAX
+# define A2_IOV_MAX IOV_MAX
+#else // !IOV_MAX
+# define A2_IOV_MAX 16
+#endif // !IOV_MAX
+
 #if defined HAVE_POSIX_MEMALIGN && defined O_DIRECT
 # define ENABLE_DIRECT_IO 1
 #endif // HAVE_POSIX_MEMALIGN && O_DIRECT
@@ -35,7 +35,10 @@
 #ifndef D_ARRAY_FUN_H
 #define D_ARRAY_FUN_H
 
+#include "common.h"
+
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 
 namespace aria2 {
@@ -124,6 +127,11 @@ public:
 
 namespace expr {
 
+// Expressions can be evaluated a byte at a time with operator[] or 8
+// bytes at a time with word().  word(index) evaluates the bytes
+// [index*8, index*8+8) in host byte order; the caller must make sure
+// that all of them are inside the arrays.
+
 template<typename L, typename OpTag, typename R>
 struct BinExpr {
   BinExpr(const L& l, const R& r):l_(l), r_(r) {}
@@ -135,6 +143,11 @@ struct BinExpr {
     return OpTag::apply(l_[index], r_[index]);
   }
 
+  uint64_t word(size_t index) const
+  {
+    return OpTag::applyWord(l_.word(index), r_.word(index));
+  }
+
   const L& l_;
   const R& r_;
 };
@@ -150,6 +163,11 @@ struct UnExpr {
     return OpTag::apply(a_[index]);
   }
 
+  uint64_t word(size_t index) const
+  {
+    return OpTag::applyWord(a_.word(index));
+  }
+
   const A& a_;
 };
 
@@ -158,6 +176,10 @@ struct And
 {
   typedef T returnType;
   static inline returnType apply(T lhs, T rhs) { return lhs&rhs; }
+  static inline uint64_t applyWord(uint64_t lhs, uint64_t rhs)
+  {
+    return lhs&rhs;
+  }
 };
 
 template<typename T>
@@ -165,6 +187,10 @@ struct Or
 {
   typedef T returnType;
   static inline returnType apply(T lhs, T rhs) { return lhs|rhs; }
+  static inline uint64_t applyWord(uint64_t lhs, uint64_t rhs)
+  {
+    return lhs|rhs;
+  }
 };
 
 template<typename T>
@@ -172,6 +198,7 @@ struct Negate
 {
   typedef T returnType;
   static inline returnType apply(T a) { return ~a; }
+  static inline uint64_t applyWord(uint64_t a) { return ~a; }
 };
 
 template<typename T>
@@ -184,6 +211,13 @@ struct Array
   const T* t_;
 
   returnType operator[](size_t index) const { return t_[index]; }
+
+  uint64_t word(size_t index) const
+  {
+    uint64_t w;
+    memcpy(&w, &t_[index*sizeof(w)], sizeof(w));
+    return w;
+  }
 };
 
 template<typename T>
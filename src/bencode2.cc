@@ -34,96 +34,220 @@
 /* copyright --> */
 #include "bencode2.h"
 
-#include <fstream>
+#include <cerrno>
+#include <cstring>
 #include <sstream>
+#include <iterator>
+#include <map>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif // HAVE_MMAP
 
+#include "a2io.h"
 #include "fmt.h"
 #include "DlAbortEx.h"
 #include "error_code.h"
+#include "util.h"
 
 namespace aria2 {
 
 namespace bencode2 {
 
 namespace {
-SharedHandle<ValueBase> decodeiter(std::istream& ss, size_t depth);
+// The number of nodes allocated at once by Document.
+const size_t NODE_BLOCK_SIZE = 1024;
+} // namespace
+
+const Node* Node::find(const std::string& k) const
+{
+  if(type != DICT) {
+    return 0;
+  }
+  // If the key appears more than once, the last one wins, as
+  // Dict::put() does.
+  const Node* found = 0;
+  for(const Node* e = first; e; e = e->next) {
+    if(e->keyLength == k.size() && memcmp(e->key, k.data(), k.size()) == 0) {
+      found = e;
+    }
+  }
+  return found;
+}
+
+const Node* Node::get(size_t index) const
+{
+  if(type != LIST) {
+    return 0;
+  }
+  const Node* e = first;
+  for(; e && index > 0; e = e->next, --index);
+  return e;
+}
+
+bool Node::equals(const std::string& s) const
+{
+  return type == STRING && length == s.size() &&
+    memcmp(str, s.data(), length) == 0;
+}
+
+Document::Document()
+  : used_(NODE_BLOCK_SIZE),
+    mapped_(0),
+    mappedLength_(0)
+{}
+
+Document::~Document()
+{
+  for(std::vector<Node*>::const_iterator i = blocks_.begin(),
+        eoi = blocks_.end(); i != eoi; ++i) {
+    delete [] *i;
+  }
+#ifdef HAVE_MMAP
+  if(mapped_) {
+    munmap(mapped_, mappedLength_);
+  }
+#endif // HAVE_MMAP
+}
+
+Node* Document::newNode()
+{
+  if(used_ == NODE_BLOCK_SIZE) {
+    blocks_.push_back(new Node[NODE_BLOCK_SIZE]);
+    used_ = 0;
+  }
+  Node* node = &blocks_.back()[used_++];
+  memset(node, 0, sizeof(Node));
+  return node;
+}
+
+namespace {
+const Node* decodeiter
+(Document& doc, const char*& p, const char* last, size_t depth);
 } // namespace
 
 namespace {
-void checkdelim(std::istream& ss, const char delim = ':')
+void checkdelim(const char*& p, const char* last, const char delim = ':')
 {
-  char d;
-  if(!(ss.get(d) && d == delim)) {
+  if(p == last || *p != delim) {
     throw DL_ABORT_EX2
       (fmt("Bencode decoding failed: Delimiter '%c' not found.",
            delim),
        error_code::BENCODE_PARSE_ERROR);
   }
+  ++p;
 }
 } // namespace
 
 namespace {
-std::string decoderawstring(std::istream& ss)
+void decoderawstring
+(const char*& p, const char* last, const char*& str, size_t& length)
 {
-  int length;
-  ss >> length;
-  if(!ss || length < 0) {
+  if(p == last || !('0' <= *p && *p <= '9')) {
     throw DL_ABORT_EX2("Bencode decoding failed:"
                        " A positive integer expected but none found.",
                        error_code::BENCODE_PARSE_ERROR);
   }
-  // TODO check length, it must be less than or equal to INT_MAX
-  checkdelim(ss);
-  char* buf = new char[length];
-  ss.read(buf, length);
-  std::string str(&buf[0], &buf[length]);
-  delete [] buf;
-  if(ss.gcount() != static_cast<int>(length)) {
+  length = 0;
+  for(; p != last && '0' <= *p && *p <= '9'; ++p) {
+    length = length*10+(*p-'0');
+    if(length > INT32_MAX) {
+      throw DL_ABORT_EX2("Bencode decoding failed:"
+                         " A positive integer expected but none found.",
+                         error_code::BENCODE_PARSE_ERROR);
+    }
+  }
+  checkdelim(p, last);
+  if(static_cast<size_t>(last-p) < length) {
     throw DL_ABORT_EX2
       (fmt("Bencode decoding failed:"
            " Expected %lu bytes of data, but only %ld read.",
            static_cast<unsigned long>(length),
-           static_cast<long int>(ss.gcount())),
+           static_cast<long int>(last-p)),
        error_code::BENCODE_PARSE_ERROR);
   }
-  return str;
+  str = p;
+  p += length;
 }
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodestring(std::istream& ss)
+const Node* decodestring(Document& doc, const char*& p, const char* last)
 {
-  return String::g(decoderawstring(ss));
+  Node* node = doc.newNode();
+  node->type = Node::STRING;
+  decoderawstring(p, last, node->str, node->length);
+  return node;
 }
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodeinteger(std::istream& ss)
+const Node* decodeinteger(Document& doc, const char*& p, const char* last)
 {
-  Integer::ValueType iv;
-  ss >> iv;
-  if(!ss) {
+  bool neg = false;
+  if(p != last && *p == '-') {
+    neg = true;
+    ++p;
+  }
+  if(p == last || !('0' <= *p && *p <= '9')) {
     throw DL_ABORT_EX2("Bencode decoding failed:"
                        " Integer expected but none found",
                        error_code::BENCODE_PARSE_ERROR);
   }
-  checkdelim(ss, 'e');
-  return Integer::g(iv);
+  // Accumulate in negative to accept INT64_MIN.
+  int64_t iv = 0;
+  for(; p != last && '0' <= *p && *p <= '9'; ++p) {
+    int digit = *p-'0';
+    if(iv < (INT64_MIN+digit)/10) {
+      throw DL_ABORT_EX2("Bencode decoding failed:"
+                         " Integer expected but none found",
+                         error_code::BENCODE_PARSE_ERROR);
+    }
+    iv = iv*10-digit;
+  }
+  if(!neg) {
+    if(iv == INT64_MIN) {
+      throw DL_ABORT_EX2("Bencode decoding failed:"
+                         " Integer expected but none found",
+                         error_code::BENCODE_PARSE_ERROR);
+    }
+    iv = -iv;
+  }
+  checkdelim(p, last, 'e');
+  Node* node = doc.newNode();
+  node->type = Node::INTEGER;
+  node->integer = iv;
+  return node;
 }
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodedict(std::istream& ss, size_t depth)
+const Node* decodedict
+(Document& doc, const char*& p, const char* last, size_t depth)
 {
-  SharedHandle<Dict> dict = Dict::g();
-  char c;
-  while(ss.get(c)) {
-    if(c == 'e') {
+  Node* dict = doc.newNode();
+  dict->type = Node::DICT;
+  // The caller has consumed the leading 'd'.
+  dict->str = p-1;
+  Node* tail = 0;
+  while(p != last) {
+    if(*p == 'e') {
+      ++p;
+      dict->length = p-dict->str;
       return dict;
     } else {
-      ss.unget();
-      std::string key = decoderawstring(ss);
-      dict->put(key, decodeiter(ss, depth));
+      const char* key;
+      size_t keyLength;
+      decoderawstring(p, last, key, keyLength);
+      Node* value = const_cast<Node*>(decodeiter(doc, p, last, depth));
+      value->key = key;
+      value->keyLength = keyLength;
+      if(tail) {
+        tail->next = value;
+      } else {
+        dict->first = value;
+      }
+      tail = value;
+      ++dict->size;
     }
   }
   throw DL_ABORT_EX2("Bencode decoding failed:"
@@ -133,16 +257,28 @@ SharedHandle<ValueBase> decodedict(std::istream& ss, size_t depth)
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodelist(std::istream& ss, size_t depth)
+const Node* decodelist
+(Document& doc, const char*& p, const char* last, size_t depth)
 {
-  SharedHandle<List> list = List::g();
-  char c;
-  while(ss.get(c)) {
-    if(c == 'e') {
+  Node* list = doc.newNode();
+  list->type = Node::LIST;
+  // The caller has consumed the leading 'l'.
+  list->str = p-1;
+  Node* tail = 0;
+  while(p != last) {
+    if(*p == 'e') {
+      ++p;
+      list->length = p-list->str;
       return list;
     } else {
-      ss.unget();
-      list->append(decodeiter(ss, depth));
+      Node* value = const_cast<Node*>(decodeiter(doc, p, last, depth));
+      if(tail) {
+        tail->next = value;
+      } else {
+        list->first = value;
+      }
+      tail = value;
+      ++list->size;
     }
   }
   throw DL_ABORT_EX2("Bencode decoding failed:"
@@ -162,32 +298,148 @@ void checkDepth(size_t depth)
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodeiter(std::istream& ss, size_t depth)
+const Node* decodeiter
+(Document& doc, const char*& p, const char* last, size_t depth)
 {
   checkDepth(depth);
-  char c;
-  if(!ss.get(c)) {
+  if(p == last) {
     throw DL_ABORT_EX2("Bencode decoding failed:"
                        " Unexpected EOF in term context."
                        " 'd', 'l', 'i' or digit is expected.",
                        error_code::BENCODE_PARSE_ERROR);
   }
+  char c = *p;
   if(c == 'd') {
-    return decodedict(ss, depth+1);
+    ++p;
+    return decodedict(doc, p, last, depth+1);
   } else if(c == 'l') {
-    return decodelist(ss, depth+1);
+    ++p;
+    return decodelist(doc, p, last, depth+1);
   } else if(c == 'i') {
-    return decodeinteger(ss);
+    ++p;
+    return decodeinteger(doc, p, last);
   } else {
-    ss.unget();
-    return decodestring(ss);
+    return decodestring(doc, p, last);
   }
 }
 } // namespace
 
+const Node* Document::parse
+(const unsigned char* data, size_t length, size_t& end)
+{
+  if(length == 0) {
+    end = 0;
+    return 0;
+  }
+  const char* first = reinterpret_cast<const char*>(data);
+  const char* p = first;
+  const Node* node = decodeiter(*this, p, first+length, 0);
+  end = p-first;
+  return node;
+}
+
+const Node* Document::parse(const unsigned char* data, size_t length)
+{
+  size_t end;
+  return parse(data, length, end);
+}
+
+const Node* Document::parseFile(const std::string& filename)
+{
+  int fd;
+  while((fd = open(filename.c_str(), O_RDONLY|O_BINARY)) == -1 &&
+        errno == EINTR);
+  if(fd == -1) {
+    throw DL_ABORT_EX2
+      (fmt("Bencode decoding failed: Cannot open file '%s'.",
+           filename.c_str()),
+       error_code::BENCODE_PARSE_ERROR);
+  }
+  a2_struct_stat st;
+  if(a2fstat(fd, &st) == -1) {
+    close(fd);
+    throw DL_ABORT_EX2
+      (fmt("Bencode decoding failed: Cannot open file '%s'.",
+           filename.c_str()),
+       error_code::BENCODE_PARSE_ERROR);
+  }
+  size_t length = st.st_size;
+  const unsigned char* data = 0;
+#ifdef HAVE_MMAP
+  if(length > 0) {
+    void* addr = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr != MAP_FAILED) {
+      mapped_ = reinterpret_cast<unsigned char*>(addr);
+      mappedLength_ = length;
+      data = mapped_;
+    }
+  }
+#endif // HAVE_MMAP
+  if(!data && length > 0) {
+    fileBuf_.resize(length);
+    size_t nread = 0;
+    while(nread < length) {
+      ssize_t r;
+      while((r = read(fd, &fileBuf_[nread], length-nread)) == -1 &&
+            errno == EINTR);
+      if(r <= 0) {
+        break;
+      }
+      nread += r;
+    }
+    length = nread;
+    data = &fileBuf_[0];
+  }
+  close(fd);
+  if(length == 0) {
+    throw DL_ABORT_EX2("Bencode decoding failed:"
+                       " Unexpected EOF in term context."
+                       " 'd', 'l', 'i' or digit is expected.",
+                       error_code::BENCODE_PARSE_ERROR);
+  }
+  return parse(data, length);
+}
+
+SharedHandle<ValueBase> toValueBase(const Node* node)
+{
+  if(!node) {
+    return SharedHandle<ValueBase>();
+  }
+  switch(node->type) {
+  case Node::STRING:
+    return String::g(reinterpret_cast<const unsigned char*>(node->str),
+                     node->length);
+  case Node::INTEGER:
+    return Integer::g(node->integer);
+  case Node::LIST: {
+    SharedHandle<List> list = List::g();
+    for(const Node* e = node->first; e; e = e->next) {
+      list->append(toValueBase(e));
+    }
+    return list;
+  }
+  case Node::DICT: {
+    SharedHandle<Dict> dict = Dict::g();
+    for(const Node* e = node->first; e; e = e->next) {
+      dict->put(std::string(e->key, e->keyLength), toValueBase(e));
+    }
+    return dict;
+  }
+  }
+  return SharedHandle<ValueBase>();
+}
+
 SharedHandle<ValueBase> decode(std::istream& in)
 {
-  return decodeiter(in, 0);
+  std::string s((std::istreambuf_iterator<char>(in)),
+                std::istreambuf_iterator<char>());
+  if(s.empty()) {
+    throw DL_ABORT_EX2("Bencode decoding failed:"
+                       " Unexpected EOF in term context."
+                       " 'd', 'l', 'i' or digit is expected.",
+                       error_code::BENCODE_PARSE_ERROR);
+  }
+  return decode(s);
 }
 
 SharedHandle<ValueBase> decode(const std::string& s)
@@ -198,37 +450,26 @@ SharedHandle<ValueBase> decode(const std::string& s)
 
 SharedHandle<ValueBase> decode(const std::string& s, size_t& end)
 {
-  if(s.empty()) {
-    return SharedHandle<ValueBase>();
-  }
-  std::istringstream ss(s);
-
-  SharedHandle<ValueBase> vlb = decodeiter(ss, 0);
-  end = ss.tellg();
-  return vlb;
+  return decode(reinterpret_cast<const unsigned char*>(s.data()), s.size(),
+                end);
 }
 
 SharedHandle<ValueBase> decode(const unsigned char* data, size_t length)
 {
-  return decode(std::string(&data[0], &data[length]));
+  size_t end;
+  return decode(data, length, end);
 }
 
 SharedHandle<ValueBase> decode(const unsigned char* data, size_t length, size_t& end)
 {
-  return decode(std::string(&data[0], &data[length]), end);
+  Document doc;
+  return toValueBase(doc.parse(data, length, end));
 }
 
 SharedHandle<ValueBase> decodeFromFile(const std::string& filename)
 {
-  std::ifstream f(filename.c_str(), std::ios::binary);
-  if(f) {
-    return decode(f);
-  } else {
-    throw DL_ABORT_EX2
-      (fmt("Bencode decoding failed: Cannot open file '%s'.",
-           filename.c_str()),
-       error_code::BENCODE_PARSE_ERROR);
-  }
+  Document doc;
+  return toValueBase(doc.parseFile(filename));
 }
 
 std::string encode(const ValueBase* vlb)
@@ -287,6 +528,57 @@ std::string encode(const SharedHandle<ValueBase>& vlb)
   return encode(vlb.get());
 }
 
+namespace {
+void encodeNode(std::string& out, const Node* node)
+{
+  switch(node->type) {
+  case Node::STRING:
+    out += util::uitos(node->length);
+    out += ':';
+    out.append(node->str, node->length);
+    break;
+  case Node::INTEGER:
+    out += 'i';
+    out += util::itos(node->integer);
+    out += 'e';
+    break;
+  case Node::LIST:
+    out += 'l';
+    for(const Node* e = node->first; e; e = e->next) {
+      encodeNode(out, e);
+    }
+    out += 'e';
+    break;
+  case Node::DICT: {
+    std::map<std::string, const Node*> entries;
+    for(const Node* e = node->first; e; e = e->next) {
+      entries[std::string(e->key, e->keyLength)] = e;
+    }
+    out += 'd';
+    for(std::map<std::string, const Node*>::const_iterator i =
+          entries.begin(), eoi = entries.end(); i != eoi; ++i) {
+      out += util::uitos((*i).first.size());
+      out += ':';
+      out += (*i).first;
+      encodeNode(out, (*i).second);
+    }
+    out += 'e';
+    break;
+  }
+  }
+}
+} // namespace
+
+std::string encode(const Node* node)
+{
+  std::string out;
+  // The result is as long as the decoded data unless it is not
+  // canonical.
+  out.reserve(node->type == Node::INTEGER ? 0 : node->length+16);
+  encodeNode(out, node);
+  return out;
+}
+
 } // namespace bencode2
 
 } // namespace aria2
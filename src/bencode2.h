@@ -38,6 +38,7 @@
 #include "common.h"
 
 #include <string>
+#include <vector>
 #include <iosfwd>
 
 #include "ValueBase.h"
@@ -48,6 +49,96 @@ namespace bencode2 {
 
 const size_t MAX_STRUCTURE_DEPTH = 100;
 
+// A value decoded by Document. Strings and dict keys point into the
+// decoded buffer and are not NULL terminated. The elements of a list
+// or a dict are linked through next.
+struct Node {
+  enum Type {
+    STRING,
+    INTEGER,
+    LIST,
+    DICT
+  };
+  Type type;
+  // The key of this node if it is an element of a dict.
+  const char* key;
+  size_t keyLength;
+  // STRING: the string. LIST and DICT: the bencoded data of this
+  // node, including the leading 'l' or 'd' and the trailing 'e'.
+  const char* str;
+  size_t length;
+  // INTEGER
+  int64_t integer;
+  // LIST and DICT. size is the number of elements.
+  const Node* first;
+  size_t size;
+  // The next element in the enclosing list or dict.
+  const Node* next;
+
+  // Returns the element of this dict whose key is key, or 0 if there
+  // is no such element or this node is not a dict.
+  const Node* find(const std::string& key) const;
+
+  // Returns a copy of the string of this node.
+  std::string s() const
+  {
+    return std::string(str, length);
+  }
+
+  const unsigned char* uc() const
+  {
+    return reinterpret_cast<const unsigned char*>(str);
+  }
+
+  // Returns the index-th element of this list, or 0 if there is no
+  // such element or this node is not a list.
+  const Node* get(size_t index) const;
+
+  // Returns true if this node is a string and equal to s.
+  bool equals(const std::string& s) const;
+};
+
+// Decodes bencoded data without copying strings. Nodes are allocated
+// from an arena owned by this object and are released at once when
+// it is destroyed, so the returned nodes are valid only while this
+// object and the decoded buffer are alive.
+class Document {
+private:
+  std::vector<Node*> blocks_;
+  // The number of nodes used in blocks_.back().
+  size_t used_;
+  // The contents of the file read by parseFile().
+  unsigned char* mapped_;
+  size_t mappedLength_;
+  std::vector<unsigned char> fileBuf_;
+
+  Document(const Document&);
+  Document& operator=(const Document&);
+public:
+  Document();
+
+  ~Document();
+
+  // Allocates a node from the arena.
+  Node* newNode();
+
+  // Decodes data and returns the root node. After decode is done
+  // successfully, returns the bencoded data length in end. Returns 0
+  // if length is 0.
+  const Node* parse(const unsigned char* data, size_t length, size_t& end);
+
+  const Node* parse(const unsigned char* data, size_t length);
+
+  // Maps filename into memory with mmap(2) if available, or reads it
+  // otherwise, and decodes it. The contents are kept until this
+  // object is destroyed.
+  const Node* parseFile(const std::string& filename);
+};
+
+// Converts node into ValueBase. Strings are copied.
+SharedHandle<ValueBase> toValueBase(const Node* node);
+
+// Reads the whole stream and decodes it.
 SharedHandle<ValueBase> decode(std::istream& in);
 
 // Decode the data in s.
@@ -68,6 +159,11 @@ std::string encode(const ValueBase* vlb);
 
 std::string encode(const SharedHandle<ValueBase>& vlb);
 
+// Encodes node in the same way as encode(toValueBase(node)): dict keys
+// are sorted and the last one of duplicate keys is used. So the result
+// may differ from the data node was decoded from.
+std::string encode(const Node* node);
+
 } // namespace bencode2
 
 } // namespace aria2
@@ -34,10 +34,109 @@
 /* copyright --> */
 #include "bitfield.h"
 
+#ifdef HAVE_CPU_DISPATCH
+# include <immintrin.h>
+#endif // HAVE_CPU_DISPATCH
+
 namespace aria2 {
 
 namespace bitfield {
 
+namespace {
+size_t countBitsGeneric(const unsigned char* data, size_t len)
+{
+  size_t count = 0;
+  size_t i = 0;
+  for(; i+sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t v;
+    memcpy(&v, data+i, sizeof(v));
+    v = v-((v >> 1)&0x5555555555555555llu);
+    v = (v&0x3333333333333333llu)+((v >> 2)&0x3333333333333333llu);
+    v = (v+(v >> 4))&0x0f0f0f0f0f0f0f0fllu;
+    count += (v*0x0101010101010101llu) >> 56;
+  }
+  for(; i < len; ++i) {
+    count += countBit32(data[i]);
+  }
+  return count;
+}
+} // namespace
+
+#ifdef HAVE_CPU_DISPATCH
+
+namespace {
+__attribute__((target("popcnt")))
+size_t countBitsPopcnt(const unsigned char* data, size_t len)
+{
+  size_t count = 0;
+  size_t i = 0;
+  for(; i+sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t v;
+    memcpy(&v, data+i, sizeof(v));
+    count += __builtin_popcountll(v);
+  }
+  for(; i < len; ++i) {
+    count += __builtin_popcount(data[i]);
+  }
+  return count;
+}
+} // namespace
+
+namespace {
+// Counts bits of each nibble by table lookup with VPSHUFB and sums
+// up the bytes with VPSADBW, 32 bytes at a time.
+__attribute__((target("avx2,popcnt")))
+size_t countBitsAvx2(const unsigned char* data, size_t len)
+{
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i lowMask = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = zero;
+  size_t i = 0;
+  for(; i+sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+    __m256i v =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data+i));
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, lowMask));
+    __m256i hi = _mm256_shuffle_epi8
+      (table, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask));
+    acc = _mm256_add_epi64
+      (acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), zero));
+  }
+  uint64_t sums[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), acc);
+  return sums[0]+sums[1]+sums[2]+sums[3]+countBitsPopcnt(data+i, len-i);
+}
+} // namespace
+
+#endif // HAVE_CPU_DISPATCH
+
+namespace {
+typedef size_t (*CountBitsFun)(const unsigned char*, size_t);
+
+CountBitsFun selectCountBits()
+{
+#ifdef HAVE_CPU_DISPATCH
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+    return countBitsAvx2;
+  }
+  if(__builtin_cpu_supports("popcnt")) {
+    return countBitsPopcnt;
+  }
+#endif // HAVE_CPU_DISPATCH
+  return countBitsGeneric;
+}
+} // namespace
+
+size_t countBits(const unsigned char* data, size_t len)
+{
+  static const CountBitsFun fun = selectCountBits();
+  return fun(data, len);
+}
+
 void flipBit(unsigned char* data, size_t length, size_t bitIndex)
 {
   size_t byteIndex = bitIndex/8;
@@ -40,8 +40,10 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 #include "util.h"
+#include "array_fun.h"
 
 namespace aria2 {
 
@@ -99,34 +101,133 @@ inline size_t countBit32(uint32_t n)
     nbits[(n >> 24)&0xffu];
 }
 
-// Counts set bit in bitfield.
-inline size_t countSetBit(const unsigned char* bitfield, size_t nbits)
+// Returns the number of leading zero bits in x. x must not be 0.
+inline size_t countLeadingZero64(uint64_t x)
 {
-  if(nbits == 0) {
-    return 0;
+#ifdef HAVE_BUILTIN_CLZLL
+  return __builtin_clzll(x);
+#else // !HAVE_BUILTIN_CLZLL
+  size_t n = 0;
+  for(size_t s = 32; s > 0; s >>= 1) {
+    if(!(x >> (64-s))) {
+      n += s;
+      x <<= s;
+    }
   }
+  return n;
+#endif // !HAVE_BUILTIN_CLZLL
+}
+
+// Returns the index-th 64 bits of bitfield in host byte order.
+inline uint64_t loadWord(const unsigned char* bitfield, size_t index)
+{
+  uint64_t w;
+  memcpy(&w, bitfield+index*sizeof(w), sizeof(w));
+  return w;
+}
+
+template<typename T>
+inline uint64_t loadWord(const expr::Array<T>& bitfield, size_t index)
+{
+  return bitfield.word(index);
+}
+
+template<typename L, typename OpTag, typename R>
+inline uint64_t loadWord
+(const expr::BinExpr<L, OpTag, R>& bitfield, size_t index)
+{
+  return bitfield.word(index);
+}
+
+template<typename OpTag, typename A>
+inline uint64_t loadWord(const expr::UnExpr<OpTag, A>& bitfield, size_t index)
+{
+  return bitfield.word(index);
+}
+
+// Returns the index-th 64 bits of bitfield as an integer. The most
+// significant bit of the returned value is the bit index*64 of
+// bitfield, so that countLeadingZero64() gives the index of the first
+// set bit in the word.
+template<typename Array>
+inline uint64_t getWord(const Array& bitfield, size_t index)
+{
+  return ntoh64(loadWord(bitfield, index));
+}
+
+// Counts set bit in data[0, len). This function uses POPCNT or AVX2
+// instructions if the CPU supports them.
+size_t countBits(const unsigned char* data, size_t len);
+
+// Counts set bit in bitfield. bitfield contains nbits bits.
+template<typename Array>
+size_t countSetBit(const Array& bitfield, size_t nbits)
+{
+  // Expressions are evaluated into buf, a chunk at a time, so that
+  // countBits() can work on a contiguous memory. The byte order does
+  // not matter here.
+  const size_t CHUNK = 32;
+  uint64_t buf[CHUNK];
+  const size_t nwords = nbits/64;
   size_t count = 0;
-  size_t size = sizeof(uint32_t);
-  size_t len = (nbits+7)/8;
-  if(nbits%32 != 0) {
-    --len;
-    count +=
-      countBit32(static_cast<uint32_t>(bitfield[len]&lastByteMask(nbits)));
-  }
-  size_t to = len/size;
-  for(size_t i = 0; i < to; ++i) {
-    uint32_t v;
-    memcpy(&v, &bitfield[i*size], sizeof(v));
-    count += countBit32(v);
+  for(size_t i = 0; i < nwords;) {
+    size_t n = std::min(CHUNK, nwords-i);
+    for(size_t j = 0; j < n; ++j, ++i) {
+      buf[j] = loadWord(bitfield, i);
+    }
+    count += countBits(reinterpret_cast<const unsigned char*>(buf),
+                       n*sizeof(uint64_t));
   }
-  for(size_t i = len-len%size; i < len; ++i) {
-    count += countBit32(static_cast<uint32_t>(bitfield[i]));
+  const size_t len = (nbits+7)/8;
+  for(size_t i = nwords*sizeof(uint64_t); i < len; ++i) {
+    unsigned char c = bitfield[i];
+    if(i == len-1) {
+      c &= lastByteMask(nbits);
+    }
+    count += countBit32(c);
   }
   return count;
 }
 
 void flipBit(unsigned char* data, size_t length, size_t bitIndex);
 
+// Returns the index of the first set bit in bitfield, starting at
+// the bit from. bitfield contains nbits bits. If there is no such
+// bit, returns nbits.
+template<typename Array>
+size_t findFirstSet(const Array& bitfield, size_t from, size_t nbits)
+{
+  const size_t nwords = nbits/64;
+  size_t i = from/64;
+  if(i < nwords) {
+    uint64_t w = getWord(bitfield, i)&(UINT64_MAX >> (from%64));
+    while(1) {
+      if(w) {
+        return i*64+countLeadingZero64(w);
+      }
+      if(++i == nwords) {
+        break;
+      }
+      w = getWord(bitfield, i);
+    }
+    from = nwords*64;
+  }
+  const size_t len = (nbits+7)/8;
+  for(size_t j = from/8; j < len; ++j) {
+    unsigned char c = bitfield[j];
+    if(j == from/8) {
+      c &= 0xffu >> (from%8);
+    }
+    if(j == len-1) {
+      c &= lastByteMask(nbits);
+    }
+    if(c) {
+      return j*8+countLeadingZero64(c)-56;
+    }
+  }
+  return nbits;
+}
+
 // Stores first missing bit index of bitfield to index.  bitfield
 // contains nbits. Returns true if missing bit index is
 // found. Otherwise returns false.
@@ -134,18 +235,12 @@ template<typename Array>
 bool getFirstMissingIndex
 (size_t& index, const Array& bitfield, size_t nbits)
 {
-  const size_t bitfieldLength = (nbits+7)/8;
-  for(size_t i = 0; i < bitfieldLength; ++i) {
-    unsigned char mask = 128;
-    size_t tindex = i*8;
-    for(size_t bi = 0; bi < 8 && tindex < nbits; ++bi, mask >>= 1, ++tindex) {
-      if(bitfield[i] & mask) {
-        index = tindex;
-        return true;
-      }
-    }
+  size_t i = findFirstSet(bitfield, 0, nbits);
+  if(i == nbits) {
+    return false;
   }
-  return false;
+  index = i;
+  return true;
 }
 
 // Appends first at most n set bit index in bitfield to out.  bitfield
@@ -154,24 +249,15 @@ template<typename Array, typename OutputIterator>
 size_t getFirstNMissingIndex
 (OutputIterator out, size_t n, const Array& bitfield, size_t nbits)
 {
-  if(n == 0) {
-    return 0;
-  }
-  const size_t origN = n;
-  const size_t bitfieldLength = (nbits+7)/8;
-  for(size_t i = 0; i < bitfieldLength; ++i) {
-    unsigned char mask = 128;
-    size_t tindex = i*8;
-    for(size_t bi = 0; bi < 8 && tindex < nbits; ++bi, mask >>= 1, ++tindex) {
-      if(bitfield[i] & mask) {
-        *out++ = tindex;
-        if(--n == 0) {
-          return origN;
-        }
-      }
+  size_t count = 0;
+  for(size_t i = 0; count < n; ++i, ++count) {
+    i = findFirstSet(bitfield, i, nbits);
+    if(i == nbits) {
+      break;
     }
+    *out++ = i;
   }
-  return origN-n;
+  return count;
 }
 
 } // namespace bitfield
@@ -112,14 +112,14 @@ const std::string SINGLE("single");
 
 namespace {
 void extractPieceHash(const SharedHandle<DownloadContext>& ctx,
-                      const std::string& hashData,
+                      const char* hashData,
                       size_t hashLength,
                       size_t numPieces)
 {
   std::vector<std::string> pieceHashes;
   pieceHashes.reserve(numPieces);
   for(size_t i = 0; i < numPieces; ++i) {
-    pieceHashes.push_back(util::toHex(hashData.data()+i*hashLength,
+    pieceHashes.push_back(util::toHex(hashData+i*hashLength,
                                       hashLength));
   }
   ctx->setPieceHashes(pieceHashes.begin(), pieceHashes.end());
@@ -127,46 +127,40 @@ void extractPieceHash(const SharedHandle<DownloadContext>& ctx,
 }
 } // namespace
 
+namespace {
+// Returns the element of dict whose key is key if its type is type,
+// or 0.
+const bencode2::Node* getNode
+(const bencode2::Node* dict, const std::string& key,
+ bencode2::Node::Type type)
+{
+  const bencode2::Node* node = dict->find(key);
+  if(node && node->type == type) {
+    return node;
+  } else {
+    return 0;
+  }
+}
+} // namespace
+
 namespace {
 void extractUrlList
 (const SharedHandle<TorrentAttribute>& torrent, std::vector<std::string>& uris,
- const ValueBase* v)
+ const bencode2::Node* v)
 {
-  class UrlListVisitor:public ValueBaseVisitor {
-  private:
-    std::vector<std::string>& uris_;
-    const SharedHandle<TorrentAttribute>& torrent_;
-  public:
-    UrlListVisitor
-    (std::vector<std::string>& uris,
-     const SharedHandle<TorrentAttribute>& torrent):
-      uris_(uris), torrent_(torrent) {}
-
-    virtual void visit(const String& v)
-    {
-      uris_.push_back(v.s());
-      torrent_->urlList.push_back(v.s());
-    }
-
-    virtual void visit(const Integer& v) {}
-
-    virtual void visit(const List& v)
-    {
-      for(List::ValueType::const_iterator itr = v.begin(), eoi = v.end();
-          itr != eoi; ++itr) {
-        const String* uri = asString(*itr);
-        if(uri) {
-          uris_.push_back(uri->s());
-          torrent_->urlList.push_back(uri->s());
-        }
+  if(!v) {
+    return;
+  }
+  if(v->type == bencode2::Node::STRING) {
+    uris.push_back(v->s());
+    torrent->urlList.push_back(v->s());
+  } else if(v->type == bencode2::Node::LIST) {
+    for(const bencode2::Node* uri = v->first; uri; uri = uri->next) {
+      if(uri->type == bencode2::Node::STRING) {
+        uris.push_back(uri->s());
+        torrent->urlList.push_back(uri->s());
       }
     }
-    virtual void visit(const Dict& v) {}
-  };
-
-  if(v) {
-    UrlListVisitor visitor(uris, torrent);
-    v->accept(visitor);
   }
 }
 } // namespace
@@ -192,7 +186,7 @@ namespace {
 void extractFileEntries
 (const SharedHandle<DownloadContext>& ctx,
  const SharedHandle<TorrentAttribute>& torrent,
- const Dict* infoDict,
+ const bencode2::Node* infoDict,
  const SharedHandle<Option>& option,
  const std::string& defaultName,
  const std::string& overrideName,
@@ -201,13 +195,10 @@ void extractFileEntries
   std::string name;
   std::string utf8Name;
   if(overrideName.empty()) {
-    std::string nameKey;
-    if(infoDict->containsKey(C_NAME_UTF8)) {
-      nameKey = C_NAME_UTF8;
-    } else {
-      nameKey = C_NAME;
-    }
-    const String* nameData = asString(infoDict->get(nameKey));
+    const std::string& nameKey =
+      infoDict->find(C_NAME_UTF8) ? C_NAME_UTF8 : C_NAME;
+    const bencode2::Node* nameData =
+      getNode(infoDict, nameKey, bencode2::Node::STRING);
     if(nameData) {
       utf8Name = util::encodeNonUtf8(nameData->s());
       if(util::detectDirTraversal(utf8Name)) {
@@ -225,46 +216,43 @@ void extractFileEntries
   }
   torrent->name = name;
   std::vector<SharedHandle<FileEntry> > fileEntries;
-  const List* filesList = asList(infoDict->get(C_FILES));
+  const bencode2::Node* filesList =
+    getNode(infoDict, C_FILES, bencode2::Node::LIST);
   if(filesList) {
-    fileEntries.reserve(filesList->size());
+    fileEntries.reserve(filesList->size);
     uint64_t length = 0;
     off_t offset = 0;
     // multi-file mode
     torrent->mode = MULTI;
-    for(List::ValueType::const_iterator itr = filesList->begin(),
-          eoi = filesList->end(); itr != eoi; ++itr) {
-      const Dict* fileDict = asDict(*itr);
-      if(!fileDict) {
+    for(const bencode2::Node* fileDict = filesList->first; fileDict;
+        fileDict = fileDict->next) {
+      if(fileDict->type != bencode2::Node::DICT) {
         continue;
       }
-      const Integer* fileLengthData = asInteger(fileDict->get(C_LENGTH));
+      const bencode2::Node* fileLengthData =
+        getNode(fileDict, C_LENGTH, bencode2::Node::INTEGER);
       if(!fileLengthData) {
         throw DL_ABORT_EX2(fmt(MSG_MISSING_BT_INFO, C_LENGTH.c_str()),
                            error_code::BITTORRENT_PARSE_ERROR);
       }
-      length += fileLengthData->i();
+      length += fileLengthData->integer;
 
-      std::string pathKey;
-      if(fileDict->containsKey(C_PATH_UTF8)) {
-        pathKey = C_PATH_UTF8;
-      } else {
-        pathKey = C_PATH;
-      }
-      const List* pathList = asList(fileDict->get(pathKey));
-      if(!pathList || pathList->empty()) {
+      const std::string& pathKey =
+        fileDict->find(C_PATH_UTF8) ? C_PATH_UTF8 : C_PATH;
+      const bencode2::Node* pathList =
+        getNode(fileDict, pathKey, bencode2::Node::LIST);
+      if(!pathList || pathList->size == 0) {
         throw DL_ABORT_EX2("Path is empty.",
                            error_code::BITTORRENT_PARSE_ERROR);
       }
       
-      std::vector<std::string> pathelem(pathList->size()+1);
+      std::vector<std::string> pathelem(pathList->size+1);
       pathelem[0] = name;
       std::vector<std::string>::iterator pathelemOutItr = pathelem.begin();
       ++pathelemOutItr;
-      for(List::ValueType::const_iterator itr = pathList->begin(),
-            eoi = pathList->end(); itr != eoi; ++itr) {
-        const String* elem = asString(*itr);
-        if(elem) {
+      for(const bencode2::Node* elem = pathList->first; elem;
+          elem = elem->next) {
+        if(elem->type == bencode2::Node::STRING) {
           (*pathelemOutItr++) = elem->s();
         } else {
           throw DL_ABORT_EX2("Path element is not string.",
@@ -287,7 +275,7 @@ void extractFileEntries
       SharedHandle<FileEntry> fileEntry
         (new FileEntry(util::applyDir(option->get(PREF_DIR),
                                       util::escapePath(utf8Path)),
-                       fileLengthData->i(), offset, uris));
+                       fileLengthData->integer, offset, uris));
       fileEntry->setOriginalName(path);
       fileEntries.push_back(fileEntry);
       offset += fileEntry->getLength();
@@ -295,12 +283,13 @@ void extractFileEntries
   } else {
     // single-file mode;
     torrent->mode = SINGLE;
-    const Integer* lengthData = asInteger(infoDict->get(C_LENGTH));
+    const bencode2::Node* lengthData =
+      getNode(infoDict, C_LENGTH, bencode2::Node::INTEGER);
     if(!lengthData) {
       throw DL_ABORT_EX2(fmt(MSG_MISSING_BT_INFO, C_LENGTH.c_str()),
                          error_code::BITTORRENT_PARSE_ERROR);
     }
-    uint64_t totalLength = lengthData->i();
+    uint64_t totalLength = lengthData->integer;
 
     // For each uri in urlList, if it ends with '/', then
     // concatenate name to it. Specification just says so.
@@ -329,21 +318,20 @@ void extractFileEntries
 
 namespace {
 void extractAnnounce
-(const SharedHandle<TorrentAttribute>& torrent, const Dict* rootDict)
+(const SharedHandle<TorrentAttribute>& torrent,
+ const bencode2::Node* rootDict)
 {
-  const List* announceList = asList(rootDict->get(C_ANNOUNCE_LIST));
+  const bencode2::Node* announceList =
+    getNode(rootDict, C_ANNOUNCE_LIST, bencode2::Node::LIST);
   if(announceList) {
-    for(List::ValueType::const_iterator tierIter = announceList->begin(),
-          eoi = announceList->end(); tierIter != eoi; ++tierIter) {
-      const List* tier = asList(*tierIter);
-      if(!tier) {
+    for(const bencode2::Node* tier = announceList->first; tier;
+        tier = tier->next) {
+      if(tier->type != bencode2::Node::LIST) {
         continue;
       }
       std::vector<std::string> ntier;
-      for(List::ValueType::const_iterator uriIter = tier->begin(),
-            eoi2 = tier->end(); uriIter != eoi2; ++uriIter) {
-        const String* uri = asString(*uriIter);
-        if(uri) {
+      for(const bencode2::Node* uri = tier->first; uri; uri = uri->next) {
+        if(uri->type == bencode2::Node::STRING) {
           ntier.push_back(util::strip(uri->s()));
         }
       }
@@ -352,7 +340,8 @@ void extractAnnounce
       }
     }
   } else {
-    const String* announce = asString(rootDict->get(C_ANNOUNCE));
+    const bencode2::Node* announce =
+      getNode(rootDict, C_ANNOUNCE, bencode2::Node::STRING);
     if(announce) {
       std::vector<std::string> tier;
       tier.push_back(util::strip(announce->s()));
@@ -364,29 +353,31 @@ void extractAnnounce
 
 namespace {
 void extractNodes
-(const SharedHandle<TorrentAttribute>& torrent, const ValueBase* nodesListSrc)
+(const SharedHandle<TorrentAttribute>& torrent,
+ const bencode2::Node* nodesList)
 {
-  const List* nodesList = asList(nodesListSrc);
-  if(nodesList) {
-    for(List::ValueType::const_iterator i = nodesList->begin(),
-          eoi = nodesList->end(); i != eoi; ++i) {
-      const List* addrPairList = asList(*i);
-      if(!addrPairList || addrPairList->size() != 2) {
-        continue;
-      }
-      const String* hostname = asString(addrPairList->get(0));
-      if(!hostname) {
-        continue;
-      }
-      if(util::strip(hostname->s()).empty()) {
-        continue;
-      }
-      const Integer* port = asInteger(addrPairList->get(1));
-      if(!port || !(0 < port->i() && port->i() < 65536)) {
-        continue;
-      }
-      torrent->nodes.push_back(std::make_pair(hostname->s(), port->i()));
+  if(!nodesList || nodesList->type != bencode2::Node::LIST) {
+    return;
+  }
+  for(const bencode2::Node* addrPairList = nodesList->first; addrPairList;
+      addrPairList = addrPairList->next) {
+    if(addrPairList->type != bencode2::Node::LIST ||
+       addrPairList->size != 2) {
+      continue;
+    }
+    const bencode2::Node* hostname = addrPairList->first;
+    if(hostname->type != bencode2::Node::STRING) {
+      continue;
+    }
+    if(util::strip(hostname->s()).empty()) {
+      continue;
+    }
+    const bencode2::Node* port = hostname->next;
+    if(port->type != bencode2::Node::INTEGER ||
+       !(0 < port->integer && port->integer < 65536)) {
+      continue;
     }
+    torrent->nodes.push_back(std::make_pair(hostname->s(), port->integer));
   }
 }
 } // namespace
@@ -394,18 +385,18 @@ void extractNodes
 namespace {
 void processRootDictionary
 (const SharedHandle<DownloadContext>& ctx,
- const SharedHandle<ValueBase>& root,
+ const bencode2::Node* rootDict,
  const SharedHandle<Option>& option,
  const std::string& defaultName,
  const std::string& overrideName,
  const std::vector<std::string>& uris)
 {
-  const Dict* rootDict = asDict(root);
-  if(!rootDict) {
+  if(!rootDict || rootDict->type != bencode2::Node::DICT) {
     throw DL_ABORT_EX2("torrent file does not contain a root dictionary.",
                        error_code::BITTORRENT_PARSE_ERROR);
   }
-  const Dict* infoDict = asDict(rootDict->get(C_INFO));
+  const bencode2::Node* infoDict =
+    getNode(rootDict, C_INFO, bencode2::Node::DICT);
   if(!infoDict) {
     throw DL_ABORT_EX2(fmt(MSG_MISSING_BT_INFO, C_INFO.c_str()),
                        error_code::BITTORRENT_PARSE_ERROR);
@@ -424,7 +415,8 @@ void processRootDictionary
   torrent->metadataSize = encodedInfoDict.size();
 
   // calculate the number of pieces
-  const String* piecesData = asString(infoDict->get(C_PIECES));
+  const bencode2::Node* piecesData =
+    getNode(infoDict, C_PIECES, bencode2::Node::STRING);
   if(!piecesData) {
     throw DL_ABORT_EX2(fmt(MSG_MISSING_BT_INFO, C_PIECES.c_str()),
                        error_code::BITTORRENT_PARSE_ERROR);
@@ -433,26 +425,28 @@ void processRootDictionary
   //   if(piecesData.s().empty()) {
   //     throw DL_ABORT_EX("The length of piece hash is 0.");
   //   }
-  size_t numPieces = piecesData->s().size()/PIECE_HASH_LENGTH;
+  size_t numPieces = piecesData->length/PIECE_HASH_LENGTH;
   // Commented out to download 0 length torrent.
   //   if(numPieces == 0) {
   //     throw DL_ABORT_EX("The number of pieces is 0.");
   //   }
   // retrieve piece length
-  const Integer* pieceLengthData = asInteger(infoDict->get(C_PIECE_LENGTH));
+  const bencode2::Node* pieceLengthData =
+    getNode(infoDict, C_PIECE_LENGTH, bencode2::Node::INTEGER);
   if(!pieceLengthData) {
     throw DL_ABORT_EX2(fmt(MSG_MISSING_BT_INFO, C_PIECE_LENGTH.c_str()),
                        error_code::BITTORRENT_PARSE_ERROR);
   }
-  size_t pieceLength = pieceLengthData->i();
+  size_t pieceLength = pieceLengthData->integer;
   ctx->setPieceLength(pieceLength);
   // retrieve piece hashes
-  extractPieceHash(ctx, piecesData->s(), PIECE_HASH_LENGTH, numPieces);
+  extractPieceHash(ctx, piecesData->str, PIECE_HASH_LENGTH, numPieces);
   // private flag
-  const Integer* privateData = asInteger(infoDict->get(C_PRIVATE));
+  const bencode2::Node* privateData =
+    getNode(infoDict, C_PRIVATE, bencode2::Node::INTEGER);
   int privatefg = 0;
   if(privateData) {
-    if(privateData->i() == 1) {
+    if(privateData->integer == 1) {
       privatefg = 1;
     }
   }
@@ -463,7 +457,7 @@ void processRootDictionary
   // This implemantation obeys HTTP-Seeding specification:
   // see http://www.getright.com/seedtorrent.html
   std::vector<std::string> urlList;
-  extractUrlList(torrent, urlList, rootDict->get(C_URL_LIST).get());
+  extractUrlList(torrent, urlList, rootDict->find(C_URL_LIST));
   urlList.insert(urlList.end(), uris.begin(), uris.end());
   std::sort(urlList.begin(), urlList.end());
   urlList.erase(std::unique(urlList.begin(), urlList.end()), urlList.end());
@@ -478,22 +472,26 @@ void processRootDictionary
   // retrieve announce
   extractAnnounce(torrent, rootDict);
   // retrieve nodes
-  extractNodes(torrent, rootDict->get(C_NODES).get());
+  extractNodes(torrent, rootDict->find(C_NODES));
 
-  const Integer* creationDate = asInteger(rootDict->get(C_CREATION_DATE));
+  const bencode2::Node* creationDate =
+    getNode(rootDict, C_CREATION_DATE, bencode2::Node::INTEGER);
   if(creationDate) {
-    torrent->creationDate = creationDate->i();
+    torrent->creationDate = creationDate->integer;
   }
-  const String* commentUtf8 = asString(rootDict->get(C_COMMENT_UTF8));
+  const bencode2::Node* commentUtf8 =
+    getNode(rootDict, C_COMMENT_UTF8, bencode2::Node::STRING);
   if(commentUtf8) {
     torrent->comment = commentUtf8->s();
   } else {
-    const String* comment = asString(rootDict->get(C_COMMENT));
+    const bencode2::Node* comment =
+      getNode(rootDict, C_COMMENT, bencode2::Node::STRING);
     if(comment) {
       torrent->comment = comment->s();
     }
   }
-  const String* createdBy = asString(rootDict->get(C_CREATED_BY));
+  const bencode2::Node* createdBy =
+    getNode(rootDict, C_CREATED_BY, bencode2::Node::STRING);
   if(createdBy) {
     torrent->createdBy = createdBy->s();
   }
@@ -507,8 +505,9 @@ void load(const std::string& torrentFile,
           const SharedHandle<Option>& option,
           const std::string& overrideName)
 {
+  bencode2::Document doc;
   processRootDictionary(ctx,
-                        bencode2::decodeFromFile(torrentFile),
+                        doc.parseFile(torrentFile),
                         option,
                         torrentFile,
                         overrideName,
@@ -521,8 +520,9 @@ void load(const std::string& torrentFile,
           const std::vector<std::string>& uris,
           const std::string& overrideName)
 {
+  bencode2::Document doc;
   processRootDictionary(ctx,
-                        bencode2::decodeFromFile(torrentFile),
+                        doc.parseFile(torrentFile),
                         option,
                         torrentFile,
                         overrideName,
@@ -536,8 +536,9 @@ void loadFromMemory(const unsigned char* content,
                     const std::string& defaultName,
                     const std::string& overrideName)
 {
+  bencode2::Document doc;
   processRootDictionary(ctx,
-                        bencode2::decode(content, length),
+                        doc.parse(content, length),
                         option,
                         defaultName,
                         overrideName,
@@ -552,8 +553,9 @@ void loadFromMemory(const unsigned char* content,
                     const std::string& defaultName,
                     const std::string& overrideName)
 {
+  bencode2::Document doc;
   processRootDictionary(ctx,
-                        bencode2::decode(content, length),
+                        doc.parse(content, length),
                         option,
                         defaultName,
                         overrideName,
@@ -566,9 +568,11 @@ void loadFromMemory(const std::string& context,
                     const std::string& defaultName,
                     const std::string& overrideName)
 {
+  bencode2::Document doc;
   processRootDictionary
     (ctx,
-     bencode2::decode(context),
+     doc.parse(reinterpret_cast<const unsigned char*>(context.data()),
+               context.size()),
      option,
      defaultName, overrideName,
      std::vector<std::string>());
@@ -581,9 +585,11 @@ void loadFromMemory(const std::string& context,
                     const std::string& defaultName,
                     const std::string& overrideName)
 {
+  bencode2::Document doc;
   processRootDictionary
     (ctx,
-     bencode2::decode(context),
+     doc.parse(reinterpret_cast<const unsigned char*>(context.data()),
+               context.size()),
      option,
      defaultName, overrideName,
      uris);
@@ -206,6 +206,16 @@ const std::string PREF_MAX_DOWNLOAD_RESULT("max-download-result");
 const std::string PREF_RETRY_WAIT("retry-wait");
 // value: string
 const std::string PREF_ASYNC_DNS_SERVER("async-dns-server");
+// value: 1*digit
+const std::string PREF_DISK_CACHE("disk-cache");
+// value: 1*digit
+const std::string PREF_HASH_CHECK_THREADS("hash-check-threads");
+// value: 1*digit
+const std::string PREF_MAX_CONCURRENT_CHECKS("max-concurrent-checks");
+// value: 1*digit
+const std::string PREF_MAX_RECV_BUFFER_SIZE("max-recv-buffer-size");
+// value: 1*digit
+const std::string PREF_ENGINE_SHARDS("engine-shards");
 
 /**
  * FTP related preferences
@@ -210,6 +210,16 @@ extern const std::string PREF_MAX_DOWNLOAD_RESULT;
 extern const std::string PREF_RETRY_WAIT;
 // value: string
 extern const std::string PREF_ASYNC_DNS_SERVER;
+// value: 1*digit
+extern const std::string PREF_DISK_CACHE;
+// value: 1*digit
+extern const std::string PREF_HASH_CHECK_THREADS;
+// value: 1*digit
+extern const std::string PREF_MAX_CONCURRENT_CHECKS;
+// value: 1*digit
+extern const std::string PREF_MAX_RECV_BUFFER_SIZE;
+// value: 1*digit
+extern const std::string PREF_ENGINE_SHARDS;
 
 /**
  * FTP related preferences
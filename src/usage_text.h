@@ -764,3 +764,34 @@
     "                              option is useful when the system does not have\n" \
     "                              /etc/resolv.conf and user does not have the\n" \
     "                              permission to create it.")
+#define TEXT_DISK_CACHE                         \
+  _(" --disk-cache=SIZE            Enable disk cache. If SIZE is 0, the disk cache\n" \
+    "                              is disabled. The downloaded data is buffered in\n" \
+    "                              memory up to SIZE bytes in total, and written to\n" \
+    "                              disk in larger contiguous chunks. The data of a\n" \
+    "                              piece is written when the piece is completed,\n" \
+    "                              when the cache is full and before the control\n" \
+    "                              file is saved.\n" \
+    "                              You can append K or M(1K = 1024, 1M = 1024K).")
+#define TEXT_HASH_CHECK_THREADS                 \
+  _(" --hash-check-threads=N       Set the number of threads which compute piece\n" \
+    "                              hashes for hash check. If 0 is given, hash check\n" \
+    "                              is done in the event loop. This option has no\n" \
+    "                              effect if aria2 was built without thread\n" \
+    "                              support.")
+#define TEXT_MAX_CONCURRENT_CHECKS              \
+  _(" --max-concurrent-checks=N    Set the maximum number of downloads whose hash\n" \
+    "                              check is done concurrently.")
+#define TEXT_MAX_RECV_BUFFER_SIZE               \
+  _(" --max-recv-buffer-size=SIZE  Set the maximum size of the buffer used to\n" \
+    "                              receive HTTP/FTP response body. The buffer\n" \
+    "                              starts at 16KiB and grows up to SIZE while the\n" \
+    "                              server sends data faster than aria2 reads it.\n" \
+    "                              You can append K or M(1K = 1024, 1M = 1024K).")
+#define TEXT_ENGINE_SHARDS                      \
+  _(" --engine-shards=N            Run downloads in N processes, each of which has\n" \
+    "                              its own event loop. The downloads given in the\n" \
+    "                              command-line or input file are distributed among\n" \
+    "                              them. The processes share no state such as DNS\n" \
+    "                              cache, cookies and server statistics. This option\n" \
+    "                              is ignored if --enable-xml-rpc is given.")
@@ -0,0 +1,40 @@
+#ifndef D_BENCH_H
+#define D_BENCH_H
+
+#include "common.h"
+
+#include <string>
+
+namespace aria2 {
+
+namespace bench {
+
+typedef void (*BenchmarkFunc)();
+
+// Registers benchmark function to be run by bench program. Use
+// A2_BENCHMARK macro instead of using this class directly.
+class Registrar {
+public:
+  Registrar(const char* name, BenchmarkFunc func);
+};
+
+// Returns current time in microseconds.
+int64_t now();
+
+// Prints the result of benchmark. elapsed is in microseconds.
+void report(const std::string& name, int64_t iteration, int64_t elapsed);
+
+// Stores value to a volatile variable, so that the compiler cannot
+// optimize away the benchmarked code which computed value.
+void consume(uint64_t value);
+
+} // namespace bench
+
+} // namespace aria2
+
+#define A2_BENCHMARK(func)                                              \
+  namespace {                                                           \
+  aria2::bench::Registrar func##Registrar(#func, func);                 \
+  }
+
+#endif // D_BENCH_H
@@ -0,0 +1,77 @@
+#include "Bench.h"
+
+#include <sys/time.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <utility>
+
+#include "Platform.h"
+
+namespace aria2 {
+
+namespace bench {
+
+namespace {
+volatile uint64_t sink;
+} // namespace
+
+namespace {
+std::vector<std::pair<const char*, BenchmarkFunc> >& getBenchmarks()
+{
+  static std::vector<std::pair<const char*, BenchmarkFunc> > benchmarks;
+  return benchmarks;
+}
+} // namespace
+
+Registrar::Registrar(const char* name, BenchmarkFunc func)
+{
+  getBenchmarks().push_back(std::make_pair(name, func));
+}
+
+int64_t now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (int64_t)tv.tv_sec*1000000+tv.tv_usec;
+}
+
+void report(const std::string& name, int64_t iteration, int64_t elapsed)
+{
+  printf("  %-50s %10lld iterations %12.1f ns/op\n",
+         name.c_str(), static_cast<long long int>(iteration),
+         iteration == 0 ? 0.0 : elapsed*1000.0/iteration);
+}
+
+void consume(uint64_t value)
+{
+  sink = value;
+}
+
+} // namespace bench
+
+} // namespace aria2
+
+// Runs all benchmarks, or the benchmarks whose name contains one of
+// the arguments.
+int main(int argc, char* argv[])
+{
+  aria2::Platform platform;
+  std::vector<std::pair<const char*, aria2::bench::BenchmarkFunc> >&
+    benchmarks = aria2::bench::getBenchmarks();
+  for(size_t i = 0; i < benchmarks.size(); ++i) {
+    bool run = argc < 2;
+    for(int j = 1; j < argc; ++j) {
+      if(strstr(benchmarks[i].first, argv[j])) {
+        run = true;
+        break;
+      }
+    }
+    if(run) {
+      printf("%s\n", benchmarks[i].first);
+      benchmarks[i].second();
+    }
+  }
+  return 0;
+}
@@ -11,14 +11,22 @@ class Bencode2Test:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(Bencode2Test);
   CPPUNIT_TEST(testDecode);
   CPPUNIT_TEST(testDecode_overflow);
+  CPPUNIT_TEST(testDecode_integer);
+  CPPUNIT_TEST(testDecodeFromFile);
+  CPPUNIT_TEST(testDocument);
   CPPUNIT_TEST(testEncode);
+  CPPUNIT_TEST(testEncode_node);
   CPPUNIT_TEST_SUITE_END();
 private:
 
 public:
   void testDecode();
   void testDecode_overflow();
+  void testDecode_integer();
+  void testDecodeFromFile();
+  void testDocument();
   void testEncode();
+  void testEncode_node();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( Bencode2Test );
@@ -180,6 +188,94 @@ void Bencode2Test::testDecode_overflow()
   }
 }
 
+void Bencode2Test::testDecode_integer()
+{
+  CPPUNIT_ASSERT_EQUAL(static_cast<Integer::ValueType>(-5),
+                       asInteger(bencode2::decode("i-5e"))->i());
+  CPPUNIT_ASSERT_EQUAL(static_cast<Integer::ValueType>(INT64_MIN),
+                       asInteger(bencode2::decode
+                                 ("i-9223372036854775808e"))->i());
+  CPPUNIT_ASSERT_EQUAL(static_cast<Integer::ValueType>(INT64_MAX),
+                       asInteger(bencode2::decode
+                                 ("i9223372036854775807e"))->i());
+  const char* bad[] = { "ie", "i-e", "i9223372036854775808e" };
+  for(size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+    try {
+      bencode2::decode(bad[i]);
+      CPPUNIT_FAIL("exception must be thrown.");
+    } catch(RecoverableException& e) {
+      CPPUNIT_ASSERT_EQUAL(std::string("Bencode decoding failed:"
+                                       " Integer expected but none found"),
+                           std::string(e.what()));
+    }
+  }
+}
+
+void Bencode2Test::testDecodeFromFile()
+{
+  SharedHandle<ValueBase> r =
+    bencode2::decodeFromFile(A2_TEST_DIR"/test.torrent");
+  const Dict* dict = asDict(r);
+  CPPUNIT_ASSERT(dict);
+  CPPUNIT_ASSERT(asDict(dict->get("info")));
+  try {
+    bencode2::decodeFromFile(A2_TEST_DIR"/nonexistent");
+    CPPUNIT_FAIL("exception must be thrown.");
+  } catch(RecoverableException& e) {
+    // success
+  }
+}
+
+void Bencode2Test::testDocument()
+{
+  std::string data =
+    "d4:name5:aria24:sizei12345678900e5:filesl3:bin3:doce0:0:etrail";
+  bencode2::Document doc;
+  size_t end;
+  const bencode2::Node* root =
+    doc.parse(reinterpret_cast<const unsigned char*>(data.data()),
+              data.size(), end);
+  CPPUNIT_ASSERT_EQUAL(data.size()-5, end);
+  CPPUNIT_ASSERT_EQUAL(bencode2::Node::DICT, root->type);
+  CPPUNIT_ASSERT_EQUAL((size_t)4, root->size);
+  const bencode2::Node* name = root->find("name");
+  CPPUNIT_ASSERT_EQUAL(bencode2::Node::STRING, name->type);
+  CPPUNIT_ASSERT_EQUAL(std::string("aria2"), name->s());
+  // Strings point into the decoded buffer.
+  CPPUNIT_ASSERT(data.data()+9 == name->str);
+  CPPUNIT_ASSERT_EQUAL((int64_t)12345678900LL, root->find("size")->integer);
+  const bencode2::Node* files = root->find("files");
+  CPPUNIT_ASSERT_EQUAL(bencode2::Node::LIST, files->type);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, files->size);
+  CPPUNIT_ASSERT_EQUAL(std::string("bin"), files->first->s());
+  CPPUNIT_ASSERT_EQUAL(std::string("doc"), files->first->next->s());
+  CPPUNIT_ASSERT(!files->first->next->next);
+  CPPUNIT_ASSERT_EQUAL(std::string(""), root->find("")->s());
+  CPPUNIT_ASSERT(!root->find("nonexistent"));
+  CPPUNIT_ASSERT(!files->find("bin"));
+  CPPUNIT_ASSERT_EQUAL(std::string("doc"), files->get(1)->s());
+  CPPUNIT_ASSERT(!files->get(2));
+  CPPUNIT_ASSERT(!root->get(0));
+  CPPUNIT_ASSERT(name->equals("aria2"));
+  CPPUNIT_ASSERT(!name->equals("aria"));
+  CPPUNIT_ASSERT(!files->equals("aria2"));
+  // Lists and dicts keep their bencoded data.
+  CPPUNIT_ASSERT_EQUAL(std::string("l3:bin3:doce"), files->s());
+  CPPUNIT_ASSERT_EQUAL(data.substr(0, end), root->s());
+
+  // The last one wins if the key appears more than once.
+  std::string dup = "d1:ai1e1:ai2ee";
+  const bencode2::Node* dupRoot =
+    doc.parse(reinterpret_cast<const unsigned char*>(dup.data()), dup.size());
+  CPPUNIT_ASSERT_EQUAL((int64_t)2, dupRoot->find("a")->integer);
+
+  const bencode2::Node* torrent =
+    doc.parseFile(A2_TEST_DIR"/test.torrent");
+  CPPUNIT_ASSERT(torrent->find("info"));
+  // Nodes decoded earlier are still valid.
+  CPPUNIT_ASSERT_EQUAL(std::string("aria2"), name->s());
+}
+
 void Bencode2Test::testEncode()
 {
   {
@@ -203,4 +299,28 @@ void Bencode2Test::testEncode()
   }
 }
 
+void Bencode2Test::testEncode_node()
+{
+  {
+    // Canonical data is encoded as it is.
+    std::string data = "d5:filesl6:aria2ci-80ee4:name5:aria2e";
+    bencode2::Document doc;
+    const bencode2::Node* root = doc.parse
+      (reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    CPPUNIT_ASSERT_EQUAL(data, bencode2::encode(root));
+  }
+  {
+    // Unsorted keys are sorted and the last duplicate key is used,
+    // just like encoding the ValueBase tree.
+    std::string data = "d1:bi1e1:ad1:yi1e1:xi2ee1:bi3ee";
+    bencode2::Document doc;
+    const bencode2::Node* root = doc.parse
+      (reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("d1:ad1:xi2e1:yi1ee1:bi3ee"),
+                         bencode2::encode(root));
+    CPPUNIT_ASSERT_EQUAL(bencode2::encode(bencode2::toValueBase(root)),
+                         bencode2::encode(root));
+  }
+}
+
 } // namespace aria2
@@ -0,0 +1,192 @@
+#include "Bench.h"
+
+#include <string>
+#include <sstream>
+#include <fstream>
+
+#include "bencode2.h"
+#include "util.h"
+
+namespace aria2 {
+
+namespace {
+// The istream based decoder which bencode2::decode used before
+// bencode2::Document was introduced, kept as the reference.
+SharedHandle<ValueBase> refDecode(std::istream& ss);
+
+std::string refDecodeRawString(std::istream& ss)
+{
+  int length;
+  ss >> length;
+  char d;
+  ss.get(d);
+  char* buf = new char[length];
+  ss.read(buf, length);
+  std::string str(&buf[0], &buf[length]);
+  delete [] buf;
+  return str;
+}
+
+SharedHandle<ValueBase> refDecode(std::istream& ss)
+{
+  char c;
+  ss.get(c);
+  if(c == 'd') {
+    SharedHandle<Dict> dict = Dict::g();
+    while(ss.get(c) && c != 'e') {
+      ss.unget();
+      std::string key = refDecodeRawString(ss);
+      dict->put(key, refDecode(ss));
+    }
+    return dict;
+  } else if(c == 'l') {
+    SharedHandle<List> list = List::g();
+    while(ss.get(c) && c != 'e') {
+      ss.unget();
+      list->append(refDecode(ss));
+    }
+    return list;
+  } else if(c == 'i') {
+    Integer::ValueType iv;
+    ss >> iv;
+    ss.get(c);
+    return Integer::g(iv);
+  } else {
+    ss.unget();
+    return String::g(refDecodeRawString(ss));
+  }
+}
+
+// Returns a multi-file torrent with numFiles files.
+std::string createTorrent(size_t numFiles)
+{
+  std::string files;
+  for(size_t i = 0; i < numFiles; ++i) {
+    std::string name = "file"+util::uitos(i)+".dat";
+    files += "d6:lengthi"+util::uitos(1000+i)+"e"
+      "4:pathl3:dir"+util::uitos(name.size())+":"+name+"ee";
+  }
+  size_t numPieces = numFiles/16+1;
+  return "d8:announce30:http://tracker.example.org/ann"
+    "4:infod5:filesl"+files+"e"
+    "4:name5:aria2"
+    "12:piece lengthi262144e"
+    "6:pieces"+util::uitos(numPieces*20)+":"+std::string(numPieces*20, 'x')+
+    "ee";
+}
+
+// Measures decoding a torrent with 200k files from memory and from a
+// file.
+void benchDecodeTorrent()
+{
+  std::string torrent = createTorrent(200000);
+  const unsigned char* data =
+    reinterpret_cast<const unsigned char*>(torrent.data());
+  const int64_t iteration = 5;
+  size_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      std::istringstream ss(torrent);
+      sum += asDict(refDecode(ss))->size();
+    }
+    bench::report("istream decode (reference)", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += asDict(bencode2::decode(data, torrent.size()))->size();
+    }
+    bench::report("bencode2::decode()", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      bencode2::Document doc;
+      sum += doc.parse(data, torrent.size())->size;
+    }
+    bench::report("bencode2::Document::parse()",
+                  iteration, bench::now()-start);
+  }
+  std::string filename = A2_TEST_OUT_DIR"/aria2_BencodeBench.torrent";
+  {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out << torrent;
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      std::ifstream in(filename.c_str(), std::ios::binary);
+      sum += asDict(refDecode(in))->size();
+    }
+    bench::report("ifstream decode (reference)",
+                  iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += asDict(bencode2::decodeFromFile(filename))->size();
+    }
+    bench::report("bencode2::decodeFromFile()",
+                  iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      bencode2::Document doc;
+      sum += doc.parseFile(filename)->size;
+    }
+    bench::report("bencode2::Document::parseFile()",
+                  iteration, bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchDecodeTorrent)
+
+namespace {
+// Measures decoding a small message like DHT get_peers response.
+void benchDecodeDHTMessage()
+{
+  std::string msg = "d1:rd2:id20:"+std::string(20, 'a')+
+    "5:token8:abcdefgh6:valuesl";
+  for(size_t i = 0; i < 8; ++i) {
+    msg += "6:"+std::string(6, 'p');
+  }
+  msg += "ee1:t2:aa1:y1:re";
+  const unsigned char* data =
+    reinterpret_cast<const unsigned char*>(msg.data());
+  const int64_t iteration = 100000;
+  size_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      std::istringstream ss(msg);
+      sum += asDict(refDecode(ss))->size();
+    }
+    bench::report("istream decode (reference)", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += asDict(bencode2::decode(data, msg.size()))->size();
+    }
+    bench::report("bencode2::decode()", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      bencode2::Document doc;
+      sum += doc.parse(data, msg.size())->size;
+    }
+    bench::report("bencode2::Document::parse()",
+                  iteration, bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchDecodeDHTMessage)
+
+} // namespace aria2
@@ -0,0 +1,106 @@
+#include "Bench.h"
+
+#include <vector>
+
+#include "BitfieldMan.h"
+#include "bitfield.h"
+#include "array_fun.h"
+
+namespace aria2 {
+
+namespace {
+const size_t NUM_PIECES = 1024*1024;
+const size_t PIECE_LENGTH = 16*1024;
+
+// The first missing piece is the last one, so that every search
+// scans the whole bitfield.
+void setAllButLast(BitfieldMan& bf)
+{
+  bf.setAllBit();
+  bf.unsetBit(NUM_PIECES-1);
+}
+
+size_t scanBitByBit(const unsigned char* bitfield, size_t nbits)
+{
+  for(size_t i = 0; i < nbits; ++i) {
+    if(!bitfield::test(bitfield, nbits, i)) {
+      return i;
+    }
+  }
+  return nbits;
+}
+
+// Measures the BitfieldMan operations called for each piece request
+// and each completed piece on a bitfield of 1M pieces.
+void benchBitfieldMan()
+{
+  BitfieldMan bf(PIECE_LENGTH, (uint64_t)NUM_PIECES*PIECE_LENGTH);
+  setAllButLast(bf);
+  const int64_t iteration = 1000;
+  size_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += scanBitByBit(bf.getBitfield(), NUM_PIECES);
+    }
+    bench::report("bit at a time scan (reference)",
+                  iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      size_t index;
+      bf.getFirstMissingUnusedIndex(index);
+      sum += index;
+    }
+    bench::report("getFirstMissingUnusedIndex()",
+                  iteration, bench::now()-start);
+  }
+  {
+    std::vector<unsigned char> peerBitfield(bf.getBitfieldLength(), 0);
+    bitfield::flipBit(&peerBitfield[0], peerBitfield.size(), NUM_PIECES-1);
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += bf.hasMissingPiece(&peerBitfield[0], peerBitfield.size());
+    }
+    bench::report("hasMissingPiece()", iteration, bench::now()-start);
+  }
+  {
+    std::vector<unsigned char> peerBitfield(bf.getBitfieldLength(), 0xffu);
+    std::vector<unsigned char> misbitfield(bf.getBitfieldLength());
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += bf.getAllMissingUnusedIndexes
+        (&misbitfield[0], misbitfield.size(),
+         &peerBitfield[0], peerBitfield.size());
+    }
+    bench::report("getAllMissingUnusedIndexes()",
+                  iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += bf.isBitRangeSet(0, NUM_PIECES-2);
+    }
+    bench::report("isBitRangeSet()", iteration, bench::now()-start);
+  }
+  {
+    // setBit() recounts the bitfield in updateCache().
+    bf.addFilter(0, (uint64_t)NUM_PIECES/2*PIECE_LENGTH);
+    bf.enableFilter();
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      bf.setBit(NUM_PIECES-1);
+      bf.unsetBit(NUM_PIECES-1);
+      sum += bf.countMissingBlock();
+    }
+    bench::report("setBit()+unsetBit() with filter",
+                  iteration, bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchBitfieldMan)
+
+} // namespace aria2
@@ -26,6 +26,7 @@ class BitfieldManTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testGetSparceMissingUnusedIndex_setBit);
   CPPUNIT_TEST(testGetSparceMissingUnusedIndex_withMinSplitSize);
   CPPUNIT_TEST(testIsBitSetOffsetRange);
+  CPPUNIT_TEST(testIsBitRangeSet);
   CPPUNIT_TEST(testGetMissingUnusedLength);
   CPPUNIT_TEST(testSetBitRange);
   CPPUNIT_TEST(testGetAllMissingIndexes);
@@ -56,6 +57,7 @@ public:
   void testGetSparceMissingUnusedIndex_setBit();
   void testGetSparceMissingUnusedIndex_withMinSplitSize();
   void testIsBitSetOffsetRange();
+  void testIsBitRangeSet();
   void testGetMissingUnusedLength();
   void testSetBitRange();
   void testCountFilteredBlock();
@@ -443,6 +445,25 @@ void BitfieldManTest::testIsBitSetOffsetRange()
   CPPUNIT_ASSERT(!bitfield.isBitSetOffsetRange(pieceLength*100, pieceLength*3));
 }
 
+void BitfieldManTest::testIsBitRangeSet()
+{
+  BitfieldMan bf(1024, 1024*200);
+  bf.setBitRange(10, 150);
+  CPPUNIT_ASSERT(bf.isBitRangeSet(10, 150));
+  CPPUNIT_ASSERT(bf.isBitRangeSet(64, 127));
+  CPPUNIT_ASSERT(bf.isBitRangeSet(150, 150));
+  CPPUNIT_ASSERT(!bf.isBitRangeSet(9, 150));
+  CPPUNIT_ASSERT(!bf.isBitRangeSet(10, 151));
+  bf.unsetBit(100);
+  CPPUNIT_ASSERT(!bf.isBitRangeSet(10, 150));
+  CPPUNIT_ASSERT(bf.isBitRangeSet(101, 150));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)140*1024, bf.getCompletedLength());
+
+  bf.setAllBit();
+  CPPUNIT_ASSERT(bf.isBitRangeSet(0, 199));
+  CPPUNIT_ASSERT(bf.isAllBitSet());
+}
+
 void BitfieldManTest::testGetMissingUnusedLength()
 {
   uint64_t totalLength = 1024*10+10;
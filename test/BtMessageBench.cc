@@ -0,0 +1,151 @@
+#include "Bench.h"
+
+#include "DefaultBtMessageFactory.h"
+#include "DownloadContext.h"
+#include "Peer.h"
+#include "BtHaveMessage.h"
+#include "BtRequestMessage.h"
+#include "BtPieceMessage.h"
+#include "IndexBtMessageValidator.h"
+#include "RangeBtMessageValidator.h"
+#include "BtPieceMessageValidator.h"
+#include "SocketBuffer.h"
+#include "MockPieceStorage.h"
+#include "bittorrent_helper.h"
+
+namespace aria2 {
+
+namespace {
+const size_t PIECE_LENGTH = 256*1024;
+const size_t NUM_PIECES = 1024;
+
+// Creates a message from data the way DefaultBtMessageFactory did
+// before messages were pooled: a new message and a new validator for
+// each message.
+SharedHandle<BtMessage> createHaveRef
+(const unsigned char* data, size_t dataLength)
+{
+  SharedHandle<BtHaveMessage> m = BtHaveMessage::create(data, dataLength);
+  m->setBtMessageValidator
+    (SharedHandle<BtMessageValidator>
+     (new IndexBtMessageValidator(m.get(), NUM_PIECES)));
+  m->validate();
+  return m;
+}
+
+SharedHandle<BtMessage> createRequestRef
+(const unsigned char* data, size_t dataLength)
+{
+  SharedHandle<BtRequestMessage> m =
+    BtRequestMessage::create(data, dataLength);
+  m->setBtMessageValidator
+    (SharedHandle<BtMessageValidator>
+     (new RangeBtMessageValidator(m.get(), NUM_PIECES, PIECE_LENGTH)));
+  m->validate();
+  return m;
+}
+
+SharedHandle<BtMessage> createPieceRef
+(const unsigned char* data, size_t dataLength)
+{
+  SharedHandle<BtPieceMessage> m = BtPieceMessage::create(data, dataLength);
+  m->setBtMessageValidator
+    (SharedHandle<BtMessageValidator>
+     (new BtPieceMessageValidator(m.get(), NUM_PIECES, PIECE_LENGTH)));
+  m->validate();
+  return m;
+}
+
+// Measures creating received have, request and piece messages,
+// which are the most frequent ones in a swarm.
+void benchCreateBtMessage()
+{
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(PIECE_LENGTH, (uint64_t)PIECE_LENGTH*NUM_PIECES));
+  SharedHandle<MockPieceStorage> pieceStorage(new MockPieceStorage());
+  for(size_t i = 0; i < NUM_PIECES; ++i) {
+    pieceStorage->addPieceLengthList(PIECE_LENGTH);
+  }
+  SharedHandle<Peer> peer(new Peer("192.168.0.1", 6881));
+  DefaultBtMessageFactory factory;
+  factory.setDownloadContext(dctx);
+  factory.setPieceStorage(pieceStorage);
+  factory.setPeer(peer);
+
+  unsigned char have[9];
+  bittorrent::createPeerMessageString(have, sizeof(have), 5, BtHaveMessage::ID);
+  bittorrent::setIntParam(&have[5], 100);
+  unsigned char request[17];
+  bittorrent::createPeerMessageString(request, sizeof(request), 13,
+                                      BtRequestMessage::ID);
+  bittorrent::setIntParam(&request[5], 100);
+  bittorrent::setIntParam(&request[9], 16*1024);
+  bittorrent::setIntParam(&request[13], 16*1024);
+  // Only the header is parsed, so that the block is omitted.
+  unsigned char piece[13];
+  bittorrent::createPeerMessageString(piece, sizeof(piece), 9+16*1024,
+                                      BtPieceMessage::ID);
+  bittorrent::setIntParam(&piece[5], 100);
+  bittorrent::setIntParam(&piece[9], 16*1024);
+
+  const int64_t iteration = 1000000;
+  size_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += createHaveRef(&have[4], sizeof(have)-4)->getId();
+      sum += createRequestRef(&request[4], sizeof(request)-4)->getId();
+      sum += createPieceRef(&piece[4], 9+16*1024)->getId();
+    }
+    bench::report("new message and validator (reference)",
+                  iteration*3, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += factory.createBtMessage(&have[4], sizeof(have)-4)->getId();
+      sum += factory.createBtMessage(&request[4], sizeof(request)-4)->getId();
+      sum += factory.createBtMessage(&piece[4], 9+16*1024)->getId();
+    }
+    bench::report("DefaultBtMessageFactory::createBtMessage()",
+                  iteration*3, bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchCreateBtMessage)
+
+namespace {
+// Measures encoding request messages into a new buffer, which
+// SimpleBtMessage::send() did before, and into a stack buffer.
+void benchEncodeBtMessage()
+{
+  BtRequestMessage msg(100, 16*1024, 16*1024);
+  const int64_t iteration = 10000000;
+  size_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      unsigned char* data = msg.createMessage();
+      sum += data[4];
+      delete [] data;
+    }
+    bench::report("createMessage() (reference)", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      unsigned char data[SocketBuffer::INLINE_BUF_SIZE];
+      msg.writeMessage(data);
+      sum += data[4];
+    }
+    bench::report("writeMessage()", iteration, bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchEncodeBtMessage)
+
+} // namespace aria2
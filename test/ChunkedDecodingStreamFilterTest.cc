@@ -21,6 +21,8 @@ class ChunkedDecodingStreamFilterTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testTransform_largeChunkSize);
   CPPUNIT_TEST(testTransform_tooLargeChunkSize);
   CPPUNIT_TEST(testTransform_chunkSizeMismatch);
+  CPPUNIT_TEST(testTransform_byteByByte);
+  CPPUNIT_TEST(testTransform_bytesProcessed);
   CPPUNIT_TEST(testGetName);
   CPPUNIT_TEST_SUITE_END();
 
@@ -50,6 +52,8 @@ public:
   void testTransform_largeChunkSize();
   void testTransform_tooLargeChunkSize();
   void testTransform_chunkSizeMismatch();
+  void testTransform_byteByByte();
+  void testTransform_bytesProcessed();
   void testGetName();
 };
 
@@ -231,6 +235,34 @@ void ChunkedDecodingStreamFilterTest::testTransform_chunkSizeMismatch()
   }
 }
 
+void ChunkedDecodingStreamFilterTest::testTransform_byteByByte()
+{
+  std::string msg = "3;ext\r\n123\r\nA\r\n1234567890\r\n0\r\nt1\r\n\r\n";
+  ssize_t outlen = 0;
+  for(size_t i = 0; i < msg.size(); ++i) {
+    CPPUNIT_ASSERT(!filter_->finished());
+    outlen += filter_->transform
+      (writer_, segment_,
+       reinterpret_cast<const unsigned char*>(msg.data()+i), 1);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, filter_->getBytesProcessed());
+  }
+  CPPUNIT_ASSERT(filter_->finished());
+  CPPUNIT_ASSERT_EQUAL((ssize_t)13, outlen);
+}
+
+void ChunkedDecodingStreamFilterTest::testTransform_bytesProcessed()
+{
+  // The bytes after the end of stream belong to the next response and
+  // must not be consumed.
+  std::string msg = "2\r\nab\r\n0\r\nt1\r\n\r\nHTTP/1.1 200 OK\r\n";
+  ssize_t r = filter_->transform
+    (writer_, segment_,
+     reinterpret_cast<const unsigned char*>(msg.data()), msg.size());
+  CPPUNIT_ASSERT_EQUAL((ssize_t)2, r);
+  CPPUNIT_ASSERT(filter_->finished());
+  CPPUNIT_ASSERT_EQUAL(msg.size()-17, filter_->getBytesProcessed());
+}
+
 void ChunkedDecodingStreamFilterTest::testGetName()
 {
   CPPUNIT_ASSERT_EQUAL
@@ -340,6 +340,10 @@ void DHTBucketTest::testMoveToHead()
   }
   bucket.moveToHead(nodes[DHTBucket::K-1]);
   CPPUNIT_ASSERT(*bucket.getNodes().front() == *nodes[DHTBucket::K-1]);
+  for(size_t i = 0; i < DHTBucket::K; ++i) {
+    CPPUNIT_ASSERT(memcmp(bucket.getNodeAt(i)->getID(), bucket.getNodeIDAt(i),
+                          DHT_ID_LENGTH) == 0);
+  }
 }
 
 void DHTBucketTest::testMoveToTail()
@@ -358,6 +362,10 @@ void DHTBucketTest::testMoveToTail()
   }
   bucket.moveToTail(nodes[0]);
   CPPUNIT_ASSERT(*bucket.getNodes().back() == *nodes[0]);
+  for(size_t i = 0; i < DHTBucket::K; ++i) {
+    CPPUNIT_ASSERT(memcmp(bucket.getNodeAt(i)->getID(), bucket.getNodeIDAt(i),
+                          DHT_ID_LENGTH) == 0);
+  }
 }
 
 void DHTBucketTest::testGetGoodNodes()
@@ -432,7 +440,7 @@ void DHTBucketTest::testDropNode()
   bucket.dropNode(nodes[3]);
   // nothing happens because the replacement cache is empty.
   {
-    std::deque<SharedHandle<DHTNode> > tnodes = bucket.getNodes();
+    std::vector<SharedHandle<DHTNode> > tnodes = bucket.getNodes();
     CPPUNIT_ASSERT_EQUAL((size_t)8, tnodes.size());
     CPPUNIT_ASSERT(*nodes[3] == *tnodes[3]);
   }
@@ -442,7 +450,7 @@ void DHTBucketTest::testDropNode()
 
   bucket.dropNode(nodes[3]);
   {
-    std::deque<SharedHandle<DHTNode> > tnodes = bucket.getNodes();
+    std::vector<SharedHandle<DHTNode> > tnodes = bucket.getNodes();
     CPPUNIT_ASSERT_EQUAL((size_t)8, tnodes.size());
     CPPUNIT_ASSERT(tnodes.end() ==
                    std::find_if(tnodes.begin(), tnodes.end(),
@@ -6,6 +6,7 @@
 #include "Exception.h"
 #include "SocketCore.h"
 #include "A2STR.h"
+#include "util.h"
 
 namespace aria2 {
 
@@ -13,6 +14,7 @@ class DHTConnectionImplTest:public CppUnit::TestFixture {
 
   CPPUNIT_TEST_SUITE(DHTConnectionImplTest);
   CPPUNIT_TEST(testWriteAndReadData);
+  CPPUNIT_TEST(testWriteAndReadData_batch);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -20,6 +22,7 @@ public:
   void tearDown() {}
 
   void testWriteAndReadData();
+  void testWriteAndReadData_batch();
 };
 
 
@@ -40,6 +43,7 @@ void DHTConnectionImplTest::testWriteAndReadData()
     // hostname should be "localhost", not 127.0.0.1. Test failed on Mac OSX10.5
     con1.sendMessage(reinterpret_cast<const unsigned char*>(message1.c_str()),
                      message1.size(), "localhost", con2port);
+    con1.flush();
 
     unsigned char readbuffer[100];
     std::string remoteHost;
@@ -56,4 +60,50 @@ void DHTConnectionImplTest::testWriteAndReadData()
   }
 }
 
+void DHTConnectionImplTest::testWriteAndReadData_batch()
+{
+  try {
+    DHTConnectionImpl con1(AF_INET);
+    uint16_t con1port = 0;
+    CPPUNIT_ASSERT(con1.bind(con1port, A2STR::NIL));
+
+    DHTConnectionImpl con2(AF_INET);
+    uint16_t con2port = 0;
+    CPPUNIT_ASSERT(con2.bind(con2port, A2STR::NIL));
+
+    // More messages than the ring can hold, so that sendMessage()
+    // flushes the ring by itself.
+    const size_t num = 40;
+    for(size_t i = 0; i < num; ++i) {
+      std::string message = "message"+util::uitos(i);
+      CPPUNIT_ASSERT_EQUAL
+        ((ssize_t)message.size(),
+         con1.sendMessage(reinterpret_cast<const unsigned char*>
+                          (message.c_str()),
+                          message.size(), "localhost", con2port));
+    }
+    CPPUNIT_ASSERT(!con1.sendQueueIsEmpty());
+    con1.flush();
+    CPPUNIT_ASSERT(con1.sendQueueIsEmpty());
+    CPPUNIT_ASSERT_EQUAL((int64_t)num, con1.getNumSent());
+
+    unsigned char readbuffer[100];
+    std::string remoteHost;
+    uint16_t remotePort;
+    for(size_t i = 0; i < num; ++i) {
+      ssize_t rlength;
+      while((rlength = con2.receiveMessage(readbuffer, sizeof(readbuffer),
+                                           remoteHost, remotePort)) == 0);
+      CPPUNIT_ASSERT_EQUAL("message"+util::uitos(i),
+                           std::string(&readbuffer[0], &readbuffer[rlength]));
+      CPPUNIT_ASSERT_EQUAL(std::string("127.0.0.1"), remoteHost);
+      CPPUNIT_ASSERT_EQUAL(con1port, remotePort);
+    }
+    CPPUNIT_ASSERT_EQUAL((int64_t)num, con2.getNumReceived());
+    CPPUNIT_ASSERT_EQUAL((int64_t)0, con2.getNumDropped());
+  } catch(Exception& e) {
+    CPPUNIT_FAIL(e.stackTrace());
+  }
+}
+
 } // namespace aria2
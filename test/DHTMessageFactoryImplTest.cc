@@ -21,6 +21,7 @@
 #include "DHTAnnouncePeerMessage.h"
 #include "DHTAnnouncePeerReplyMessage.h"
 #include "bencode2.h"
+#include "TestUtil.h"
 
 namespace aria2 {
 
@@ -95,7 +96,8 @@ void DHTMessageFactoryImplTest::testCreatePingMessage()
   
   SharedHandle<DHTPingMessage> m
     (dynamic_pointer_cast<DHTPingMessage>
-     (factory->createQueryMessage(&dict, "192.168.0.1", 6881)));
+     (factory->createQueryMessage(BencodeNode(&dict).get(),
+                                  "192.168.0.1", 6881)));
   SharedHandle<DHTNode> remoteNode(new DHTNode(remoteNodeID));
   remoteNode->setIPAddress("192.168.0.1");
   remoteNode->setPort(6881);
@@ -121,7 +123,7 @@ void DHTMessageFactoryImplTest::testCreatePingReplyMessage()
   
   SharedHandle<DHTPingReplyMessage> m
     (dynamic_pointer_cast<DHTPingReplyMessage>
-     (factory->createResponseMessage("ping", &dict,
+     (factory->createResponseMessage("ping", BencodeNode(&dict).get(),
                                      remoteNode->getIPAddress(),
                                      remoteNode->getPort())));
 
@@ -146,7 +148,8 @@ void DHTMessageFactoryImplTest::testCreateFindNodeMessage()
   
   SharedHandle<DHTFindNodeMessage> m
     (dynamic_pointer_cast<DHTFindNodeMessage>
-     (factory->createQueryMessage(&dict, "192.168.0.1", 6881)));
+     (factory->createQueryMessage(BencodeNode(&dict).get(),
+                                  "192.168.0.1", 6881)));
   SharedHandle<DHTNode> remoteNode(new DHTNode(remoteNodeID));
   remoteNode->setIPAddress("192.168.0.1");
   remoteNode->setPort(6881);
@@ -192,7 +195,7 @@ void DHTMessageFactoryImplTest::testCreateFindNodeReplyMessage()
   
     SharedHandle<DHTFindNodeReplyMessage> m
       (dynamic_pointer_cast<DHTFindNodeReplyMessage>
-       (factory->createResponseMessage("find_node", &dict,
+       (factory->createResponseMessage("find_node", BencodeNode(&dict).get(),
                                        remoteNode->getIPAddress(),
                                        remoteNode->getPort())));
 
@@ -245,7 +248,7 @@ void DHTMessageFactoryImplTest::testCreateFindNodeReplyMessage6()
   
     SharedHandle<DHTFindNodeReplyMessage> m
       (dynamic_pointer_cast<DHTFindNodeReplyMessage>
-       (factory->createResponseMessage("find_node", &dict,
+       (factory->createResponseMessage("find_node", BencodeNode(&dict).get(),
                                        remoteNode->getIPAddress(),
                                        remoteNode->getPort())));
 
@@ -277,7 +280,8 @@ void DHTMessageFactoryImplTest::testCreateGetPeersMessage()
   
   SharedHandle<DHTGetPeersMessage> m
     (dynamic_pointer_cast<DHTGetPeersMessage>
-     (factory->createQueryMessage(&dict, "192.168.0.1", 6881)));
+     (factory->createQueryMessage(BencodeNode(&dict).get(),
+                                  "192.168.0.1", 6881)));
   SharedHandle<DHTNode> remoteNode(new DHTNode(remoteNodeID));
   remoteNode->setIPAddress("192.168.0.1");
   remoteNode->setPort(6881);
@@ -339,7 +343,7 @@ void DHTMessageFactoryImplTest::testCreateGetPeersReplyMessage()
   
     SharedHandle<DHTGetPeersReplyMessage> m
       (dynamic_pointer_cast<DHTGetPeersReplyMessage>
-       (factory->createResponseMessage("get_peers", &dict,
+       (factory->createResponseMessage("get_peers", BencodeNode(&dict).get(),
                                        remoteNode->getIPAddress(),
                                        remoteNode->getPort())));
 
@@ -412,7 +416,7 @@ void DHTMessageFactoryImplTest::testCreateGetPeersReplyMessage6()
   
     SharedHandle<DHTGetPeersReplyMessage> m
       (dynamic_pointer_cast<DHTGetPeersReplyMessage>
-       (factory->createResponseMessage("get_peers", &dict,
+       (factory->createResponseMessage("get_peers", BencodeNode(&dict).get(),
                                        remoteNode->getIPAddress(),
                                        remoteNode->getPort())));
 
@@ -453,7 +457,8 @@ void DHTMessageFactoryImplTest::testCreateAnnouncePeerMessage()
   
     SharedHandle<DHTAnnouncePeerMessage> m
       (dynamic_pointer_cast<DHTAnnouncePeerMessage>
-       (factory->createQueryMessage(&dict, "192.168.0.1", 6882)));
+       (factory->createQueryMessage(BencodeNode(&dict).get(),
+                                    "192.168.0.1", 6882)));
     SharedHandle<DHTNode> remoteNode(new DHTNode(remoteNodeID));
     remoteNode->setIPAddress("192.168.0.1");
     remoteNode->setPort(6882);
@@ -486,7 +491,7 @@ void DHTMessageFactoryImplTest::testCreateAnnouncePeerReplyMessage()
   
   SharedHandle<DHTAnnouncePeerReplyMessage> m
     (dynamic_pointer_cast<DHTAnnouncePeerReplyMessage>
-     (factory->createResponseMessage("announce_peer", &dict,
+     (factory->createResponseMessage("announce_peer", BencodeNode(&dict).get(),
                                      remoteNode->getIPAddress(),
                                      remoteNode->getPort())));
 
@@ -511,7 +516,7 @@ void DHTMessageFactoryImplTest::testReceivedErrorMessage()
   remoteNode->setPort(6881);
 
   try {
-    factory->createResponseMessage("announce_peer", &dict,
+    factory->createResponseMessage("announce_peer", BencodeNode(&dict).get(),
                                    remoteNode->getIPAddress(),
                                    remoteNode->getPort());
     CPPUNIT_FAIL("exception must be thrown.");
@@ -10,6 +10,8 @@
 #include "DHTMessageTrackerEntry.h"
 #include "DHTRoutingTable.h"
 #include "MockDHTMessageFactory.h"
+#include "DHTConstants.h"
+#include "TestUtil.h"
 
 namespace aria2 {
 
@@ -18,6 +20,9 @@ class DHTMessageTrackerTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(DHTMessageTrackerTest);
   CPPUNIT_TEST(testMessageArrived);
   CPPUNIT_TEST(testHandleTimeout);
+  CPPUNIT_TEST(testGetTimeout);
+  CPPUNIT_TEST(testGetAlpha);
+  CPPUNIT_TEST(testGetAlpha_lateReply);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -27,6 +32,11 @@ public:
   void testMessageArrived();
 
   void testHandleTimeout();
+
+  void testGetTimeout();
+
+  void testGetAlpha();
+  void testGetAlpha_lateReply();
 };
 
 
@@ -65,7 +75,8 @@ void DHTMessageTrackerTest::testMessageArrived()
     resDict.put("t", m2->getTransactionID());
     
     std::pair<SharedHandle<DHTMessage>, SharedHandle<DHTMessageCallback> > p =
-      tracker.messageArrived(&resDict, m2->getRemoteNode()->getIPAddress(),
+      tracker.messageArrived(BencodeNode(&resDict).get(),
+                             m2->getRemoteNode()->getIPAddress(),
                              m2->getRemoteNode()->getPort());
     SharedHandle<DHTMessage> reply = p.first;
 
@@ -78,7 +89,8 @@ void DHTMessageTrackerTest::testMessageArrived()
     resDict.put("t", m3->getTransactionID());
 
     std::pair<SharedHandle<DHTMessage>, SharedHandle<DHTMessageCallback> > p =
-      tracker.messageArrived(&resDict, m3->getRemoteNode()->getIPAddress(),
+      tracker.messageArrived(BencodeNode(&resDict).get(),
+                             m3->getRemoteNode()->getIPAddress(),
                              m3->getRemoteNode()->getPort());
     SharedHandle<DHTMessage> reply = p.first;
 
@@ -91,15 +103,123 @@ void DHTMessageTrackerTest::testMessageArrived()
     resDict.put("t", m1->getTransactionID());
 
     std::pair<SharedHandle<DHTMessage>, SharedHandle<DHTMessageCallback> > p =
-      tracker.messageArrived(&resDict, "192.168.1.100", 6889);
+      tracker.messageArrived(BencodeNode(&resDict).get(),
+                             "192.168.1.100", 6889);
     SharedHandle<DHTMessage> reply = p.first;
 
     CPPUNIT_ASSERT(!reply);
   }
 }
 
+namespace {
+class TimeoutCounter:public MockDHTMessageCallback {
+public:
+  int count;
+
+  TimeoutCounter():count(0) {}
+
+  virtual void onTimeout(const SharedHandle<DHTNode>& remoteNode)
+  {
+    ++count;
+  }
+};
+} // namespace
+
 void DHTMessageTrackerTest::testHandleTimeout()
 {
+  SharedHandle<DHTNode> localNode(new DHTNode());
+  SharedHandle<DHTRoutingTable> routingTable(new DHTRoutingTable(localNode));
+  SharedHandle<MockDHTMessageFactory> factory(new MockDHTMessageFactory());
+  factory->setLocalNode(localNode);
+
+  SharedHandle<MockDHTMessage> m1(new MockDHTMessage(localNode,
+                                                     SharedHandle<DHTNode>(new DHTNode())));
+  SharedHandle<MockDHTMessage> m2(new MockDHTMessage(localNode,
+                                                     SharedHandle<DHTNode>(new DHTNode())));
+  SharedHandle<MockDHTMessage> m3(new MockDHTMessage(localNode,
+                                                     SharedHandle<DHTNode>(new DHTNode())));
+  m1->getRemoteNode()->setIPAddress("192.168.0.1");
+  m1->getRemoteNode()->setPort(6881);
+  m2->getRemoteNode()->setIPAddress("192.168.0.2");
+  m2->getRemoteNode()->setPort(6882);
+  m3->getRemoteNode()->setIPAddress("192.168.0.3");
+  m3->getRemoteNode()->setPort(6883);
+
+  SharedHandle<TimeoutCounter> callback(new TimeoutCounter());
+  DHTMessageTracker tracker;
+  tracker.setRoutingTable(routingTable);
+  tracker.setMessageFactory(factory);
+  // m2 does not time out.
+  tracker.addMessage(m2, DHT_MESSAGE_TIMEOUT, callback);
+  tracker.addMessage(m1, 0, callback);
+  tracker.addMessage(m3, 0, callback);
+  {
+    // m3 is answered before timeout.
+    Dict resDict;
+    resDict.put("t", m3->getTransactionID());
+    CPPUNIT_ASSERT(tracker.messageArrived
+                   (BencodeNode(&resDict).get(),
+                    m3->getRemoteNode()->getIPAddress(),
+                    m3->getRemoteNode()->getPort()).first);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tracker.countEntry());
+
+  tracker.handleTimeout();
+
+  CPPUNIT_ASSERT_EQUAL(1, callback->count);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, tracker.countEntry());
+  CPPUNIT_ASSERT(!tracker.getEntryFor(m1));
+  CPPUNIT_ASSERT(tracker.getEntryFor(m2));
+}
+
+void DHTMessageTrackerTest::testGetTimeout()
+{
+  DHTMessageTracker tracker;
+  CPPUNIT_ASSERT_EQUAL((time_t)10, tracker.getTimeout(10));
+  // SRTT=300, RTTVAR=150
+  tracker.updateRTT(300);
+  CPPUNIT_ASSERT_EQUAL((time_t)DHT_MIN_MESSAGE_TIMEOUT,
+                       tracker.getTimeout(10));
+  for(int i = 0; i < 100; ++i) {
+    tracker.updateRTT(i%2 == 0 ? 1000 : 5000);
+  }
+  time_t timeout = tracker.getTimeout(10);
+  CPPUNIT_ASSERT(3 < timeout);
+  CPPUNIT_ASSERT(timeout <= 10);
+  CPPUNIT_ASSERT_EQUAL((time_t)3, tracker.getTimeout(3));
+}
+
+void DHTMessageTrackerTest::testGetAlpha()
+{
+  DHTMessageTracker tracker;
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tracker.getAlpha(3, 8));
+  // Half of the queries time out.
+  for(int i = 0; i < 200; ++i) {
+    tracker.updateMissRate(i%2 == 0);
+  }
+  size_t alpha = tracker.getAlpha(3, 8);
+  CPPUNIT_ASSERT(5 <= alpha);
+  CPPUNIT_ASSERT(alpha <= 7);
+  for(int i = 0; i < 200; ++i) {
+    tracker.updateMissRate(true);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)8, tracker.getAlpha(3, 8));
+  for(int i = 0; i < 200; ++i) {
+    tracker.updateMissRate(false);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tracker.getAlpha(3, 8));
+}
+
+void DHTMessageTrackerTest::testGetAlpha_lateReply()
+{
+  DHTMessageTracker tracker;
+  for(int i = 0; i < 50; ++i) {
+    tracker.updateRTT(100);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tracker.getAlpha(3, 8));
+  // Much later than SRTT+4*RTTVAR.
+  tracker.updateRTT(5000);
+  CPPUNIT_ASSERT_EQUAL((size_t)4, tracker.getAlpha(3, 8));
 }
 
 } // namespace aria2
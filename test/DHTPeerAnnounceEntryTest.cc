@@ -17,12 +17,14 @@ class DHTPeerAnnounceEntryTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testRemoveStalePeerAddrEntry);
   CPPUNIT_TEST(testEmpty);
   CPPUNIT_TEST(testAddPeerAddrEntry);
+  CPPUNIT_TEST(testAddPeerAddrEntry_max);
   CPPUNIT_TEST(testGetPeers);
   CPPUNIT_TEST_SUITE_END();
 public:
   void testRemoveStalePeerAddrEntry();
   void testEmpty();
   void testAddPeerAddrEntry();
+  void testAddPeerAddrEntry_max();
   void testGetPeers();
 };
 
@@ -83,6 +85,31 @@ void DHTPeerAnnounceEntryTest::testAddPeerAddrEntry()
   CPPUNIT_ASSERT(0 != entry.getPeerAddrEntries()[0].getLastUpdated().getTime());
 }
 
+void DHTPeerAnnounceEntryTest::testAddPeerAddrEntry_max()
+{
+  unsigned char infohash[DHT_ID_LENGTH];
+  memset(infohash, 0xff, DHT_ID_LENGTH);
+
+  DHTPeerAnnounceEntry entry(infohash);
+  entry.addPeerAddrEntry(PeerAddrEntry("192.168.0.1", 6881));
+  // The least recently updated entry
+  entry.addPeerAddrEntry(PeerAddrEntry("192.168.0.2", 6881, Timer(0)));
+  for(int i = 3; entry.countPeerAddrEntry() < DHT_PEER_ANNOUNCE_MAX_PEER;
+      ++i) {
+    entry.addPeerAddrEntry(PeerAddrEntry("192.168.1."+util::itos(i), 6881));
+  }
+  entry.addPeerAddrEntry(PeerAddrEntry("192.168.0.3", 6881));
+
+  CPPUNIT_ASSERT_EQUAL((size_t)DHT_PEER_ANNOUNCE_MAX_PEER,
+                       entry.countPeerAddrEntry());
+  const std::vector<PeerAddrEntry>& peerAddrEntries =
+    entry.getPeerAddrEntries();
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.1"),
+                       peerAddrEntries[0].getIPAddress());
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.3"),
+                       peerAddrEntries[1].getIPAddress());
+}
+
 void DHTPeerAnnounceEntryTest::testGetPeers()
 {
   unsigned char infohash[DHT_ID_LENGTH];
@@ -0,0 +1,98 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "DHTRoutingTable.h"
+#include "DHTBucket.h"
+#include "DHTNode.h"
+#include "XORCloser.h"
+#include "util.h"
+
+namespace aria2 {
+
+namespace {
+class NodeCloser {
+private:
+  XORCloser closer_;
+public:
+  NodeCloser(const unsigned char* key):closer_(key, DHT_ID_LENGTH) {}
+
+  bool operator()(const SharedHandle<DHTNode>& node1,
+                  const SharedHandle<DHTNode>& node2) const
+  {
+    return memcmp(node1->getID(), node2->getID(), DHT_ID_LENGTH) != 0 &&
+      closer_(node1->getID(), node2->getID());
+  }
+};
+
+// Measures getClosestKNodes() on a routing table whose buckets are all
+// full, which is what find_node and get_peers queries hit.
+void benchGetClosestKNodes()
+{
+  SharedHandle<DHTNode> localNode(new DHTNode());
+  DHTRoutingTable table(localNode);
+  for(size_t i = 0; i < 100000; ++i) {
+    table.addNode(SharedHandle<DHTNode>(new DHTNode()));
+  }
+  std::vector<SharedHandle<DHTBucket> > buckets;
+  table.getBuckets(buckets);
+  size_t numNodes = 0;
+  for(size_t i = 0; i < buckets.size(); ++i) {
+    numNodes += buckets[i]->countNode();
+  }
+  printf("  %lu buckets, %lu nodes\n",
+         static_cast<unsigned long>(buckets.size()),
+         static_cast<unsigned long>(numNodes));
+  const size_t numKeys = 1024;
+  std::vector<unsigned char> keys(numKeys*DHT_ID_LENGTH);
+  for(size_t i = 0; i < numKeys; ++i) {
+    util::generateRandomKey(&keys[i*DHT_ID_LENGTH]);
+  }
+  const int64_t iteration = 100000;
+  size_t sum = 0;
+  {
+    const int64_t refIteration = iteration/100;
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < refIteration; ++i) {
+      const unsigned char* key = &keys[(i%numKeys)*DHT_ID_LENGTH];
+      std::vector<SharedHandle<DHTNode> > nodes;
+      for(size_t j = 0; j < buckets.size(); ++j) {
+        buckets[j]->getGoodNodes(nodes);
+      }
+      std::partial_sort(nodes.begin(), nodes.begin()+DHTBucket::K,
+                        nodes.end(), NodeCloser(key));
+      sum += nodes.size();
+    }
+    bench::report("collect all and sort (reference)",
+                  refIteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      const unsigned char* key = &keys[(i%numKeys)*DHT_ID_LENGTH];
+      std::vector<SharedHandle<DHTNode> > nodes;
+      table.getClosestKNodes(nodes, key);
+      sum += nodes.size();
+    }
+    bench::report("getClosestKNodes()", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      const unsigned char* key = &keys[(i%numKeys)*DHT_ID_LENGTH];
+      SharedHandle<DHTNode> nodes[DHTBucket::K];
+      sum += table.getClosestKNodes(nodes, key);
+    }
+    bench::report("getClosestKNodes() into array", iteration,
+                  bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchGetClosestKNodes)
+
+} // namespace aria2
@@ -1,6 +1,7 @@
 #include "DHTRoutingTable.h"
 
 #include <cstring>
+#include <algorithm>
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "Exception.h"
@@ -10,6 +11,7 @@
 #include "MockDHTTaskQueue.h"
 #include "MockDHTTaskFactory.h"
 #include "DHTTask.h"
+#include "XORCloser.h"
 
 namespace aria2 {
 
@@ -19,6 +21,7 @@ class DHTRoutingTableTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testAddNode);
   CPPUNIT_TEST(testAddNode_localNode);
   CPPUNIT_TEST(testGetClosestKNodes);
+  CPPUNIT_TEST(testGetClosestKNodes_exact);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -28,6 +31,7 @@ public:
   void testAddNode();
   void testAddNode_localNode();
   void testGetClosestKNodes();
+  void testGetClosestKNodes_exact();
 };
 
 
@@ -110,4 +114,58 @@ void DHTRoutingTableTest::testGetClosestKNodes()
   }
 }
 
+namespace {
+class NodeCloser {
+private:
+  XORCloser closer_;
+public:
+  NodeCloser(const unsigned char* key):closer_(key, DHT_ID_LENGTH) {}
+
+  bool operator()(const SharedHandle<DHTNode>& node1,
+                  const SharedHandle<DHTNode>& node2) const
+  {
+    return memcmp(node1->getID(), node2->getID(), DHT_ID_LENGTH) != 0 &&
+      closer_(node1->getID(), node2->getID());
+  }
+};
+} // namespace
+
+void DHTRoutingTableTest::testGetClosestKNodes_exact()
+{
+  SharedHandle<DHTNode> localNode(new DHTNode());
+  DHTRoutingTable table(localNode);
+  for(size_t i = 0; i < 1000; ++i) {
+    SharedHandle<DHTNode> node(new DHTNode());
+    table.addNode(node);
+    if(i%7 == 0) {
+      node->markBad();
+    }
+  }
+  std::vector<SharedHandle<DHTBucket> > buckets;
+  table.getBuckets(buckets);
+  std::vector<SharedHandle<DHTNode> > goodNodes;
+  for(size_t i = 0; i < buckets.size(); ++i) {
+    buckets[i]->getGoodNodes(goodNodes);
+  }
+  CPPUNIT_ASSERT(DHTBucket::K <= goodNodes.size());
+  for(size_t i = 0; i < 100; ++i) {
+    unsigned char key[DHT_ID_LENGTH];
+    util::generateRandomKey(key);
+    std::vector<SharedHandle<DHTNode> > expected = goodNodes;
+    std::sort(expected.begin(), expected.end(), NodeCloser(key));
+    std::vector<SharedHandle<DHTNode> > nodes;
+    table.getClosestKNodes(nodes, key);
+    CPPUNIT_ASSERT_EQUAL((size_t)DHTBucket::K, nodes.size());
+    for(size_t j = 0; j < DHTBucket::K; ++j) {
+      CPPUNIT_ASSERT(*expected[j] == *nodes[j]);
+    }
+    SharedHandle<DHTNode> closest[DHTBucket::K];
+    CPPUNIT_ASSERT_EQUAL((size_t)DHTBucket::K,
+                         table.getClosestKNodes(closest, key));
+    for(size_t j = 0; j < DHTBucket::K; ++j) {
+      CPPUNIT_ASSERT(closest[j].get() == nodes[j].get());
+    }
+  }
+}
+
 } // namespace aria2
@@ -1,8 +1,11 @@
 #include "DHTTaskExecutor.h"
 
+#include <cstring>
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "MockDHTTask.h"
+#include "DHTNodeLookupTask.h"
+#include "DHTMessageCallback.h"
 #include "array_fun.h"
 
 namespace aria2 {
@@ -11,9 +14,13 @@ class DHTTaskExecutorTest:public CppUnit::TestFixture {
 
   CPPUNIT_TEST_SUITE(DHTTaskExecutorTest);
   CPPUNIT_TEST(testUpdate);
+  CPPUNIT_TEST(testUpdate_maxStart);
+  CPPUNIT_TEST(testAddTask_duplicate);
   CPPUNIT_TEST_SUITE_END();
 public:
   void testUpdate();
+  void testUpdate_maxStart();
+  void testAddTask_duplicate();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(DHTTaskExecutorTest);
@@ -45,4 +52,44 @@ void DHTTaskExecutorTest::testUpdate()
   CPPUNIT_ASSERT_EQUAL((size_t)0, tex.getQueueSize());
 }
 
+void DHTTaskExecutorTest::testUpdate_maxStart()
+{
+  SharedHandle<DHTNode> rn;
+  DHTTaskExecutor tex(10);
+  for(size_t i = 0; i < 5; ++i) {
+    tex.addTask(SharedHandle<MockDHTTask>(new MockDHTTask(rn)));
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tex.update(2));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tex.getExecutingTaskSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tex.getQueueSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, tex.update(0));
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tex.getQueueSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tex.update(10));
+  CPPUNIT_ASSERT_EQUAL((size_t)5, tex.getExecutingTaskSize());
+}
+
+void DHTTaskExecutorTest::testAddTask_duplicate()
+{
+  DHTTaskExecutor tex(10);
+  unsigned char id[DHT_ID_LENGTH];
+  memset(id, 0, DHT_ID_LENGTH);
+  SharedHandle<DHTNodeLookupTask> t1(new DHTNodeLookupTask(id));
+  tex.addTask(t1);
+  // Differs after DHT_LOOKUP_DEDUP_PREFIX_BITS
+  id[DHT_LOOKUP_DEDUP_PREFIX_BITS/8] = 0xff;
+  SharedHandle<DHTNodeLookupTask> t2(new DHTNodeLookupTask(id));
+  tex.addTask(t2);
+  CPPUNIT_ASSERT(t2->finished());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, tex.getQueueSize());
+  // Differs in the first byte
+  id[0] = 0x80;
+  SharedHandle<DHTNodeLookupTask> t3(new DHTNodeLookupTask(id));
+  tex.addTask(t3);
+  CPPUNIT_ASSERT(!t3->finished());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tex.getQueueSize());
+  // MockDHTTask is never a duplicate.
+  tex.addTask(SharedHandle<MockDHTTask>(new MockDHTTask(SharedHandle<DHTNode>())));
+  CPPUNIT_ASSERT_EQUAL((size_t)3, tex.getQueueSize());
+}
+
 } // namespace aria2
@@ -17,6 +17,7 @@
 #include "DownloadContext.h"
 #include "bittorrent_helper.h"
 #include "array_fun.h"
+#include "UDPTrackerRequest.h"
 
 namespace aria2 {
 
@@ -33,6 +34,8 @@ class DefaultBtAnnounceTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testProcessAnnounceResponse_malformed);
   CPPUNIT_TEST(testProcessAnnounceResponse_failureReason);
   CPPUNIT_TEST(testProcessAnnounceResponse);
+  CPPUNIT_TEST(testCreateUDPTrackerRequest);
+  CPPUNIT_TEST(testProcessUDPTrackerResponse);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<DownloadContext> dctx_;
@@ -90,6 +93,8 @@ public:
   void testProcessAnnounceResponse_malformed();
   void testProcessAnnounceResponse_failureReason();
   void testProcessAnnounceResponse();
+  void testCreateUDPTrackerRequest();
+  void testProcessUDPTrackerResponse();
 };
 
 
@@ -413,4 +418,74 @@ void DefaultBtAnnounceTest::testProcessAnnounceResponse()
 #endif // !HAVE_INET_NTOP
 }
 
+void DefaultBtAnnounceTest::testCreateUDPTrackerRequest()
+{
+  SharedHandle<List> announceList = List::g();
+  announceList->append(createAnnounceTier("udp://localhost:6969/announce"));
+  setAnnounceList(dctx_, announceList);
+  option_->put(PREF_BT_EXTERNAL_IP, "192.168.1.1");
+
+  DefaultBtAnnounce btAnnounce(dctx_, option_);
+  btAnnounce.setPieceStorage(pieceStorage_);
+  btAnnounce.setPeerStorage(peerStorage_);
+  btAnnounce.setBtRuntime(btRuntime_);
+
+  CPPUNIT_ASSERT_EQUAL(std::string("udp://localhost:6969/announce"),
+                       btAnnounce.getAnnounceUrl().substr(0, 29));
+  SharedHandle<UDPTrackerRequest> req =
+    btAnnounce.createUDPTrackerRequest("127.0.0.1", 6969);
+  CPPUNIT_ASSERT(req);
+  CPPUNIT_ASSERT_EQUAL(std::string("127.0.0.1"), req->remoteAddr);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6969, req->remotePort);
+  CPPUNIT_ASSERT_EQUAL((int32_t)UDPT_ACT_ANNOUNCE, req->action);
+  CPPUNIT_ASSERT_EQUAL(std::string("0123456789abcdef0123456789abcdef01234567"),
+                       util::toHex(req->infohash));
+  CPPUNIT_ASSERT_EQUAL(std::string("-aria2-ultrafastdltl"), req->peerId);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1310720, req->downloaded);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1572864, req->left);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1572864, req->uploaded);
+  CPPUNIT_ASSERT_EQUAL((int32_t)UDPT_EVT_STARTED, req->event);
+  CPPUNIT_ASSERT_EQUAL(std::string("c0a80101"),
+                       util::toHex(reinterpret_cast<const unsigned char*>
+                                   (&req->ip), 4));
+  CPPUNIT_ASSERT_EQUAL(bittorrent::getIntParam
+                       (reinterpret_cast<const unsigned char*>("dltl"), 0),
+                       req->key);
+  CPPUNIT_ASSERT_EQUAL((int32_t)50, req->numWant);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6989, req->port);
+
+  btAnnounce.announceStart();
+  btAnnounce.announceSuccess();
+  btRuntime_->setHalt(true);
+  req = btAnnounce.createUDPTrackerRequest("127.0.0.1", 6969);
+  CPPUNIT_ASSERT_EQUAL((int32_t)UDPT_EVT_STOPPED, req->event);
+  CPPUNIT_ASSERT_EQUAL((int32_t)0, req->numWant);
+}
+
+void DefaultBtAnnounceTest::testProcessUDPTrackerResponse()
+{
+  SharedHandle<UDPTrackerRequest> req(new UDPTrackerRequest());
+  req->action = UDPT_ACT_ANNOUNCE;
+  SharedHandle<UDPTrackerReply> reply(new UDPTrackerReply());
+  reply->interval = 1800;
+  reply->leechers = 200;
+  reply->seeders = 100;
+  reply->peers.push_back(std::make_pair(std::string("192.168.0.2"), 6890));
+  reply->peers.push_back(std::make_pair(std::string("192.168.0.3"), 6891));
+  req->reply = reply;
+
+  DefaultBtAnnounce an(dctx_, option_);
+  an.setPeerStorage(peerStorage_);
+  an.setBtRuntime(btRuntime_);
+  an.processUDPTrackerResponse(req);
+  CPPUNIT_ASSERT_EQUAL((time_t)1800, an.getInterval());
+  CPPUNIT_ASSERT_EQUAL((time_t)1800, an.getMinInterval());
+  CPPUNIT_ASSERT_EQUAL((unsigned int)100, an.getComplete());
+  CPPUNIT_ASSERT_EQUAL((unsigned int)200, an.getIncomplete());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, peerStorage_->getPeers().size());
+  SharedHandle<Peer> peer = peerStorage_->getPeers()[0];
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.2"), peer->getIPAddress());
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6890, peer->getPort());
+}
+
 } // namespace aria2
@@ -12,6 +12,7 @@
 #include "MockExtensionMessageFactory.h"
 #include "BtExtendedMessage.h"
 #include "BtPortMessage.h"
+#include "BtHaveMessage.h"
 #include "Exception.h"
 #include "FileEntry.h"
 
@@ -22,6 +23,7 @@ class DefaultBtMessageFactoryTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(DefaultBtMessageFactoryTest);
   CPPUNIT_TEST(testCreateBtMessage_BtExtendedMessage);
   CPPUNIT_TEST(testCreatePortMessage);
+  CPPUNIT_TEST(testCreateBtMessage_pooled);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<DownloadContext> dctx_;
@@ -47,6 +49,7 @@ public:
 
   void testCreateBtMessage_BtExtendedMessage();
   void testCreatePortMessage();
+  void testCreateBtMessage_pooled();
 };
 
 
@@ -99,4 +102,42 @@ void DefaultBtMessageFactoryTest::testCreatePortMessage()
   }
 }
 
+void DefaultBtMessageFactoryTest::testCreateBtMessage_pooled()
+{
+  // 10 pieces
+  dctx_.reset(new DownloadContext(1024, 10*1024));
+  factory_->setDownloadContext(dctx_);
+  unsigned char data[9];
+  bittorrent::createPeerMessageString(data, sizeof(data), 5, BtHaveMessage::ID);
+  bittorrent::setIntParam(&data[5], 1);
+  BtMessage* released;
+  {
+    SharedHandle<BtMessage> m =
+      factory_->createBtMessage(&data[4], sizeof(data)-4);
+    static_cast<BtHaveMessage*>(m.get())->setInvalidate(true);
+    released = m.get();
+  }
+  // The released message object is reused with its state cleared.
+  SharedHandle<BtHaveMessage> m1
+    (static_pointer_cast<BtHaveMessage>
+     (factory_->createBtMessage(&data[4], sizeof(data)-4)));
+  CPPUNIT_ASSERT(released == m1.get());
+  CPPUNIT_ASSERT(!m1->isInvalidate());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, m1->getIndex());
+  // m1 is still in use, so that another object is returned.
+  SharedHandle<BtHaveMessage> m2
+    (static_pointer_cast<BtHaveMessage>(factory_->createHaveMessage(9)));
+  CPPUNIT_ASSERT(m1.get() != m2.get());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, m1->getIndex());
+  CPPUNIT_ASSERT_EQUAL((size_t)9, m2->getIndex());
+  // Out of range index is rejected without a validator object.
+  bittorrent::setIntParam(&data[5], 10);
+  try {
+    factory_->createBtMessage(&data[4], sizeof(data)-4);
+    CPPUNIT_FAIL("exception must be thrown.");
+  } catch(Exception& e) {
+    // success
+  }
+}
+
 } // namespace aria2
@@ -13,6 +13,8 @@
 #include "Piece.h"
 #include "FileEntry.h"
 #include "array_fun.h"
+#include "File.h"
+#include "TestUtil.h"
 #ifdef ENABLE_BITTORRENT
 # include "MockPeerStorage.h"
 # include "BtRuntime.h"
@@ -38,6 +40,10 @@ class DefaultBtProgressInfoFileTest:public CppUnit::TestFixture {
 #endif // !WORDS_BIGENDIAN
   CPPUNIT_TEST(testLoad_nonBt_pieceLengthShorter);
   CPPUNIT_TEST(testUpdateFilename);
+  CPPUNIT_TEST(testSave_updateInPlace);
+  CPPUNIT_TEST(testSave_compaction);
+  CPPUNIT_TEST(testLoad_tornJournal);
+  CPPUNIT_TEST(testLoad_bitfieldUpdatedAfterRecord);
   CPPUNIT_TEST_SUITE_END();
 private:
 
@@ -97,6 +103,10 @@ public:
 #endif // !WORDS_BIGENDIAN
   void testLoad_nonBt_pieceLengthShorter();
   void testUpdateFilename();
+  void testSave_updateInPlace();
+  void testSave_compaction();
+  void testLoad_tornJournal();
+  void testLoad_bitfieldUpdatedAfterRecord();
 };
 
 #undef BLOCK_LENGTH
@@ -241,7 +251,7 @@ void DefaultBtProgressInfoFileTest::testSave()
 
   unsigned char version[2];
   in.read((char*)version, sizeof(version));
-  CPPUNIT_ASSERT_EQUAL(std::string("0001"),
+  CPPUNIT_ASSERT_EQUAL(std::string("0002"),
                        util::toHex(version, sizeof(version)));
 
   unsigned char extension[4];
@@ -279,10 +289,21 @@ void DefaultBtProgressInfoFileTest::testSave()
   bitfieldLength = ntohl(bitfieldLength);
   CPPUNIT_ASSERT_EQUAL((uint32_t)10, bitfieldLength);
 
+  // bitfield starts at 8 bytes boundary
+  in.ignore(2);
+  CPPUNIT_ASSERT_EQUAL((std::streamoff)56, (std::streamoff)in.tellg());
+
   unsigned char bitfieldRead[10];
   in.read((char*)bitfieldRead, sizeof(bitfieldRead));
   CPPUNIT_ASSERT_EQUAL(std::string("fffffffffffffffffffe"),
                        util::toHex(bitfieldRead, sizeof(bitfieldRead)));
+  in.ignore(6);
+
+  // journal record
+  uint32_t recordLength;
+  in.read((char*)&recordLength, sizeof(recordLength));
+  recordLength = ntohl(recordLength);
+  CPPUNIT_ASSERT_EQUAL((uint32_t)30, recordLength);
 
   uint32_t numInFlightPiece;
   in.read((char*)&numInFlightPiece, sizeof(numInFlightPiece));
@@ -474,7 +495,7 @@ void DefaultBtProgressInfoFileTest::testSave_nonBt()
 
   unsigned char version[2];
   in.read((char*)version, sizeof(version));
-  CPPUNIT_ASSERT_EQUAL(std::string("0001"),
+  CPPUNIT_ASSERT_EQUAL(std::string("0002"),
                        util::toHex(version, sizeof(version)));
 
   unsigned char extension[4];
@@ -507,10 +528,21 @@ void DefaultBtProgressInfoFileTest::testSave_nonBt()
   bitfieldLength = ntohl(bitfieldLength);
   CPPUNIT_ASSERT_EQUAL((uint32_t)10, bitfieldLength);
 
+  // bitfield starts at 8 bytes boundary
+  in.ignore(6);
+  CPPUNIT_ASSERT_EQUAL((std::streamoff)40, (std::streamoff)in.tellg());
+
   unsigned char bitfieldRead[10];
   in.read((char*)bitfieldRead, sizeof(bitfieldRead));
   CPPUNIT_ASSERT_EQUAL(std::string("fffffffffffffffffffe"),
                        util::toHex(bitfieldRead, sizeof(bitfieldRead)));
+  in.ignore(6);
+
+  // journal record
+  uint32_t recordLength;
+  in.read((char*)&recordLength, sizeof(recordLength));
+  recordLength = ntohl(recordLength);
+  CPPUNIT_ASSERT_EQUAL((uint32_t)30, recordLength);
 
   uint32_t numInFlightPiece;
   in.read((char*)&numInFlightPiece, sizeof(numInFlightPiece));
@@ -576,4 +608,180 @@ void DefaultBtProgressInfoFileTest::testUpdateFilename()
                        infoFile.getFilename());
 }
 
+namespace {
+// Loads filename into a new piece storage and returns the hex string
+// of its bitfield followed by the bitfields of in-flight pieces.
+std::string loadState(const SharedHandle<DownloadContext>& dctx,
+                      const Option* option)
+{
+  BitfieldMan bitfield(dctx->getPieceLength(), dctx->getTotalLength());
+  SharedHandle<MockPieceStorage> pieceStorage(new MockPieceStorage());
+  pieceStorage->setBitfield(&bitfield);
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage, option);
+  infoFile.load();
+  std::string state = util::toHex(bitfield.getBitfield(),
+                                  bitfield.getBitfieldLength());
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  pieceStorage->getInFlightPieces(inFlightPieces);
+  for(std::vector<SharedHandle<Piece> >::const_iterator i =
+        inFlightPieces.begin(), eoi = inFlightPieces.end(); i != eoi; ++i) {
+    state += " "+util::uitos((*i)->getIndex())+":"+
+      util::toHex((*i)->getBitfield(), (*i)->getBitfieldLength());
+  }
+  return state;
+}
+
+void writeFile(const std::string& filename, const std::string& data)
+{
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  out.write(data.data(), data.size());
+}
+} // namespace
+
+void DefaultBtProgressInfoFileTest::testSave_updateInPlace()
+{
+  initializeMembers(1024, 81920);
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/save-inplace"));
+  SharedHandle<Piece> p1(new Piece(1, 1024));
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.push_back(p1);
+  pieceStorage_->addInFlightPiece(inFlightPieces);
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage_, option_.get());
+  File f(infoFile.getFilename());
+
+  infoFile.save();
+  // header: 34, padding: 6, bitfield: 10+6, record: 8+4+13
+  CPPUNIT_ASSERT_EQUAL((uint64_t)81, f.size());
+
+  // Nothing changed. The file is left as is.
+  infoFile.save();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)81, f.size());
+
+  // Only the bitfield changed. It is overwritten in place.
+  bitfield_->setBit(70);
+  infoFile.save();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)81, f.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000200 1:00"),
+                       loadState(dctx, option_.get()));
+
+  // The in-flight piece changed. A record is appended.
+  p1->completeBlock(0);
+  infoFile.save();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)106, f.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000200 1:80"),
+                       loadState(dctx, option_.get()));
+
+  // The file which was not written by infoFile is rewritten.
+  writeFile(infoFile.getFilename(), readFile(infoFile.getFilename())+"x");
+  bitfield_->setBit(0);
+  infoFile.save();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)81, f.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("80000000000000000200 1:80"),
+                       loadState(dctx, option_.get()));
+}
+
+void DefaultBtProgressInfoFileTest::testSave_compaction()
+{
+  initializeMembers(1024, 81920);
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/save-compaction"));
+  SharedHandle<Piece> p1(new Piece(1, 1024));
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.push_back(p1);
+  pieceStorage_->addInFlightPiece(inFlightPieces);
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage_, option_.get());
+  File f(infoFile.getFilename());
+
+  infoFile.save();
+  uint64_t prevSize = f.size();
+  int numCompaction = 0;
+  for(int i = 0; i < 6000; ++i) {
+    if(i%2 == 0) {
+      p1->completeBlock(0);
+    } else {
+      p1->clearAllBlock();
+    }
+    infoFile.save();
+    uint64_t size = f.size();
+    if(size < prevSize) {
+      ++numCompaction;
+      CPPUNIT_ASSERT_EQUAL((uint64_t)81, size);
+    } else {
+      CPPUNIT_ASSERT_EQUAL(prevSize+25, size);
+    }
+    CPPUNIT_ASSERT(size <= 56+64*1024);
+    prevSize = size;
+  }
+  CPPUNIT_ASSERT_EQUAL(2, numCompaction);
+  CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000000 1:00"),
+                       loadState(dctx, option_.get()));
+}
+
+void DefaultBtProgressInfoFileTest::testLoad_tornJournal()
+{
+  initializeMembers(1024, 81920);
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/load-torn"));
+  SharedHandle<Piece> p1(new Piece(1, 1024));
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.push_back(p1);
+  pieceStorage_->addInFlightPiece(inFlightPieces);
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage_, option_.get());
+  infoFile.save();
+  p1->completeBlock(0);
+  infoFile.save();
+  std::string data = readFile(infoFile.getFilename());
+  CPPUNIT_ASSERT_EQUAL((size_t)106, data.size());
+
+  // Crashed while appending the second record: the first one is used.
+  for(size_t len = 82; len < data.size(); ++len) {
+    writeFile(infoFile.getFilename(), data.substr(0, len));
+    CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000000 1:00"),
+                         loadState(dctx, option_.get()));
+  }
+  // The second record is garbled.
+  std::string garbled = data;
+  garbled[102] ^= 0xff;
+  writeFile(infoFile.getFilename(), garbled);
+  CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000000 1:00"),
+                       loadState(dctx, option_.get()));
+  // Even the first record is torn.
+  writeFile(infoFile.getFilename(), data.substr(0, 70));
+  CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000000"),
+                       loadState(dctx, option_.get()));
+
+  // The next save() after loading the torn file rewrites it.
+  writeFile(infoFile.getFilename(), data.substr(0, 90));
+  BitfieldMan bitfield(1024, 81920);
+  SharedHandle<MockPieceStorage> pieceStorage(new MockPieceStorage());
+  pieceStorage->setBitfield(&bitfield);
+  DefaultBtProgressInfoFile infoFile2(dctx, pieceStorage, option_.get());
+  infoFile2.load();
+  infoFile2.save();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)81, File(infoFile.getFilename()).size());
+  CPPUNIT_ASSERT_EQUAL(std::string("00000000000000000000 1:00"),
+                       loadState(dctx, option_.get()));
+}
+
+void DefaultBtProgressInfoFileTest::testLoad_bitfieldUpdatedAfterRecord()
+{
+  initializeMembers(1024, 81920);
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/load-bitfield"));
+  SharedHandle<Piece> p1(new Piece(1, 1024));
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.push_back(p1);
+  pieceStorage_->addInFlightPiece(inFlightPieces);
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage_, option_.get());
+  infoFile.save();
+  // Piece 1 completed, but the record which drops it is not in the
+  // file yet.
+  bitfield_->setBit(1);
+  infoFile.save();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)81, File(infoFile.getFilename()).size());
+  CPPUNIT_ASSERT_EQUAL(std::string("40000000000000000000"),
+                       loadState(dctx, option_.get()));
+}
+
 } // namespace aria2
@@ -0,0 +1,199 @@
+#include "DownloadEngine.h"
+
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SelectEventPoll.h"
+#include "RequestGroupMan.h"
+#include "RequestGroup.h"
+#include "Option.h"
+#include "Command.h"
+#include "TimerA2.h"
+
+namespace aria2 {
+
+class DownloadEngineTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DownloadEngineTest);
+  CPPUNIT_TEST(testRun_wakeupByStatus);
+  CPPUNIT_TEST(testRun_wakeupByDeadline);
+  CPPUNIT_TEST(testRun_addSleepingCommand);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  SharedHandle<DownloadEngine> e_;
+  SharedHandle<Option> option_;
+public:
+  void setUp()
+  {
+    option_.reset(new Option());
+    e_.reset
+      (new DownloadEngine(SharedHandle<EventPoll>(new SelectEventPoll())));
+    e_->setOption(option_.get());
+    e_->setRequestGroupMan
+      (SharedHandle<RequestGroupMan>
+       (new RequestGroupMan(std::vector<SharedHandle<RequestGroup> >(),
+                            1, option_.get())));
+  }
+
+  void testRun_wakeupByStatus();
+  void testRun_wakeupByDeadline();
+  void testRun_addSleepingCommand();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DownloadEngineTest);
+
+namespace {
+// Re-adds itself as inactive until it is executed max times. The
+// value of *tick at each execution is recorded.
+class SleepCommand:public Command {
+private:
+  DownloadEngine* e_;
+  const int* tick_;
+  size_t max_;
+public:
+  std::vector<int> ticks;
+
+  SleepCommand(DownloadEngine* e, const int* tick, size_t max)
+    : Command(1), e_(e), tick_(tick), max_(max) {}
+
+  virtual bool execute()
+  {
+    ticks.push_back(*tick_);
+    if(ticks.size() == max_) {
+      return true;
+    }
+    e_->addCommand(this);
+    return false;
+  }
+};
+
+// Runs in every iteration until tick reaches max and makes target
+// active when tick reaches wakeupTick. If addTarget is true, target
+// is also added to DownloadEngine before it is made active.
+class TickCommand:public Command {
+private:
+  DownloadEngine* e_;
+  int* tick_;
+  int max_;
+  int wakeupTick_;
+  Command* target_;
+  bool addTarget_;
+public:
+  TickCommand(DownloadEngine* e, int* tick, int max, int wakeupTick,
+              Command* target, bool addTarget = false)
+    : Command(2), e_(e), tick_(tick), max_(max), wakeupTick_(wakeupTick),
+      target_(target), addTarget_(addTarget)
+  {
+    setStatusRealtime();
+  }
+
+  virtual bool execute()
+  {
+    ++*tick_;
+    if(*tick_ == wakeupTick_) {
+      if(addTarget_) {
+        e_->addCommand(target_);
+      }
+      target_->setStatusActive();
+    }
+    if(*tick_ == max_) {
+      return true;
+    }
+    e_->setNoWait(true);
+    e_->addCommand(this);
+    return false;
+  }
+};
+
+// Keeps the result of SleepCommand after it is deleted.
+class RecordCommand:public SleepCommand {
+private:
+  std::vector<int>* result_;
+public:
+  RecordCommand(DownloadEngine* e, const int* tick, size_t max,
+                std::vector<int>* result)
+    : SleepCommand(e, tick, max), result_(result) {}
+
+  virtual ~RecordCommand()
+  {
+    *result_ = ticks;
+  }
+};
+
+// Sleeps after the first execution. Once woken up, it stays active
+// until it is executed max times.
+class StayActiveCommand:public Command {
+private:
+  DownloadEngine* e_;
+  const int* tick_;
+  size_t max_;
+  std::vector<int>* result_;
+public:
+  StayActiveCommand(DownloadEngine* e, const int* tick, size_t max,
+                    std::vector<int>* result)
+    : Command(3), e_(e), tick_(tick), max_(max), result_(result) {}
+
+  virtual bool execute()
+  {
+    result_->push_back(*tick_);
+    if(result_->size() == max_) {
+      return true;
+    }
+    if(result_->size() > 1) {
+      setStatusActive();
+    }
+    e_->addCommand(this);
+    return false;
+  }
+};
+} // namespace
+
+void DownloadEngineTest::testRun_wakeupByStatus()
+{
+  int tick = 0;
+  std::vector<int> ticks;
+  RecordCommand* sleeper = new RecordCommand(e_.get(), &tick, 2, &ticks);
+  e_->addCommand(new TickCommand(e_.get(), &tick, 5, 3, sleeper));
+  e_->addCommand(sleeper);
+  e_->run();
+  // All commands are executed in the first iteration. After that,
+  // sleeper is executed only after it is made active, in the next
+  // iteration before TickCommand.
+  CPPUNIT_ASSERT_EQUAL((size_t)2, ticks.size());
+  CPPUNIT_ASSERT_EQUAL(1, ticks[0]);
+  CPPUNIT_ASSERT_EQUAL(3, ticks[1]);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, e_->countSleepingCommand());
+}
+
+void DownloadEngineTest::testRun_wakeupByDeadline()
+{
+  int tick = 0;
+  std::vector<int> ticks;
+  Timer start;
+  e_->addCommand(new RecordCommand(e_.get(), &tick, 2, &ticks));
+  e_->run();
+  CPPUNIT_ASSERT_EQUAL((size_t)2, ticks.size());
+  // Sleeping command is executed when its deadline passes.
+  CPPUNIT_ASSERT(start.differenceInMillis() >= 500);
+}
+
+void DownloadEngineTest::testRun_addSleepingCommand()
+{
+  int tick = 0;
+  std::vector<int> ticks;
+  Command* sleeper = new StayActiveCommand(e_.get(), &tick, 3, &ticks);
+  e_->addCommand(new TickCommand(e_.get(), &tick, 5, 3, sleeper, true));
+  e_->addCommand(sleeper);
+  e_->run();
+  // sleeper is added while sleeping and then made active. It must be
+  // queued only once, so that it is executed once in each iteration.
+  CPPUNIT_ASSERT_EQUAL((size_t)3, ticks.size());
+  CPPUNIT_ASSERT_EQUAL(1, ticks[0]);
+  CPPUNIT_ASSERT_EQUAL(3, ticks[1]);
+  CPPUNIT_ASSERT_EQUAL(4, ticks[2]);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, e_->countSleepingCommand());
+}
+
+} // namespace aria2
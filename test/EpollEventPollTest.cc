@@ -0,0 +1,130 @@
+#include "EpollEventPoll.h"
+
+#include <unistd.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Command.h"
+
+namespace aria2 {
+
+class EpollEventPollTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(EpollEventPollTest);
+  CPPUNIT_TEST(testAddEvents);
+  CPPUNIT_TEST(testDeleteEvents);
+  CPPUNIT_TEST(testPoll_removeStaleEvents);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  int fds_[2];
+public:
+  void setUp()
+  {
+    CPPUNIT_ASSERT_EQUAL(0, pipe(fds_));
+  }
+
+  void tearDown()
+  {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  void testAddEvents();
+  void testDeleteEvents();
+  void testPoll_removeStaleEvents();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EpollEventPollTest);
+
+namespace {
+class MockCommand:public Command {
+public:
+  MockCommand(cuid_t cuid):Command(cuid) {}
+
+  virtual bool execute()
+  {
+    return true;
+  }
+
+  bool isActive() const
+  {
+    return statusMatch(Command::STATUS_ACTIVE);
+  }
+};
+
+struct timeval zeroTimeout()
+{
+  struct timeval tv;
+  tv.tv_sec = tv.tv_usec = 0;
+  return tv;
+}
+} // namespace
+
+void EpollEventPollTest::testAddEvents()
+{
+  EpollEventPoll poll;
+  MockCommand c1(1);
+  MockCommand c2(2);
+  CPPUNIT_ASSERT(poll.addEvents(fds_[0], &c1, EventPoll::EVENT_READ));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, poll.getNumCtl());
+  // Already registered
+  CPPUNIT_ASSERT(poll.addEvents(fds_[0], &c2, EventPoll::EVENT_READ));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, poll.getNumCtl());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, poll.getNumCtlSkipped());
+
+  CPPUNIT_ASSERT_EQUAL((ssize_t)1, write(fds_[1], "a", 1));
+  poll.poll(zeroTimeout());
+  CPPUNIT_ASSERT(c1.isActive());
+  CPPUNIT_ASSERT(c2.isActive());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, poll.getNumWait());
+}
+
+void EpollEventPollTest::testDeleteEvents()
+{
+  EpollEventPoll poll;
+  MockCommand c1(1);
+  MockCommand c2(2);
+  poll.addEvents(fds_[0], &c1, EventPoll::EVENT_READ);
+  poll.addEvents(fds_[0], &c2, EventPoll::EVENT_READ);
+  // c1 still wants the event, so epoll is not changed.
+  CPPUNIT_ASSERT(poll.deleteEvents(fds_[0], &c2, EventPoll::EVENT_READ));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, poll.getNumCtl());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, poll.getNumCtlSkipped());
+  // No one wants the socket. It is removed from epoll.
+  CPPUNIT_ASSERT(poll.deleteEvents(fds_[0], &c1, EventPoll::EVENT_READ));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, poll.getNumCtl());
+  CPPUNIT_ASSERT(!poll.deleteEvents(fds_[0], &c1, EventPoll::EVENT_READ));
+
+  CPPUNIT_ASSERT_EQUAL((ssize_t)1, write(fds_[1], "a", 1));
+  poll.poll(zeroTimeout());
+  CPPUNIT_ASSERT(!c1.isActive());
+  CPPUNIT_ASSERT(!c2.isActive());
+}
+
+void EpollEventPollTest::testPoll_removeStaleEvents()
+{
+  EpollEventPoll poll;
+  MockCommand c1(1);
+  MockCommand c2(2);
+  // The write end of a pipe is always writable.
+  poll.addEvents(fds_[1], &c1, EventPoll::EVENT_ERROR);
+  poll.addEvents(fds_[1], &c2, EventPoll::EVENT_WRITE);
+  CPPUNIT_ASSERT(poll.deleteEvents(fds_[1], &c2, EventPoll::EVENT_WRITE));
+  uint64_t numCtl = poll.getNumCtl();
+  // The stale write event fires once and is removed from epoll.
+  poll.poll(zeroTimeout());
+  CPPUNIT_ASSERT(!c1.isActive());
+  CPPUNIT_ASSERT(!c2.isActive());
+  CPPUNIT_ASSERT_EQUAL(numCtl+1, poll.getNumCtl());
+  poll.poll(zeroTimeout());
+  CPPUNIT_ASSERT_EQUAL(numCtl+1, poll.getNumCtl());
+
+  // Adding the event again needs epoll_ctl.
+  poll.addEvents(fds_[1], &c2, EventPoll::EVENT_WRITE);
+  CPPUNIT_ASSERT_EQUAL(numCtl+2, poll.getNumCtl());
+  poll.poll(zeroTimeout());
+  CPPUNIT_ASSERT(c2.isActive());
+}
+
+} // namespace aria2
@@ -1,6 +1,7 @@
 #include "GZipDecoder.h"
 
 #include <iostream>
+#include <algorithm>
 #include <fstream>
 
 #include <cppunit/extensions/HelperMacros.h>
@@ -18,6 +19,7 @@ class GZipDecoderTest:public CppUnit::TestFixture {
 
   CPPUNIT_TEST_SUITE(GZipDecoderTest);
   CPPUNIT_TEST(testDecode);
+  CPPUNIT_TEST(testDecode_appendToBuffer);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -25,6 +27,7 @@ public:
   void tearDown() {}
 
   void testDecode();
+  void testDecode_appendToBuffer();
 };
 
 
@@ -59,4 +62,24 @@ void GZipDecoderTest::testDecode()
 #endif // ENABLE_MESSAGE_DIGEST
 }
 
+void GZipDecoderTest::testDecode_appendToBuffer()
+{
+  std::string data = readFile(A2_TEST_DIR"/gzip_decode_test.gz");
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+  GZipDecoder decoder;
+  decoder.init();
+  std::string expected = decoder.decode(p, data.size());
+  CPPUNIT_ASSERT(decoder.finished());
+  decoder.release();
+
+  // Feed small pieces and let the decoder append to the same buffer.
+  decoder.init();
+  std::string out = "prefix";
+  for(size_t i = 0; i < data.size(); i += 100) {
+    decoder.decode(out, p+i, std::min((size_t)100, data.size()-i));
+  }
+  CPPUNIT_ASSERT(decoder.finished());
+  CPPUNIT_ASSERT_EQUAL("prefix"+expected, out);
+}
+
 } // namespace aria2
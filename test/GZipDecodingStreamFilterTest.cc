@@ -12,6 +12,7 @@
 #include "ByteArrayDiskWriter.h"
 #include "SinkStreamFilter.h"
 #include "MockSegment.h"
+#include "TestUtil.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "MessageDigest.h"
 #endif // ENABLE_MESSAGE_DIGEST
@@ -22,6 +23,7 @@ class GZipDecodingStreamFilterTest:public CppUnit::TestFixture {
 
   CPPUNIT_TEST_SUITE(GZipDecodingStreamFilterTest);
   CPPUNIT_TEST(testTransform);
+  CPPUNIT_TEST(testTransform_ownedBuffer);
   CPPUNIT_TEST_SUITE_END();
 
   class MockSegment2:public MockSegment {
@@ -41,6 +43,27 @@ class GZipDecodingStreamFilterTest:public CppUnit::TestFixture {
     }
   };
 
+  // Accepts owned buffers as if the write cache were used.
+  class OwningSinkStreamFilter:public SinkStreamFilter {
+  public:
+    size_t numOwned;
+    OwningSinkStreamFilter():numOwned(0) {}
+
+    virtual ssize_t transformOwned
+    (const SharedHandle<BinaryStream>& out,
+     const SharedHandle<Segment>& segment,
+     unsigned char* inbuf, size_t inlen)
+    {
+      ++numOwned;
+      return SinkStreamFilter::transformOwned(out, segment, inbuf, inlen);
+    }
+
+    virtual bool acceptsOwnedBuffer(const SharedHandle<Segment>& segment) const
+    {
+      return true;
+    }
+  };
+
   SharedHandle<GZipDecodingStreamFilter> filter_;
   SharedHandle<SinkStreamFilter> sinkFilter_;
   SharedHandle<ByteArrayDiskWriter> writer_;
@@ -57,6 +80,7 @@ public:
   }
 
   void testTransform();
+  void testTransform_ownedBuffer();
 };
 
 
@@ -80,4 +104,24 @@ void GZipDecodingStreamFilterTest::testTransform()
 #endif // ENABLE_MESSAGE_DIGEST
 }
 
+void GZipDecodingStreamFilterTest::testTransform_ownedBuffer()
+{
+  SharedHandle<OwningSinkStreamFilter> sink(new OwningSinkStreamFilter());
+  GZipDecodingStreamFilter filter(sink);
+  filter.init();
+  SharedHandle<ByteArrayDiskWriter> writer(new ByteArrayDiskWriter());
+  SharedHandle<MockSegment2> segment(new MockSegment2());
+  std::string data = readFile(A2_TEST_DIR"/gzip_decode_test.gz");
+  filter.transform(writer, segment,
+                   reinterpret_cast<const unsigned char*>(data.data()),
+                   data.size());
+  CPPUNIT_ASSERT(filter.finished());
+  // Full output buffers are handed over to the sink.
+  CPPUNIT_ASSERT(sink->numOwned > 0);
+  filter_->transform(writer_, segment_,
+                     reinterpret_cast<const unsigned char*>(data.data()),
+                     data.size());
+  CPPUNIT_ASSERT_EQUAL(writer_->getString(), writer->getString());
+}
+
 } // namespace aria2
@@ -2,6 +2,7 @@
 #include "HttpHeader.h"
 #include "DlRetryEx.h"
 #include "DlAbortEx.h"
+#include "error_code.h"
 #include <iostream>
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -12,12 +13,14 @@ class HttpHeaderProcessorTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(HttpHeaderProcessorTest);
   CPPUNIT_TEST(testUpdate1);
   CPPUNIT_TEST(testUpdate2);
+  CPPUNIT_TEST(testUpdate_byteByByte);
   CPPUNIT_TEST(testGetPutBackDataLength);
   CPPUNIT_TEST(testGetPutBackDataLength_nullChar);
   CPPUNIT_TEST(testGetHttpResponseHeader);
   CPPUNIT_TEST(testGetHttpResponseHeader_empty);
   CPPUNIT_TEST(testGetHttpResponseHeader_statusOnly);
   CPPUNIT_TEST(testGetHttpResponseHeader_insufficientStatusLength);
+  CPPUNIT_TEST(testGetHttpResponseHeader_notStatusLine);
   CPPUNIT_TEST(testBeyondLimit);
   CPPUNIT_TEST(testGetHeaderString);
   CPPUNIT_TEST(testGetHttpRequestHeader);
@@ -26,12 +29,14 @@ class HttpHeaderProcessorTest:public CppUnit::TestFixture {
 public:
   void testUpdate1();
   void testUpdate2();
+  void testUpdate_byteByByte();
   void testGetPutBackDataLength();
   void testGetPutBackDataLength_nullChar();
   void testGetHttpResponseHeader();
   void testGetHttpResponseHeader_empty();
   void testGetHttpResponseHeader_statusOnly();
   void testGetHttpResponseHeader_insufficientStatusLength();
+  void testGetHttpResponseHeader_notStatusLine();
   void testBeyondLimit();
   void testGetHeaderString();
   void testGetHttpRequestHeader();
@@ -60,6 +65,40 @@ void HttpHeaderProcessorTest::testUpdate2()
   CPPUNIT_ASSERT(proc.eoh());
 }
 
+void HttpHeaderProcessorTest::testUpdate_byteByByte()
+{
+  HttpHeaderProcessor proc;
+  std::string hd = "HTTP/1.1 206 Partial Content\r\n"
+    "Content-Length: 100\r\n"
+    "Content-Range: bytes 100-199/300\r\n"
+    "X-Folded: text1 \r\n"
+    "\t text2\r\n"
+    "Set-Cookie: a=b\r\n"
+    "SET-COOKIE: c=d\r\n"
+    "\r\n";
+  for(size_t i = 0; i < hd.size()-1; ++i) {
+    proc.update(hd.substr(i, 1));
+    CPPUNIT_ASSERT(!proc.eoh());
+  }
+  proc.update(hd.substr(hd.size()-1)+"putbackme");
+  CPPUNIT_ASSERT(proc.eoh());
+  CPPUNIT_ASSERT_EQUAL((size_t)9, proc.getPutBackDataLength());
+
+  SharedHandle<HttpHeader> header = proc.getHttpResponseHeader();
+  CPPUNIT_ASSERT_EQUAL(206, header->getStatusCode());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)100ULL,
+                       header->getFirstAsULLInt(HttpHeader::CONTENT_LENGTH));
+  CPPUNIT_ASSERT_EQUAL(std::string("bytes 100-199/300"),
+                       header->getFirst(HttpHeader::CONTENT_RANGE));
+  CPPUNIT_ASSERT_EQUAL(std::string("text1 text2"),
+                       header->getFirst("X-Folded"));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, header->get(HttpHeader::SET_COOKIE).size());
+  CPPUNIT_ASSERT_EQUAL(std::string("c=d"),
+                       header->get(HttpHeader::SET_COOKIE)[1]);
+  // The status line is not a header field.
+  CPPUNIT_ASSERT(!header->defined("HTTP/1.1 206 Partial Content"));
+}
+
 void HttpHeaderProcessorTest::testGetPutBackDataLength()
 {
   HttpHeaderProcessor proc;
@@ -156,6 +195,20 @@ void HttpHeaderProcessorTest::testGetHttpResponseHeader_insufficientStatusLength
   
 }
 
+void HttpHeaderProcessorTest::testGetHttpResponseHeader_notStatusLine()
+{
+  HttpHeaderProcessor proc;
+
+  std::string hd = "0123456789 200 OK\r\n\r\n";
+  proc.update(hd);
+  try {
+    proc.getHttpResponseHeader();
+    CPPUNIT_FAIL("Exception must be thrown.");
+  } catch(DlRetryEx& ex) {
+    CPPUNIT_ASSERT_EQUAL(error_code::HTTP_PROTOCOL_ERROR, ex.getErrorCode());
+  }
+}
+
 void HttpHeaderProcessorTest::testBeyondLimit()
 {
   HttpHeaderProcessor proc;
@@ -15,6 +15,7 @@ class HttpHeaderTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testGet);
   CPPUNIT_TEST(testClearField);
   CPPUNIT_TEST(testFill);
+  CPPUNIT_TEST(testInterestingHeader);
   CPPUNIT_TEST_SUITE_END();
   
 public:
@@ -22,6 +23,7 @@ public:
   void testGet();
   void testClearField();
   void testFill();
+  void testInterestingHeader();
 };
 
 
@@ -126,4 +128,30 @@ void HttpHeaderTest::testFill()
                        h.get("Duplicate")[1]);
 }
 
+void HttpHeaderTest::testInterestingHeader()
+{
+  CPPUNIT_ASSERT_EQUAL((int)HttpHeader::CONTENT_LENGTH,
+                       HttpHeader::idInterestingHeader("content-LENGTH"));
+  CPPUNIT_ASSERT_EQUAL((int)HttpHeader::MAX_INTERESTING_HEADER,
+                       HttpHeader::idInterestingHeader("Content-Lengt"));
+  CPPUNIT_ASSERT_EQUAL((int)HttpHeader::MAX_INTERESTING_HEADER,
+                       HttpHeader::idInterestingHeader(""));
+
+  HttpHeader h;
+  h.put("Transfer-Encoding", "chunked");
+  h.put(HttpHeader::LOCATION, "http://host/");
+  h.put("location", "http://host2/");
+  CPPUNIT_ASSERT(h.defined(HttpHeader::TRANSFER_ENCODING));
+  CPPUNIT_ASSERT(!h.defined(HttpHeader::CONNECTION));
+  CPPUNIT_ASSERT_EQUAL(std::string("http://host/"),
+                       h.getFirst("LOCATION"));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, h.get(HttpHeader::LOCATION).size());
+  CPPUNIT_ASSERT_EQUAL(std::string("http://host2/"),
+                       h.get("Location")[1]);
+
+  h.clearField();
+  CPPUNIT_ASSERT(!h.defined(HttpHeader::TRANSFER_ENCODING));
+  CPPUNIT_ASSERT(!h.defined("Location"));
+}
+
 } // namespace aria2
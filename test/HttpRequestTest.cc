@@ -119,6 +119,16 @@ void HttpRequestTest::testGetEndByte()
   CPPUNIT_ASSERT_EQUAL((off_t)(segmentLength*index+100-1),
                        httpRequest.getEndByte());
 
+  // Merged with the following segments
+  fileEntry->setLength(segmentLength*10);
+  httpRequest.setEndOffsetOverride(segmentLength*4);
+
+  CPPUNIT_ASSERT_EQUAL((off_t)(segmentLength*4-1), httpRequest.getEndByte());
+
+  httpRequest.setEndOffsetOverride(segmentLength*11);
+
+  CPPUNIT_ASSERT_EQUAL((off_t)(segmentLength*10-1), httpRequest.getEndByte());
+
   request->setPipeliningHint(false);
 
   CPPUNIT_ASSERT_EQUAL((off_t)0LL, httpRequest.getEndByte());
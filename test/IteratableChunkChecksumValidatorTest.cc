@@ -8,6 +8,10 @@
 #include "DiskAdaptor.h"
 #include "FileEntry.h"
 #include "PieceSelector.h"
+#ifdef HAVE_PTHREAD
+# include "PieceHashWorkerPool.h"
+# include "util.h"
+#endif // HAVE_PTHREAD
 
 namespace aria2 {
 
@@ -16,6 +20,9 @@ class IteratableChunkChecksumValidatorTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(IteratableChunkChecksumValidatorTest);
   CPPUNIT_TEST(testValidate);
   CPPUNIT_TEST(testValidate_readError);
+#ifdef HAVE_PTHREAD
+  CPPUNIT_TEST(testValidate_workerPool);
+#endif // HAVE_PTHREAD
   CPPUNIT_TEST_SUITE_END();
 private:
 
@@ -26,6 +33,9 @@ public:
 
   void testValidate();
   void testValidate_readError();
+#ifdef HAVE_PTHREAD
+  void testValidate_workerPool();
+#endif // HAVE_PTHREAD
 };
 
 
@@ -104,4 +114,41 @@ void IteratableChunkChecksumValidatorTest::testValidate_readError() {
   CPPUNIT_ASSERT(!ps->hasPiece(4));
 }
 
+#ifdef HAVE_PTHREAD
+void IteratableChunkChecksumValidatorTest::testValidate_workerPool() {
+  Option option;
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(100, 500, A2_TEST_DIR"/chunkChecksumTestFile250.txt"));
+  std::deque<std::string> hashes(&csArray[0], &csArray[3]);
+  hashes[1] = "ffffffffffffffffffffffffffffffffffffffff";
+  hashes.push_back("ffffffffffffffffffffffffffffffffffffffff");
+  hashes.push_back("ffffffffffffffffffffffffffffffffffffffff");
+  dctx->setPieceHashes(hashes.begin(), hashes.end());
+  dctx->setPieceHashAlgo("sha-1");
+  SharedHandle<DefaultPieceStorage> ps(new DefaultPieceStorage(dctx, &option));
+  ps->initStorage();
+  ps->getDiskAdaptor()->enableReadOnly();
+  ps->getDiskAdaptor()->openFile();
+
+  SharedHandle<PieceHashWorkerPool> pool(new PieceHashWorkerPool(2));
+  CPPUNIT_ASSERT(pool->start());
+  IteratableChunkChecksumValidator validator(dctx, ps);
+  validator.setWorkerPool(pool);
+  validator.init();
+  CPPUNIT_ASSERT(validator.isAsync());
+
+  for(int i = 0; i < 500 && !validator.finished(); ++i) {
+    validator.validateChunk();
+    util::usleep(10000);
+  }
+  CPPUNIT_ASSERT(validator.finished());
+  CPPUNIT_ASSERT_EQUAL((off_t)500, validator.getCurrentOffset());
+  CPPUNIT_ASSERT(ps->hasPiece(0));
+  CPPUNIT_ASSERT(!ps->hasPiece(1));
+  CPPUNIT_ASSERT(!ps->hasPiece(2));
+  CPPUNIT_ASSERT(!ps->hasPiece(3));
+  CPPUNIT_ASSERT(!ps->hasPiece(4));
+}
+#endif // HAVE_PTHREAD
+
 } // namespace aria2
@@ -2,6 +2,7 @@
 #define D_MOCK_BT_ANNOUNCE_H
 
 #include "BtAnnounce.h"
+#include "UDPTrackerRequest.h"
 
 namespace aria2 {
 
@@ -45,6 +46,15 @@ public:
   virtual void processAnnounceResponse(const unsigned char* trackerResponse,
                                        size_t trackerResponseLength) {}
 
+  virtual SharedHandle<UDPTrackerRequest>
+  createUDPTrackerRequest(const std::string& remoteAddr, uint16_t remotePort)
+  {
+    return SharedHandle<UDPTrackerRequest>();
+  }
+
+  virtual void processUDPTrackerResponse
+  (const SharedHandle<UDPTrackerRequest>& req) {}
+
   virtual bool noMoreAnnounce() {
     return false;
   }
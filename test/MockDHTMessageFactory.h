@@ -16,7 +16,7 @@ public:
   virtual ~MockDHTMessageFactory() {}
 
   virtual SharedHandle<DHTQueryMessage>
-  createQueryMessage(const Dict* dict,
+  createQueryMessage(const bencode2::Node* dict,
                      const std::string& ipaddr, uint16_t port)
   {
     return SharedHandle<DHTQueryMessage>();
@@ -24,7 +24,7 @@ public:
 
   virtual SharedHandle<DHTResponseMessage>
   createResponseMessage(const std::string& messageType,
-                        const Dict* dict,
+                        const bencode2::Node* dict,
                         const std::string& ipaddr, uint16_t port)
   {
     SharedHandle<DHTNode> remoteNode(new DHTNode());
@@ -33,7 +33,7 @@ public:
     remoteNode->setPort(port);
     SharedHandle<MockDHTResponseMessage> m
       (new MockDHTResponseMessage(localNode_, remoteNode,
-                                  asString(dict->get("t"))->s()));
+                                  dict->find("t")->s()));
     return m;
   }
 
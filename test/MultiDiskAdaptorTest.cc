@@ -20,6 +20,7 @@ class MultiDiskAdaptorTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(MultiDiskAdaptorTest);
   CPPUNIT_TEST(testWriteData);
   CPPUNIT_TEST(testReadData);
+  CPPUNIT_TEST(testGetFdForRead);
   CPPUNIT_TEST(testCutTrailingGarbage);
   CPPUNIT_TEST(testSize);
   CPPUNIT_TEST(testUtime);
@@ -35,6 +36,7 @@ public:
 
   void testWriteData();
   void testReadData();
+  void testGetFdForRead();
   void testCutTrailingGarbage();
   void testSize();
   void testUtime();
@@ -363,6 +365,31 @@ void MultiDiskAdaptorTest::testReadData() {
   CPPUNIT_ASSERT_EQUAL(std::string("1234567890ABCDEFGHIJKLMNO"), std::string((char*)buf));
 }
 
+void MultiDiskAdaptorTest::testGetFdForRead()
+{
+  SharedHandle<FileEntry> entry1(new FileEntry(A2_TEST_DIR"/file1r.txt", 15, 0));
+  SharedHandle<FileEntry> entry2(new FileEntry(A2_TEST_DIR"/file2r.txt", 7, 15));
+  SharedHandle<FileEntry> entry3(new FileEntry(A2_TEST_DIR"/file3r.txt", 3, 22));
+  std::vector<SharedHandle<FileEntry> > entries;
+  entries.push_back(entry1);
+  entries.push_back(entry2);
+  entries.push_back(entry3);
+
+  adaptor->setFileEntries(entries.begin(), entries.end());
+  adaptor->enableReadOnly();
+  adaptor->openFile();
+  off_t fileOffset;
+  int fd = adaptor->getFdForRead(fileOffset, 16, 6);
+  CPPUNIT_ASSERT(fd != -1);
+  CPPUNIT_ASSERT_EQUAL((off_t)1, fileOffset);
+  unsigned char buf[6];
+  CPPUNIT_ASSERT_EQUAL((ssize_t)6, pread(fd, buf, sizeof(buf), fileOffset));
+  CPPUNIT_ASSERT_EQUAL(std::string("GHIJKL"),
+                       std::string(&buf[0], &buf[sizeof(buf)]));
+  // The data spans file1r.txt and file2r.txt.
+  CPPUNIT_ASSERT_EQUAL(-1, adaptor->getFdForRead(fileOffset, 14, 2));
+}
+
 void MultiDiskAdaptorTest::testCutTrailingGarbage()
 {
   std::string dir = A2_TEST_OUT_DIR;
@@ -0,0 +1,82 @@
+#include "MultiUrlRequestInfo.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Option.h"
+#include "prefs.h"
+
+namespace aria2 {
+
+class MultiUrlRequestInfoTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(MultiUrlRequestInfoTest);
+  CPPUNIT_TEST(testSetShardOption_limits);
+  CPPUNIT_TEST(testSetShardOption_noLimit);
+  CPPUNIT_TEST(testSetShardOption_files);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testSetShardOption_limits();
+  void testSetShardOption_noLimit();
+  void testSetShardOption_files();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MultiUrlRequestInfoTest);
+
+void MultiUrlRequestInfoTest::testSetShardOption_limits()
+{
+  // The remainder goes to the first shards.
+  int32_t download[] = { 334, 333, 333 };
+  int32_t concurrent[] = { 2, 2, 1 };
+  for(size_t shard = 0; shard < 3; ++shard) {
+    Option option;
+    option.put(PREF_MAX_OVERALL_DOWNLOAD_LIMIT, "1000");
+    option.put(PREF_MAX_OVERALL_UPLOAD_LIMIT, "2");
+    option.put(PREF_MAX_CONCURRENT_DOWNLOADS, "5");
+    setShardOption(&option, shard, 3);
+    CPPUNIT_ASSERT_EQUAL(download[shard],
+                         option.getAsInt(PREF_MAX_OVERALL_DOWNLOAD_LIMIT));
+    // Each shard has at least 1, because 0 means no limit.
+    CPPUNIT_ASSERT_EQUAL(1, option.getAsInt(PREF_MAX_OVERALL_UPLOAD_LIMIT));
+    CPPUNIT_ASSERT_EQUAL(concurrent[shard],
+                         option.getAsInt(PREF_MAX_CONCURRENT_DOWNLOADS));
+  }
+}
+
+void MultiUrlRequestInfoTest::testSetShardOption_noLimit()
+{
+  Option option;
+  option.put(PREF_MAX_OVERALL_DOWNLOAD_LIMIT, "0");
+  option.put(PREF_MAX_OVERALL_UPLOAD_LIMIT, "0");
+  option.put(PREF_MAX_CONCURRENT_DOWNLOADS, "1");
+  setShardOption(&option, 1, 2);
+  CPPUNIT_ASSERT_EQUAL(0, option.getAsInt(PREF_MAX_OVERALL_DOWNLOAD_LIMIT));
+  CPPUNIT_ASSERT_EQUAL(0, option.getAsInt(PREF_MAX_OVERALL_UPLOAD_LIMIT));
+  CPPUNIT_ASSERT_EQUAL(1, option.getAsInt(PREF_MAX_CONCURRENT_DOWNLOADS));
+}
+
+void MultiUrlRequestInfoTest::testSetShardOption_files()
+{
+  Option option;
+  option.put(PREF_MAX_CONCURRENT_DOWNLOADS, "5");
+  option.put(PREF_SAVE_SESSION, "/tmp/session");
+  option.put(PREF_DHT_FILE_PATH, "/tmp/dht.dat");
+  option.put(PREF_DHT_FILE_PATH6, "/tmp/dht6.dat");
+  Option option0 = option;
+  setShardOption(&option0, 0, 3);
+  CPPUNIT_ASSERT_EQUAL(std::string("/tmp/session"),
+                       option0.get(PREF_SAVE_SESSION));
+  CPPUNIT_ASSERT_EQUAL(std::string("/tmp/dht.dat"),
+                       option0.get(PREF_DHT_FILE_PATH));
+  setShardOption(&option, 2, 3);
+  CPPUNIT_ASSERT_EQUAL(std::string("/tmp/session.2"),
+                       option.get(PREF_SAVE_SESSION));
+  CPPUNIT_ASSERT_EQUAL(std::string("/tmp/dht.dat.2"),
+                       option.get(PREF_DHT_FILE_PATH));
+  CPPUNIT_ASSERT_EQUAL(std::string("/tmp/dht6.dat.2"),
+                       option.get(PREF_DHT_FILE_PATH6));
+  // Blank options stay blank.
+  CPPUNIT_ASSERT(option.blank(PREF_SAVE_COOKIES));
+}
+
+} // namespace aria2
@@ -0,0 +1,91 @@
+#include "Bench.h"
+
+#include <vector>
+
+#include "RequestGroup.h"
+#include "RequestGroupMan.h"
+#include "DefaultPeerStorage.h"
+#include "BtRuntime.h"
+#include "Peer.h"
+#include "Option.h"
+#include "wallclock.h"
+#include "util.h"
+
+namespace aria2 {
+
+namespace {
+// Compares the cost of computing overall transfer statistics the way
+// it was done before NetStat, by walking the active peers of every
+// BitTorrent download, with the cost of reading RequestGroupMan's
+// NetStat, which is updated incrementally.
+void benchOverallTransferStat()
+{
+  const size_t numGroups = 200;
+  const size_t numPeers = 50;
+  SharedHandle<Option> option(new Option());
+  std::vector<SharedHandle<RequestGroup> > groups;
+  std::vector<SharedHandle<DefaultPeerStorage> > peerStorages;
+  for(size_t i = 0; i < numGroups; ++i) {
+    groups.push_back(SharedHandle<RequestGroup>(new RequestGroup(option)));
+    SharedHandle<DefaultPeerStorage> ps(new DefaultPeerStorage());
+    ps->setBtRuntime(SharedHandle<BtRuntime>(new BtRuntime()));
+    for(size_t j = 0; j < numPeers; ++j) {
+      SharedHandle<Peer> peer(new Peer("192.168.0.1", 6881+j));
+      peer->allocateSessionResource(256*1024, 1024*1024*1024);
+      peer->updateDownloadLength(16*1024);
+      peer->updateUploadLength(16*1024);
+      ps->addPeer(peer);
+    }
+    peerStorages.push_back(ps);
+  }
+  RequestGroupMan rgman(groups, 1, option.get());
+  for(size_t i = 0; i < numGroups; ++i) {
+    groups[i]->setRequestGroupMan(&rgman);
+    for(size_t j = 0; j < numPeers; ++j) {
+      groups[i]->updateDownloadLength(16*1024);
+      groups[i]->updateUploadLength(16*1024);
+    }
+  }
+  const int64_t iteration = 1000;
+  uint64_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      // DefaultPeerStorage caches its statistics for 250ms. Advance
+      // the clock so that every call walks the peers, as every call
+      // did once in 250ms.
+      global::wallclock.advance(1);
+      TransferStat s;
+      for(std::vector<SharedHandle<DefaultPeerStorage> >::const_iterator j =
+            peerStorages.begin(), eoj = peerStorages.end(); j != eoj; ++j) {
+        s += (*j)->calculateStat();
+      }
+      sum += s.getDownloadSpeed();
+    }
+    bench::report("walk "+util::uitos(numGroups*numPeers)+" peers of "+
+                  util::uitos(numGroups)+" groups",
+                  iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      sum += rgman.calculateStat().getDownloadSpeed();
+    }
+    bench::report("RequestGroupMan::calculateStat()",
+                  iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      groups[i%numGroups]->updateDownloadLength(16*1024);
+    }
+    bench::report("RequestGroup::updateDownloadLength()",
+                  iteration, bench::now()-start);
+  }
+  bench::consume(sum);
+}
+} // namespace
+
+A2_BENCHMARK(benchOverallTransferStat)
+
+} // namespace aria2
@@ -0,0 +1,85 @@
+#include "NetStat.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "wallclock.h"
+
+namespace aria2 {
+
+class NetStatTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(NetStatTest);
+  CPPUNIT_TEST(testUpdateLength);
+  CPPUNIT_TEST(testCalculateSpeed);
+  CPPUNIT_TEST(testResetSpeed);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  Timer savedWallclock_;
+public:
+  void setUp()
+  {
+    savedWallclock_ = global::wallclock;
+  }
+
+  void tearDown()
+  {
+    global::wallclock = savedWallclock_;
+  }
+
+  void testUpdateLength();
+  void testCalculateSpeed();
+  void testResetSpeed();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NetStatTest);
+
+void NetStatTest::testUpdateLength()
+{
+  NetStat stat;
+  CPPUNIT_ASSERT_EQUAL((uint64_t)0, stat.getSessionDownloadLength());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)0, stat.getSessionUploadLength());
+  stat.updateDownloadLength(100);
+  stat.updateDownloadLength(200);
+  stat.updateUploadLength(50);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)300, stat.getSessionDownloadLength());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)50, stat.getSessionUploadLength());
+}
+
+void NetStatTest::testCalculateSpeed()
+{
+  NetStat stat;
+  // Start measuring at global::wallclock.
+  stat.resetSpeed();
+  stat.updateDownloadLength(3000);
+  stat.updateDownloadLength(1000);
+  stat.updateUploadLength(1000);
+  global::wallclock.advance(2);
+  CPPUNIT_ASSERT_EQUAL(2000U, stat.calculateDownloadSpeed());
+  CPPUNIT_ASSERT_EQUAL(500U, stat.calculateUploadSpeed());
+}
+
+void NetStatTest::testResetSpeed()
+{
+  NetStat stat;
+  stat.resetSpeed();
+  stat.updateDownloadLength(4000);
+  stat.updateUploadLength(1000);
+  global::wallclock.advance(1);
+  CPPUNIT_ASSERT_EQUAL(4000U, stat.calculateDownloadSpeed());
+  stat.resetSpeed();
+  CPPUNIT_ASSERT_EQUAL(0U, stat.calculateDownloadSpeed());
+  CPPUNIT_ASSERT_EQUAL(0U, stat.calculateUploadSpeed());
+  global::wallclock.advance(1);
+  CPPUNIT_ASSERT_EQUAL(0U, stat.calculateDownloadSpeed());
+  CPPUNIT_ASSERT_EQUAL(0U, stat.calculateUploadSpeed());
+  // The session lengths are not reset.
+  CPPUNIT_ASSERT_EQUAL((uint64_t)4000, stat.getSessionDownloadLength());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1000, stat.getSessionUploadLength());
+  stat.updateDownloadLength(500);
+  global::wallclock.advance(1);
+  CPPUNIT_ASSERT_EQUAL(250U, stat.calculateDownloadSpeed());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)4500, stat.getSessionDownloadLength());
+}
+
+} // namespace aria2
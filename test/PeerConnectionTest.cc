@@ -0,0 +1,135 @@
+#include "PeerConnection.h"
+
+#include <cstring>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SocketCore.h"
+#include "Peer.h"
+#include "ARC4Encryptor.h"
+#include "ARC4Decryptor.h"
+#include "bittorrent_helper.h"
+#include "util.h"
+
+namespace aria2 {
+
+class PeerConnectionTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PeerConnectionTest);
+  CPPUNIT_TEST(testReceiveMessage);
+  CPPUNIT_TEST(testReceiveMessage_encrypted);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  SharedHandle<SocketCore> clientSocket_;
+  SharedHandle<SocketCore> serverSocket_;
+  SharedHandle<Peer> peer_;
+public:
+  void setUp()
+  {
+    SocketCore listenSocket;
+    listenSocket.bind(0);
+    listenSocket.beginListen();
+    std::pair<std::string, uint16_t> addrinfo;
+    listenSocket.getAddrInfo(addrinfo);
+    clientSocket_.reset(new SocketCore());
+    clientSocket_->establishConnection("localhost", addrinfo.second);
+    while(!clientSocket_->isWritable(0));
+    serverSocket_.reset(listenSocket.acceptConnection());
+    clientSocket_->setBlockingMode();
+    serverSocket_->setNonBlockingMode();
+    peer_.reset(new Peer("localhost", 6881));
+  }
+
+  void testReceiveMessage();
+  void testReceiveMessage_encrypted();
+
+  // Sends a have message and a piece message with a 16KiB block from
+  // client to server and checks that server receives them.
+  void sendAndReceive(PeerConnection& client, PeerConnection& server);
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PeerConnectionTest);
+
+namespace {
+bool receive(PeerConnection& conn,
+             const unsigned char*& data, size_t& dataLength)
+{
+  for(int i = 0; i < 1000; ++i) {
+    if(conn.receiveMessage(data, dataLength)) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+void PeerConnectionTest::sendAndReceive
+(PeerConnection& client, PeerConnection& server)
+{
+  unsigned char have[9];
+  bittorrent::createPeerMessageString(have, sizeof(have), 5, 4);
+  bittorrent::setIntParam(&have[5], 100);
+  client.pushInlineBytes(have, sizeof(have));
+
+  const size_t blockLength = 16*1024;
+  unsigned char* piece = new unsigned char[13+blockLength];
+  bittorrent::createPeerMessageString(piece, 13+blockLength,
+                                      9+blockLength, 7);
+  bittorrent::setIntParam(&piece[5], 100);
+  bittorrent::setIntParam(&piece[9], 0);
+  for(size_t i = 0; i < blockLength; ++i) {
+    piece[13+i] = i%256;
+  }
+  client.pushBytes(piece, 13+blockLength);
+  while(!client.sendBufferIsEmpty()) {
+    client.sendPendingData();
+  }
+
+  const unsigned char* data;
+  size_t dataLength;
+  CPPUNIT_ASSERT(receive(server, data, dataLength));
+  CPPUNIT_ASSERT_EQUAL((size_t)5, dataLength);
+  CPPUNIT_ASSERT(memcmp(&have[4], data, dataLength) == 0);
+  // The payload is not copied.
+  CPPUNIT_ASSERT(server.getBuffer() == data);
+
+  CPPUNIT_ASSERT(receive(server, data, dataLength));
+  CPPUNIT_ASSERT_EQUAL((size_t)9+blockLength, dataLength);
+  CPPUNIT_ASSERT(server.getBuffer() == data);
+  CPPUNIT_ASSERT_EQUAL((uint8_t)7, data[0]);
+  for(size_t i = 0; i < blockLength; ++i) {
+    CPPUNIT_ASSERT_EQUAL((unsigned char)(i%256), data[9+i]);
+  }
+}
+
+void PeerConnectionTest::testReceiveMessage()
+{
+  PeerConnection client(1, peer_, clientSocket_);
+  PeerConnection server(2, peer_, serverSocket_);
+  sendAndReceive(client, server);
+}
+
+void PeerConnectionTest::testReceiveMessage_encrypted()
+{
+  unsigned char key1[20];
+  unsigned char key2[20];
+  util::generateRandomData(key1, sizeof(key1));
+  util::generateRandomData(key2, sizeof(key2));
+  SharedHandle<ARC4Encryptor> clientEnc(new ARC4Encryptor());
+  clientEnc->init(key1, sizeof(key1));
+  SharedHandle<ARC4Decryptor> clientDec(new ARC4Decryptor());
+  clientDec->init(key2, sizeof(key2));
+  SharedHandle<ARC4Encryptor> serverEnc(new ARC4Encryptor());
+  serverEnc->init(key2, sizeof(key2));
+  SharedHandle<ARC4Decryptor> serverDec(new ARC4Decryptor());
+  serverDec->init(key1, sizeof(key1));
+
+  PeerConnection client(1, peer_, clientSocket_);
+  client.enableEncryption(clientEnc, clientDec);
+  PeerConnection server(2, peer_, serverSocket_);
+  server.enableEncryption(serverEnc, serverDec);
+  sendAndReceive(client, server);
+}
+
+} // namespace aria2
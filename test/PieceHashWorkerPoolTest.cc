@@ -0,0 +1,198 @@
+#include "PieceHashWorkerPool.h"
+
+#include <poll.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "util.h"
+
+namespace aria2 {
+
+class PieceHashWorkerPoolTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PieceHashWorkerPoolTest);
+  CPPUNIT_TEST(testProcess);
+  CPPUNIT_TEST(testProcess_readError);
+  CPPUNIT_TEST(testSubmit);
+  CPPUNIT_TEST(testCloseGroup);
+  CPPUNIT_TEST(testWakeupFd);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testProcess();
+  void testProcess_readError();
+  void testSubmit();
+  void testCloseGroup();
+  void testWakeupFd();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PieceHashWorkerPoolTest);
+
+namespace {
+PieceHashWorkerPool::Span createSpan
+(const std::string& path, off_t offset, size_t length)
+{
+  PieceHashWorkerPool::Span span;
+  span.path = path;
+  span.offset = offset;
+  span.length = length;
+  return span;
+}
+
+// Returns the job for the piece index of
+// chunkChecksumTestFile250.txt. The piece length is 100.
+PieceHashWorkerPool::Job createJob(size_t index, const std::string& hash)
+{
+  PieceHashWorkerPool::Job job;
+  job.index = index;
+  job.hashType = "sha-1";
+  job.expectedHash = hash;
+  job.spans.push_back
+    (createSpan(A2_TEST_DIR"/chunkChecksumTestFile250.txt", index*100, 100));
+  return job;
+}
+
+void waitResults
+(PieceHashWorkerPool& pool, int64_t groupId, size_t num,
+ std::vector<PieceHashWorkerPool::Result>& results)
+{
+  for(int i = 0; i < 500 && results.size() < num; ++i) {
+    pool.takeResults(groupId, results);
+    if(results.size() < num) {
+      util::usleep(10000);
+    }
+  }
+}
+
+bool isReadable(int fd, int timeout)
+{
+  struct pollfd p;
+  p.fd = fd;
+  p.events = POLLIN;
+  p.revents = 0;
+  return poll(&p, 1, timeout) == 1 && (p.revents&POLLIN);
+}
+} // namespace
+
+void PieceHashWorkerPoolTest::testProcess()
+{
+  unsigned char buf[30];
+  PieceHashWorkerPool::Job job =
+    createJob(0, "29b0e7878271645fffb7eec7db4a7473a1c00bc1");
+  PieceHashWorkerPool::Result result =
+    PieceHashWorkerPool::process(job, buf, sizeof(buf));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, result.index);
+  CPPUNIT_ASSERT(result.match);
+  CPPUNIT_ASSERT(result.error.empty());
+
+  // The same data split into several spans
+  job.spans.clear();
+  job.spans.push_back
+    (createSpan(A2_TEST_DIR"/chunkChecksumTestFile250.txt", 0, 33));
+  job.spans.push_back
+    (createSpan(A2_TEST_DIR"/chunkChecksumTestFile250.txt", 33, 67));
+  result = PieceHashWorkerPool::process(job, buf, sizeof(buf));
+  CPPUNIT_ASSERT(result.match);
+
+  job.expectedHash = "ffffffffffffffffffffffffffffffffffffffff";
+  result = PieceHashWorkerPool::process(job, buf, sizeof(buf));
+  CPPUNIT_ASSERT(!result.match);
+  CPPUNIT_ASSERT_EQUAL(std::string("29b0e7878271645fffb7eec7db4a7473a1c00bc1"),
+                       result.actualHash);
+  CPPUNIT_ASSERT(result.error.empty());
+}
+
+void PieceHashWorkerPoolTest::testProcess_readError()
+{
+  unsigned char buf[30];
+  // The file is only 250 bytes long.
+  PieceHashWorkerPool::Job job =
+    createJob(2, "ffffffffffffffffffffffffffffffffffffffff");
+  PieceHashWorkerPool::Result result =
+    PieceHashWorkerPool::process(job, buf, sizeof(buf));
+  CPPUNIT_ASSERT(!result.match);
+  CPPUNIT_ASSERT(!result.error.empty());
+
+  job.spans.clear();
+  job.spans.push_back(createSpan(A2_TEST_OUT_DIR"/aria2_PieceHashWorkerPool"
+                                 "Test_nonexistent", 0, 100));
+  result = PieceHashWorkerPool::process(job, buf, sizeof(buf));
+  CPPUNIT_ASSERT(!result.match);
+  CPPUNIT_ASSERT(!result.error.empty());
+}
+
+void PieceHashWorkerPoolTest::testSubmit()
+{
+  PieceHashWorkerPool pool(2);
+  CPPUNIT_ASSERT(pool.start());
+  int64_t groupId = pool.openGroup();
+  pool.submit(groupId, createJob(0, "29b0e7878271645fffb7eec7db4a7473a1c00bc1"));
+  pool.submit(groupId, createJob(1, "ffffffffffffffffffffffffffffffffffffffff"));
+  pool.submit(groupId, createJob(2, "ffffffffffffffffffffffffffffffffffffffff"));
+  std::vector<PieceHashWorkerPool::Result> results;
+  waitResults(pool, groupId, 3, results);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, results.size());
+  bool match[3] = { false, true, true };
+  for(size_t i = 0; i < results.size(); ++i) {
+    CPPUNIT_ASSERT(results[i].index < 3);
+    match[results[i].index] = results[i].match;
+  }
+  CPPUNIT_ASSERT(match[0]);
+  CPPUNIT_ASSERT(!match[1]);
+  CPPUNIT_ASSERT(!match[2]);
+  pool.drainWakeupFd(groupId);
+  pool.closeGroup(groupId);
+}
+
+void PieceHashWorkerPoolTest::testCloseGroup()
+{
+  PieceHashWorkerPool pool(1);
+  CPPUNIT_ASSERT(pool.start());
+  int64_t g1 = pool.openGroup();
+  int64_t g2 = pool.openGroup();
+  CPPUNIT_ASSERT(g1 != g2);
+  for(size_t i = 0; i < 2; ++i) {
+    pool.submit(g1, createJob(i, "ffffffffffffffffffffffffffffffffffffffff"));
+  }
+  pool.closeGroup(g1);
+  pool.submit(g2, createJob(0, "29b0e7878271645fffb7eec7db4a7473a1c00bc1"));
+  std::vector<PieceHashWorkerPool::Result> results;
+  waitResults(pool, g2, 1, results);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, results.size());
+  CPPUNIT_ASSERT(results[0].match);
+  // Results of closed group are discarded.
+  results.clear();
+  pool.takeResults(g1, results);
+  CPPUNIT_ASSERT(results.empty());
+}
+
+void PieceHashWorkerPoolTest::testWakeupFd()
+{
+  PieceHashWorkerPool pool(1);
+  CPPUNIT_ASSERT(pool.start());
+  int64_t g1 = pool.openGroup();
+  int64_t g2 = pool.openGroup();
+  int fd1 = pool.getWakeupFd(g1);
+  int fd2 = pool.getWakeupFd(g2);
+  CPPUNIT_ASSERT(fd1 != -1);
+  CPPUNIT_ASSERT(fd2 != -1);
+  CPPUNIT_ASSERT(fd1 != fd2);
+  pool.submit(g1, createJob(0, "29b0e7878271645fffb7eec7db4a7473a1c00bc1"));
+  pool.submit(g2, createJob(0, "29b0e7878271645fffb7eec7db4a7473a1c00bc1"));
+  CPPUNIT_ASSERT(isReadable(fd1, 5000));
+  CPPUNIT_ASSERT(isReadable(fd2, 5000));
+  // Draining the pipe of g1 does not take the wakeup of g2.
+  pool.drainWakeupFd(g1);
+  CPPUNIT_ASSERT(!isReadable(fd1, 0));
+  CPPUNIT_ASSERT(isReadable(fd2, 0));
+  std::vector<PieceHashWorkerPool::Result> results;
+  pool.takeResults(g1, results);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, results.size());
+  // A new result after takeResults() wakes up g1 again.
+  pool.submit(g1, createJob(1, "ffffffffffffffffffffffffffffffffffffffff"));
+  CPPUNIT_ASSERT(isReadable(fd1, 5000));
+  pool.closeGroup(g1);
+  CPPUNIT_ASSERT_EQUAL(-1, pool.getWakeupFd(g1));
+}
+
+} // namespace aria2
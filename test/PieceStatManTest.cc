@@ -1,5 +1,7 @@
 #include "PieceStatMan.h"
 
+#include <algorithm>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 namespace aria2 {
@@ -11,6 +13,8 @@ class PieceStatManTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testAddPieceStats_bitfield);
   CPPUNIT_TEST(testUpdatePieceStats);
   CPPUNIT_TEST(testSubtractPieceStats);
+  CPPUNIT_TEST(testSetPieceOwned);
+  CPPUNIT_TEST(testSetOwnedPieces);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -21,66 +25,66 @@ public:
   void testAddPieceStats_bitfield();
   void testUpdatePieceStats();
   void testSubtractPieceStats();
+  void testSetPieceOwned();
+  void testSetOwnedPieces();
 };
 
 
 CPPUNIT_TEST_SUITE_REGISTRATION(PieceStatManTest);
 
+namespace {
+// Checks that the count of each piece equals to counts, and
+// getRarerPieceIndexes() lists the pieces we don't have in rarest
+// first order, followed by the pieces in owned.
+void checkStats(const PieceStatMan& pieceStatMan, const size_t* counts,
+                const std::vector<size_t>& owned = std::vector<size_t>())
+{
+  const size_t n = pieceStatMan.getNumPieces();
+  for(size_t i = 0; i < n; ++i) {
+    CPPUNIT_ASSERT_EQUAL(counts[i], pieceStatMan.getCount(i));
+  }
+  std::vector<size_t> indexes = pieceStatMan.getRarerPieceIndexes();
+  CPPUNIT_ASSERT_EQUAL(n, indexes.size());
+  CPPUNIT_ASSERT_EQUAL(n-owned.size(), pieceStatMan.countMissingPieces());
+  const size_t missing = pieceStatMan.countMissingPieces();
+  for(size_t i = 1; i < missing; ++i) {
+    CPPUNIT_ASSERT(counts[indexes[i-1]] <= counts[indexes[i]]);
+  }
+  std::vector<size_t> ownedIndexes(indexes.begin()+missing, indexes.end());
+  std::sort(ownedIndexes.begin(), ownedIndexes.end());
+  CPPUNIT_ASSERT(owned == ownedIndexes);
+  std::sort(indexes.begin(), indexes.end());
+  for(size_t i = 0; i < n; ++i) {
+    CPPUNIT_ASSERT_EQUAL(i, indexes[i]);
+  }
+}
+} // namespace
+
 void PieceStatManTest::testAddPieceStats_index()
 {
   PieceStatMan pieceStatMan(10, false);
   pieceStatMan.addPieceStats(1);
   {
-    size_t indexes[] = { 0, 2, 3, 4, 5, 6, 7, 8, 9, 1 };
-    size_t counts[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
-    
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    CPPUNIT_ASSERT_EQUAL((size_t)10, stats.size());
-    
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+    size_t counts[] = { 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    checkStats(pieceStatMan, counts);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, pieceStatMan.getRarerPieceIndexes()[9]);
   }
 
   pieceStatMan.addPieceStats(1);
-
   {
-    size_t indexes[] = { 0, 2, 3, 4, 5, 6, 7, 8, 9, 1 };
-    size_t counts[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 };
-
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+    size_t counts[] = { 0, 2, 0, 0, 0, 0, 0, 0, 0, 0 };
+    checkStats(pieceStatMan, counts);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, pieceStatMan.getRarerPieceIndexes()[9]);
   }
 
   pieceStatMan.addPieceStats(3);
   pieceStatMan.addPieceStats(9);
   pieceStatMan.addPieceStats(3);
   pieceStatMan.addPieceStats(0);
-
   {
-    size_t indexes[] = { 2, 4, 5, 6, 7, 8, 0, 9, 1, 3 };
-    size_t counts[] = {  0, 0, 0, 0, 0, 0, 1, 1, 2, 2 };
-
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+    size_t counts[] = { 1, 2, 0, 2, 0, 0, 0, 0, 0, 1 };
+    checkStats(pieceStatMan, counts);
   }
-
 }
 
 void PieceStatManTest::testAddPieceStats_bitfield()
@@ -89,37 +93,14 @@ void PieceStatManTest::testAddPieceStats_bitfield()
   const unsigned char bitfield[] = { 0xaa, 0x80 };
   pieceStatMan.addPieceStats(bitfield, sizeof(bitfield));
   {
-    size_t indexes[] = { 1, 3, 5, 7, 9, 0, 2, 4, 6, 8 };
-    size_t counts[] = { 0, 0, 0, 0, 0, 1, 1, 1, 1, 1 };
-
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    CPPUNIT_ASSERT_EQUAL((size_t)10, stats.size());
-    
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+    size_t counts[] = { 1, 0, 1, 0, 1, 0, 1, 0, 1, 0 };
+    checkStats(pieceStatMan, counts);
   }
 
   pieceStatMan.addPieceStats(bitfield, sizeof(bitfield));
-
   {
-    size_t indexes[] = { 1, 3, 5, 7, 9, 0, 2, 4, 6, 8 };
-    size_t counts[] = { 0, 0, 0, 0, 0, 2, 2, 2, 2, 2 };
-
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    CPPUNIT_ASSERT_EQUAL((size_t)10, stats.size());
-    
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+    size_t counts[] = { 2, 0, 2, 0, 2, 0, 2, 0, 2, 0 };
+    checkStats(pieceStatMan, counts);
   }
 }
 
@@ -141,20 +122,8 @@ void PieceStatManTest::testUpdatePieceStats()
     // new: 0, 0, 0, 1, 1, 1, 1, 1, 0, 0
     // ---------------------------------
     // res: 0, 0, 0, 1, 2, 2, 2, 2, 1, 1
-
-    size_t indexes[] = { 0, 1, 2, 3, 8, 9, 4, 5, 6, 7 };
-    size_t counts[] =  { 0, 0, 0, 1, 1, 1, 2, 2, 2, 2 };
-
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    CPPUNIT_ASSERT_EQUAL((size_t)10, stats.size());
-    
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+    size_t counts[] = { 0, 0, 0, 1, 2, 2, 2, 2, 1, 1 };
+    checkStats(pieceStatMan, counts);
   }
 }
 
@@ -174,21 +143,68 @@ void PieceStatManTest::testSubtractPieceStats()
     // new: 0, 0, 1, 1, 1, 1, 1, 1, 0, 0
     // ---------------------------------
     // res: 1, 1, 0, 0, 0, 0, 0, 0, 0, 0
+    size_t counts[] = { 1, 1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    checkStats(pieceStatMan, counts);
+  }
+}
 
-    size_t indexes[] = { 2, 3, 4, 5, 6, 7, 8, 9, 0, 1 };
-    size_t counts[] =  { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1 };
-
-    const std::vector<size_t>& statsidx(pieceStatMan.getRarerPieceIndexes());
-    const std::vector<SharedHandle<PieceStat> >& stats
-      (pieceStatMan.getPieceStats());
-
-    CPPUNIT_ASSERT_EQUAL((size_t)10, stats.size());
-    
-    for(size_t i = 0; i < 10; ++i) {
-      CPPUNIT_ASSERT_EQUAL(indexes[i], statsidx[i]);
-      CPPUNIT_ASSERT_EQUAL(counts[i], stats[statsidx[i]]->getCount());
-    }
+void PieceStatManTest::testSetPieceOwned()
+{
+  PieceStatMan pieceStatMan(10, true);
+  const unsigned char bitfield[] = { 0xf0, 0x00 };
+  pieceStatMan.addPieceStats(bitfield, sizeof(bitfield));
+  pieceStatMan.addPieceStats(1);
+  pieceStatMan.setPieceOwned(1, true);
+  pieceStatMan.setPieceOwned(8, true);
+  std::vector<size_t> owned;
+  owned.push_back(1);
+  owned.push_back(8);
+  {
+    size_t counts[] = { 1, 2, 1, 1, 0, 0, 0, 0, 0, 0 };
+    checkStats(pieceStatMan, counts, owned);
   }
+  // Counts of owned pieces are still updated.
+  pieceStatMan.addPieceStats(8);
+  pieceStatMan.addPieceStats(8);
+  pieceStatMan.addPieceStats(8);
+  pieceStatMan.subtractPieceStats(bitfield, sizeof(bitfield));
+  {
+    size_t counts[] = { 0, 1, 0, 0, 0, 0, 0, 0, 3, 0 };
+    checkStats(pieceStatMan, counts, owned);
+  }
+  // The count of piece 8 is larger than any other piece.
+  pieceStatMan.setPieceOwned(8, false);
+  owned.pop_back();
+  {
+    size_t counts[] = { 0, 1, 0, 0, 0, 0, 0, 0, 3, 0 };
+    checkStats(pieceStatMan, counts, owned);
+    CPPUNIT_ASSERT_EQUAL((size_t)8, pieceStatMan.getRarerPieceIndexes()[8]);
+  }
+  pieceStatMan.setPieceOwned(1, false);
+  owned.clear();
+  pieceStatMan.addPieceStats(1);
+  {
+    size_t counts[] = { 0, 2, 0, 0, 0, 0, 0, 0, 3, 0 };
+    checkStats(pieceStatMan, counts, owned);
+  }
+}
+
+void PieceStatManTest::testSetOwnedPieces()
+{
+  PieceStatMan pieceStatMan(10, true);
+  const unsigned char bitfield[] = { 0xff, 0xc0 };
+  pieceStatMan.addPieceStats(bitfield, sizeof(bitfield));
+  const unsigned char ownedBitfield[] = { 0x81, 0x40 };
+  pieceStatMan.setOwnedPieces(ownedBitfield, sizeof(ownedBitfield));
+  std::vector<size_t> owned;
+  owned.push_back(0);
+  owned.push_back(7);
+  owned.push_back(9);
+  size_t counts[] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+  checkStats(pieceStatMan, counts, owned);
+  const unsigned char noneBitfield[] = { 0x00, 0x00 };
+  pieceStatMan.setOwnedPieces(noneBitfield, sizeof(noneBitfield));
+  checkStats(pieceStatMan, counts);
 }
 
 } // namespace aria2
@@ -4,6 +4,10 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include "WrDiskCache.h"
+#include "DirectDiskAdaptor.h"
+#include "ByteArrayDiskWriter.h"
+
 namespace aria2 {
 
 class PieceTest:public CppUnit::TestFixture {
@@ -15,6 +19,7 @@ class PieceTest:public CppUnit::TestFixture {
 #ifdef ENABLE_MESSAGE_DIGEST
 
   CPPUNIT_TEST(testUpdateHash);
+  CPPUNIT_TEST(testGetHashStringWithWrCache);
 
 #endif // ENABLE_MESSAGE_DIGEST
 
@@ -30,6 +35,7 @@ public:
 #ifdef ENABLE_MESSAGE_DIGEST
 
   void testUpdateHash();
+  void testGetHashStringWithWrCache();
 
 #endif // ENABLE_MESSAGE_DIGEST
 };
@@ -84,6 +90,26 @@ void PieceTest::testUpdateHash()
                        p.getHashString());
 }
 
+void PieceTest::testGetHashStringWithWrCache()
+{
+  SharedHandle<DirectDiskAdaptor> adaptor(new DirectDiskAdaptor());
+  SharedHandle<ByteArrayDiskWriter> writer(new ByteArrayDiskWriter());
+  writer->setString("SPAM!.....SPAM!!");
+  adaptor->setDiskWriter(writer);
+  adaptor->setTotalLength(16);
+  WrDiskCache dc(1024);
+  Piece p(0, 16, 2*1024*1024);
+  p.setHashAlgo("sha-1");
+  p.initWrCache(&dc, adaptor);
+  std::string spam("SPAM!");
+  p.updateWrCache(&dc, reinterpret_cast<const unsigned char*>(spam.c_str()),
+                  spam.size(), 5);
+  CPPUNIT_ASSERT_EQUAL(std::string("d9189aff79e075a2e60271b9556a710dc1bc7de7"),
+                       p.getHashStringWithWrCache(16, adaptor));
+  // Cached data is not written to disk.
+  CPPUNIT_ASSERT_EQUAL(std::string("SPAM!.....SPAM!!"), writer->getString());
+}
+
 #endif // ENABLE_MESSAGE_DIGEST
 
 } // namespace aria2
@@ -46,6 +46,19 @@ void RarestPieceSelectorTest::testSelect()
   CPPUNIT_ASSERT(selector.select(index, bf.getBitfield(),
                                  bf.countBlock()));
   CPPUNIT_ASSERT_EQUAL((size_t)2, index);
+
+  // Pieces we have are never selected.
+  pieceStatMan->setPieceOwned(2, true);
+
+  CPPUNIT_ASSERT(selector.select(index, bf.getBitfield(),
+                                 bf.countBlock()));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, index);
+
+  pieceStatMan->setPieceOwned(0, true);
+  pieceStatMan->setPieceOwned(1, true);
+
+  CPPUNIT_ASSERT(!selector.select(index, bf.getBitfield(),
+                                  bf.countBlock()));
 }
 
 } // namespace aria2
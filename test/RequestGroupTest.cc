@@ -7,6 +7,7 @@
 #include "FileEntry.h"
 #include "PieceStorage.h"
 #include "DownloadResult.h"
+#include "RequestGroupMan.h"
 
 namespace aria2 {
 
@@ -15,6 +16,7 @@ class RequestGroupTest : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(RequestGroupTest);
   CPPUNIT_TEST(testGetFirstFilePath);
   CPPUNIT_TEST(testCreateDownloadResult);
+  CPPUNIT_TEST(testUpdateDownloadLength);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<Option> option_;
@@ -26,6 +28,7 @@ public:
 
   void testGetFirstFilePath();
   void testCreateDownloadResult();
+  void testUpdateDownloadLength();
 };
 
 
@@ -88,4 +91,28 @@ void RequestGroupTest::testCreateDownloadResult()
   }
 }
 
+void RequestGroupTest::testUpdateDownloadLength()
+{
+  RequestGroupMan rgman(std::vector<SharedHandle<RequestGroup> >(), 1,
+                        option_.get());
+  RequestGroup group1(option_);
+  RequestGroup group2(option_);
+  group1.setRequestGroupMan(&rgman);
+  group2.setRequestGroupMan(&rgman);
+
+  group1.updateDownloadLength(100);
+  group1.updateUploadLength(10);
+  group2.updateDownloadLength(200);
+
+  TransferStat stat1 = group1.calculateStat();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)100, stat1.getSessionDownloadLength());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)10, stat1.getSessionUploadLength());
+  TransferStat stat2 = group2.calculateStat();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)200, stat2.getSessionDownloadLength());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)0, stat2.getSessionUploadLength());
+  TransferStat stat = rgman.calculateStat();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)300, stat.getSessionDownloadLength());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)10, stat.getSessionUploadLength());
+}
+
 } // namespace aria2
@@ -10,6 +10,7 @@
 #include "PieceSelector.h"
 #include "FileEntry.h"
 #include "PeerStat.h"
+#include "wallclock.h"
 
 namespace aria2 {
 
@@ -23,6 +24,11 @@ class SegmentManTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testCancelAllSegments);
   CPPUNIT_TEST(testGetPeerStat);
   CPPUNIT_TEST(testGetCleanSegmentIfOwnerIsIdle);
+  CPPUNIT_TEST(testGetCleanSegmentAfter);
+  CPPUNIT_TEST(testStealSegment);
+  CPPUNIT_TEST(testStealSegment_unknownSpeed);
+  CPPUNIT_TEST(testStealSegment_slowerThief);
+  CPPUNIT_TEST(testStealSegment_fileEntry);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<Option> option_;
@@ -32,6 +38,7 @@ private:
 public:
   void setUp()
   {
+    global::wallclock.reset();
     size_t pieceLength = 1024*1024;
     uint64_t totalLength = 64*1024*1024;
     option_.reset(new Option());
@@ -48,6 +55,11 @@ public:
   void testCancelAllSegments();
   void testGetPeerStat();
   void testGetCleanSegmentIfOwnerIsIdle();
+  void testGetCleanSegmentAfter();
+  void testStealSegment();
+  void testStealSegment_unknownSpeed();
+  void testStealSegment_slowerThief();
+  void testStealSegment_fileEntry();
 };
 
 
@@ -199,4 +211,136 @@ void SegmentManTest::testGetCleanSegmentIfOwnerIsIdle()
   CPPUNIT_ASSERT(!segmentMan_->getCleanSegmentIfOwnerIsIdle(5, 1));
 }
 
+void SegmentManTest::testGetCleanSegmentAfter()
+{
+  // segment#0-#2 are in file1 and segment#3- are in file2.
+  SharedHandle<FileEntry> file1(new FileEntry("file1", 3*1024*1024, 0));
+  SharedHandle<Segment> seg0 = segmentMan_->getSegmentWithIndex(1, 0);
+  SharedHandle<Segment> seg1 =
+    segmentMan_->getCleanSegmentAfter(1, seg0, file1);
+  CPPUNIT_ASSERT(seg1);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, seg1->getIndex());
+  // segment#2 has data.
+  SharedHandle<Segment> seg2 = segmentMan_->getSegmentWithIndex(2, 2);
+  seg2->updateWrittenLength(100);
+  segmentMan_->cancelSegment(2);
+  CPPUNIT_ASSERT(!segmentMan_->getCleanSegmentAfter(1, seg1, file1));
+  // It is canceled and can be checked out again.
+  CPPUNIT_ASSERT(segmentMan_->getSegmentWithIndex(2, 2));
+  // segment#3 is out of file1.
+  CPPUNIT_ASSERT(!segmentMan_->getCleanSegmentAfter(2, seg2, file1));
+  CPPUNIT_ASSERT(segmentMan_->getSegmentWithIndex(3, 3));
+}
+
+namespace {
+// Creates active PeerStat which downloaded bytes in the last second.
+SharedHandle<PeerStat> createPeerStat(cuid_t cuid, size_t bytes)
+{
+  SharedHandle<PeerStat> peerStat(new PeerStat(cuid));
+  peerStat->downloadStart();
+  peerStat->updateDownloadLength(bytes);
+  return peerStat;
+}
+} // namespace
+
+void SegmentManTest::testStealSegment()
+{
+  // A slow source has segment#0 and a fast source has segment#32.
+  // Both have 31 free segments after them, which are not split for
+  // the other connections because of minSplitSize.
+  size_t minSplitSize = 64*1024*1024;
+  SharedHandle<Segment> slowSeg = segmentMan_->getSegmentWithIndex(1, 0);
+  SharedHandle<Segment> fastSeg = segmentMan_->getSegmentWithIndex(2, 32);
+  segmentMan_->registerPeerStat(createPeerStat(1, 100*1024));
+  segmentMan_->registerPeerStat(createPeerStat(2, 1000*1024));
+  SharedHandle<PeerStat> thief(new PeerStat(3));
+  thief->downloadStart();
+  thief->updateDownloadLength(300*1024);
+  thief->downloadStop();
+  segmentMan_->registerPeerStat(thief);
+  CPPUNIT_ASSERT(!segmentMan_->getSegment(3, minSplitSize));
+  // The speed is not measured yet.
+  CPPUNIT_ASSERT(!segmentMan_->stealSegment(3));
+  global::wallclock.advance(1);
+  // The slow source keeps 31*100/(100+300) = 7 segments and the
+  // thief takes the rest.
+  SharedHandle<Segment> segment = segmentMan_->stealSegment(3);
+  CPPUNIT_ASSERT(segment);
+  CPPUNIT_ASSERT_EQUAL((size_t)8, segment->getIndex());
+  CPPUNIT_ASSERT_EQUAL((size_t)7, segmentMan_->countFreePieceFrom(1));
+  // The slow source cannot continue to the stolen segment, even
+  // though the thief has not started downloading it yet.
+  CPPUNIT_ASSERT_EQUAL(PeerStat::IDLE, thief->getStatus());
+  CPPUNIT_ASSERT(!segmentMan_->getSegmentWithIndex(1, 8));
+  CPPUNIT_ASSERT(!segmentMan_->getCleanSegmentIfOwnerIsIdle(1, 8));
+  std::vector<SharedHandle<Segment> > segments;
+  segmentMan_->getInFlightSegment(segments, 3);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, segments.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)8, segments[0]->getIndex());
+}
+
+void SegmentManTest::testStealSegment_unknownSpeed()
+{
+  SharedHandle<Segment> slowSeg = segmentMan_->getSegmentWithIndex(1, 0);
+  SharedHandle<Segment> fastSeg = segmentMan_->getSegmentWithIndex(2, 32);
+  segmentMan_->registerPeerStat(createPeerStat(1, 100*1024));
+  segmentMan_->registerPeerStat(createPeerStat(2, 1000*1024));
+  global::wallclock.advance(1);
+  // The speed of cuid 3 is not known. It takes the latter half.
+  SharedHandle<Segment> segment = segmentMan_->stealSegment(3);
+  CPPUNIT_ASSERT(segment);
+  CPPUNIT_ASSERT_EQUAL((size_t)16, segment->getIndex());
+  // cuid 3 has no PeerStat, but the segment is not taken back.
+  CPPUNIT_ASSERT(!segmentMan_->getCleanSegmentIfOwnerIsIdle(1, 16));
+}
+
+void SegmentManTest::testStealSegment_slowerThief()
+{
+  SharedHandle<Segment> slowSeg = segmentMan_->getSegmentWithIndex(1, 0);
+  segmentMan_->registerPeerStat(createPeerStat(1, 100*1024));
+  SharedHandle<PeerStat> thief(new PeerStat(2));
+  thief->downloadStart();
+  thief->updateDownloadLength(50*1024);
+  segmentMan_->registerPeerStat(thief);
+  global::wallclock.advance(1);
+  // Stealing from the faster connection doesn't help.
+  CPPUNIT_ASSERT(!segmentMan_->stealSegment(2));
+  // Idle owner is not a victim. Its segment is left to
+  // getCleanSegmentIfOwnerIsIdle().
+  segmentMan_->getSegmentWithIndex(3, 40);
+  segmentMan_->registerPeerStat(SharedHandle<PeerStat>(new PeerStat(3)));
+  SharedHandle<Segment> segment = segmentMan_->stealSegment(4);
+  CPPUNIT_ASSERT(segment);
+  CPPUNIT_ASSERT_EQUAL((size_t)20, segment->getIndex());
+}
+
+void SegmentManTest::testStealSegment_fileEntry()
+{
+  SharedHandle<DownloadContext> dctx(new DownloadContext());
+  dctx->setPieceLength(1024*1024);
+  SharedHandle<FileEntry> fileEntries[] = {
+    SharedHandle<FileEntry>(new FileEntry("file1", 16*1024*1024, 0)),
+    SharedHandle<FileEntry>
+    (new FileEntry("file2", 48*1024*1024, 16*1024*1024))
+  };
+  dctx->setFileEntries(&fileEntries[0], &fileEntries[2]);
+  SharedHandle<DefaultPieceStorage> ps
+    (new DefaultPieceStorage(dctx, option_.get()));
+  SegmentMan segman(option_.get(), dctx, ps);
+  segman.getSegmentWithIndex(1, 0);
+  segman.getSegmentWithIndex(2, 16);
+  segman.registerPeerStat(createPeerStat(1, 100*1024));
+  segman.registerPeerStat(createPeerStat(2, 1000*1024));
+  global::wallclock.advance(1);
+  // Only cuid 2 downloads file2, so it is the victim although it is
+  // faster than cuid 1. It has 47 free segments after it.
+  SharedHandle<Segment> segment = segman.stealSegment(3, fileEntries[1]);
+  CPPUNIT_ASSERT(segment);
+  CPPUNIT_ASSERT_EQUAL((size_t)(17+47/2), segment->getIndex());
+  // The free segments of cuid 1 stop at the end of file1.
+  segment = segman.stealSegment(4, fileEntries[0]);
+  CPPUNIT_ASSERT(segment);
+  CPPUNIT_ASSERT_EQUAL((size_t)(1+15/2), segment->getIndex());
+}
+
 } // namespace aria2
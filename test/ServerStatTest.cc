@@ -15,6 +15,9 @@ class ServerStatTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(ServerStatTest);
   CPPUNIT_TEST(testSetStatus);
   CPPUNIT_TEST(testOperatorOstream);
+  CPPUNIT_TEST(testUpdateRtt);
+  CPPUNIT_TEST(testCalculatePipelineDepth);
+  CPPUNIT_TEST(testPipeliningBroken);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -23,6 +26,9 @@ public:
 
   void testSetStatus();
   void testOperatorOstream();
+  void testUpdateRtt();
+  void testCalculatePipelineDepth();
+  void testPipeliningBroken();
 };
 
 
@@ -82,4 +88,49 @@ void ServerStatTest::testOperatorOstream()
 
 }
 
+void ServerStatTest::testUpdateRtt()
+{
+  ServerStat ss("localhost", "http");
+  CPPUNIT_ASSERT_EQUAL(0U, ss.getRtt());
+  ss.updateRtt(80);
+  CPPUNIT_ASSERT_EQUAL(80U, ss.getRtt());
+  ss.updateRtt(160);
+  CPPUNIT_ASSERT_EQUAL(90U, ss.getRtt());
+}
+
+void ServerStatTest::testCalculatePipelineDepth()
+{
+  ServerStat ss("localhost", "http");
+  // RTT is unknown
+  CPPUNIT_ASSERT_EQUAL(8U, ss.calculatePipelineDepth(8, 1024*1024));
+  CPPUNIT_ASSERT_EQUAL(1U, ss.calculatePipelineDepth(1, 1024*1024));
+  ss.updateRtt(100);
+  ss.setDownloadSpeed(10*1024*1024);
+  // 1MiB is received in one RTT.
+  CPPUNIT_ASSERT_EQUAL(2U, ss.calculatePipelineDepth(8, 1024*1024));
+  // 4 segments are received in one RTT.
+  CPPUNIT_ASSERT_EQUAL(5U, ss.calculatePipelineDepth(8, 256*1024));
+  CPPUNIT_ASSERT_EQUAL(8U, ss.calculatePipelineDepth(8, 16*1024));
+  ss.increasePipeliningFailures();
+  CPPUNIT_ASSERT_EQUAL(2U, ss.calculatePipelineDepth(8, 256*1024));
+  ss.increasePipeliningFailures();
+  CPPUNIT_ASSERT_EQUAL(1U, ss.calculatePipelineDepth(8, 256*1024));
+}
+
+void ServerStatTest::testPipeliningBroken()
+{
+  ServerStat ss("localhost", "http");
+  CPPUNIT_ASSERT(!ss.isPipeliningBroken());
+  ss.increasePipeliningFailures();
+  ss.increasePipeliningFailures();
+  CPPUNIT_ASSERT(!ss.isPipeliningBroken());
+  ss.increasePipeliningFailures();
+  CPPUNIT_ASSERT(ss.isPipeliningBroken());
+
+  ServerStat ss2("localhost", "http");
+  ss2.setPipeliningBroken();
+  CPPUNIT_ASSERT(ss2.isPipeliningBroken());
+  CPPUNIT_ASSERT_EQUAL(1U, ss2.calculatePipelineDepth(8, 1024*1024));
+}
+
 } // namespace aria2
@@ -0,0 +1,135 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "SocketBuffer.h"
+#include "SocketCore.h"
+#include "a2io.h"
+
+namespace aria2 {
+
+namespace {
+// Returns the number of write(2) family system calls issued by this
+// process, or -1 if it is not available.  Both writev(2) and
+// write(2) are counted, but send(2) is not.
+int64_t getSyscw()
+{
+  std::ifstream in("/proc/self/io");
+  std::string key;
+  int64_t value;
+  while(in >> key >> value) {
+    if(key == "syscw:") {
+      return value;
+    }
+  }
+  return -1;
+}
+
+void drain(SocketCore& socket)
+{
+  char buf[64*1024];
+  while(1) {
+    size_t len = sizeof(buf);
+    socket.readData(buf, len);
+    if(len == 0) {
+      break;
+    }
+  }
+}
+
+// Queue of messages a BitTorrent peer sends for each 16KiB block:
+// a have, 2 requests, a piece message header and the block itself.
+const size_t BLOCK_LENGTH = 16*1024;
+const size_t MSGS_PER_BLOCK = 5;
+const size_t MSG_LENGTHS[MSGS_PER_BLOCK] = { 9, 17, 17, 13, BLOCK_LENGTH };
+
+void report(const std::string& name, int64_t mib, int64_t elapsed,
+            int64_t syscw)
+{
+  bench::report(name+" (per MiB)", mib, elapsed);
+  if(syscw >= 0) {
+    printf("  %-50s %12.1f syscalls/MiB\n", "",
+           static_cast<double>(syscw)/mib);
+  }
+}
+
+// Compares sending a queue of BitTorrent messages one entry per
+// system call with SocketBuffer::send(), which gathers the queued
+// entries into one writev(2) call.
+void benchSocketBufferSend()
+{
+  SocketCore listenSocket;
+  listenSocket.bind(0);
+  listenSocket.beginListen();
+  std::pair<std::string, uint16_t> addrinfo;
+  listenSocket.getAddrInfo(addrinfo);
+  SharedHandle<SocketCore> client(new SocketCore());
+  client->establishConnection("localhost", addrinfo.second);
+  while(!client->isWritable(0));
+  SharedHandle<SocketCore> server(listenSocket.acceptConnection());
+  server->setNonBlockingMode();
+
+  const int64_t mib = 256;
+  const size_t blocks = mib*1024*1024/BLOCK_LENGTH;
+  std::string data(BLOCK_LENGTH, 'a');
+  {
+    int64_t syscw = getSyscw();
+    int64_t start = bench::now();
+    for(size_t i = 0; i < blocks; ++i) {
+      for(size_t j = 0; j < MSGS_PER_BLOCK; ++j) {
+        a2iovec iov;
+        iov.iov_base = &data[0];
+        iov.iov_len = MSG_LENGTHS[j];
+        while(iov.iov_len > 0) {
+          ssize_t r = client->writeVector(&iov, 1);
+          iov.iov_base = static_cast<char*>(iov.iov_base)+r;
+          iov.iov_len -= r;
+          if(iov.iov_len > 0) {
+            drain(*server);
+          }
+        }
+      }
+    }
+    int64_t elapsed = bench::now()-start;
+    report("one system call per entry", mib, elapsed,
+           syscw < 0 ? -1 : getSyscw()-syscw);
+  }
+  drain(*server);
+  {
+    SocketBuffer sb(client);
+    int64_t syscw = getSyscw();
+    int64_t start = bench::now();
+    for(size_t i = 0; i < blocks; ++i) {
+      for(size_t j = 0; j < MSGS_PER_BLOCK; ++j) {
+        if(MSG_LENGTHS[j] == BLOCK_LENGTH) {
+          unsigned char* block = new unsigned char[BLOCK_LENGTH];
+          memcpy(block, data.data(), BLOCK_LENGTH);
+          sb.pushBytes(block, BLOCK_LENGTH);
+        } else {
+          sb.pushStr(data.substr(0, MSG_LENGTHS[j]));
+        }
+      }
+      // Flush every 4 blocks, like a peer which has a few messages
+      // queued when the socket becomes writable.
+      if(i%4 == 3) {
+        while(!sb.sendBufferIsEmpty()) {
+          sb.send();
+          if(!sb.sendBufferIsEmpty()) {
+            drain(*server);
+          }
+        }
+      }
+    }
+    int64_t elapsed = bench::now()-start;
+    report("SocketBuffer::send()", mib, elapsed,
+           syscw < 0 ? -1 : getSyscw()-syscw);
+  }
+}
+} // namespace
+
+A2_BENCHMARK(benchSocketBufferSend)
+
+} // namespace aria2
@@ -0,0 +1,121 @@
+#include "SocketBuffer.h"
+
+#include <cstring>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SocketCore.h"
+#include "MultiDiskAdaptor.h"
+#include "FileEntry.h"
+#include "Exception.h"
+#include "a2io.h"
+
+namespace aria2 {
+
+class SocketBufferTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(SocketBufferTest);
+  CPPUNIT_TEST(testSend);
+  CPPUNIT_TEST(testSend_manyEntries);
+  CPPUNIT_TEST(testSend_file);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  SharedHandle<SocketCore> clientSocket_;
+  SharedHandle<SocketCore> serverSocket_;
+public:
+  void setUp()
+  {
+    SocketCore listenSocket;
+    listenSocket.bind(0);
+    listenSocket.beginListen();
+    std::pair<std::string, uint16_t> addrinfo;
+    listenSocket.getAddrInfo(addrinfo);
+    clientSocket_.reset(new SocketCore());
+    clientSocket_->establishConnection("localhost", addrinfo.second);
+    while(!clientSocket_->isWritable(0));
+    serverSocket_.reset(listenSocket.acceptConnection());
+    clientSocket_->setBlockingMode();
+    serverSocket_->setBlockingMode();
+  }
+
+  void testSend();
+  void testSend_manyEntries();
+  void testSend_file();
+
+  std::string sendAll(SocketBuffer& sb);
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SocketBufferTest);
+
+std::string SocketBufferTest::sendAll(SocketBuffer& sb)
+{
+  size_t total = 0;
+  while(!sb.sendBufferIsEmpty()) {
+    total += sb.send();
+  }
+  std::string data;
+  char buf[256];
+  while(data.size() < total) {
+    size_t len = sizeof(buf);
+    serverSocket_->readData(buf, len);
+    CPPUNIT_ASSERT(len > 0);
+    data.append(&buf[0], &buf[len]);
+  }
+  return data;
+}
+
+void SocketBufferTest::testSend()
+{
+  SocketBuffer sb(clientSocket_);
+  sb.pushStr("hello ");
+  unsigned char* bytes = new unsigned char[5];
+  memcpy(bytes, "world", 5);
+  sb.pushBytes(bytes, 5);
+  sb.pushInlineBytes(reinterpret_cast<const unsigned char*>("!"), 1);
+  CPPUNIT_ASSERT_EQUAL(std::string("hello world!"), sendAll(sb));
+}
+
+void SocketBufferTest::testSend_manyEntries()
+{
+  SocketBuffer sb(clientSocket_);
+  std::string expected;
+  // More entries than a single writev(2) call can take. Short strings
+  // are stored inline and long ones are not.
+  for(size_t i = 0; i < A2_IOV_MAX+10; ++i) {
+    std::string s(i%100, 'a'+i%26);
+    sb.pushStr(s);
+    expected += s;
+  }
+  CPPUNIT_ASSERT_EQUAL(expected, sendAll(sb));
+}
+
+void SocketBufferTest::testSend_file()
+{
+  SharedHandle<FileEntry> entry1(new FileEntry(A2_TEST_DIR"/file1r.txt", 15, 0));
+  SharedHandle<FileEntry> entry2(new FileEntry(A2_TEST_DIR"/file2r.txt", 7, 15));
+  std::vector<SharedHandle<FileEntry> > entries;
+  entries.push_back(entry1);
+  entries.push_back(entry2);
+  SharedHandle<MultiDiskAdaptor> adaptor(new MultiDiskAdaptor());
+  adaptor->setPieceLength(2);
+  adaptor->setFileEntries(entries.begin(), entries.end());
+  adaptor->enableReadOnly();
+  adaptor->openFile();
+
+  SocketBuffer sb(clientSocket_);
+  if(!clientSocket_->isSendFileAvailable()) {
+    CPPUNIT_ASSERT(!sb.pushFile(adaptor, 0, 1));
+    return;
+  }
+  sb.pushStr("<");
+  CPPUNIT_ASSERT(sb.pushFile(adaptor, 2, 5));
+  sb.pushStr("|");
+  // The data spans file1r.txt and file2r.txt, so that it is read into
+  // memory and sent.
+  CPPUNIT_ASSERT(sb.pushFile(adaptor, 13, 4));
+  sb.pushStr(">");
+  CPPUNIT_ASSERT_EQUAL(std::string("<34567|DEFG>"), sendAll(sb));
+}
+
+} // namespace aria2
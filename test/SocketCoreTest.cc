@@ -1,5 +1,10 @@
 #include "SocketCore.h"
 #include "Exception.h"
+#include "TLSSessionCache.h"
+#include "array_fun.h"
+#ifdef ENABLE_SSL
+# include "TLSContext.h"
+#endif // ENABLE_SSL
 #include <iostream>
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -10,6 +15,9 @@ class SocketCoreTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(SocketCoreTest);
   CPPUNIT_TEST(testWriteAndReadDatagram);
   CPPUNIT_TEST(testGetSocketError);
+#ifdef ENABLE_SSL
+  CPPUNIT_TEST(testTLSSessionResumption);
+#endif // ENABLE_SSL
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -18,6 +26,9 @@ public:
 
   void testWriteAndReadDatagram();
   void testGetSocketError();
+#ifdef ENABLE_SSL
+  void testTLSSessionResumption();
+#endif // ENABLE_SSL
 };
 
 
@@ -69,4 +80,232 @@ void SocketCoreTest::testGetSocketError()
   CPPUNIT_ASSERT_EQUAL(std::string(""), s.getSocketError());
 }
 
+#ifdef HAVE_LIBSSL
+namespace {
+// Connects to the local TLS server listening on server and completes
+// the handshake, using cache for the client side. Returns true if the
+// server resumed the session.
+bool connectTLS(SocketCore& server, SSL_CTX* serverCtx, uint16_t port,
+                const SharedHandle<TLSSessionCache>& cache)
+{
+  SocketCore client;
+  client.establishConnection("localhost", port);
+  SharedHandle<SocketCore> conn(server.acceptConnection());
+  conn->setNonBlockingMode();
+  SSL* ssl = SSL_new(serverCtx);
+  SSL_set_fd(ssl, conn->getSockfd());
+  client.prepareSecureConnection(cache, "localhost", port);
+  bool clientDone = false;
+  bool serverDone = false;
+  for(int i = 0; i < 100000 && !(clientDone && serverDone); ++i) {
+    if(!clientDone) {
+      clientDone = client.initiateSecureConnection("localhost");
+    }
+    if(!serverDone) {
+      int r = SSL_accept(ssl);
+      if(r == 1) {
+        serverDone = true;
+      } else {
+        int e = SSL_get_error(ssl, r);
+        CPPUNIT_ASSERT(e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE);
+      }
+    }
+  }
+  CPPUNIT_ASSERT(clientDone && serverDone);
+  // In TLSv1.3, the session ticket arrives after the handshake.
+  CPPUNIT_ASSERT_EQUAL(1, SSL_write(ssl, "x", 1));
+  char buf[1];
+  size_t len = 0;
+  for(int i = 0; i < 10 && len == 0; ++i) {
+    // The data may already be buffered by the TLS library, so read
+    // even if the socket does not become readable.
+    client.isReadable(1);
+    len = sizeof(buf);
+    client.readData(buf, len);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)1, len);
+  bool resumed = SSL_session_reused(ssl);
+  SSL_free(ssl);
+  return resumed;
+}
+} // namespace
+
+void SocketCoreTest::testTLSSessionResumption()
+{
+  SharedHandle<TLSContext> tlsContext(new TLSContext());
+  SocketCore::setTLSContext(tlsContext);
+
+  SSL_CTX* serverCtx = SSL_CTX_new(SSLv23_server_method());
+  CPPUNIT_ASSERT_EQUAL
+    (1, SSL_CTX_use_certificate_file(serverCtx, A2_TEST_DIR"/tls-server.crt",
+                                     SSL_FILETYPE_PEM));
+  CPPUNIT_ASSERT_EQUAL
+    (1, SSL_CTX_use_PrivateKey_file(serverCtx, A2_TEST_DIR"/tls-server.key",
+                                    SSL_FILETYPE_PEM));
+  const unsigned char sessionIdContext[] = "aria2";
+  SSL_CTX_set_session_id_context(serverCtx, sessionIdContext,
+                                 sizeof(sessionIdContext)-1);
+  try {
+    SocketCore server;
+    server.bind(0);
+    server.beginListen();
+    std::pair<std::string, uint16_t> addr;
+    server.getAddrInfo(addr);
+
+    SharedHandle<TLSSessionCache> cache(new TLSSessionCache());
+    // The first connection does the full handshake.
+    CPPUNIT_ASSERT(!connectTLS(server, serverCtx, addr.second, cache));
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache->countHit());
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache->countMiss());
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache->size());
+    // The second one resumes the session.
+    CPPUNIT_ASSERT(connectTLS(server, serverCtx, addr.second, cache));
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache->countHit());
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache->countMiss());
+    // Without the cache, the session is not resumed.
+    CPPUNIT_ASSERT(!connectTLS(server, serverCtx, addr.second,
+                               SharedHandle<TLSSessionCache>()));
+  } catch(Exception& e) {
+    std::cerr << e.stackTrace() << std::endl;
+    SSL_CTX_free(serverCtx);
+    CPPUNIT_FAIL("exception thrown");
+  }
+  SSL_CTX_free(serverCtx);
+  SocketCore::setTLSContext(SharedHandle<TLSContext>());
+}
+#endif // HAVE_LIBSSL
+
+#ifdef HAVE_LIBGNUTLS
+namespace {
+// Connects to the local TLS server listening on server and completes
+// the handshake, using cache for the client side. Returns true if the
+// server resumed the session. If sessionBeforeRead is not null, the
+// session data cached right after the handshake is stored in it.
+bool connectTLS(SocketCore& server, gnutls_certificate_credentials_t cred,
+                const char* priority, gnutls_datum_t* ticketKey,
+                uint16_t port, const SharedHandle<TLSSessionCache>& cache,
+                std::string* sessionBeforeRead = 0)
+{
+  SocketCore client;
+  client.establishConnection("localhost", port);
+  SharedHandle<SocketCore> conn(server.acceptConnection());
+  conn->setNonBlockingMode();
+  gnutls_session_t session;
+  CPPUNIT_ASSERT_EQUAL(GNUTLS_E_SUCCESS,
+                       gnutls_init(&session, GNUTLS_SERVER));
+  CPPUNIT_ASSERT_EQUAL(GNUTLS_E_SUCCESS,
+                       gnutls_priority_set_direct(session, priority, 0));
+  gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, cred);
+  CPPUNIT_ASSERT_EQUAL(GNUTLS_E_SUCCESS,
+                       gnutls_session_ticket_enable_server(session,
+                                                           ticketKey));
+  gnutls_transport_set_ptr(session,
+                           (gnutls_transport_ptr_t)(ptrdiff_t)
+                           conn->getSockfd());
+  client.prepareSecureConnection(cache, "localhost", port);
+  bool clientDone = false;
+  bool serverDone = false;
+  for(int i = 0; i < 100000 && !(clientDone && serverDone); ++i) {
+    if(!clientDone) {
+      clientDone = client.initiateSecureConnection("localhost");
+    }
+    if(!serverDone) {
+      int r = gnutls_handshake(session);
+      if(r == GNUTLS_E_SUCCESS) {
+        serverDone = true;
+      } else {
+        CPPUNIT_ASSERT(r == GNUTLS_E_AGAIN || r == GNUTLS_E_INTERRUPTED);
+      }
+    }
+  }
+  CPPUNIT_ASSERT(clientDone && serverDone);
+  if(sessionBeforeRead) {
+    CPPUNIT_ASSERT(cache->find(*sessionBeforeRead, "localhost", port));
+  }
+  // In TLSv1.3, the session ticket arrives after the handshake.
+  CPPUNIT_ASSERT_EQUAL((ssize_t)1, gnutls_record_send(session, "x", 1));
+  char buf[1];
+  size_t len = 0;
+  for(int i = 0; i < 10 && len == 0; ++i) {
+    // The data may already be buffered by the TLS library, so read
+    // even if the socket does not become readable.
+    client.isReadable(1);
+    len = sizeof(buf);
+    client.readData(buf, len);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)1, len);
+  bool resumed = gnutls_session_is_resumed(session);
+  gnutls_deinit(session);
+  return resumed;
+}
+} // namespace
+
+void SocketCoreTest::testTLSSessionResumption()
+{
+  SharedHandle<TLSContext> tlsContext(new TLSContext());
+  SocketCore::setTLSContext(tlsContext);
+
+  gnutls_certificate_credentials_t cred;
+  CPPUNIT_ASSERT_EQUAL(GNUTLS_E_SUCCESS,
+                       gnutls_certificate_allocate_credentials(&cred));
+  CPPUNIT_ASSERT_EQUAL
+    (GNUTLS_E_SUCCESS,
+     gnutls_certificate_set_x509_key_file(cred, A2_TEST_DIR"/tls-server.crt",
+                                          A2_TEST_DIR"/tls-server.key",
+                                          GNUTLS_X509_FMT_PEM));
+  gnutls_datum_t ticketKey;
+  CPPUNIT_ASSERT_EQUAL(GNUTLS_E_SUCCESS,
+                       gnutls_session_ticket_key_generate(&ticketKey));
+  const char* priorities[] = {
+    "NORMAL:-VERS-ALL:+VERS-TLS1.2",
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+    "NORMAL:-VERS-ALL:+VERS-TLS1.3",
+#endif // GNUTLS_VERSION_NUMBER >= 0x030605
+  };
+  try {
+    SocketCore server;
+    server.bind(0);
+    server.beginListen();
+    std::pair<std::string, uint16_t> addr;
+    server.getAddrInfo(addr);
+
+    for(size_t i = 0; i < A2_ARRAY_LEN(priorities); ++i) {
+      SharedHandle<TLSSessionCache> cache(new TLSSessionCache());
+      // The first connection does the full handshake and stores the
+      // session with gnutls_session_get_data2().
+      std::string sessionBeforeRead;
+      CPPUNIT_ASSERT(!connectTLS(server, cred, priorities[i], &ticketKey,
+                                 addr.second, cache, &sessionBeforeRead));
+      CPPUNIT_ASSERT_EQUAL((size_t)1, cache->countMiss());
+      CPPUNIT_ASSERT_EQUAL((size_t)1, cache->size());
+      std::string sessionAfterRead;
+      CPPUNIT_ASSERT(cache->find(sessionAfterRead, "localhost", addr.second));
+      if(i == 1) {
+        // In TLSv1.3, the session is stored again after the first
+        // read, which received the session ticket.
+        CPPUNIT_ASSERT(sessionBeforeRead != sessionAfterRead);
+      }
+      // The second one resumes the session with
+      // gnutls_session_set_data().
+      CPPUNIT_ASSERT(connectTLS(server, cred, priorities[i], &ticketKey,
+                                addr.second, cache));
+      CPPUNIT_ASSERT_EQUAL((size_t)3, cache->countHit());
+      CPPUNIT_ASSERT_EQUAL((size_t)1, cache->countMiss());
+      // Without the cache, the session is not resumed.
+      CPPUNIT_ASSERT(!connectTLS(server, cred, priorities[i], &ticketKey,
+                                 addr.second,
+                                 SharedHandle<TLSSessionCache>()));
+    }
+  } catch(Exception& e) {
+    std::cerr << e.stackTrace() << std::endl;
+    gnutls_free(ticketKey.data);
+    gnutls_certificate_free_credentials(cred);
+    CPPUNIT_FAIL("exception thrown");
+  }
+  gnutls_free(ticketKey.data);
+  gnutls_certificate_free_credentials(cred);
+  SocketCore::setTLSContext(SharedHandle<TLSContext>());
+}
+#endif // HAVE_LIBGNUTLS
+
 } // namespace aria2
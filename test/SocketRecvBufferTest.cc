@@ -0,0 +1,147 @@
+#include "SocketRecvBuffer.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SocketCore.h"
+#include "array_fun.h"
+
+namespace aria2 {
+
+class SocketRecvBufferTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(SocketRecvBufferTest);
+  CPPUNIT_TEST(testRecv);
+  CPPUNIT_TEST(testUpdateCapacity);
+  CPPUNIT_TEST(testRecvOwned);
+  CPPUNIT_TEST(testResetCapacity);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  SharedHandle<SocketCore> clientSocket_;
+  SharedHandle<SocketCore> serverSocket_;
+public:
+  void setUp()
+  {
+    SocketCore listenSocket;
+    listenSocket.bind(0);
+    listenSocket.beginListen();
+    std::pair<std::string, uint16_t> addrinfo;
+    listenSocket.getAddrInfo(addrinfo);
+    clientSocket_.reset(new SocketCore());
+    clientSocket_->establishConnection("localhost", addrinfo.second);
+    while(!clientSocket_->isWritable(0));
+    serverSocket_.reset(listenSocket.acceptConnection());
+    clientSocket_->setBlockingMode();
+    serverSocket_->setBlockingMode();
+  }
+
+  void testRecv();
+  void testUpdateCapacity();
+  void testRecvOwned();
+  void testResetCapacity();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SocketRecvBufferTest);
+
+void SocketRecvBufferTest::testRecv()
+{
+  SocketRecvBuffer buf(clientSocket_, 8);
+  buf.setMaxCapacity(20);
+  serverSocket_->writeData(std::string(40, 'a'));
+  CPPUNIT_ASSERT_EQUAL((ssize_t)8, buf.recv());
+  // The buffer was filled, so that it grew.
+  CPPUNIT_ASSERT_EQUAL((size_t)16, buf.getCapacity());
+  CPPUNIT_ASSERT_EQUAL((size_t)8, buf.getBufferLength());
+  buf.shiftBuffer(4);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)12, buf.recv());
+  CPPUNIT_ASSERT_EQUAL((size_t)20, buf.getCapacity());
+  CPPUNIT_ASSERT_EQUAL(std::string(16, 'a'),
+                       std::string(&buf.getBuffer()[0],
+                                   &buf.getBuffer()[buf.getBufferLength()]));
+  buf.clearBuffer();
+  CPPUNIT_ASSERT_EQUAL((ssize_t)20, buf.recv());
+  // Reached the maximum capacity
+  CPPUNIT_ASSERT_EQUAL((size_t)20, buf.getCapacity());
+}
+
+void SocketRecvBufferTest::testUpdateCapacity()
+{
+  SocketRecvBuffer buf(clientSocket_, 8);
+  // The buffer never grows by default.
+  buf.updateCapacity(8, 8);
+  CPPUNIT_ASSERT_EQUAL((size_t)8, buf.getCapacity());
+  buf.setMaxCapacity(32);
+  // Partial read
+  buf.updateCapacity(8, 7);
+  CPPUNIT_ASSERT_EQUAL((size_t)8, buf.getCapacity());
+  // Read less than capacity was requested
+  buf.updateCapacity(4, 4);
+  CPPUNIT_ASSERT_EQUAL((size_t)8, buf.getCapacity());
+  buf.updateCapacity(8, 8);
+  CPPUNIT_ASSERT_EQUAL((size_t)16, buf.getCapacity());
+}
+
+void SocketRecvBufferTest::testRecvOwned()
+{
+  SocketRecvBuffer buf(clientSocket_, 8);
+  buf.setMaxCapacity(32);
+  serverSocket_->writeData(std::string(8, 'a'));
+  {
+    // The read filled the whole block, so the block is returned as
+    // is and the capacity grows.
+    size_t len = 8;
+    array_ptr<unsigned char> data(buf.recvOwned(len));
+    CPPUNIT_ASSERT_EQUAL((size_t)8, len);
+    CPPUNIT_ASSERT_EQUAL(std::string(8, 'a'),
+                         std::string(&data[0], &data[len]));
+    CPPUNIT_ASSERT_EQUAL((size_t)16, buf.getCapacity());
+  }
+  serverSocket_->writeData(std::string(5, 'b'));
+  {
+    // A short read is copied into a block of its size. The capacity
+    // does not grow.
+    size_t len = 16;
+    array_ptr<unsigned char> data(buf.recvOwned(len));
+    CPPUNIT_ASSERT_EQUAL((size_t)5, len);
+    CPPUNIT_ASSERT_EQUAL(std::string(5, 'b'),
+                         std::string(&data[0], &data[len]));
+    CPPUNIT_ASSERT_EQUAL((size_t)16, buf.getCapacity());
+  }
+  // The internal buffer is not used.
+  CPPUNIT_ASSERT(buf.bufferEmpty());
+  clientSocket_->setNonBlockingMode();
+  {
+    // No data available
+    size_t len = 16;
+    CPPUNIT_ASSERT(!buf.recvOwned(len));
+    CPPUNIT_ASSERT_EQUAL((size_t)0, len);
+  }
+}
+
+void SocketRecvBufferTest::testResetCapacity()
+{
+  SocketRecvBuffer buf(clientSocket_, 8);
+  buf.setMaxCapacity(32);
+  buf.updateCapacity(8, 8);
+  buf.updateCapacity(16, 16);
+  CPPUNIT_ASSERT_EQUAL((size_t)32, buf.getCapacity());
+  serverSocket_->writeData(std::string(20, 'a'));
+  CPPUNIT_ASSERT_EQUAL((ssize_t)20, buf.recv());
+  // The data does not fit in the initial capacity.
+  buf.resetCapacity();
+  CPPUNIT_ASSERT_EQUAL((size_t)20, buf.getCapacity());
+  CPPUNIT_ASSERT_EQUAL(std::string(20, 'a'),
+                       std::string(&buf.getBuffer()[0],
+                                   &buf.getBuffer()[buf.getBufferLength()]));
+  buf.shiftBuffer(16);
+  buf.resetCapacity();
+  CPPUNIT_ASSERT_EQUAL((size_t)8, buf.getCapacity());
+  CPPUNIT_ASSERT_EQUAL(std::string(4, 'a'),
+                       std::string(&buf.getBuffer()[0],
+                                   &buf.getBuffer()[buf.getBufferLength()]));
+  // The maximum capacity is reset, too.
+  buf.updateCapacity(8, 8);
+  CPPUNIT_ASSERT_EQUAL((size_t)8, buf.getCapacity());
+}
+
+} // namespace aria2
@@ -0,0 +1,162 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <string>
+#include <algorithm>
+
+#include "ChunkedDecodingStreamFilter.h"
+#include "GZipDecodingStreamFilter.h"
+#include "SinkStreamFilter.h"
+#include "GZipEncoder.h"
+#include "BinaryStream.h"
+#include "MockSegment.h"
+#include "util.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+namespace {
+// Discards written data.
+class NullBinaryStream:public BinaryStream {
+public:
+  size_t written;
+
+  NullBinaryStream():written(0) {}
+
+  virtual void writeData(const unsigned char* data, size_t len, off_t offset)
+  {
+    written += len;
+  }
+
+  virtual ssize_t readData(unsigned char* data, size_t len, off_t offset)
+  {
+    return 0;
+  }
+
+  virtual void enableDirectIO() {}
+
+  virtual void disableDirectIO() {}
+};
+
+class BenchSegment:public MockSegment {
+private:
+  off_t positionToWrite_;
+public:
+  BenchSegment():positionToWrite_(0) {}
+
+  virtual void updateWrittenLength(size_t bytes)
+  {
+    positionToWrite_ += bytes;
+  }
+
+  virtual off_t getPositionToWrite() const
+  {
+    return positionToWrite_;
+  }
+};
+
+// Returns about length bytes of text which compresses like a
+// typical HTML page.
+std::string createBody(size_t length)
+{
+  std::string body;
+  for(size_t i = 0; body.size() < length; ++i) {
+    body += "<tr><td class=\"name\">file"+util::uitos(i)+
+      ".dat</td><td class=\"size\">"+util::uitos(i*7919%100000)+
+      "</td></tr>\n";
+  }
+  return body;
+}
+
+std::string gzip(const std::string& data)
+{
+  GZipEncoder encoder;
+  encoder.init();
+  encoder << data;
+  return encoder.str();
+}
+
+std::string chunk(const std::string& data, size_t chunkSize)
+{
+  std::string res;
+  for(size_t i = 0; i < data.size(); i += chunkSize) {
+    size_t len = std::min(chunkSize, data.size()-i);
+    res += fmt("%x", static_cast<unsigned int>(len));
+    res += "\r\n";
+    res.append(data, i, len);
+    res += "\r\n";
+  }
+  res += "0\r\n\r\n";
+  return res;
+}
+
+// Feeds body to filter in reads of 16KiB, the size of the socket
+// receive buffer, and returns the number of decoded bytes.
+size_t run(const SharedHandle<StreamFilter>& filter, const std::string& body)
+{
+  SharedHandle<NullBinaryStream> out(new NullBinaryStream());
+  SharedHandle<Segment> segment(new BenchSegment());
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(body.data());
+  size_t offset = 0;
+  while(offset < body.size()) {
+    size_t len = std::min((size_t)16*1024, body.size()-offset);
+    filter->transform(out, segment, p+offset, len);
+    offset += filter->getBytesProcessed();
+  }
+  return out->written;
+}
+
+// Measures decoding 8MiB body with chunked and/or gzip encoding.
+void benchDecodeHttpBody()
+{
+  std::string body = createBody(8*1024*1024);
+  std::string gzipped = gzip(body);
+  std::string chunked = chunk(body, 4*1024);
+  std::string chunkedGzipped = chunk(gzipped, 4*1024);
+  const int64_t iteration = 10;
+  size_t sum = 0;
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      SharedHandle<StreamFilter> filter
+        (new ChunkedDecodingStreamFilter
+         (SharedHandle<StreamFilter>(new SinkStreamFilter())));
+      filter->init();
+      sum += run(filter, chunked);
+    }
+    bench::report("chunked", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      SharedHandle<StreamFilter> filter
+        (new GZipDecodingStreamFilter
+         (SharedHandle<StreamFilter>(new SinkStreamFilter())));
+      filter->init();
+      sum += run(filter, gzipped);
+    }
+    bench::report("gzip", iteration, bench::now()-start);
+  }
+  {
+    int64_t start = bench::now();
+    for(int64_t i = 0; i < iteration; ++i) {
+      SharedHandle<StreamFilter> gzipFilter
+        (new GZipDecodingStreamFilter
+         (SharedHandle<StreamFilter>(new SinkStreamFilter())));
+      SharedHandle<StreamFilter> filter
+        (new ChunkedDecodingStreamFilter(gzipFilter));
+      gzipFilter->init();
+      filter->init();
+      sum += run(filter, chunkedGzipped);
+    }
+    bench::report("chunked+gzip", iteration, bench::now()-start);
+  }
+  if(sum != body.size()*iteration*3) {
+    printf("Decoded length mismatch\n");
+  }
+}
+} // namespace
+
+A2_BENCHMARK(benchDecodeHttpBody)
+
+} // namespace aria2
@@ -0,0 +1,100 @@
+#include "TLSSessionCache.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "wallclock.h"
+
+namespace aria2 {
+
+class TLSSessionCacheTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(TLSSessionCacheTest);
+  CPPUNIT_TEST(testFind);
+  CPPUNIT_TEST(testPut_replace);
+  CPPUNIT_TEST(testPut_maxSize);
+  CPPUNIT_TEST(testFind_timeout);
+  CPPUNIT_TEST(testRemove);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void setUp()
+  {
+    global::wallclock.reset();
+  }
+
+  void testFind();
+  void testPut_replace();
+  void testPut_maxSize();
+  void testFind_timeout();
+  void testRemove();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TLSSessionCacheTest);
+
+void TLSSessionCacheTest::testFind()
+{
+  TLSSessionCache cache;
+  std::string session;
+  CPPUNIT_ASSERT(!cache.find(session, "www", 443));
+  cache.put("www", 443, "session1");
+  cache.put("ftp", 990, "session2");
+  CPPUNIT_ASSERT(cache.find(session, "www", 443));
+  CPPUNIT_ASSERT_EQUAL(std::string("session1"), session);
+  CPPUNIT_ASSERT(cache.find(session, "ftp", 990));
+  CPPUNIT_ASSERT_EQUAL(std::string("session2"), session);
+  CPPUNIT_ASSERT(!cache.find(session, "www", 8443));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, cache.countHit());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, cache.countMiss());
+}
+
+void TLSSessionCacheTest::testPut_replace()
+{
+  TLSSessionCache cache;
+  cache.put("www", 443, "session1");
+  cache.put("www", 443, "session2");
+  CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+  std::string session;
+  CPPUNIT_ASSERT(cache.find(session, "www", 443));
+  CPPUNIT_ASSERT_EQUAL(std::string("session2"), session);
+}
+
+void TLSSessionCacheTest::testPut_maxSize()
+{
+  TLSSessionCache cache(2);
+  std::string session;
+  cache.put("alpha", 443, "session1");
+  cache.put("bravo", 443, "session2");
+  // alpha is now used more recently than bravo.
+  CPPUNIT_ASSERT(cache.find(session, "alpha", 443));
+  cache.put("charlie", 443, "session3");
+  CPPUNIT_ASSERT_EQUAL((size_t)2, cache.size());
+  CPPUNIT_ASSERT(!cache.find(session, "bravo", 443));
+  CPPUNIT_ASSERT(cache.find(session, "alpha", 443));
+  CPPUNIT_ASSERT(cache.find(session, "charlie", 443));
+}
+
+void TLSSessionCacheTest::testFind_timeout()
+{
+  TLSSessionCache cache(256, 60);
+  std::string session;
+  cache.put("www", 443, "session1");
+  global::wallclock.advance(59);
+  CPPUNIT_ASSERT(cache.find(session, "www", 443));
+  global::wallclock.advance(1);
+  CPPUNIT_ASSERT(!cache.find(session, "www", 443));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, cache.countHit());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, cache.countMiss());
+}
+
+void TLSSessionCacheTest::testRemove()
+{
+  TLSSessionCache cache;
+  cache.put("www", 443, "session1");
+  cache.remove("www", 443);
+  std::string session;
+  CPPUNIT_ASSERT(!cache.find(session, "www", 443));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+}
+
+} // namespace aria2
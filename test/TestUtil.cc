@@ -14,6 +14,7 @@
 #include "Cookie.h"
 #include "DefaultDiskWriter.h"
 #include "fmt.h"
+#include "ValueBase.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "message_digest_helper.h"
 #endif // ENABLE_MESSAGE_DIGEST
@@ -75,6 +76,13 @@ Cookie createCookie
     (name, value, expiryTime, true, domain, hostOnly, path, secure, false, 0);
 }
 
+BencodeNode::BencodeNode(const ValueBase* vlb)
+  : data_(bencode2::encode(vlb))
+{
+  node_ = doc_.parse(reinterpret_cast<const unsigned char*>(data_.data()),
+                     data_.size());
+}
+
 #ifdef ENABLE_MESSAGE_DIGEST
 std::string fileHexDigest
 (const SharedHandle<MessageDigest>& ctx, const std::string& filename)
@@ -4,10 +4,12 @@
 
 #include "SharedHandle.h"
 #include "Cookie.h"
+#include "bencode2.h"
 
 namespace aria2 {
 
 class MessageDigest;
+class ValueBase;
 
 void createFile(const std::string& filename, size_t length);
 
@@ -42,6 +44,23 @@ Cookie createCookie
  const std::string& path,
  bool secure);
 
+// Holds bencode2::Node decoded from the bencoded form of vlb, so that
+// tests can build the input of functions taking bencode2::Node with
+// ValueBase. get() is valid while this object is alive.
+class BencodeNode {
+private:
+  std::string data_;
+  bencode2::Document doc_;
+  const bencode2::Node* node_;
+public:
+  BencodeNode(const ValueBase* vlb);
+
+  const bencode2::Node* get() const
+  {
+    return node_;
+  }
+};
+
 #ifdef ENABLE_MESSAGE_DIGEST
 // Returns hex digest of contents of file denoted by filename.
 std::string fileHexDigest
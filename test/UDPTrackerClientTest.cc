@@ -0,0 +1,422 @@
+#include "UDPTrackerClient.h"
+
+#include <cstring>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "UDPTrackerRequest.h"
+#include "bittorrent_helper.h"
+#include "SocketCore.h"
+#include "A2STR.h"
+#include "util.h"
+
+namespace aria2 {
+
+class UDPTrackerClientTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(UDPTrackerClientTest);
+  CPPUNIT_TEST(testCreateUDPTrackerConnect);
+  CPPUNIT_TEST(testCreateUDPTrackerAnnounce);
+  CPPUNIT_TEST(testAnnounceReply_ipv6);
+  CPPUNIT_TEST(testConnectFollowedByAnnounce);
+  CPPUNIT_TEST(testRequestFailure);
+  CPPUNIT_TEST(testTimeout);
+  CPPUNIT_TEST(testConnectionIdExpiry);
+  CPPUNIT_TEST(testStubTracker);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testCreateUDPTrackerConnect();
+  void testCreateUDPTrackerAnnounce();
+  void testAnnounceReply_ipv6();
+  void testConnectFollowedByAnnounce();
+  void testRequestFailure();
+  void testTimeout();
+  void testConnectionIdExpiry();
+  void testStubTracker();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(UDPTrackerClientTest);
+
+namespace {
+SharedHandle<UDPTrackerRequest> createAnnounce
+(const std::string& remoteAddr, uint16_t remotePort)
+{
+  SharedHandle<UDPTrackerRequest> req(new UDPTrackerRequest());
+  req->remoteAddr = remoteAddr;
+  req->remotePort = remotePort;
+  req->action = UDPT_ACT_ANNOUNCE;
+  req->infohash = std::string(20, 'i');
+  req->peerId = std::string(20, 'p');
+  req->downloaded = 1000000000LL;
+  req->left = 2000000000LL;
+  req->uploaded = 3000000000LL;
+  req->event = UDPT_EVT_STARTED;
+  req->key = 0xdeadbeef;
+  req->numWant = 50;
+  req->port = 6889;
+  return req;
+}
+} // namespace
+
+namespace {
+int64_t getLLIntParam(const unsigned char* data, size_t pos)
+{
+  uint64_t hi = bittorrent::getIntParam(data, pos);
+  uint64_t lo = bittorrent::getIntParam(data, pos+4);
+  return static_cast<int64_t>((hi << 32) | lo);
+}
+} // namespace
+
+namespace {
+void setLLIntParam(unsigned char* dest, int64_t param)
+{
+  uint64_t v = static_cast<uint64_t>(param);
+  bittorrent::setIntParam(dest, static_cast<uint32_t>(v >> 32));
+  bittorrent::setIntParam(dest+4, static_cast<uint32_t>(v & 0xffffffffu));
+}
+} // namespace
+
+namespace {
+size_t createConnectReply
+(unsigned char* data, int32_t transactionId, int64_t connectionId)
+{
+  bittorrent::setIntParam(data, UDPT_ACT_CONNECT);
+  bittorrent::setIntParam(data+4, transactionId);
+  setLLIntParam(data+8, connectionId);
+  return 16;
+}
+} // namespace
+
+namespace {
+size_t createAnnounceReply
+(unsigned char* data, int32_t transactionId, int numPeers)
+{
+  bittorrent::setIntParam(data, UDPT_ACT_ANNOUNCE);
+  bittorrent::setIntParam(data+4, transactionId);
+  bittorrent::setIntParam(data+8, 1800);
+  bittorrent::setIntParam(data+12, 100);
+  bittorrent::setIntParam(data+16, 256);
+  for(int i = 0; i < numPeers; ++i) {
+    bittorrent::packcompact(data+20+6*i, "192.168.0."+util::itos(i+1),
+                            6990+i);
+  }
+  return 20+6*numPeers;
+}
+} // namespace
+
+void UDPTrackerClientTest::testCreateUDPTrackerConnect()
+{
+  unsigned char data[100];
+  SharedHandle<UDPTrackerRequest> req(new UDPTrackerRequest());
+  req->action = UDPT_ACT_CONNECT;
+  req->transactionId = 1000000009;
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16,
+                       createUDPTrackerConnect(data, sizeof(data), req));
+  CPPUNIT_ASSERT_EQUAL((int64_t)0x41727101980LL, getLLIntParam(data, 0));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)UDPT_ACT_CONNECT,
+                       bittorrent::getIntParam(data, 8));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)1000000009,
+                       bittorrent::getIntParam(data, 12));
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1, createUDPTrackerConnect(data, 15, req));
+}
+
+void UDPTrackerClientTest::testCreateUDPTrackerAnnounce()
+{
+  unsigned char data[100];
+  SharedHandle<UDPTrackerRequest> req = createAnnounce("192.168.0.1", 6969);
+  req->connectionId = 12345012345LL;
+  req->transactionId = 1000000009;
+  unsigned char ip[] = { 192, 168, 0, 2 };
+  memcpy(&req->ip, ip, sizeof(ip));
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98,
+                       createUDPTrackerAnnounce(data, sizeof(data), req));
+  CPPUNIT_ASSERT_EQUAL(req->connectionId, getLLIntParam(data, 0));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)UDPT_ACT_ANNOUNCE,
+                       bittorrent::getIntParam(data, 8));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)req->transactionId,
+                       bittorrent::getIntParam(data, 12));
+  CPPUNIT_ASSERT_EQUAL(req->infohash,
+                       std::string(&data[16], &data[36]));
+  CPPUNIT_ASSERT_EQUAL(req->peerId,
+                       std::string(&data[36], &data[56]));
+  CPPUNIT_ASSERT_EQUAL(req->downloaded, getLLIntParam(data, 56));
+  CPPUNIT_ASSERT_EQUAL(req->left, getLLIntParam(data, 64));
+  CPPUNIT_ASSERT_EQUAL(req->uploaded, getLLIntParam(data, 72));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)UDPT_EVT_STARTED,
+                       bittorrent::getIntParam(data, 80));
+  CPPUNIT_ASSERT(memcmp(ip, &data[84], 4) == 0);
+  CPPUNIT_ASSERT_EQUAL(req->key, bittorrent::getIntParam(data, 88));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)50, bittorrent::getIntParam(data, 92));
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6889, bittorrent::getShortIntParam(data, 96));
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1, createUDPTrackerAnnounce(data, 97, req));
+}
+
+void UDPTrackerClientTest::testAnnounceReply_ipv6()
+{
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  Timer now;
+  UDPTrackerClient tr;
+  tr.setConnectionId("2001:db8::1", 6969, 1111, now);
+  SharedHandle<UDPTrackerRequest> req = createAnnounce("2001:db8::1", 6969);
+  tr.addRequest(req);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98, tr.createRequest(data, sizeof(data),
+                                                     remoteAddr, remotePort,
+                                                     now));
+  CPPUNIT_ASSERT_EQUAL(std::string("2001:db8::1"), remoteAddr);
+  tr.requestSent(now);
+  // IPv6 tracker returns 18 bytes compact peers.
+  bittorrent::setIntParam(data, UDPT_ACT_ANNOUNCE);
+  bittorrent::setIntParam(data+4, req->transactionId);
+  bittorrent::setIntParam(data+8, 1800);
+  bittorrent::setIntParam(data+12, 1);
+  bittorrent::setIntParam(data+16, 1);
+  bittorrent::packcompact(data+20, "2001:db8::2", 6881);
+  bittorrent::packcompact(data+38, "2001:db8::3", 6882);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, 56, "2001:db8::1", 6969,
+                                          now));
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_SUCCESS, req->error);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, req->reply->peers.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("2001:db8::2"),
+                       req->reply->peers[0].first);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6881, req->reply->peers[0].second);
+  CPPUNIT_ASSERT_EQUAL(std::string("2001:db8::3"),
+                       req->reply->peers[1].first);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6882, req->reply->peers[1].second);
+}
+
+void UDPTrackerClientTest::testConnectFollowedByAnnounce()
+{
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  Timer now;
+  UDPTrackerClient tr;
+  SharedHandle<UDPTrackerRequest> req1 = createAnnounce("192.168.0.1", 6991);
+  SharedHandle<UDPTrackerRequest> req2 = createAnnounce("192.168.0.1", 6991);
+  tr.addRequest(req1);
+  tr.addRequest(req2);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tr.getPendingRequests().size());
+  // No connection ID yet, so connect request comes first.
+  ssize_t rv = tr.createRequest(data, sizeof(data), remoteAddr, remotePort,
+                                now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16, rv);
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.1"), remoteAddr);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6991, remotePort);
+  CPPUNIT_ASSERT_EQUAL((uint32_t)UDPT_ACT_CONNECT,
+                       bittorrent::getIntParam(data, 8));
+  int32_t transactionId = bittorrent::getIntParam(data, 12);
+  tr.requestSent(now);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, tr.getInflightRequests().size());
+  // req2 waits for the connect reply as well.
+  rv = tr.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1, rv);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tr.getConnectRequests().size());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, tr.getPendingRequests().size());
+  // Reply from wrong port is ignored
+  rv = createConnectReply(data, transactionId, 1111);
+  CPPUNIT_ASSERT_EQUAL(-1, tr.receiveReply(data, rv, "192.168.0.1", 6990,
+                                           now));
+  // Wrong transaction ID
+  rv = createConnectReply(data, transactionId+1, 1111);
+  CPPUNIT_ASSERT_EQUAL(-1, tr.receiveReply(data, rv, "192.168.0.1", 6991,
+                                           now));
+  rv = createConnectReply(data, transactionId, 1111);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, rv, "192.168.0.1", 6991,
+                                          now));
+  CPPUNIT_ASSERT(tr.getInflightRequests().empty());
+  CPPUNIT_ASSERT(tr.getConnectRequests().empty());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tr.getPendingRequests().size());
+  UDPTrackerConnection* c = tr.getConnectionId("192.168.0.1", 6991, now);
+  CPPUNIT_ASSERT(c);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_CST_CONNECTED, c->state);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1111, c->connectionId);
+  // Now announce requests use the connection ID in this order.
+  rv = tr.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98, rv);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1111, getLLIntParam(data, 0));
+  CPPUNIT_ASSERT_EQUAL(req1->transactionId,
+                       (int32_t)bittorrent::getIntParam(data, 12));
+  tr.requestSent(now);
+  rv = tr.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98, rv);
+  CPPUNIT_ASSERT_EQUAL(req2->transactionId,
+                       (int32_t)bittorrent::getIntParam(data, 12));
+  tr.requestSent(now);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tr.getInflightRequests().size());
+
+  rv = createAnnounceReply(data, req1->transactionId, 2);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, rv, "192.168.0.1", 6991,
+                                          now));
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req1->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_SUCCESS, req1->error);
+  CPPUNIT_ASSERT_EQUAL((int32_t)1800, req1->reply->interval);
+  CPPUNIT_ASSERT_EQUAL((int32_t)100, req1->reply->leechers);
+  CPPUNIT_ASSERT_EQUAL((int32_t)256, req1->reply->seeders);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, req1->reply->peers.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.2"),
+                       req1->reply->peers[1].first);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6991, req1->reply->peers[1].second);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_PENDING, req2->state);
+
+  // Error reply
+  bittorrent::setIntParam(data, UDPT_ACT_ERROR);
+  bittorrent::setIntParam(data+4, req2->transactionId);
+  memcpy(data+8, "failure", 7);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, 15, "192.168.0.1", 6991,
+                                          now));
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req2->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_TRACKER, req2->error);
+  CPPUNIT_ASSERT_EQUAL(std::string("failure"), req2->reply->errorMessage);
+  CPPUNIT_ASSERT(tr.noRequest());
+}
+
+void UDPTrackerClientTest::testRequestFailure()
+{
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  Timer now;
+  UDPTrackerClient tr;
+  SharedHandle<UDPTrackerRequest> req1 = createAnnounce("192.168.0.1", 6991);
+  SharedHandle<UDPTrackerRequest> req2 = createAnnounce("192.168.0.1", 6991);
+  tr.addRequest(req1);
+  tr.addRequest(req2);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16, tr.createRequest(data, sizeof(data),
+                                                     remoteAddr, remotePort,
+                                                     now));
+  int32_t transactionId = bittorrent::getIntParam(data, 12);
+  tr.requestSent(now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1, tr.createRequest(data, sizeof(data),
+                                                     remoteAddr, remotePort,
+                                                     now));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, tr.getConnectRequests().size());
+  // Error reply to connect request fails the requests waiting for it.
+  bittorrent::setIntParam(data, UDPT_ACT_ERROR);
+  bittorrent::setIntParam(data+4, transactionId);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, 8, "192.168.0.1", 6991,
+                                          now));
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req1->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_TRACKER, req1->error);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req2->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_TRACKER, req2->error);
+  CPPUNIT_ASSERT(!tr.getConnectionId("192.168.0.1", 6991, now));
+  CPPUNIT_ASSERT(tr.noRequest());
+
+  // Connect request which could not be sent.
+  SharedHandle<UDPTrackerRequest> req3 = createAnnounce("192.168.0.1", 6991);
+  tr.addRequest(req3);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16, tr.createRequest(data, sizeof(data),
+                                                     remoteAddr, remotePort,
+                                                     now));
+  tr.requestFail(UDPT_ERR_NETWORK);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req3->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_NETWORK, req3->error);
+  CPPUNIT_ASSERT(tr.noRequest());
+
+  // Cancelled request is not sent.
+  tr.setConnectionId("192.168.0.1", 6991, 1111, now);
+  SharedHandle<UDPTrackerRequest> req4 = createAnnounce("192.168.0.1", 6991);
+  tr.addRequest(req4);
+  req4->state = UDPT_STA_COMPLETE;
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1, tr.createRequest(data, sizeof(data),
+                                                     remoteAddr, remotePort,
+                                                     now));
+  CPPUNIT_ASSERT(tr.noRequest());
+}
+
+void UDPTrackerClientTest::testTimeout()
+{
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  Timer now;
+  UDPTrackerClient tr;
+  tr.setConnectionId("192.168.0.1", 6991, 1111, now);
+  SharedHandle<UDPTrackerRequest> req = createAnnounce("192.168.0.1", 6991);
+  tr.addRequest(req);
+  for(int i = 0; i <= UDPTrackerClient::MAX_RETRY; ++i) {
+    // Keep connection ID alive.
+    tr.setConnectionId("192.168.0.1", 6991, 1111, now);
+    CPPUNIT_ASSERT_EQUAL((ssize_t)98,
+                         tr.createRequest(data, sizeof(data), remoteAddr,
+                                          remotePort, now));
+    tr.requestSent(now);
+    CPPUNIT_ASSERT_EQUAL(i, req->failCount);
+    Timer t = now;
+    t.advance(UDPTrackerClient::getTimeout(i)-1);
+    tr.handleTimeout(t);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, tr.getInflightRequests().size());
+    now.advance(UDPTrackerClient::getTimeout(i));
+    tr.handleTimeout(now);
+  }
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_TIMEOUT, req->error);
+  CPPUNIT_ASSERT(tr.noRequest());
+  CPPUNIT_ASSERT_EQUAL((time_t)15, UDPTrackerClient::getTimeout(0));
+  CPPUNIT_ASSERT_EQUAL((time_t)60, UDPTrackerClient::getTimeout(2));
+}
+
+void UDPTrackerClientTest::testConnectionIdExpiry()
+{
+  Timer now;
+  UDPTrackerClient tr;
+  tr.setConnectionId("192.168.0.1", 6991, 1111, now);
+  Timer t = now;
+  t.advance(UDPTrackerClient::CONNECTION_ID_TTL-1);
+  CPPUNIT_ASSERT(tr.getConnectionId("192.168.0.1", 6991, t));
+  t.advance(1);
+  CPPUNIT_ASSERT(!tr.getConnectionId("192.168.0.1", 6991, t));
+}
+
+void UDPTrackerClientTest::testStubTracker()
+{
+  // Stub tracker on loopback
+  SocketCore tracker(SOCK_DGRAM);
+  tracker.bind("127.0.0.1", 0, AF_INET);
+  std::pair<std::string, uint16_t> trackerAddr;
+  tracker.getAddrInfo(trackerAddr);
+  SocketCore client(SOCK_DGRAM);
+  client.bind("127.0.0.1", 0, AF_INET);
+
+  Timer now;
+  UDPTrackerClient tr;
+  SharedHandle<UDPTrackerRequest> req =
+    createAnnounce("127.0.0.1", trackerAddr.second);
+  tr.addRequest(req);
+  unsigned char data[1024];
+  std::pair<std::string, uint16_t> peer;
+  std::string remoteAddr;
+  uint16_t remotePort;
+  // connect
+  ssize_t len = tr.createRequest(data, sizeof(data), remoteAddr, remotePort,
+                                 now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16, len);
+  client.writeData(data, len, remoteAddr, remotePort);
+  tr.requestSent(now);
+  len = tracker.readDataFrom(data, sizeof(data), peer);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16, len);
+  len = createConnectReply(data, bittorrent::getIntParam(data, 12), 777);
+  tracker.writeData(data, len, peer.first, peer.second);
+  len = client.readDataFrom(data, sizeof(data), peer);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, len, peer.first, peer.second,
+                                          now));
+  // announce
+  len = tr.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98, len);
+  client.writeData(data, len, remoteAddr, remotePort);
+  tr.requestSent(now);
+  len = tracker.readDataFrom(data, sizeof(data), peer);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98, len);
+  CPPUNIT_ASSERT_EQUAL((int64_t)777, getLLIntParam(data, 0));
+  len = createAnnounceReply(data, bittorrent::getIntParam(data, 12), 3);
+  tracker.writeData(data, len, peer.first, peer.second);
+  len = client.readDataFrom(data, sizeof(data), peer);
+  CPPUNIT_ASSERT_EQUAL(0, tr.receiveReply(data, len, peer.first, peer.second,
+                                          now));
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_SUCCESS, req->error);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, req->reply->peers.size());
+}
+
+} // namespace aria2
@@ -0,0 +1,129 @@
+#include "WrDiskCacheEntry.h"
+
+#include <cstring>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "DirectDiskAdaptor.h"
+#include "ByteArrayDiskWriter.h"
+
+namespace aria2 {
+
+namespace {
+class CountingDiskWriter:public ByteArrayDiskWriter {
+public:
+  int writeCount;
+
+  CountingDiskWriter():writeCount(0) {}
+
+  virtual void writeData(const unsigned char* data, size_t len, off_t position)
+  {
+    ++writeCount;
+    ByteArrayDiskWriter::writeData(data, len, position);
+  }
+};
+} // namespace
+
+class WrDiskCacheEntryTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(WrDiskCacheEntryTest);
+  CPPUNIT_TEST(testCacheData);
+  CPPUNIT_TEST(testAcquireData);
+  CPPUNIT_TEST(testWriteToDisk);
+  CPPUNIT_TEST(testClear);
+  CPPUNIT_TEST_SUITE_END();
+
+  SharedHandle<DirectDiskAdaptor> adaptor_;
+  SharedHandle<CountingDiskWriter> writer_;
+public:
+  void setUp()
+  {
+    adaptor_.reset(new DirectDiskAdaptor());
+    adaptor_->setTotalLength(100);
+    writer_.reset(new CountingDiskWriter());
+    adaptor_->setDiskWriter(writer_);
+  }
+
+  void testCacheData();
+  void testAcquireData();
+  void testWriteToDisk();
+  void testClear();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WrDiskCacheEntryTest);
+
+void WrDiskCacheEntryTest::testCacheData()
+{
+  WrDiskCacheEntry e(adaptor_);
+  const unsigned char* data = reinterpret_cast<const unsigned char*>
+    ("0123456789");
+  CPPUNIT_ASSERT(e.cacheData(data, 3, 10));
+  CPPUNIT_ASSERT(e.cacheData(data, 3, 0));
+  CPPUNIT_ASSERT(e.cacheData(data, 7, 3));
+  CPPUNIT_ASSERT_EQUAL((size_t)13, e.getSize());
+  // Overlaps [3, 10)
+  CPPUNIT_ASSERT(!e.cacheData(data, 1, 9));
+  // Overlaps [10, 13)
+  CPPUNIT_ASSERT(!e.cacheData(data, 2, 12));
+  CPPUNIT_ASSERT(!e.cacheData(data, 10, 1));
+  CPPUNIT_ASSERT_EQUAL((size_t)13, e.getSize());
+  CPPUNIT_ASSERT(e.cacheData(data, 2, 13));
+  CPPUNIT_ASSERT_EQUAL((size_t)15, e.getSize());
+
+  const WrDiskCacheEntry::DataCellSet& dataSet = e.getDataSet();
+  CPPUNIT_ASSERT_EQUAL((size_t)4, dataSet.size());
+  WrDiskCacheEntry::DataCellSet::const_iterator i = dataSet.begin();
+  CPPUNIT_ASSERT_EQUAL((off_t)0, (*i++)->goff);
+  CPPUNIT_ASSERT_EQUAL((off_t)3, (*i++)->goff);
+  CPPUNIT_ASSERT_EQUAL((off_t)10, (*i++)->goff);
+  CPPUNIT_ASSERT_EQUAL((off_t)13, (*i++)->goff);
+}
+
+void WrDiskCacheEntryTest::testAcquireData()
+{
+  WrDiskCacheEntry e(adaptor_);
+  unsigned char* data = new unsigned char[3];
+  memcpy(data, "abc", 3);
+  CPPUNIT_ASSERT(e.acquireData(data, 3, 10));
+  CPPUNIT_ASSERT_EQUAL((size_t)3, e.getSize());
+  // data is stored without copying
+  CPPUNIT_ASSERT(data == (*e.getDataSet().begin())->data);
+  unsigned char* overlap = new unsigned char[2];
+  // Overlaps [10, 13). The ownership is not taken.
+  CPPUNIT_ASSERT(!e.acquireData(overlap, 2, 12));
+  delete [] overlap;
+  CPPUNIT_ASSERT_EQUAL((size_t)3, e.getSize());
+  e.writeToDisk();
+  CPPUNIT_ASSERT_EQUAL(std::string("abc"), writer_->getString().substr(10));
+}
+
+void WrDiskCacheEntryTest::testWriteToDisk()
+{
+  WrDiskCacheEntry e(adaptor_);
+  e.cacheData(reinterpret_cast<const unsigned char*>("ef"), 2, 4);
+  e.cacheData(reinterpret_cast<const unsigned char*>("abcd"), 4, 0);
+  e.cacheData(reinterpret_cast<const unsigned char*>("gh"), 2, 6);
+  e.cacheData(reinterpret_cast<const unsigned char*>("z"), 1, 9);
+  e.writeToDisk();
+  // [0, 8) is written at once, and [9, 10) is written separately.
+  CPPUNIT_ASSERT_EQUAL(2, writer_->writeCount);
+  std::string s = writer_->getString();
+  CPPUNIT_ASSERT_EQUAL(std::string("abcdefgh"), s.substr(0, 8));
+  CPPUNIT_ASSERT_EQUAL('z', s[9]);
+  // writeToDisk() does not release data.
+  CPPUNIT_ASSERT_EQUAL((size_t)9, e.getSize());
+}
+
+void WrDiskCacheEntryTest::testClear()
+{
+  WrDiskCacheEntry e(adaptor_);
+  e.cacheData(reinterpret_cast<const unsigned char*>("abcd"), 4, 0);
+  e.clear();
+  CPPUNIT_ASSERT_EQUAL((size_t)0, e.getSize());
+  CPPUNIT_ASSERT(e.getDataSet().empty());
+  e.writeToDisk();
+  CPPUNIT_ASSERT_EQUAL(0, writer_->writeCount);
+}
+
+} // namespace aria2
@@ -0,0 +1,119 @@
+#include "WrDiskCache.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "WrDiskCacheEntry.h"
+#include "DirectDiskAdaptor.h"
+#include "ByteArrayDiskWriter.h"
+#include "Piece.h"
+
+namespace aria2 {
+
+class WrDiskCacheTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(WrDiskCacheTest);
+  CPPUNIT_TEST(testUpdate);
+  CPPUNIT_TEST(testEnsureLimit);
+  CPPUNIT_TEST(testPieceWrCache);
+  CPPUNIT_TEST_SUITE_END();
+
+  SharedHandle<DirectDiskAdaptor> adaptor_;
+  SharedHandle<ByteArrayDiskWriter> writer_;
+public:
+  void setUp()
+  {
+    adaptor_.reset(new DirectDiskAdaptor());
+    adaptor_->setTotalLength(100);
+    writer_.reset(new ByteArrayDiskWriter());
+    adaptor_->setDiskWriter(writer_);
+  }
+
+  void testUpdate();
+  void testEnsureLimit();
+  void testPieceWrCache();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(WrDiskCacheTest);
+
+void WrDiskCacheTest::testUpdate()
+{
+  WrDiskCache dc(100);
+  WrDiskCacheEntry e(adaptor_);
+  e.cacheData(reinterpret_cast<const unsigned char*>("abcd"), 4, 0);
+  dc.update(&e, 4);
+  CPPUNIT_ASSERT_EQUAL((size_t)4, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, dc.countEntry());
+  CPPUNIT_ASSERT(e.getLastUpdate() > 0);
+
+  e.clear();
+  dc.update(&e, -4);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.countEntry());
+  CPPUNIT_ASSERT_EQUAL((int64_t)0, e.getLastUpdate());
+
+  e.cacheData(reinterpret_cast<const unsigned char*>("abcd"), 4, 0);
+  dc.update(&e, 4);
+  dc.remove(&e);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.countEntry());
+  // Data is not written by remove()
+  CPPUNIT_ASSERT_EQUAL(std::string(), writer_->getString());
+}
+
+void WrDiskCacheTest::testEnsureLimit()
+{
+  WrDiskCache dc(10);
+  WrDiskCacheEntry e1(adaptor_);
+  WrDiskCacheEntry e2(adaptor_);
+  e1.cacheData(reinterpret_cast<const unsigned char*>("abcd"), 4, 0);
+  dc.update(&e1, 4);
+  e2.cacheData(reinterpret_cast<const unsigned char*>("ABCD"), 4, 10);
+  dc.update(&e2, 4);
+  e1.cacheData(reinterpret_cast<const unsigned char*>("ef"), 2, 4);
+  dc.update(&e1, 2);
+  CPPUNIT_ASSERT_EQUAL((size_t)10, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL(std::string(), writer_->getString());
+
+  // e2 is least recently updated, so it is written to disk first.
+  e1.cacheData(reinterpret_cast<const unsigned char*>("g"), 1, 6);
+  dc.update(&e1, 1);
+  CPPUNIT_ASSERT_EQUAL((size_t)7, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, dc.countEntry());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, e2.getSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)7, e1.getSize());
+  CPPUNIT_ASSERT_EQUAL(std::string("ABCD"), writer_->getString().substr(10));
+}
+
+void WrDiskCacheTest::testPieceWrCache()
+{
+  WrDiskCache dc(100);
+  Piece p(1, 10);
+  p.initWrCache(&dc, adaptor_);
+  p.updateWrCache(&dc, reinterpret_cast<const unsigned char*>("abcde"), 5, 10);
+  p.updateWrCache(&dc, reinterpret_cast<const unsigned char*>("fghij"), 5, 15);
+  CPPUNIT_ASSERT_EQUAL((size_t)10, dc.getSize());
+  // Overlapped data supersedes cached data.
+  p.updateWrCache(&dc, reinterpret_cast<const unsigned char*>("FG"), 2, 15);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL(std::string("abcdefghij"),
+                       writer_->getString().substr(10));
+  p.flushWrCache(&dc);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL(std::string("abcdeFGhij"),
+                       writer_->getString().substr(10));
+
+  p.updateWrCache(&dc, reinterpret_cast<const unsigned char*>("xyz"), 3, 10);
+  p.clearWrCache(&dc);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL(std::string("abcdeFGhij"),
+                       writer_->getString().substr(10));
+
+  p.updateWrCache(&dc, reinterpret_cast<const unsigned char*>("xyz"), 3, 10);
+  p.releaseWrCache(&dc);
+  CPPUNIT_ASSERT(!p.getWrDiskCacheEntry());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.getSize());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, dc.countEntry());
+}
+
+} // namespace aria2
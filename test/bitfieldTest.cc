@@ -1,7 +1,13 @@
 #include "bitfield.h"
 
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
 #include <cppunit/extensions/HelperMacros.h>
 
+#include "array_fun.h"
+
 namespace aria2 {
 
 class bitfieldTest:public CppUnit::TestFixture {
@@ -10,7 +16,11 @@ class bitfieldTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testTest);
   CPPUNIT_TEST(testCountBit32);
   CPPUNIT_TEST(testCountSetBit);
+  CPPUNIT_TEST(testCountSetBit_expr);
+  CPPUNIT_TEST(testCountBits);
   CPPUNIT_TEST(testLastByteMask);
+  CPPUNIT_TEST(testFindFirstSet);
+  CPPUNIT_TEST(testGetFirstNMissingIndex);
   CPPUNIT_TEST_SUITE_END();
 private:
 
@@ -18,7 +28,11 @@ public:
   void testTest();
   void testCountBit32();
   void testCountSetBit();
+  void testCountSetBit_expr();
+  void testCountBits();
   void testLastByteMask();
+  void testFindFirstSet();
+  void testGetFirstNMissingIndex();
 };
 
 
@@ -54,6 +68,108 @@ void bitfieldTest::testCountSetBit()
   CPPUNIT_ASSERT_EQUAL((size_t)0, bitfield::countSetBit(bitfield, 0));
 }
 
+void bitfieldTest::testCountSetBit_expr()
+{
+  // Large enough to use several chunks of words.
+  const size_t nbits = 64*100+13;
+  unsigned char a[(nbits+7)/8];
+  unsigned char b[(nbits+7)/8];
+  for(size_t i = 0; i < sizeof(a); ++i) {
+    a[i] = i*7;
+    b[i] = i*13+1;
+  }
+  size_t expected = 0;
+  for(size_t i = 0; i < nbits; ++i) {
+    if(bitfield::test(a, nbits, i) && !bitfield::test(b, nbits, i)) {
+      ++expected;
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL
+    (expected,
+     bitfield::countSetBit(expr::array(a)&~expr::array(b), nbits));
+}
+
+void bitfieldTest::testCountBits()
+{
+  unsigned char data[1000];
+  for(size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = i*31+i/3;
+  }
+  // Lengths around the boundaries of 8 and 32 bytes.
+  size_t lens[] = { 0, 1, 7, 8, 9, 31, 32, 33, 63, 64, 65, 999 };
+  for(size_t i = 0; i < A2_ARRAY_LEN(lens); ++i) {
+    // Unaligned data
+    for(size_t offset = 0; offset < 2; ++offset) {
+      size_t expected = 0;
+      for(size_t j = 0; j < lens[i]; ++j) {
+        expected += bitfield::countBit32(data[offset+j]);
+      }
+      CPPUNIT_ASSERT_EQUAL(expected,
+                           bitfield::countBits(data+offset, lens[i]));
+    }
+  }
+}
+
+void bitfieldTest::testFindFirstSet()
+{
+  unsigned char bitfield[20];
+  memset(bitfield, 0, sizeof(bitfield));
+  const size_t nbits = 155;
+  CPPUNIT_ASSERT_EQUAL(nbits, bitfield::findFirstSet(bitfield, 0, nbits));
+  bitfield::flipBit(bitfield, sizeof(bitfield), 3);
+  bitfield::flipBit(bitfield, sizeof(bitfield), 63);
+  bitfield::flipBit(bitfield, sizeof(bitfield), 64);
+  bitfield::flipBit(bitfield, sizeof(bitfield), 130);
+  bitfield::flipBit(bitfield, sizeof(bitfield), 154);
+  // Beyond nbits
+  bitfield::flipBit(bitfield, sizeof(bitfield), 155);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, bitfield::findFirstSet(bitfield, 0, nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)3, bitfield::findFirstSet(bitfield, 3, nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)63, bitfield::findFirstSet(bitfield, 4, nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)64,
+                       bitfield::findFirstSet(bitfield, 64, nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)130,
+                       bitfield::findFirstSet(bitfield, 65, nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)154,
+                       bitfield::findFirstSet(bitfield, 131, nbits));
+  CPPUNIT_ASSERT_EQUAL(nbits, bitfield::findFirstSet(bitfield, 155, nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)130,
+                       bitfield::findFirstSet(bitfield, 65, 131));
+  CPPUNIT_ASSERT_EQUAL((size_t)130,
+                       bitfield::findFirstSet(bitfield, 65, 130));
+  // Expression
+  CPPUNIT_ASSERT_EQUAL((size_t)0,
+                       bitfield::findFirstSet(~expr::array(bitfield), 0,
+                                              nbits));
+  CPPUNIT_ASSERT_EQUAL((size_t)65,
+                       bitfield::findFirstSet(~expr::array(bitfield), 63,
+                                              nbits));
+}
+
+void bitfieldTest::testGetFirstNMissingIndex()
+{
+  unsigned char bitfield[20];
+  memset(bitfield, 0, sizeof(bitfield));
+  const size_t nbits = 155;
+  size_t indexes[] = { 0, 7, 8, 63, 64, 100, 154 };
+  for(size_t i = 0; i < A2_ARRAY_LEN(indexes); ++i) {
+    bitfield::flipBit(bitfield, sizeof(bitfield), indexes[i]);
+  }
+  std::vector<size_t> out;
+  CPPUNIT_ASSERT_EQUAL
+    ((size_t)4, bitfield::getFirstNMissingIndex
+     (std::back_inserter(out), 4, bitfield, nbits));
+  CPPUNIT_ASSERT(std::equal(out.begin(), out.end(), indexes));
+  out.clear();
+  CPPUNIT_ASSERT_EQUAL
+    ((size_t)7, bitfield::getFirstNMissingIndex
+     (std::back_inserter(out), 100, bitfield, nbits));
+  CPPUNIT_ASSERT(std::equal(out.begin(), out.end(), indexes));
+  CPPUNIT_ASSERT_EQUAL
+    ((size_t)0, bitfield::getFirstNMissingIndex
+     (std::back_inserter(out), 0, bitfield, nbits));
+}
+
 void bitfieldTest::testLastByteMask()
 {
   CPPUNIT_ASSERT_EQUAL((unsigned int)0,